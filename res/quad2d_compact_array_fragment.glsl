@@ -0,0 +1,15 @@
+#version 430 core
+
+// Samples the sprite_atlas layer each compact quad carries with its cell.
+uniform sampler2DArray u_texture_index;
+in vec2 v_texture_uv;
+in vec4 v_color;
+flat in uint v_layer;
+out vec4 fragment_color;
+
+void main()
+{
+
+    fragment_color = texture(u_texture_index, vec3(v_texture_uv, float(v_layer))) * v_color;
+
+}
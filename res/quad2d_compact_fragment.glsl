@@ -0,0 +1,14 @@
+#version 430 core
+
+uniform sampler2D u_texture_index;
+in vec2 v_texture_uv;
+in vec4 v_color;
+out vec4 fragment_color;
+
+void main()
+{
+
+    fragment_color = texture(u_texture_index, v_texture_uv) * v_color;
+
+}
+
@@ -0,0 +1,53 @@
+#version 430 core
+
+// Each uvec4 is one quad_compact_layout: position, scale, rotation and cell, tint.
+layout (std430, binding = 1) readonly buffer quad_compact_instances
+{
+    uvec4 u_instances[];
+};
+
+layout (std140, binding = 0) uniform quad_atlas
+{
+    vec4 u_atlas_cells[1024];
+};
+
+layout (std140, binding = 1) uniform quad_frame
+{
+    mat4 u_projection;
+    mat4 u_camera;
+    mat4 u_view_projection;
+};
+
+out vec2 v_texture_uv;
+out vec4 v_color;
+flat out uint v_layer;
+
+const vec2 quad_corners[4] = vec2[4](
+    vec2(0.0f, 0.0f), vec2(0.0f, 1.0f), vec2(1.0f, 1.0f), vec2(1.0f, 0.0f));
+
+void main()
+{
+
+    uvec4 instance = u_instances[gl_VertexID >> 2];
+    vec2 corner = quad_corners[gl_VertexID & 3];
+
+    int packed_position = int(instance.x);
+    vec2 position = vec2(bitfieldExtract(packed_position, 0, 16),
+            bitfieldExtract(packed_position, 16, 16)) * 0.125f;
+    vec2 scale = unpackHalf2x16(instance.y);
+    float angle = float(instance.z & 0xFFFFu) * (6.28318530718f / 65536.0f);
+    float c = cos(angle);
+    float s = sin(angle);
+
+    vec2 local = (corner - 0.5f) * scale;
+    vec2 rotated = vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    vec4 cell = u_atlas_cells[bitfieldExtract(instance.z, 16, 10)];
+    v_texture_uv = cell.xy + corner * cell.zw;
+    v_color = unpackUnorm4x8(instance.w);
+    v_layer = instance.z >> 26;
+
+    gl_Position = u_view_projection * vec4(rotated + position, 0.0f, 1.0f);
+
+}
+
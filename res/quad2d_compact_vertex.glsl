@@ -0,0 +1,47 @@
+#version 430 core
+layout (location = 0) in vec2 in_position;
+layout (location = 1) in vec2 in_texture_coordinates;
+layout (location = 2) in vec2 v_position;
+layout (location = 3) in vec2 v_scale;
+layout (location = 4) in uvec2 v_rotation_cell;
+layout (location = 5) in vec4 v_tint;
+
+// Cells are (offset.xy, dimension.xy) in normalized texture coordinates.
+layout (std140, binding = 0) uniform quad_atlas
+{
+    vec4 u_atlas_cells[1024];
+};
+
+layout (std140, binding = 1) uniform quad_frame
+{
+    mat4 u_projection;
+    mat4 u_camera;
+    mat4 u_view_projection;
+};
+
+out vec2 v_texture_uv;
+out vec4 v_color;
+flat out uint v_layer;
+
+void main()
+{
+
+    // Positions arrive as 13.3 fixed point, rotation as a fraction of a turn.
+    vec2 position = v_position * 0.125f;
+    float angle = float(v_rotation_cell.x) * (6.28318530718f / 65536.0f);
+    float c = cos(angle);
+    float s = sin(angle);
+
+    vec2 local = in_position * v_scale;
+    vec2 rotated = vec2(local.x * c - local.y * s, local.x * s + local.y * c);
+
+    // The low ten bits pick the cell, the rest the texture array layer.
+    vec4 cell = u_atlas_cells[v_rotation_cell.y & 0x3FFu];
+    v_texture_uv = cell.xy + in_texture_coordinates * cell.zw;
+    v_color = v_tint;
+    v_layer = v_rotation_cell.y >> 10;
+
+    gl_Position = u_projection * u_camera * vec4(rotated + position, 0.0f, 1.0f);
+
+}
+
@@ -0,0 +1,67 @@
+#version 430 core
+layout (local_size_x = 256) in;
+
+struct quad_instance
+{
+    vec2 position;
+    vec2 scale;
+    vec2 texture_offset;
+    vec2 texture_dimension;
+};
+
+layout (std430, binding = 1) readonly buffer quad_instances
+{
+    quad_instance u_instances[];
+};
+
+layout (std430, binding = 2) writeonly buffer quad_visible_instances
+{
+    quad_instance u_visible[];
+};
+
+// Laid out as the DrawElementsIndirectCommand, the instance count is the cursor
+// survivors are appended at.
+layout (std430, binding = 3) buffer quad_draw_command
+{
+    uint u_element_count;
+    uint u_instance_count;
+    uint u_first_index;
+    int u_base_vertex;
+    uint u_base_instance;
+};
+
+uniform uint u_quad_count;
+uniform vec4 u_view;            // min.xy, max.xy
+
+shared uint group_visible;
+shared uint group_base;
+
+void main()
+{
+
+    if (gl_LocalInvocationIndex == 0) group_visible = 0;
+    barrier();
+
+    // Survivors take a slot in the group first, then the group takes one range
+    // of the output, so there's one global atomic per group.
+    uint index = gl_GlobalInvocationID.x;
+    bool visible = false;
+    uint local_slot = 0;
+    quad_instance quad;
+    if (index < u_quad_count)
+    {
+        quad = u_instances[index];
+        vec2 half_extent = abs(quad.scale) * 0.5f;
+        visible = all(greaterThanEqual(quad.position + half_extent, u_view.xy)) &&
+            all(lessThanEqual(quad.position - half_extent, u_view.zw));
+        if (visible) local_slot = atomicAdd(group_visible, 1u);
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex == 0 && group_visible > 0)
+        group_base = atomicAdd(u_instance_count, group_visible);
+    barrier();
+
+    if (visible) u_visible[group_base + local_slot] = quad;
+
+}
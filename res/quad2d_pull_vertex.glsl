@@ -0,0 +1,45 @@
+#version 430 core
+
+// Matches quad_layout, 32 bytes under std430.
+struct quad_instance
+{
+    vec2 position;
+    vec2 scale;
+    vec2 texture_offset;
+    vec2 texture_dimensions;
+};
+
+layout (std430, binding = 1) readonly buffer quad_instances
+{
+    quad_instance u_instances[];
+};
+
+layout (std140, binding = 1) uniform quad_frame
+{
+    mat4 u_projection;
+    mat4 u_camera;
+    mat4 u_view_projection;
+};
+
+out vec2 v_texture_uv;
+out vec2 v_original_uv;
+
+// Same corner order as the instanced mesh: bottom left, top left, top right,
+// bottom right.
+const vec2 quad_corners[4] = vec2[4](
+    vec2(0.0f, 0.0f), vec2(0.0f, 1.0f), vec2(1.0f, 1.0f), vec2(1.0f, 0.0f));
+
+void main()
+{
+
+    quad_instance instance = u_instances[gl_VertexID >> 2];
+    vec2 corner = quad_corners[gl_VertexID & 3];
+
+    v_texture_uv = instance.texture_offset + corner * instance.texture_dimensions;
+    v_original_uv = corner;
+
+    vec2 world = (corner - 0.5f) * instance.scale + instance.position;
+    gl_Position = u_view_projection * vec4(world, 0.0f, 1.0f);
+
+}
+
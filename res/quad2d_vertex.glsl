@@ -6,8 +6,12 @@ layout (location = 3) in vec2 v_scale;
 layout (location = 4) in vec2 v_texture_offset;
 layout (location = 5) in vec2 v_texture_dimensions;
 
-uniform mat4 u_projection;
-uniform mat4 u_camera;
+layout (std140, binding = 1) uniform quad_frame
+{
+    mat4 u_projection;
+    mat4 u_camera;
+    mat4 u_view_projection;
+};
 
 out vec2 v_texture_uv;
 out vec2 v_original_uv;
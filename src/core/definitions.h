@@ -1,7 +1,9 @@
 #ifndef SRC_CORE_DEFINITIONS_H
 #define SRC_CORE_DEFINITIONS_H
 #include <stdio.h>
+#if defined(_WIN32)
 #include <conio.h>
+#endif
 #include <stdint.h>
 #include <stdbool.h>
 #include <assert.h>
@@ -0,0 +1,213 @@
+#include <core/jobs.h>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#define JOBS_MAX_WORKERS 64
+
+typedef struct job_dispatch
+{
+    job_range_proc proc;
+    vptr user_data;
+    u64 count;
+    u64 batch_size;
+    std::atomic<u64> next;
+    std::atomic<u64> completed;
+} job_dispatch;
+
+typedef struct job_system_state
+{
+    std::thread workers[JOBS_MAX_WORKERS];
+    u32 worker_count;
+    b32 initialized;
+    b32 shutdown;
+
+    std::mutex dispatch_lock;
+    std::mutex signal_lock;
+    std::condition_variable signal_start;
+    std::condition_variable signal_finish;
+    u64 generation;
+    u32 workers_active;
+
+    job_dispatch current;
+} job_system_state;
+
+static inline job_system_state* get_job_system_state() { static job_system_state js; return &js; }
+static thread_local b32 job_thread_is_inside_job = false;
+static thread_local u32 job_thread_worker_index = 0;
+static thread_local b32 job_thread_owns_dispatch = false;
+
+static inline void
+jobs_execute_batches(job_dispatch *dispatch, u32 worker_index)
+{
+
+    job_thread_is_inside_job = true;
+    job_thread_worker_index = worker_index;
+
+    for (;;)
+    {
+
+        u64 begin = dispatch->next.fetch_add(dispatch->batch_size, std::memory_order_relaxed);
+        if (begin >= dispatch->count) break;
+
+        u64 end = begin + dispatch->batch_size;
+        if (end > dispatch->count) end = dispatch->count;
+
+        dispatch->proc(dispatch->user_data, begin, end, worker_index);
+        dispatch->completed.fetch_add(end - begin, std::memory_order_acq_rel);
+
+    }
+
+    job_thread_is_inside_job = false;
+
+}
+
+static void
+jobs_worker_main(u32 worker_index)
+{
+
+    job_system_state *state = get_job_system_state();
+    u64 seen_generation = 0;
+
+    for (;;)
+    {
+
+        {
+            std::unique_lock<std::mutex> lock(state->signal_lock);
+            state->signal_start.wait(lock, [&]{
+                return state->shutdown || state->generation != seen_generation;
+            });
+            if (state->shutdown) return;
+            seen_generation = state->generation;
+            state->workers_active++;
+        }
+
+        jobs_execute_batches(&state->current, worker_index);
+
+        {
+            std::lock_guard<std::mutex> lock(state->signal_lock);
+            state->workers_active--;
+        }
+        state->signal_finish.notify_all();
+
+    }
+
+}
+
+b32
+jobs_initialize(u32 worker_count)
+{
+
+    job_system_state *state = get_job_system_state();
+    if (state->initialized) return true;
+
+    // By default, leave one hardware thread for the calling thread.
+    if (worker_count == 0)
+    {
+        u32 hardware_threads = std::thread::hardware_concurrency();
+        worker_count = (hardware_threads > 1) ? hardware_threads - 1 : 0;
+    }
+
+    if (worker_count > JOBS_MAX_WORKERS) worker_count = JOBS_MAX_WORKERS;
+
+    state->shutdown = false;
+    state->generation = 0;
+    state->workers_active = 0;
+    state->worker_count = worker_count;
+    for (u32 i = 0; i < worker_count; ++i)
+        state->workers[i] = std::thread(jobs_worker_main, i + 1);
+
+    state->initialized = true;
+    return true;
+
+}
+
+void
+jobs_shutdown()
+{
+
+    job_system_state *state = get_job_system_state();
+    if (!state->initialized) return;
+
+    {
+        std::lock_guard<std::mutex> lock(state->signal_lock);
+        state->shutdown = true;
+    }
+    state->signal_start.notify_all();
+
+    for (u32 i = 0; i < state->worker_count; ++i)
+        state->workers[i].join();
+
+    state->worker_count = 0;
+    state->initialized = false;
+
+}
+
+u32
+jobs_worker_count()
+{
+
+    job_system_state *state = get_job_system_state();
+    return state->worker_count + 1;
+
+}
+
+void
+jobs_parallel_for(u64 count, u64 batch_size, job_range_proc proc, vptr user_data)
+{
+
+    NX_ENSURE_POINTER(proc);
+    if (count == 0) return;
+    if (batch_size == 0) batch_size = 1;
+
+    job_system_state *state = get_job_system_state();
+
+    // Nested inside a job, the thread keeps the index of the job it's in; no
+    // other thread uses it until that job returns.
+    if (job_thread_is_inside_job)
+    {
+        proc(user_data, 0, count, job_thread_worker_index);
+        return;
+    }
+
+    // Index zero belongs to whoever holds the dispatch lock, so every other
+    // dispatch waits for it, even the ones done here in a single batch. Those
+    // keep the lock while they run, and may dispatch again from inside.
+    std::unique_lock<std::mutex> dispatch_guard(state->dispatch_lock, std::defer_lock);
+    if (!job_thread_owns_dispatch) dispatch_guard.lock();
+    if (!state->initialized || state->worker_count == 0 || count <= batch_size)
+    {
+        b32 owned = job_thread_owns_dispatch;
+        job_thread_owns_dispatch = true;
+        proc(user_data, 0, count, 0);
+        job_thread_owns_dispatch = owned;
+        return;
+    }
+
+    // A worker which woke late for the previous dispatch may still be looking at
+    // it, so wait for it to leave before the dispatch is overwritten.
+    job_dispatch *dispatch = &state->current;
+    {
+        std::unique_lock<std::mutex> lock(state->signal_lock);
+        state->signal_finish.wait(lock, [&]{ return state->workers_active == 0; });
+
+        dispatch->proc          = proc;
+        dispatch->user_data     = user_data;
+        dispatch->count         = count;
+        dispatch->batch_size    = batch_size;
+        dispatch->next.store(0, std::memory_order_relaxed);
+        dispatch->completed.store(0, std::memory_order_relaxed);
+        state->generation++;
+    }
+    state->signal_start.notify_all();
+
+    jobs_execute_batches(dispatch, 0);
+
+    // Wait for any stragglers still working on their last batch.
+    std::unique_lock<std::mutex> lock(state->signal_lock);
+    state->signal_finish.wait(lock, [&]{
+        return dispatch->completed.load(std::memory_order_acquire) == count;
+    });
+
+}
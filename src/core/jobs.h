@@ -0,0 +1,32 @@
+#ifndef SRC_CORE_JOBS_H
+#define SRC_CORE_JOBS_H
+#include <core/definitions.h>
+
+// --- Job System --------------------------------------------------------------
+//
+// A small fixed-size worker pool used by engine subsystems to split data-parallel
+// work across cores. The pool is created once at init and lives for the duration
+// of the application. Work is handed out as ranges of [begin, end) in batches,
+// the calling thread participates in the work and the call returns only once the
+// whole range has been processed.
+//
+// Worker indices are stable for the lifetime of the pool; index zero is always
+// the thread which issued the dispatch. No two threads run with the same index
+// at the same time, which lets callers keep per-thread scratch space indexed by
+// worker, jobs_worker_count() entries of it, without any locking.
+//
+// Dispatches issued from inside a job run inline on the calling thread, with the
+// index of the job they're in; scratch for that index may already be in use by
+// the outer job, on the same thread. Dispatches from several threads outside of
+// jobs are serialized: a second one waits for the first to finish, even when it
+// would run in a single batch. Never dispatch while holding a lock a job needs.
+//
+
+typedef void (*job_range_proc)(vptr user_data, u64 begin, u64 end, u32 worker_index);
+
+b32     jobs_initialize(u32 worker_count);
+void    jobs_shutdown();
+u32     jobs_worker_count();
+void    jobs_parallel_for(u64 count, u64 batch_size, job_range_proc proc, vptr user_data);
+
+#endif
@@ -2,5 +2,5 @@
 #define SRC_CORE_LINEAR_H
 #include <math.h>
 #include <core/definitions.h>
-#include <handmademath/HandMadeMath.h>
+#include <handmademath/HandmadeMath.h>
 #endif
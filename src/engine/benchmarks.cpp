@@ -0,0 +1,1575 @@
+#include <engine/benchmarks.h>
+#include <engine/particles.h>
+#include <engine/ecs.h>
+#include <engine/spatialgrid.h>
+#include <engine/sweepprune.h>
+#include <engine/physics2d.h>
+#include <engine/renderers/quad2d.h>
+#include <engine/renderers/quadcull.h>
+#include <engine/renderers/spritebatch.h>
+#include <engine/renderers/commandbuffer.h>
+#include <engine/renderers/uniformring.h>
+#include <engine/renderers/quadraster.h>
+#include <platform/system.h>
+#include <core/jobs.h>
+
+#define BENCHMARK_FRAMES 120
+
+typedef struct benchmark_timer
+{
+    r64 total;
+    r64 minimum;
+    r64 maximum;
+    u64 samples;
+} benchmark_timer;
+
+static inline void
+benchmark_timer_reset(benchmark_timer *timer)
+{
+
+    timer->total = 0.0;
+    timer->minimum = 1e30;
+    timer->maximum = 0.0;
+    timer->samples = 0;
+
+}
+
+static inline void
+benchmark_timer_record(benchmark_timer *timer, u64 begin, u64 end)
+{
+
+    r64 elapsed = system_timestamp_difference_ms(begin, end);
+    timer->total += elapsed;
+    timer->minimum = (elapsed < timer->minimum) ? elapsed : timer->minimum;
+    timer->maximum = (elapsed > timer->maximum) ? elapsed : timer->maximum;
+    timer->samples++;
+
+}
+
+static inline void
+benchmark_timer_report(benchmark_timer *timer, ccptr name, u64 items)
+{
+
+    r64 average = timer->total / (r64)timer->samples;
+    printf("--      %-32s : avg %8.3f ms, min %8.3f ms, max %8.3f ms, %8.2f M/s\n",
+            name, average, timer->minimum, timer->maximum,
+            ((r64)items / (average / 1000.0)) / 1000000.0);
+
+}
+
+// --- Particles ---------------------------------------------------------------
+
+void
+benchmark_particles(memory_arena *arena)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 particle_count = 1 << 20;
+
+    printf("-- Particle Benchmark (%llu particles, %u threads)\n",
+            particle_count, jobs_worker_count());
+
+    // The particle system only touches the instance array, so no GL objects
+    // are required for the output buffer here.
+    quad_render_buffer output = {0};
+    output.vertex_buffer = memory_arena_push_array(arena, quad_layout, particle_count);
+    output.vertex_buffer_size = sizeof(quad_layout) * particle_count;
+    output.vertex_buffer_count = particle_count;
+    output.instance_stride = sizeof(quad_layout);
+
+    particle_emitter_description description = {0};
+    description.position        = { 640.0f, 360.0f };
+    description.spawn_extent    = { 740.0f, 460.0f };
+    description.spawn_limit     = (u32)particle_count;
+    description.capacity        = (u32)particle_count;
+    description.velocity_min    = { -32.0f, -128.0f };
+    description.velocity_max    = {  32.0f,  -64.0f };
+    description.acceleration    = { 0.0f, -9.8f };
+    description.scale_min       = 8.0f;
+    description.scale_max       = 32.0f;
+    description.velocity_curve  = particle_curve_constant(1.0f);
+    description.scale_curve     = particle_curve_linear(1.0f, 0.0f);
+    description.color_curve     = particle_color_curve_linear({ 1.0f, 1.0f, 1.0f, 1.0f },
+                                    { 1.0f, 1.0f, 1.0f, 0.0f });
+    description.atlas_columns   = 8;
+    description.atlas_rows      = 8;
+    description.frame_count     = 64;
+    description.frame_mode      = PARTICLE_FRAME_RANDOM;
+
+    benchmark_timer timer;
+    r32 delta_time = 1.0f / 60.0f;
+
+    // Steady state, nothing dies so this measures integration and compaction.
+    {
+
+        description.lifetime_min = 1000.0f;
+        description.lifetime_max = 2000.0f;
+        description.spawn_rate = 0.0f;
+
+        particle_system system = {0};
+        particle_system_create(&system, arena, 1, particle_count, particle_count);
+        particle_emitter *emitter = particle_system_add_emitter(&system, arena, &description);
+        particle_emitter_burst(&system, emitter, particle_count);
+
+        benchmark_timer_reset(&timer);
+        for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+        {
+            u64 begin = system_timestamp();
+            particle_system_update(&system, delta_time, &output, 0);
+            u64 end = system_timestamp();
+            benchmark_timer_record(&timer, begin, end);
+        }
+
+        benchmark_timer_report(&timer, "Update (steady)", system.live_count);
+
+    }
+
+    // Churn, roughly two percent of the particles die and respawn every frame.
+    {
+
+        description.lifetime_min = 0.5f;
+        description.lifetime_max = 1.5f;
+        description.spawn_rate = (r32)particle_count;
+
+        particle_system system = {0};
+        particle_system_create(&system, arena, 1, particle_count, particle_count);
+        particle_emitter *emitter = particle_system_add_emitter(&system, arena, &description);
+        particle_emitter_burst(&system, emitter, particle_count);
+
+        benchmark_timer_reset(&timer);
+        u64 spawned = 0;
+        u64 killed = 0;
+        for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+        {
+            u64 begin = system_timestamp();
+            particle_system_update(&system, delta_time, &output, 0);
+            u64 end = system_timestamp();
+            benchmark_timer_record(&timer, begin, end);
+            spawned += system.spawned_count;
+            killed += system.killed_count;
+        }
+
+        benchmark_timer_report(&timer, "Update (churn)", system.live_count);
+        printf("--      %-32s : %llu live, %llu spawned/frame, %llu killed/frame\n", "Churn Statistics",
+                system.live_count, spawned / BENCHMARK_FRAMES, killed / BENCHMARK_FRAMES);
+
+    }
+
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Spatial Grid ------------------------------------------------------------
+
+void
+benchmark_spatial_grid(memory_arena *arena)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 entry_count = 1 << 20;
+    u32 query_count = 10000;
+    u64 max_results = NX_KILOBYTES(64);
+    u64 max_pairs = entry_count * 8;
+
+    printf("-- Spatial Grid Benchmark (%llu entries, %u threads)\n",
+            entry_count, jobs_worker_count());
+
+    // A world about the size of the demo quads scattered over a 16K square,
+    // roughly four entries per 32 pixel cell.
+    r32 world_size = 16384.0f;
+    r32 *position_x = memory_arena_push_array(arena, r32, entry_count);
+    r32 *position_y = memory_arena_push_array(arena, r32, entry_count);
+    r32 *half_extent = memory_arena_push_array(arena, r32, entry_count);
+    u32 *results = memory_arena_push_array(arena, u32, max_results);
+    spatial_grid_pair *pairs = memory_arena_push_array(arena, spatial_grid_pair, max_pairs);
+
+    u64 seed = 0x853C49E6748FEA9BULL;
+    for (u64 i = 0; i < entry_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        position_x[i] = (r32)((seed >> 40) & 0xFFFFFF) / 16777216.0f * world_size;
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        position_y[i] = (r32)((seed >> 40) & 0xFFFFFF) / 16777216.0f * world_size;
+        half_extent[i] = 4.0f + (r32)((seed >> 20) & 0xF) * (12.0f / 15.0f);
+    }
+
+    spatial_grid grid = {0};
+    spatial_grid_create(&grid, arena, entry_count, 32.0f);
+
+    benchmark_timer timer;
+    benchmark_timer_reset(&timer);
+    for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+    {
+        u64 begin = system_timestamp();
+        spatial_grid_rebuild(&grid, position_x, position_y, half_extent, entry_count);
+        u64 end = system_timestamp();
+        benchmark_timer_record(&timer, begin, end);
+    }
+    benchmark_timer_report(&timer, "Rebuild", entry_count);
+
+    // Each query batch is timed as a whole, reported per batch.
+    u64 hits = 0;
+    benchmark_timer_reset(&timer);
+    for (u32 frame = 0; frame < 8; ++frame)
+    {
+        u64 begin = system_timestamp();
+        for (u32 q = 0; q < query_count; ++q)
+        {
+            vec2 point = { position_x[q * 97] + 1.0f, position_y[q * 97] - 1.0f };
+            hits += spatial_grid_query_point(&grid, point, results, max_results);
+        }
+        u64 end = system_timestamp();
+        benchmark_timer_record(&timer, begin, end);
+    }
+    benchmark_timer_report(&timer, "Point Queries (10K)", query_count);
+    printf("--      %-32s : %.2f\n", "Average Point Hits", (r64)hits / (8.0 * query_count));
+
+    hits = 0;
+    benchmark_timer_reset(&timer);
+    for (u32 frame = 0; frame < 8; ++frame)
+    {
+        u64 begin = system_timestamp();
+        for (u32 q = 0; q < query_count; ++q)
+        {
+            vec2 min = { position_x[q * 89], position_y[q * 89] };
+            vec2 max = { min.X + 256.0f, min.Y + 256.0f };
+            hits += spatial_grid_query_rect(&grid, min, max, results, max_results);
+        }
+        u64 end = system_timestamp();
+        benchmark_timer_record(&timer, begin, end);
+    }
+    benchmark_timer_report(&timer, "Rect Queries (10K, 256px)", query_count);
+    printf("--      %-32s : %.2f\n", "Average Rect Hits", (r64)hits / (8.0 * query_count));
+
+    hits = 0;
+    benchmark_timer_reset(&timer);
+    for (u32 frame = 0; frame < 8; ++frame)
+    {
+        u64 begin = system_timestamp();
+        for (u32 q = 0; q < query_count; ++q)
+        {
+            vec2 center = { position_x[q * 83], position_y[q * 83] };
+            hits += spatial_grid_query_circle(&grid, center, 128.0f, results, max_results);
+        }
+        u64 end = system_timestamp();
+        benchmark_timer_record(&timer, begin, end);
+    }
+    benchmark_timer_report(&timer, "Circle Queries (10K, r128)", query_count);
+    printf("--      %-32s : %.2f\n", "Average Circle Hits", (r64)hits / (8.0 * query_count));
+
+    u64 pair_count = 0;
+    benchmark_timer_reset(&timer);
+    for (u32 frame = 0; frame < 8; ++frame)
+    {
+        u64 begin = system_timestamp();
+        pair_count = spatial_grid_find_pairs(&grid, pairs, max_pairs);
+        u64 end = system_timestamp();
+        benchmark_timer_record(&timer, begin, end);
+    }
+    benchmark_timer_report(&timer, "Pair Enumeration", entry_count);
+    printf("--      %-32s : %llu\n", "Overlapping Pairs", pair_count);
+
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Sweep and Prune ---------------------------------------------------------
+
+void
+benchmark_sweep_prune(memory_arena *arena)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u32 body_counts[] = { 10000, 100000 };
+
+    printf("-- Sweep and Prune Benchmark\n");
+
+    for (u32 run = 0; run < NX_ARRSIZE(body_counts); ++run)
+    {
+
+        u64 run_state = memory_arena_save(arena);
+        u32 body_count = body_counts[run];
+
+        // Same density and mix of 8 to 32 pixel sprites as the quad demo, in a
+        // square world scaled with the body count.
+        r32 world_size = sqrtf((r32)body_count) * 40.0f;
+        quad_layout *quads = memory_arena_push_array(arena, quad_layout, body_count);
+        r32 *velocity = memory_arena_push_array(arena, r32, body_count);
+
+        u64 seed = 0x2545F4914F6CDD1DULL;
+        for (u32 i = 0; i < body_count; ++i)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            r32 x = (r32)((seed >> 40) & 0xFFFFFF) / 16777216.0f * world_size;
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            r32 y = (r32)((seed >> 40) & 0xFFFFFF) / 16777216.0f * world_size;
+            r32 scale = 8.0f + (r32)((seed >> 16) & 0xFF) * (24.0f / 255.0f);
+            quads[i].transform.position = { x, y };
+            quads[i].transform.scale = { scale, scale };
+            velocity[i] = -64.0f - (r32)((seed >> 8) & 0xFF) * 0.25f;
+        }
+
+        sweep_prune sap = {0};
+        sweep_prune_create(&sap, arena, body_count);
+        sweep_prune_update_from_quads(&sap, quads, body_count);
+        sweep_prune_sort(&sap);
+
+        benchmark_timer update_timer;
+        benchmark_timer sweep_timer;
+        benchmark_timer_reset(&update_timer);
+        benchmark_timer_reset(&sweep_timer);
+        u64 pair_count = 0;
+        u64 shift_count = 0;
+
+        for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+        {
+
+            // Sprites drift along both axes so the x order actually changes.
+            for (u32 i = 0; i < body_count; ++i)
+            {
+                quads[i].transform.position.X += velocity[i] * (1.0f / 60.0f) * ((i & 1) ? 1.0f : -1.0f);
+                quads[i].transform.position.Y += velocity[i] * (1.0f / 60.0f);
+            }
+
+            u64 begin = system_timestamp();
+            sweep_prune_update_from_quads(&sap, quads, body_count);
+            sweep_prune_sort(&sap);
+            u64 middle = system_timestamp();
+            shift_count += sap.last_shift_count;
+
+            u64 pair_state = memory_arena_save(arena);
+            sweep_prune_pair *pairs = NULL;
+            pair_count = sweep_prune_find_pairs(&sap, arena, &pairs);
+            memory_arena_restore(arena, pair_state);
+            u64 end = system_timestamp();
+
+            benchmark_timer_record(&update_timer, begin, middle);
+            benchmark_timer_record(&sweep_timer, middle, end);
+
+        }
+
+        printf("--      %-32s : %u\n", "Bodies", body_count);
+        benchmark_timer_report(&update_timer, "Update + Insertion Sort", body_count);
+        benchmark_timer_report(&sweep_timer, "SIMD Sweep", body_count);
+        printf("--      %-32s : %llu pairs, %llu shifts/frame\n", "Statistics",
+                pair_count, shift_count / BENCHMARK_FRAMES);
+
+        // Dropping the second half of the quads has to drop their pairs with
+        // them, and bringing them back has to find the same pairs again.
+        u64 pair_state = memory_arena_save(arena);
+        sweep_prune_pair *pairs = NULL;
+        sweep_prune_update_from_quads(&sap, quads, body_count / 2);
+        u64 half_pair_count = sweep_prune_find_pairs(&sap, arena, &pairs);
+        memory_arena_restore(arena, pair_state);
+        sweep_prune_update_from_quads(&sap, quads, body_count);
+        u64 restored_pair_count = sweep_prune_find_pairs(&sap, arena, &pairs);
+        memory_arena_restore(arena, pair_state);
+
+        NX_ASSERT(half_pair_count < pair_count);
+        NX_ASSERT(restored_pair_count == pair_count);
+        printf("--      %-32s : %llu pairs at half the bodies, %llu restored\n", "Shrinking",
+                half_pair_count, restored_pair_count);
+
+        memory_arena_restore(arena, run_state);
+
+    }
+
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Physics 2D --------------------------------------------------------------
+
+void
+benchmark_physics2d(memory_arena *arena)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u32 body_counts[] = { 10000, 100000 };
+
+    printf("-- Physics 2D Benchmark (%u threads)\n", jobs_worker_count());
+
+    for (u32 run = 0; run < NX_ARRSIZE(body_counts); ++run)
+    {
+
+        u64 run_state = memory_arena_save(arena);
+        u32 body_count = body_counts[run];
+
+        // Bodies rain onto a field of small static platforms, one per sixteen
+        // bodies, so the contacts split into many islands like a level would.
+        u32 columns = (u32)sqrtf((r32)body_count);
+        u32 platform_count = body_count / 16;
+        u32 platform_columns = (u32)sqrtf((r32)platform_count);
+        r32 spacing = 24.0f;
+        r32 world_size = (r32)columns * spacing;
+
+        physics_world world = {0};
+        physics_world_create(&world, arena, body_count + platform_count + 4, body_count,
+                (u64)(body_count + platform_count) * 512);
+
+        r32 platform_spacing = world_size / (r32)platform_columns;
+        for (u32 i = 0; i < platform_count; ++i)
+        {
+            r32 x = ((r32)(i % platform_columns) + 0.5f) * platform_spacing;
+            r32 y = ((r32)(i / platform_columns) + 0.25f) * platform_spacing;
+            physics_body_create_box(&world, { x, y }, { platform_spacing * 0.3f, 4.0f }, 0.0f);
+        }
+
+        vec2 triangle[3] = { { -7.0f, -6.0f }, { 7.0f, -6.0f }, { 0.0f, 7.0f } };
+        vec2 hexagon[6] = { {  7.0f, 0.0f }, {  3.5f,  6.062f }, { -3.5f,  6.062f },
+                            { -7.0f, 0.0f }, { -3.5f, -6.062f }, {  3.5f, -6.062f } };
+
+        u64 seed = 0x9E3779B97F4A7C15ULL;
+        for (u32 i = 0; i < body_count; ++i)
+        {
+
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            r32 jitter = (r32)((seed >> 40) & 0xFF) * (4.0f / 255.0f);
+            vec2 position = { ((r32)(i % columns) + 0.5f) * spacing + jitter,
+                              ((r32)(i / columns) + 0.5f) * spacing };
+
+            switch (i & 3)
+            {
+                case 0: physics_body_create_circle(&world, position, 6.0f, 1.0f); break;
+                case 1: physics_body_create_box(&world, position, { 6.0f, 5.0f }, 1.0f); break;
+                case 2: physics_body_create_polygon(&world, position, triangle, 3, 1.0f); break;
+                case 3: physics_body_create_polygon(&world, position, hexagon, 6, 1.0f); break;
+            }
+
+        }
+
+        benchmark_timer timer;
+        benchmark_timer_reset(&timer);
+        u64 contacts = 0;
+        u64 islands = 0;
+        for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+        {
+            u64 begin = system_timestamp();
+            physics_world_step(&world, world.fixed_delta);
+            u64 end = system_timestamp();
+            benchmark_timer_record(&timer, begin, end);
+            contacts += world.contact_count;
+            islands += world.island_count;
+        }
+
+        printf("--      %-32s : %u\n", "Bodies", body_count);
+        benchmark_timer_report(&timer, "Step", body_count);
+        printf("--      %-32s : %llu pairs, %llu contacts/step, %llu islands/step\n", "Statistics",
+                world.pair_count, contacts / BENCHMARK_FRAMES, islands / BENCHMARK_FRAMES);
+
+        memory_arena_restore(arena, run_state);
+
+    }
+
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Entity Component System -------------------------------------------------
+
+typedef struct benchmark_ecs_context
+{
+    u32 position;
+    u32 velocity;
+    u32 lifetime;
+    r32 delta_time;
+    ecs_command_buffer *commands;       // One per worker.
+} benchmark_ecs_context;
+
+static inline r32
+benchmark_ecs_lifetime(u32 key)
+{
+
+    return 0.5f + (r32)((key * 2654435761u) >> 24) * (1.0f / 255.0f);
+
+}
+
+static void
+benchmark_ecs_move(ecs_world *world, ecs_chunk_view *view, vptr user_data, u32 worker_index)
+{
+
+    benchmark_ecs_context *context = (benchmark_ecs_context*)user_data;
+    vec2 *position = (vec2*)ecs_chunk_get_column(view, context->position);
+    vec2 *velocity = (vec2*)ecs_chunk_get_column(view, context->velocity);
+    for (u32 i = 0; i < view->count; ++i)
+    {
+        position[i].X += velocity[i].X * context->delta_time;
+        position[i].Y += velocity[i].Y * context->delta_time;
+    }
+
+}
+
+static void
+benchmark_ecs_expire(ecs_world *world, ecs_chunk_view *view, vptr user_data, u32 worker_index)
+{
+
+    // Expired entities are replaced through the worker's command buffer, since
+    // the chunks can't change while the query is running.
+    benchmark_ecs_context *context = (benchmark_ecs_context*)user_data;
+    ecs_command_buffer *commands = context->commands + worker_index;
+    r32 *lifetime = (r32*)ecs_chunk_get_column(view, context->lifetime);
+    for (u32 i = 0; i < view->count; ++i)
+    {
+
+        lifetime[i] -= context->delta_time;
+        if (lifetime[i] > 0.0f) continue;
+
+        ecs_command_destroy_entity(commands, view->entities[i]);
+        ecs_entity spawned = ecs_command_create_entity(commands, view->archetype->mask);
+        r32 spawned_lifetime = benchmark_ecs_lifetime(view->entities[i] + 1);
+        vec2 spawned_velocity = { 16.0f, -spawned_lifetime * 64.0f };
+        ecs_command_set_component(commands, spawned, context->lifetime, &spawned_lifetime);
+        ecs_command_set_component(commands, spawned, context->velocity, &spawned_velocity);
+
+    }
+
+}
+
+void
+benchmark_ecs(memory_arena *arena)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u32 entity_count = 1 << 18;
+    u32 worker_count = jobs_worker_count();
+
+    printf("-- ECS Benchmark (%u entities, %u threads)\n", entity_count, worker_count);
+
+    ecs_world world = {};
+    ecs_world_create(&world, arena, entity_count * 2, 1024);
+
+    benchmark_ecs_context context = {};
+    context.position    = ecs_component_register(&world, sizeof(vec2), alignof(vec2));
+    context.velocity    = ecs_component_register(&world, sizeof(vec2), alignof(vec2));
+    context.lifetime    = ecs_component_register(&world, sizeof(r32), alignof(r32));
+    context.delta_time  = 1.0f / 60.0f;
+
+    // Half of them live forever, the other half expire and respawn, roughly one
+    // percent of all entities per frame.
+    ecs_mask moving = ECS_COMPONENT_BIT(context.position) | ECS_COMPONENT_BIT(context.velocity);
+    ecs_mask expiring = moving | ECS_COMPONENT_BIT(context.lifetime);
+    for (u32 i = 0; i < entity_count; ++i)
+    {
+        ecs_entity entity = ecs_entity_create(&world, (i & 1) ? expiring : moving);
+        vec2 velocity = { (r32)(i % 64) - 32.0f, -64.0f };
+        r32 lifetime = benchmark_ecs_lifetime(i);
+        ecs_entity_add_component(&world, entity, context.velocity, &velocity);
+        if (i & 1) ecs_entity_add_component(&world, entity, context.lifetime, &lifetime);
+    }
+
+    // Sized for every worker respawning a sixteenth of the expiring entities in
+    // one frame, far more than any frame does.
+    context.commands = memory_arena_push_array(arena, ecs_command_buffer, worker_count);
+    for (u32 i = 0; i < worker_count; ++i)
+        ecs_command_buffer_create(context.commands + i, &world, arena, (u64)entity_count / 32 * 128);
+
+    ecs_query move_query = { moving, 0 };
+    ecs_query expire_query = { ECS_COMPONENT_BIT(context.lifetime), 0 };
+
+    benchmark_timer for_each_timer;
+    benchmark_timer dispatch_timer;
+    benchmark_timer expire_timer;
+    benchmark_timer_reset(&for_each_timer);
+    benchmark_timer_reset(&dispatch_timer);
+    benchmark_timer_reset(&expire_timer);
+    u64 respawned = 0;
+
+    for (u32 frame = 0; frame < BENCHMARK_FRAMES; ++frame)
+    {
+
+        u64 begin = system_timestamp();
+        ecs_query_for_each(&world, &move_query, benchmark_ecs_move, &context);
+        u64 end = system_timestamp();
+        benchmark_timer_record(&for_each_timer, begin, end);
+
+        begin = system_timestamp();
+        ecs_query_dispatch(&world, &move_query, benchmark_ecs_move, &context);
+        end = system_timestamp();
+        benchmark_timer_record(&dispatch_timer, begin, end);
+
+        begin = system_timestamp();
+        ecs_query_dispatch(&world, &expire_query, benchmark_ecs_expire, &context);
+        for (u32 i = 0; i < worker_count; ++i)
+        {
+            respawned += context.commands[i].pending_count;
+            ecs_command_buffer_playback(context.commands + i);
+        }
+        end = system_timestamp();
+        benchmark_timer_record(&expire_timer, begin, end);
+
+    }
+
+    NX_ASSERT(world.live_entity_count == entity_count);
+    benchmark_timer_report(&for_each_timer, "Move (for each)", entity_count);
+    benchmark_timer_report(&dispatch_timer, "Move (dispatch)", entity_count);
+    benchmark_timer_report(&expire_timer, "Expire and respawn", entity_count / 2);
+    printf("--      %-32s : %llu respawned/frame, %u archetypes\n", "Statistics",
+            respawned / BENCHMARK_FRAMES, world.archetype_count);
+
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Quad Upload -------------------------------------------------------------
+
+static void
+benchmark_quad_upload_write(quad_layout *destination, quad_layout *source, u64 count, r32 offset)
+{
+
+    // Stands in for the simulation; the source is only read and the destination
+    // only written, so the destination may be write-combined mapped memory.
+    for (u64 i = 0; i < count; ++i)
+    {
+        quad_layout quad = source[i];
+        quad.transform.position.X += offset;
+        destination[i] = quad;
+    }
+
+}
+
+void
+benchmark_quad_upload(memory_arena *arena, GLuint program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 quad_count = 1 << 20;
+    u32 frame_count = 32;
+
+    printf("-- Quad Upload Benchmark (%llu quads, %llu MB per frame)\n",
+            quad_count, (sizeof(quad_layout) * quad_count) >> 20);
+
+    quad_render_buffer buffer = {0};
+    renderer2d_create_quad_render_context(&buffer, arena, quad_count);
+
+    // Tiny quads, and rasterization is discarded entirely, so the numbers are
+    // dominated by the upload even on a software rasterizer like llvmpipe.
+    quad_layout *staging = (quad_layout*)buffer.staging_buffer;
+    u64 seed = 0xDA3E39CB94B95BDBULL;
+    for (u64 i = 0; i < quad_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        quad_layout *quad = staging + i;
+        quad->transform.position    = { (r32)((seed >> 40) % 1280), (r32)((seed >> 20) % 720) };
+        quad->transform.scale       = { 1.0f, 1.0f };
+        quad->texture.offset        = { 0.0f, 0.0f };
+        quad->texture.dimension     = { 0.125f, 0.125f };
+    }
+
+    opengl_state_use_program(program);
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    for (u32 mode = 0; mode < QUAD_UPLOAD_MODE_COUNT; ++mode)
+    {
+
+        renderer2d_set_quad_upload_mode(&buffer, (quad_upload_mode)mode);
+        b32 persistent = (mode == QUAD_UPLOAD_PERSISTENT || mode == QUAD_UPLOAD_PERSISTENT_FLUSH);
+
+        // Persistent modes run twice: copying from the arena at render time, and
+        // writing straight into the mapped region.
+        for (u32 direct = 0; direct <= (u32)persistent; ++direct)
+        {
+
+            char name[64];
+            sprintf_s(name, 64, "%s%s", renderer2d_quad_upload_mode_name((quad_upload_mode)mode),
+                    direct ? " (direct)" : "");
+
+            glFinish();
+            u64 stalls = buffer.fence_stalls;
+            u64 run_begin = system_timestamp();
+
+            benchmark_timer timer;
+            benchmark_timer_reset(&timer);
+            for (u32 frame = 0; frame < frame_count; ++frame)
+            {
+
+                u64 begin = system_timestamp();
+
+                r32 offset = (frame & 1) ? 1.0f : -1.0f;
+                if (direct)
+                {
+                    quad_layout *target = renderer2d_map_quad_render_context(&buffer);
+                    benchmark_quad_upload_write(target, staging, quad_count, offset);
+                }
+                else
+                {
+                    benchmark_quad_upload_write(staging, staging, quad_count, offset);
+                }
+
+                renderer2d_render_quad_render_context(&buffer, quad_count);
+
+                u64 end = system_timestamp();
+                benchmark_timer_record(&timer, begin, end);
+
+            }
+
+            glFinish();
+            r64 wall = system_timestamp_difference_ms(run_begin, system_timestamp()) / frame_count;
+
+            benchmark_timer_report(&timer, name, quad_count);
+            printf("--      %-32s : %8.3f ms/frame with GPU, %llu fence stalls\n", "",
+                    wall, buffer.fence_stalls - stalls);
+
+        }
+
+    }
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    renderer2d_delete_quad_render_context(&buffer);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Compact Quads -----------------------------------------------------------
+
+void
+benchmark_quad_compact(memory_arena *arena, GLuint standard_program, GLuint compact_program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 quad_count = 1 << 20;
+    u32 frame_count = 32;
+
+    printf("-- Compact Quad Benchmark (%llu quads, %llu MB vs %llu MB per frame)\n", quad_count,
+            (sizeof(quad_layout) * quad_count) >> 20, (sizeof(quad_compact_layout) * quad_count) >> 20);
+
+    quad_render_buffer standard = {0};
+    quad_render_buffer compact = {0};
+    renderer2d_create_quad_render_context(&standard, arena, quad_count);
+    renderer2d_create_quad_compact_render_context(&compact, arena, quad_count);
+    renderer2d_set_quad_atlas_grid(&compact, 8, 8);
+
+    quad_layout *source = (quad_layout*)standard.staging_buffer;
+    u64 seed = 0x2545F4914F6CDD1DULL;
+    for (u64 i = 0; i < quad_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        quad_layout *quad = source + i;
+        quad->transform.position    = { (r32)((seed >> 40) % 1280), (r32)((seed >> 20) % 720) };
+        quad->transform.scale       = { 1.0f, 1.0f };
+        quad->texture.offset        = { (r32)((seed >> 8) & 7) * 0.125f, (r32)((seed >> 12) & 7) * 0.125f };
+        quad->texture.dimension     = { 0.125f, 0.125f };
+    }
+
+    // Packing is timed on its own, it is the CPU cost the smaller upload pays for.
+    benchmark_timer pack_timer;
+    benchmark_timer_reset(&pack_timer);
+    for (u32 frame = 0; frame < frame_count; ++frame)
+    {
+        u64 begin = system_timestamp();
+        renderer2d_quad_compact_pack_layouts((quad_compact_layout*)compact.staging_buffer,
+                source, quad_count, 8, 8, 0);
+        benchmark_timer_record(&pack_timer, begin, system_timestamp());
+    }
+
+    benchmark_timer_report(&pack_timer, "Pack (CPU only)", quad_count);
+
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    for (u32 mode = 0; mode < QUAD_UPLOAD_MODE_COUNT; ++mode)
+    {
+
+        renderer2d_set_quad_upload_mode(&standard, (quad_upload_mode)mode);
+        renderer2d_set_quad_upload_mode(&compact, (quad_upload_mode)mode);
+
+        // Standard uploads the floats as they are, compact packs every frame
+        // straight into whatever the upload mode maps.
+        for (u32 format = 0; format < 2; ++format)
+        {
+
+            char name[64];
+            sprintf_s(name, 64, "%s, %s", renderer2d_quad_upload_mode_name((quad_upload_mode)mode),
+                    format ? "compact" : "standard");
+
+            opengl_state_use_program(format ? compact_program : standard_program);
+            glFinish();
+            u64 run_begin = system_timestamp();
+
+            benchmark_timer timer;
+            benchmark_timer_reset(&timer);
+            for (u32 frame = 0; frame < frame_count; ++frame)
+            {
+
+                u64 begin = system_timestamp();
+
+                if (format)
+                {
+                    quad_compact_layout *target = renderer2d_map_quad_compact_render_context(&compact);
+                    renderer2d_quad_compact_pack_layouts(target, source, quad_count, 8, 8, 0);
+                    renderer2d_render_quad_render_context(&compact, quad_count);
+                }
+                else
+                {
+                    renderer2d_render_quad_render_context(&standard, quad_count);
+                }
+
+                benchmark_timer_record(&timer, begin, system_timestamp());
+
+            }
+
+            glFinish();
+            r64 wall = system_timestamp_difference_ms(run_begin, system_timestamp()) / frame_count;
+
+            benchmark_timer_report(&timer, name, quad_count);
+            printf("--      %-32s : %8.3f ms/frame with GPU\n", "", wall);
+
+        }
+
+    }
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    renderer2d_delete_quad_render_context(&compact);
+    renderer2d_delete_quad_render_context(&standard);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Quad Draw Paths ---------------------------------------------------------
+
+void
+benchmark_quad_draw_path(memory_arena *arena, GLuint instanced_program, GLuint pulled_program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 quad_count = 1 << 20;
+    u32 frame_count = 32;
+
+    printf("-- Quad Draw Path Benchmark (%llu quads)\n", quad_count);
+
+    quad_render_buffer buffer = {0};
+    renderer2d_create_quad_render_context(&buffer, arena, quad_count);
+
+    quad_layout *staging = (quad_layout*)buffer.staging_buffer;
+    u64 seed = 0x9E3779B97F4A7C15ULL;
+    for (u64 i = 0; i < quad_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        quad_layout *quad = staging + i;
+        quad->transform.position    = { (r32)((seed >> 40) % 1280), (r32)((seed >> 20) % 720) };
+        quad->transform.scale       = { 1.0f, 1.0f };
+        quad->texture.offset        = { 0.0f, 0.0f };
+        quad->texture.dimension     = { 0.125f, 0.125f };
+    }
+
+    // Both programs read the same frame block, pushed once for the whole run.
+    quad_frame_constants frame_constants = {0};
+    frame_constants.projection = orthographic_rh_no(0.0f, 1280.0f, 0.0f, 720.0f, -10.0f, 10.0f);
+    frame_constants.camera = translate({ 0.0f, 0.0f, 0.0f });
+    frame_constants.view_projection = frame_constants.projection * frame_constants.camera;
+
+    uniform_ring frame_uniforms = {0};
+    uniform_ring_create(&frame_uniforms, sizeof(quad_frame_constants));
+    uniform_ring_begin_frame(&frame_uniforms);
+    uniform_allocation frame_allocation = uniform_ring_push_value(&frame_uniforms, &frame_constants);
+    uniform_ring_bind(&frame_allocation, QUAD_FRAME_BINDING);
+
+    // Both paths upload the same way, the difference between them is the
+    // vertex fetch and transform.
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    for (u32 path = 0; path < QUAD_DRAW_PATH_COUNT; ++path)
+    {
+
+        GLuint program = (path == QUAD_DRAW_PULLED) ? pulled_program : instanced_program;
+        opengl_state_use_program(program);
+        renderer2d_set_quad_draw_path(&buffer, (quad_draw_path)path);
+
+        glFinish();
+        benchmark_timer timer;
+        benchmark_timer_reset(&timer);
+        for (u32 frame = 0; frame < frame_count; ++frame)
+        {
+
+            u64 begin = system_timestamp();
+            renderer2d_render_quad_render_context(&buffer, quad_count);
+            glFinish();
+            benchmark_timer_record(&timer, begin, system_timestamp());
+
+        }
+
+        benchmark_timer_report(&timer, renderer2d_quad_draw_path_name((quad_draw_path)path), quad_count);
+
+    }
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    uniform_ring_end_frame(&frame_uniforms);
+    uniform_ring_delete(&frame_uniforms);
+    renderer2d_delete_quad_render_context(&buffer);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Quad Dirty Tracking -----------------------------------------------------
+
+void
+benchmark_quad_dirty(memory_arena *arena, GLuint program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 quad_count = 1 << 20;
+    u32 frame_count = 32;
+
+    printf("-- Quad Dirty Tracking Benchmark (%llu quads)\n", quad_count);
+
+    quad_render_buffer buffer = {0};
+    renderer2d_create_quad_render_context(&buffer, arena, quad_count);
+
+    quad_layout *staging = (quad_layout*)buffer.staging_buffer;
+    u64 seed = 0xC2B2AE3D27D4EB4FULL;
+    for (u64 i = 0; i < quad_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        quad_layout *quad = staging + i;
+        quad->transform.position    = { (r32)((seed >> 40) % 1280), (r32)((seed >> 20) % 720) };
+        quad->transform.scale       = { 1.0f, 1.0f };
+        quad->texture.offset        = { 0.0f, 0.0f };
+        quad->texture.dimension     = { 0.125f, 0.125f };
+    }
+
+    // Untracked is the full upload every frame, the rest mark what they touch.
+    ccptr scenario_names[] = { "untracked", "idle", "10% contiguous", "1 in 4096 scattered", "everything" };
+    u32 scenario_count = sizeof(scenario_names) / sizeof(scenario_names[0]);
+    quad_upload_mode modes[] = { QUAD_UPLOAD_SUBDATA, QUAD_UPLOAD_PERSISTENT_FLUSH };
+
+    opengl_state_use_program(program);
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    for (u32 m = 0; m < 2; ++m)
+    {
+
+        renderer2d_set_quad_upload_mode(&buffer, modes[m]);
+        for (u32 scenario = 0; scenario < scenario_count; ++scenario)
+        {
+
+            renderer2d_set_quad_dirty_tracking(&buffer, scenario != 0);
+
+            // Flush the initial full upload out of every region first.
+            for (u32 warm = 0; warm < QUAD_UPLOAD_REGIONS; ++warm)
+                renderer2d_render_quad_render_context(&buffer, quad_count);
+
+            char name[64];
+            sprintf_s(name, 64, "%s, %s", renderer2d_quad_upload_mode_name(modes[m]),
+                    scenario_names[scenario]);
+
+            glFinish();
+            u64 run_begin = system_timestamp();
+            u64 bytes = 0;
+            u64 ranges = 0;
+
+            benchmark_timer timer;
+            benchmark_timer_reset(&timer);
+            for (u32 frame = 0; frame < frame_count; ++frame)
+            {
+
+                u64 begin = system_timestamp();
+
+                r32 offset = (frame & 1) ? 1.0f : -1.0f;
+                if (scenario == 2)
+                {
+                    u64 first = (quad_count / 10) * (frame % 10);
+                    for (u64 i = first; i < first + quad_count / 10; ++i)
+                        staging[i].transform.position.X += offset;
+                    renderer2d_mark_quad_range_dirty(&buffer, first, quad_count / 10);
+                }
+                else if (scenario == 3)
+                {
+                    for (u64 i = frame; i < quad_count; i += 4096)
+                    {
+                        staging[i].transform.position.X += offset;
+                        renderer2d_mark_quad_range_dirty(&buffer, i, 1);
+                    }
+                }
+                else if (scenario == 4)
+                {
+                    renderer2d_mark_quad_range_dirty(&buffer, 0, quad_count);
+                }
+
+                renderer2d_render_quad_render_context(&buffer, quad_count);
+                bytes += buffer.upload_bytes;
+                ranges += buffer.upload_ranges;
+
+                benchmark_timer_record(&timer, begin, system_timestamp());
+
+            }
+
+            glFinish();
+            r64 wall = system_timestamp_difference_ms(run_begin, system_timestamp()) / frame_count;
+
+            benchmark_timer_report(&timer, name, quad_count);
+            printf("--      %-32s : %8.3f ms/frame with GPU, %6.2f MB and %llu ranges per frame\n", "",
+                    wall, (r64)bytes / frame_count / (1024.0 * 1024.0), ranges / frame_count);
+
+        }
+
+    }
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    renderer2d_delete_quad_render_context(&buffer);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Sprite Batch ------------------------------------------------------------
+
+void
+benchmark_sprite_batch(memory_arena *arena, GLuint program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u32 sprite_count = 1 << 20;
+    u32 frame_count = 16;
+    const u32 texture_count = 16;
+    const u32 layer_count = 8;
+
+    printf("-- Sprite Batch Benchmark (%u sprites, %u textures, %u layers)\n",
+            sprite_count, texture_count, layer_count);
+
+    GLuint textures[texture_count];
+    glGenTextures(texture_count, textures);
+    for (u32 i = 0; i < texture_count; ++i)
+    {
+        u32 texel = 0xFF000000 | (i * 0x00100F07);
+        opengl_state_bind_texture(0, GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texel);
+    }
+
+    sprite_batch batch = {0};
+    sprite_batch_create(&batch, arena, sprite_count);
+    sprite_submission *sprites = memory_arena_push_array(arena, sprite_submission, sprite_count);
+
+    // Random state everywhere is the worst case for the sort. Alpha blended sprites
+    // are kept to the top layer and one texture, since their depth order would
+    // otherwise split them into a draw each, as it should.
+    u64 seed = 0x8CB92BA72F3D8DD7ULL;
+    for (u32 i = 0; i < sprite_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        sprite_submission *sprite = sprites + i;
+        sprite->quad.transform.position     = { (r32)((seed >> 40) % 1280), (r32)((seed >> 20) % 720) };
+        sprite->quad.transform.scale        = { 1.0f, 1.0f };
+        sprite->quad.texture.offset         = { 0.0f, 0.0f };
+        sprite->quad.texture.dimension      = { 1.0f, 1.0f };
+        sprite->layer       = (u32)((seed >> 8) % layer_count);
+        sprite->texture     = textures[(seed >> 16) % texture_count];
+        sprite->blend       = ((seed >> 24) & 1) ? RENDER_BLEND_ADDITIVE : RENDER_BLEND_OPAQUE;
+        if (sprite->layer == layer_count - 1)
+        {
+            sprite->texture = textures[0];
+            sprite->blend = RENDER_BLEND_ALPHA;
+        }
+        sprite->depth       = (r32)((seed >> 32) & 0xFFFF) / 65535.0f;
+    }
+
+    // Without sorting, every change of texture or blend mode is a draw.
+    u32 unsorted_draws = 1;
+    for (u32 i = 1; i < sprite_count; ++i)
+    {
+        unsorted_draws += (sprites[i].texture != sprites[i - 1].texture ||
+                sprites[i].blend != sprites[i - 1].blend);
+    }
+
+    opengl_state_use_program(program);
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    benchmark_timer submit_timer;
+    benchmark_timer end_timer;
+    benchmark_timer_reset(&submit_timer);
+    benchmark_timer_reset(&end_timer);
+    r64 sort_total = 0.0;
+    r64 gather_total = 0.0;
+
+    for (u32 frame = 0; frame < frame_count; ++frame)
+    {
+
+        u64 begin = system_timestamp();
+        sprite_batch_begin(&batch);
+        for (u32 i = 0; i < sprite_count; ++i)
+            sprite_batch_submit(&batch, sprites + i);
+        u64 submitted = system_timestamp();
+
+        sprite_batch_end(&batch);
+        glFinish();
+        u64 end = system_timestamp();
+
+        benchmark_timer_record(&submit_timer, begin, submitted);
+        benchmark_timer_record(&end_timer, submitted, end);
+        sort_total += batch.sort_milliseconds;
+        gather_total += batch.gather_milliseconds;
+
+    }
+
+    benchmark_timer_report(&submit_timer, "Submit", sprite_count);
+    benchmark_timer_report(&end_timer, "Sort, gather, upload and draw", sprite_count);
+    printf("--      %-32s : %8.3f ms sort (%u passes), %8.3f ms gather\n", "",
+            sort_total / frame_count, batch.sort_passes, gather_total / frame_count);
+    printf("--      %-32s : %u draws sorted, %u unsorted\n", "", batch.draw_count, unsorted_draws);
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    opengl_state_enable(GL_BLEND);
+    opengl_state_blend_func(GL_ONE, GL_ZERO);
+    sprite_batch_delete(&batch);
+    for (u32 i = 0; i < texture_count; ++i)
+        opengl_texture_delete(textures[i]);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Quad Culling ------------------------------------------------------------
+
+void
+benchmark_quad_cull(memory_arena *arena, GLuint program, GLuint cull_program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u64 quad_count = 1 << 22;
+    u32 frame_count = 16;
+    vec2 view_min = { 0.0f, 0.0f };
+    vec2 view_max = { 1280.0f, 720.0f };
+
+    printf("-- Quad Culling Benchmark (%llu quads)\n", quad_count);
+
+    quad_render_buffer world = {0};
+    quad_render_buffer visible = {0};
+    renderer2d_create_quad_render_context(&world, arena, quad_count);
+    renderer2d_create_quad_render_context(&visible, arena, quad_count);
+    renderer2d_set_quad_upload_mode(&world, QUAD_UPLOAD_PERSISTENT_FLUSH);
+    renderer2d_set_quad_upload_mode(&visible, QUAD_UPLOAD_PERSISTENT_FLUSH);
+
+    quad_culler culler = {0};
+    quad_culler_create(&culler, arena, quad_count);
+
+    // The GPU culler has the world resident, so its frames send nothing.
+    quad_gpu_culler gpu_culler = {0};
+    quad_gpu_culler_create(&gpu_culler, cull_program, quad_count);
+
+    // The world grows around the view, from the runtime's 100 pixel margin out
+    // to a scrolling map with the view as a small window onto it.
+    r32 world_scales[] = { 1.0f, 4.0f, 16.0f, 64.0f };
+    u32 world_count = sizeof(world_scales) / sizeof(world_scales[0]);
+
+    opengl_state_use_program(program);
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    for (u32 w = 0; w < world_count; ++w)
+    {
+
+        r32 world_width = view_max.X * world_scales[w] + 200.0f;
+        r32 world_height = view_max.Y * world_scales[w] + 200.0f;
+        quad_layout *quads = world.vertex_buffer;
+        u64 seed = 0x9E3779B97F4A7C15ULL;
+        for (u64 i = 0; i < quad_count; ++i)
+        {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            r32 x = (r32)((seed >> 40) & 0xFFFF) / 65535.0f;
+            r32 y = (r32)((seed >> 24) & 0xFFFF) / 65535.0f;
+            quads[i].transform.position = { x * world_width - 100.0f, y * world_height - 100.0f };
+            quads[i].transform.scale    = { 16.0f, 16.0f };
+            quads[i].texture.offset     = { 0.0f, 0.0f };
+            quads[i].texture.dimension  = { 0.125f, 0.125f };
+        }
+
+        quad_gpu_culler_update(&gpu_culler, quads, 0, quad_count);
+
+        benchmark_timer full_timer;
+        benchmark_timer cull_timer;
+        benchmark_timer gpu_timer;
+        benchmark_timer_reset(&full_timer);
+        benchmark_timer_reset(&cull_timer);
+        benchmark_timer_reset(&gpu_timer);
+        r64 cull_total = 0.0;
+
+        for (u32 frame = 0; frame < frame_count; ++frame)
+        {
+
+            u64 begin = system_timestamp();
+            renderer2d_render_quad_render_context(&world, quad_count);
+            glFinish();
+            u64 full_end = system_timestamp();
+
+            quad_layout *destination = renderer2d_map_quad_render_context(&visible);
+            u64 visible_count = quad_culler_cull(&culler, destination, quads, quad_count, view_min, view_max);
+            renderer2d_render_quad_render_context(&visible, visible_count);
+            glFinish();
+            u64 cull_end = system_timestamp();
+
+            quad_gpu_culler_cull(&gpu_culler, quad_count, view_min, view_max);
+            opengl_state_use_program(program);
+            quad_gpu_culler_draw(&gpu_culler);
+            glFinish();
+            u64 gpu_end = system_timestamp();
+
+            benchmark_timer_record(&full_timer, begin, full_end);
+            benchmark_timer_record(&cull_timer, full_end, cull_end);
+            benchmark_timer_record(&gpu_timer, cull_end, gpu_end);
+            cull_total += culler.cull_milliseconds;
+
+        }
+
+        printf("--    World %.0fx the view, %llu visible, %llu culled\n", world_scales[w],
+                culler.visible_count, culler.culled_count);
+        benchmark_timer_report(&full_timer, "Upload and draw everything", quad_count);
+        benchmark_timer_report(&cull_timer, "Cull, upload and draw visible", quad_count);
+        printf("--      %-32s : %8.3f ms of that culling\n", "", cull_total / frame_count);
+        benchmark_timer_report(&gpu_timer, "GPU cull and indirect draw", quad_count);
+        printf("--      %-32s : %u visible on the GPU\n", "",
+                quad_gpu_culler_read_visible_count(&gpu_culler));
+
+    }
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    quad_gpu_culler_delete(&gpu_culler);
+    renderer2d_delete_quad_render_context(&visible);
+    renderer2d_delete_quad_render_context(&world);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Render Commands ---------------------------------------------------------
+
+typedef struct benchmark_command_context
+{
+    render_command_buffer *commands;
+    quad_render_buffer *quads;
+    render_draw_state *states;
+    u32 *state_indices;
+    u32 quads_per_draw;
+} benchmark_command_context;
+
+static void
+benchmark_record_commands(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    benchmark_command_context *context = (benchmark_command_context*)user_data;
+    for (u64 i = begin; i < end; ++i)
+    {
+        render_draw_state *state = context->states + context->state_indices[i];
+        u64 key = render_command_make_key(0, state->blend, state->program, state->texture, (u32)i);
+        render_command_draw_quads(context->commands, worker_index, key, state, context->quads,
+                (u32)i * context->quads_per_draw, context->quads_per_draw);
+    }
+
+}
+
+void
+benchmark_render_commands(memory_arena *arena, GLuint program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    u32 draw_count = 1 << 15;
+    u32 quads_per_draw = 4;
+    u32 frame_count = 16;
+    const u32 texture_count = 16;
+
+    printf("-- Render Command Benchmark (%u draws, %u textures, %u threads)\n",
+            draw_count, texture_count, jobs_worker_count());
+
+    GLuint textures[texture_count];
+    glGenTextures(texture_count, textures);
+    for (u32 i = 0; i < texture_count; ++i)
+    {
+        u32 texel = 0xFF000000 | (i * 0x00100F07);
+        opengl_state_bind_texture(0, GL_TEXTURE_2D, textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, &texel);
+    }
+
+    // Every texture in both opaque and additive, picked at random per draw, so
+    // recording order changes state on nearly every draw.
+    render_draw_state states[texture_count * 2];
+    for (u32 i = 0; i < texture_count * 2; ++i)
+    {
+        states[i].program = program;
+        states[i].texture = textures[i % texture_count];
+        states[i].texture_array = false;
+        states[i].blend = (i < texture_count) ? RENDER_BLEND_OPAQUE : RENDER_BLEND_ADDITIVE;
+    }
+
+    u32 *state_indices = memory_arena_push_array(arena, u32, draw_count);
+    u64 seed = 0xD1B54A32D192ED03ULL;
+    for (u32 i = 0; i < draw_count; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        state_indices[i] = (u32)((seed >> 33) % (texture_count * 2));
+    }
+
+    u64 quad_count = (u64)draw_count * quads_per_draw;
+    quad_render_buffer quads = {0};
+    renderer2d_create_quad_render_context(&quads, arena, quad_count);
+    for (u64 i = 0; i < quad_count; ++i)
+    {
+        quads.vertex_buffer[i].transform.position   = { (r32)(i % 1280), (r32)((i / 1280) % 720) };
+        quads.vertex_buffer[i].transform.scale      = { 1.0f, 1.0f };
+        quads.vertex_buffer[i].texture.offset       = { 0.0f, 0.0f };
+        quads.vertex_buffer[i].texture.dimension    = { 1.0f, 1.0f };
+    }
+
+    // Every stream can take the whole frame, so the single threaded run fits.
+    render_command_buffer commands;
+    render_command_buffer_create(&commands, arena, draw_count, 0);
+
+    benchmark_command_context context = {0};
+    context.commands = &commands;
+    context.quads = &quads;
+    context.states = states;
+    context.state_indices = state_indices;
+    context.quads_per_draw = quads_per_draw;
+
+    opengl_state_enable(GL_RASTERIZER_DISCARD);
+
+    benchmark_timer direct_timer;
+    benchmark_timer single_timer;
+    benchmark_timer parallel_timer;
+    benchmark_timer submit_timer;
+    benchmark_timer_reset(&direct_timer);
+    benchmark_timer_reset(&single_timer);
+    benchmark_timer_reset(&parallel_timer);
+    benchmark_timer_reset(&submit_timer);
+    r64 sort_total = 0.0;
+    opengl_state_statistics before, after;
+    u64 direct_issued = 0;
+    u64 direct_elided = 0;
+    u64 sorted_issued = 0;
+    u64 sorted_elided = 0;
+
+    for (u32 frame = 0; frame < frame_count; ++frame)
+    {
+
+        // Issuing the draws straight away, in the order they were made.
+        opengl_state_get_statistics(&before);
+        u64 begin = system_timestamp();
+        renderer2d_upload_quad_render_context(&quads, quad_count);
+        opengl_state_use_program(program);
+        for (u32 i = 0; i < draw_count; ++i)
+        {
+            render_draw_state *state = states + state_indices[i];
+            if (state->blend == RENDER_BLEND_ADDITIVE)
+            {
+                opengl_state_enable(GL_BLEND);
+                opengl_state_blend_func(GL_SRC_ALPHA, GL_ONE);
+            }
+            else
+            {
+                opengl_state_disable(GL_BLEND);
+            }
+            opengl_state_bind_texture(0, GL_TEXTURE_2D, state->texture);
+            renderer2d_draw_quad_range(&quads, (u64)i * quads_per_draw, quads_per_draw);
+        }
+        renderer2d_end_quad_render_context(&quads);
+        glFinish();
+        u64 direct_end = system_timestamp();
+        opengl_state_get_statistics(&after);
+        direct_issued = after.issued_calls - before.issued_calls;
+        direct_elided = after.elided_calls - before.elided_calls;
+
+        render_command_buffer_reset(&commands);
+        benchmark_record_commands(&context, 0, draw_count, 0);
+        u64 single_end = system_timestamp();
+
+        render_command_buffer_reset(&commands);
+        u64 parallel_begin = system_timestamp();
+        render_command_upload_quads(&commands, 0, &quads, quad_count);
+        jobs_parallel_for(draw_count, 1024, benchmark_record_commands, &context);
+        u64 parallel_end = system_timestamp();
+
+        opengl_state_get_statistics(&before);
+        render_command_buffer_sort(&commands);
+        render_command_buffer_submit(&commands);
+        glFinish();
+        u64 submit_end = system_timestamp();
+        opengl_state_get_statistics(&after);
+        sorted_issued = after.issued_calls - before.issued_calls;
+        sorted_elided = after.elided_calls - before.elided_calls;
+
+        benchmark_timer_record(&direct_timer, begin, direct_end);
+        benchmark_timer_record(&single_timer, direct_end, single_end);
+        benchmark_timer_record(&parallel_timer, parallel_begin, parallel_end);
+        benchmark_timer_record(&submit_timer, parallel_end, submit_end);
+        sort_total += commands.sort_milliseconds;
+
+    }
+
+    benchmark_timer_report(&direct_timer, "Direct upload and draw", draw_count);
+    printf("--      %-32s : GL %llu issued, %llu elided\n", "", direct_issued, direct_elided);
+    benchmark_timer_report(&single_timer, "Record, one thread", draw_count);
+    benchmark_timer_report(&parallel_timer, "Record, all threads", draw_count);
+    benchmark_timer_report(&submit_timer, "Sort and submit", draw_count);
+    printf("--      %-32s : %8.3f ms sort (%u passes), %u dropped\n", "",
+            sort_total / frame_count, commands.sort_passes, commands.dropped_count);
+    printf("--      %-32s : GL %llu issued, %llu elided\n", "", sorted_issued, sorted_elided);
+
+    opengl_state_disable(GL_RASTERIZER_DISCARD);
+    opengl_state_enable(GL_BLEND);
+    opengl_state_blend_func(GL_ONE, GL_ZERO);
+    renderer2d_delete_quad_render_context(&quads);
+    for (u32 i = 0; i < texture_count; ++i)
+        opengl_texture_delete(textures[i]);
+    memory_arena_restore(arena, arena_state);
+
+}
+
+// --- Software Quad Rasterizer ------------------------------------------------
+
+void
+benchmark_quad_raster(memory_arena *arena, GLuint program)
+{
+
+    u64 arena_state = memory_arena_save(arena);
+    const u32 width = 1280;
+    const u32 height = 720;
+    const u32 texture_size = 256;
+    u64 quad_counts[] = { 10000, 100000, 1000000 };
+    u64 quad_capacity = 1000000;
+    u64 compare_count = 10000;
+    u32 frame_count = 8;
+
+    printf("-- Software Quad Rasterizer Benchmark (%ux%u, %u threads)\n",
+            width, height, jobs_worker_count());
+
+    // Alpha runs diagonally across the texture, so blending sees every value.
+    image texture = {0};
+    texture.width = texture_size;
+    texture.height = texture_size;
+    texture.pitch = texture_size * 4;
+    texture.bits_per_pixel = 32;
+    texture.buffer = memory_arena_push(arena, (u64)texture_size * texture_size * 4);
+    u32 *texels = (u32*)texture.buffer;
+    for (u32 y = 0; y < texture_size; ++y)
+    {
+        for (u32 x = 0; x < texture_size; ++x)
+            texels[y * texture_size + x] = x | (y << 8) | ((x ^ y) << 16) | (((x + y) >> 1) << 24);
+    }
+
+    // Sprite sized quads showing their own texel sized region of the texture.
+    quad_layout *quads = memory_arena_push_array(arena, quad_layout, quad_capacity);
+    u64 seed = 0x2545F4914F6CDD1DULL;
+    for (u64 i = 0; i < quad_capacity; ++i)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        r32 size_x = (r32)(8 + (seed >> 60) * 2);
+        r32 size_y = (r32)(8 + ((seed >> 56) & 0xF) * 2);
+        quad_layout *quad = quads + i;
+        quad->transform.position    = { (r32)((seed >> 40) % width), (r32)((seed >> 20) % height) };
+        quad->transform.scale       = { size_x, size_y };
+        quad->texture.offset        = { (r32)((seed >> 8) % 192) / texture_size, (r32)(seed % 192) / texture_size };
+        quad->texture.dimension     = { size_x / texture_size, size_y / texture_size };
+    }
+
+    quad_frame_constants frame_constants = {0};
+    frame_constants.projection = orthographic_rh_no(0.0f, (r32)width, 0.0f, (r32)height, -10.0f, 10.0f);
+    frame_constants.camera = translate({ 0.0f, 0.0f, 0.0f });
+    frame_constants.view_projection = frame_constants.projection * frame_constants.camera;
+
+    quad_rasterizer rasterizer;
+    quad_rasterizer_create(&rasterizer, arena, width, height, quad_capacity);
+
+    for (u32 blend = 0; blend < 2; ++blend)
+    {
+
+        for (u32 run = 0; run < NX_ARRSIZE(quad_counts); ++run)
+        {
+
+            benchmark_timer timer;
+            benchmark_timer_reset(&timer);
+            for (u32 frame = 0; frame < frame_count; ++frame)
+            {
+
+                u64 begin = system_timestamp();
+                quad_rasterizer_clear(&rasterizer, 0xFF000000);
+                quad_rasterizer_draw(&rasterizer, quads, quad_counts[run], &texture,
+                        &frame_constants.view_projection, (quad_raster_blend)blend);
+                benchmark_timer_record(&timer, begin, system_timestamp());
+
+            }
+
+            char name[64];
+            sprintf_s(name, 64, "%s, %llu quads",
+                    (blend == QUAD_RASTER_ALPHA) ? "Alpha" : "Opaque", quad_counts[run]);
+            benchmark_timer_report(&timer, name, quad_counts[run]);
+            printf("--      %-32s : %u passes, %.2f tiles a quad\n", "",
+                    rasterizer.passes, (r64)rasterizer.bin_entries / (r64)quad_counts[run]);
+
+        }
+
+    }
+
+    // The same quads through the GL quad renderer into an offscreen target, read
+    // back and compared. There's no depth attachment, so drawing order decides.
+    GLuint texture_identifier = opengl_texture_create(&texture);
+    GLuint color_texture = 0;
+    GLuint framebuffer = 0;
+    glGenTextures(1, &color_texture);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, color_texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, color_texture, 0);
+    NX_ASSERT(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    opengl_state_viewport(0, 0, width, height);
+    opengl_state_clear_color(0.0f, 0.0f, 0.0f, 1.0f);
+
+    uniform_ring frame_uniforms = {0};
+    uniform_ring_create(&frame_uniforms, sizeof(quad_frame_constants));
+    uniform_ring_begin_frame(&frame_uniforms);
+    uniform_allocation frame_allocation = uniform_ring_push_value(&frame_uniforms, &frame_constants);
+    uniform_ring_bind(&frame_allocation, QUAD_FRAME_BINDING);
+
+    quad_render_buffer buffer = {0};
+    renderer2d_create_quad_render_context(&buffer, arena, compare_count);
+    memcpy(buffer.staging_buffer, quads, sizeof(quad_layout) * compare_count);
+    u32 *readback = memory_arena_push_array(arena, u32, (u64)width * height);
+
+    opengl_state_use_program(program);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, texture_identifier);
+    opengl_state_enable(GL_BLEND);
+    for (u32 blend = 0; blend < 2; ++blend)
+    {
+
+        if (blend == QUAD_RASTER_ALPHA) opengl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        else opengl_state_blend_func(GL_ONE, GL_ZERO);
+
+        glClear(GL_COLOR_BUFFER_BIT);
+        renderer2d_render_quad_render_context(&buffer, compare_count);
+        glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, readback);
+
+        quad_rasterizer_clear(&rasterizer, 0xFF000000);
+        quad_rasterizer_draw(&rasterizer, quads, compare_count, &texture,
+                &frame_constants.view_projection, (quad_raster_blend)blend);
+
+        // A pixel differs by its largest channel difference.
+        u32 *pixels = (u32*)rasterizer.target.buffer;
+        u64 differing = 0;
+        u32 largest = 0;
+        for (u64 i = 0; i < (u64)width * height; ++i)
+        {
+            u32 difference = 0;
+            for (u32 shift = 0; shift < 32; shift += 8)
+            {
+                i32 channel = (i32)((pixels[i] >> shift) & 0xFF) - (i32)((readback[i] >> shift) & 0xFF);
+                channel = (channel < 0) ? -channel : channel;
+                difference = ((u32)channel > difference) ? (u32)channel : difference;
+            }
+            differing += (difference > 2);
+            largest = (difference > largest) ? difference : largest;
+        }
+
+        char name[64];
+        sprintf_s(name, 64, "%s against GL, %llu quads",
+                (blend == QUAD_RASTER_ALPHA) ? "Alpha" : "Opaque", compare_count);
+        printf("--      %-32s : %.4f%% of pixels differ by more than 2, at most %u\n",
+                name, 100.0 * (r64)differing / ((r64)width * height), largest);
+
+    }
+
+    opengl_state_blend_func(GL_ONE, GL_ZERO);
+    opengl_state_viewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &framebuffer);
+    opengl_texture_delete(color_texture);
+    opengl_texture_delete(texture_identifier);
+    renderer2d_delete_quad_render_context(&buffer);
+    uniform_ring_end_frame(&frame_uniforms);
+    uniform_ring_delete(&frame_uniforms);
+    memory_arena_restore(arena, arena_state);
+
+}
@@ -0,0 +1,32 @@
+#ifndef SRC_ENGINE_BENCHMARKS_H
+#define SRC_ENGINE_BENCHMARKS_H
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+
+// --- Engine Benchmarks -------------------------------------------------------
+//
+// Self-contained timing runs for the engine subsystems. Each benchmark takes
+// its scratch memory from the provided arena, restores the arena when it is
+// done, and reports its results on the debug console. These are meant to be
+// triggered from the runtime with a debug key and are not part of the frame.
+//
+// The renderer benchmarks need a current GL context and draw into whatever
+// framebuffer is bound, so run them from the runtime between frames.
+//
+
+void benchmark_particles(memory_arena *arena);
+void benchmark_spatial_grid(memory_arena *arena);
+void benchmark_sweep_prune(memory_arena *arena);
+void benchmark_physics2d(memory_arena *arena);
+void benchmark_ecs(memory_arena *arena);
+void benchmark_quad_upload(memory_arena *arena, GLuint program);
+void benchmark_quad_compact(memory_arena *arena, GLuint standard_program, GLuint compact_program);
+void benchmark_quad_draw_path(memory_arena *arena, GLuint instanced_program, GLuint pulled_program);
+void benchmark_quad_dirty(memory_arena *arena, GLuint program);
+void benchmark_sprite_batch(memory_arena *arena, GLuint program);
+void benchmark_quad_cull(memory_arena *arena, GLuint program, GLuint cull_program);
+void benchmark_render_commands(memory_arena *arena, GLuint program);
+void benchmark_quad_raster(memory_arena *arena, GLuint program);
+
+#endif
@@ -0,0 +1,776 @@
+#include <engine/ecs.h>
+#include <core/jobs.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+#define ECS_INDEX_BITS          20
+#define ECS_INDEX_MASK          ((1u << ECS_INDEX_BITS) - 1)
+#define ECS_GENERATION_MASK     0x7FFu
+#define ECS_PENDING_BIT         0x80000000u
+#define ECS_CHUNK_ALIGNMENT     64
+#define ECS_COMMAND_ALIGNMENT   16
+
+typedef enum ecs_command_type
+{
+    ECS_COMMAND_CREATE,
+    ECS_COMMAND_DESTROY,
+    ECS_COMMAND_ADD,
+    ECS_COMMAND_SET,
+    ECS_COMMAND_REMOVE,
+} ecs_command_type;
+
+typedef struct ecs_command_header
+{
+    u16 type;
+    u16 component;
+    ecs_entity entity;          // For creates, the resolved entity after playback.
+    ecs_mask mask;
+    u32 data_size;
+    u32 record_size;
+} ecs_command_header;
+
+typedef struct ecs_dispatch_context
+{
+    ecs_world *world;
+    ecs_query *query;
+    ecs_chunk **chunks;
+    ecs_chunk_proc proc;
+    vptr user_data;
+} ecs_dispatch_context;
+
+// Kept out of ecs_world so the header stays plain data.
+typedef struct ecs_dispatch_guard
+{
+    std::atomic<b32> active;
+} ecs_dispatch_guard;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+ecs_align_up(u64 value, u64 alignment)
+{
+
+    return (value + alignment - 1) & ~(alignment - 1);
+
+}
+
+static inline u32
+ecs_entity_index(ecs_entity entity)
+{
+
+    return entity & ECS_INDEX_MASK;
+
+}
+
+static inline u32
+ecs_entity_generation(ecs_entity entity)
+{
+
+    return (entity >> ECS_INDEX_BITS) & ECS_GENERATION_MASK;
+
+}
+
+static inline u8*
+ecs_chunk_column(ecs_chunk *chunk, u32 offset)
+{
+
+    return (u8*)chunk + offset;
+
+}
+
+static inline ecs_entity*
+ecs_chunk_entities(ecs_chunk *chunk)
+{
+
+    return (ecs_entity*)ecs_chunk_column(chunk, chunk->archetype->entity_column_offset);
+
+}
+
+static ecs_archetype*
+ecs_archetype_acquire(ecs_world *world, ecs_mask mask)
+{
+
+    for (u32 i = 0; i < world->archetype_count; ++i)
+    {
+        if (world->archetypes[i].mask == mask) return world->archetypes + i;
+    }
+
+    NX_ASSERT(world->archetype_count < ECS_MAX_ARCHETYPES);
+    if (world->archetype_count >= ECS_MAX_ARCHETYPES) return NULL;
+
+    ecs_archetype *archetype = world->archetypes + world->archetype_count;
+    memset(archetype, 0, sizeof(ecs_archetype));
+    archetype->mask = mask;
+
+    // Estimate the capacity from the per-entity footprint, then back it off
+    // until the aligned columns actually fit in the chunk.
+    u64 header_size = ecs_align_up(sizeof(ecs_chunk), ECS_CHUNK_ALIGNMENT);
+    u64 entity_stride = sizeof(ecs_entity);
+    for (u32 c = 0; c < world->component_count; ++c)
+    {
+        if (mask & ECS_COMPONENT_BIT(c)) entity_stride += world->components[c].size;
+    }
+
+    u64 capacity = (ECS_CHUNK_SIZE - header_size) / entity_stride;
+    for (; capacity > 0; --capacity)
+    {
+
+        u64 offset = header_size;
+        archetype->entity_column_offset = (u16)offset;
+        offset += sizeof(ecs_entity) * capacity;
+
+        for (u32 c = 0; c < world->component_count; ++c)
+        {
+            if (!(mask & ECS_COMPONENT_BIT(c))) continue;
+            offset = ecs_align_up(offset, world->components[c].alignment);
+            archetype->column_offsets[c] = (u16)offset;
+            offset += (u64)world->components[c].size * capacity;
+        }
+
+        if (offset <= ECS_CHUNK_SIZE) break;
+
+    }
+
+    NX_ASSERT(capacity > 0); // Components too large to fit a single entity in a chunk.
+    archetype->chunk_capacity = (u32)capacity;
+
+    world->archetype_count++;
+    return archetype;
+
+}
+
+static ecs_chunk*
+ecs_chunk_acquire(ecs_world *world, ecs_archetype *archetype)
+{
+
+    ecs_chunk *chunk = world->free_chunks;
+    if (chunk != NULL)
+    {
+        world->free_chunks = chunk->next;
+    }
+    else
+    {
+        NX_ASSERT(memory_arena_can_accomodate(&world->chunk_arena, ECS_CHUNK_SIZE));
+        if (!memory_arena_can_accomodate(&world->chunk_arena, ECS_CHUNK_SIZE)) return NULL;
+        chunk = (ecs_chunk*)memory_arena_push(&world->chunk_arena, ECS_CHUNK_SIZE);
+    }
+
+    chunk->archetype = archetype;
+    chunk->count = 0;
+    chunk->next = NULL;
+    chunk->previous = archetype->tail;
+
+    if (archetype->tail != NULL) archetype->tail->next = chunk;
+    else archetype->head = chunk;
+    archetype->tail = chunk;
+    archetype->chunk_count++;
+
+    return chunk;
+
+}
+
+static void
+ecs_chunk_release(ecs_world *world, ecs_chunk *chunk)
+{
+
+    ecs_archetype *archetype = chunk->archetype;
+    if (chunk->previous != NULL) chunk->previous->next = chunk->next;
+    else archetype->head = chunk->next;
+    if (chunk->next != NULL) chunk->next->previous = chunk->previous;
+    else archetype->tail = chunk->previous;
+    archetype->chunk_count--;
+
+    chunk->archetype = NULL;
+    chunk->previous = NULL;
+    chunk->next = world->free_chunks;
+    world->free_chunks = chunk;
+
+}
+
+static inline b32
+ecs_archetype_allocate_row(ecs_world *world, ecs_archetype *archetype, ecs_entity entity,
+        ecs_chunk **out_chunk, u32 *out_row)
+{
+
+    ecs_chunk *chunk = archetype->tail;
+    if (chunk == NULL || chunk->count >= archetype->chunk_capacity)
+        chunk = ecs_chunk_acquire(world, archetype);
+    if (chunk == NULL) return false;
+
+    u32 row = chunk->count++;
+    ecs_chunk_entities(chunk)[row] = entity;
+    archetype->entity_count++;
+
+    *out_chunk = chunk;
+    *out_row = row;
+    return true;
+
+}
+
+static void
+ecs_archetype_remove_row(ecs_world *world, ecs_chunk *chunk, u32 row)
+{
+
+    // Keep chunks dense by moving the very last entity of the archetype into
+    // the hole. Only the tail chunk ever shrinks.
+    ecs_archetype *archetype = chunk->archetype;
+    ecs_chunk *tail = archetype->tail;
+    u32 last_row = tail->count - 1;
+
+    if (chunk != tail || row != last_row)
+    {
+
+        ecs_entity moved = ecs_chunk_entities(tail)[last_row];
+        ecs_chunk_entities(chunk)[row] = moved;
+
+        for (u32 c = 0; c < world->component_count; ++c)
+        {
+            u32 offset = archetype->column_offsets[c];
+            if (offset == 0) continue;
+            u32 size = world->components[c].size;
+            memcpy(ecs_chunk_column(chunk, offset) + (u64)size * row,
+                    ecs_chunk_column(tail, offset) + (u64)size * last_row, size);
+        }
+
+        ecs_entity_location *location = world->entities + ecs_entity_index(moved);
+        location->chunk = chunk;
+        location->row = row;
+
+    }
+
+    tail->count--;
+    archetype->entity_count--;
+    if (tail->count == 0) ecs_chunk_release(world, tail);
+
+}
+
+// Returns false, leaving the entity where it was, if the archetype or chunk
+// tables are full.
+static b32
+ecs_entity_move(ecs_world *world, ecs_entity entity, ecs_mask new_mask)
+{
+
+    ecs_entity_location *location = world->entities + ecs_entity_index(entity);
+    ecs_chunk *source_chunk = location->chunk;
+    u32 source_row = location->row;
+    ecs_archetype *source = source_chunk->archetype;
+    ecs_archetype *destination = ecs_archetype_acquire(world, new_mask);
+    if (destination == NULL) return false;
+
+    ecs_chunk *chunk;
+    u32 row;
+    if (!ecs_archetype_allocate_row(world, destination, entity, &chunk, &row)) return false;
+
+    // Carry over shared components, zero the new ones.
+    for (u32 c = 0; c < world->component_count; ++c)
+    {
+
+        u32 destination_offset = destination->column_offsets[c];
+        if (destination_offset == 0) continue;
+
+        u32 size = world->components[c].size;
+        u8 *target = ecs_chunk_column(chunk, destination_offset) + (u64)size * row;
+        u32 source_offset = source->column_offsets[c];
+        if (source_offset != 0)
+            memcpy(target, ecs_chunk_column(source_chunk, source_offset) + (u64)size * source_row, size);
+        else
+            memset(target, 0, size);
+
+    }
+
+    ecs_archetype_remove_row(world, source_chunk, source_row);
+
+    location->chunk = chunk;
+    location->row = row;
+    return true;
+
+}
+
+// --- World & Entities --------------------------------------------------------
+
+void
+ecs_world_create(ecs_world *world, memory_arena *arena, u32 entity_capacity, u64 chunk_limit)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(entity_capacity <= ECS_INDEX_MASK);
+
+    memset(world, 0, sizeof(ecs_world));
+
+    // The chunks get their own partition so that arena save/restore by other
+    // systems can never reclaim them.
+    u64 chunk_bytes = chunk_limit * ECS_CHUNK_SIZE + ECS_CHUNK_ALIGNMENT;
+    memory_arena_partition(arena, &world->chunk_arena, chunk_bytes);
+    u64 misalignment = (u64)world->chunk_arena.buffer % ECS_CHUNK_ALIGNMENT;
+    if (misalignment != 0) memory_arena_push(&world->chunk_arena, ECS_CHUNK_ALIGNMENT - misalignment);
+
+    world->chunk_limit      = chunk_limit;
+    world->dispatch_guard   = new (memory_arena_push_type(arena, ecs_dispatch_guard)) ecs_dispatch_guard();
+    world->chunk_scratch    = memory_arena_push_array(arena, ecs_chunk*, chunk_limit);
+    world->entities         = memory_arena_push_array(arena, ecs_entity_location, entity_capacity);
+    world->free_entities    = memory_arena_push_array(arena, u32, entity_capacity);
+    world->entity_capacity  = entity_capacity;
+
+}
+
+u32
+ecs_component_register(ecs_world *world, u32 size, u32 alignment)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(world->component_count < ECS_MAX_COMPONENTS);
+    NX_ASSERT(size > 0);
+    NX_ASSERT(alignment > 0 && (alignment & (alignment - 1)) == 0);
+    NX_ASSERT(alignment <= ECS_CHUNK_ALIGNMENT);
+
+    // Components registered after archetypes exist would not appear in their
+    // layouts, so register everything before creating entities.
+    NX_ASSERT(world->archetype_count == 0);
+
+    u32 component = world->component_count++;
+    world->components[component].size = size;
+    world->components[component].alignment = alignment;
+    return component;
+
+}
+
+ecs_entity
+ecs_entity_create(ecs_world *world, ecs_mask components)
+{
+
+    NX_ENSURE_POINTER(world);
+
+    ecs_archetype *archetype = ecs_archetype_acquire(world, components);
+    if (archetype == NULL) return ECS_NULL_ENTITY;
+
+    u32 index;
+    if (world->free_entity_count > 0)
+        index = world->free_entities[--world->free_entity_count];
+    else
+    {
+        NX_ASSERT(world->entity_high_water < world->entity_capacity);
+        if (world->entity_high_water >= world->entity_capacity) return ECS_NULL_ENTITY;
+        index = world->entity_high_water++;
+        world->entities[index].generation = 0;
+    }
+
+    ecs_entity_location *location = world->entities + index;
+    ecs_entity entity = index | (location->generation << ECS_INDEX_BITS);
+
+    if (!ecs_archetype_allocate_row(world, archetype, entity, &location->chunk, &location->row))
+    {
+        location->chunk = NULL;
+        world->free_entities[world->free_entity_count++] = index;
+        return ECS_NULL_ENTITY;
+    }
+    for (u32 c = 0; c < world->component_count; ++c)
+    {
+        u32 offset = archetype->column_offsets[c];
+        if (offset == 0) continue;
+        u32 size = world->components[c].size;
+        memset(ecs_chunk_column(location->chunk, offset) + (u64)size * location->row, 0, size);
+    }
+
+    world->live_entity_count++;
+    return entity;
+
+}
+
+b32
+ecs_entity_is_alive(ecs_world *world, ecs_entity entity)
+{
+
+    NX_ENSURE_POINTER(world);
+    if (entity & ECS_PENDING_BIT) return false;
+
+    u32 index = ecs_entity_index(entity);
+    if (index >= world->entity_high_water) return false;
+
+    ecs_entity_location *location = world->entities + index;
+    return location->chunk != NULL && location->generation == ecs_entity_generation(entity);
+
+}
+
+void
+ecs_entity_destroy(ecs_world *world, ecs_entity entity)
+{
+
+    if (!ecs_entity_is_alive(world, entity)) return;
+
+    u32 index = ecs_entity_index(entity);
+    ecs_entity_location *location = world->entities + index;
+    ecs_archetype_remove_row(world, location->chunk, location->row);
+
+    location->chunk = NULL;
+    location->row = 0;
+    location->generation = (location->generation + 1) & ECS_GENERATION_MASK;
+    world->free_entities[world->free_entity_count++] = index;
+    world->live_entity_count--;
+
+}
+
+ecs_mask
+ecs_entity_get_mask(ecs_world *world, ecs_entity entity)
+{
+
+    if (!ecs_entity_is_alive(world, entity)) return 0;
+    return world->entities[ecs_entity_index(entity)].chunk->archetype->mask;
+
+}
+
+vptr
+ecs_entity_get_component(ecs_world *world, ecs_entity entity, u32 component)
+{
+
+    if (!ecs_entity_is_alive(world, entity)) return NULL;
+
+    ecs_entity_location *location = world->entities + ecs_entity_index(entity);
+    u32 offset = location->chunk->archetype->column_offsets[component];
+    if (offset == 0) return NULL;
+
+    return ecs_chunk_column(location->chunk, offset) +
+        (u64)world->components[component].size * location->row;
+
+}
+
+b32
+ecs_entity_add_component(ecs_world *world, ecs_entity entity, u32 component, vptr data)
+{
+
+    if (!ecs_entity_is_alive(world, entity)) return false;
+    NX_ASSERT(component < world->component_count);
+
+    ecs_mask mask = ecs_entity_get_mask(world, entity);
+    if (!(mask & ECS_COMPONENT_BIT(component)) &&
+        !ecs_entity_move(world, entity, mask | ECS_COMPONENT_BIT(component)))
+        return false;
+
+    vptr target = ecs_entity_get_component(world, entity, component);
+    if (target == NULL) return false;
+    if (data != NULL) memcpy(target, data, world->components[component].size);
+    return true;
+
+}
+
+void
+ecs_entity_remove_component(ecs_world *world, ecs_entity entity, u32 component)
+{
+
+    if (!ecs_entity_is_alive(world, entity)) return;
+
+    ecs_mask mask = ecs_entity_get_mask(world, entity);
+    if (mask & ECS_COMPONENT_BIT(component))
+        ecs_entity_move(world, entity, mask & ~ECS_COMPONENT_BIT(component));
+
+}
+
+// --- Queries -----------------------------------------------------------------
+
+static inline b32
+ecs_query_matches(ecs_query *query, ecs_archetype *archetype)
+{
+
+    return ((archetype->mask & query->include) == query->include) &&
+        ((archetype->mask & query->exclude) == 0);
+
+}
+
+static inline void
+ecs_chunk_view_from_chunk(ecs_chunk_view *view, ecs_chunk *chunk)
+{
+
+    view->chunk     = chunk;
+    view->archetype = chunk->archetype;
+    view->entities  = ecs_chunk_entities(chunk);
+    view->count     = chunk->count;
+
+}
+
+vptr
+ecs_chunk_get_column(ecs_chunk_view *view, u32 component)
+{
+
+    NX_ENSURE_POINTER(view);
+    u32 offset = view->archetype->column_offsets[component];
+    if (offset == 0) return NULL;
+    return ecs_chunk_column(view->chunk, offset);
+
+}
+
+u64
+ecs_query_count(ecs_world *world, ecs_query *query)
+{
+
+    u64 count = 0;
+    for (u32 a = 0; a < world->archetype_count; ++a)
+    {
+        ecs_archetype *archetype = world->archetypes + a;
+        if (ecs_query_matches(query, archetype)) count += archetype->entity_count;
+    }
+
+    return count;
+
+}
+
+static void
+ecs_query_walk(ecs_world *world, ecs_query *query, ecs_chunk_proc proc, vptr user_data,
+        u64 first_archetype, u64 last_archetype, u32 worker_index)
+{
+
+    for (u64 a = first_archetype; a < last_archetype; ++a)
+    {
+
+        ecs_archetype *archetype = world->archetypes + a;
+        if (!ecs_query_matches(query, archetype)) continue;
+
+        for (ecs_chunk *chunk = archetype->head; chunk != NULL; chunk = chunk->next)
+        {
+            ecs_chunk_view view;
+            ecs_chunk_view_from_chunk(&view, chunk);
+            proc(world, &view, user_data, worker_index);
+        }
+
+    }
+
+}
+
+void
+ecs_query_for_each(ecs_world *world, ecs_query *query, ecs_chunk_proc proc, vptr user_data)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(query);
+    NX_ENSURE_POINTER(proc);
+
+    ecs_query_walk(world, query, proc, user_data, 0, world->archetype_count, 0);
+
+}
+
+static void
+ecs_query_dispatch_archetypes(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    ecs_dispatch_context *context = (ecs_dispatch_context*)user_data;
+    ecs_query_walk(context->world, context->query, context->proc, context->user_data,
+            begin, end, worker_index);
+
+}
+
+static void
+ecs_query_dispatch_chunks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    ecs_dispatch_context *context = (ecs_dispatch_context*)user_data;
+    for (u64 i = begin; i < end; ++i)
+    {
+        ecs_chunk_view view;
+        ecs_chunk_view_from_chunk(&view, context->chunks[i]);
+        context->proc(context->world, &view, context->user_data, worker_index);
+    }
+
+}
+
+void
+ecs_query_dispatch(ecs_world *world, ecs_query *query, ecs_chunk_proc proc, vptr user_data)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(query);
+    NX_ENSURE_POINTER(proc);
+
+    ecs_dispatch_context context = {};
+    context.world       = world;
+    context.query       = query;
+    context.chunks      = world->chunk_scratch;
+    context.proc        = proc;
+    context.user_data   = user_data;
+
+    // The chunk list lives in the world, so only one dispatch at a time gets
+    // it. Any other, nested or from another thread, hands out whole archetypes
+    // instead, which still gets each a worker index no other thread is using.
+    std::atomic<b32> *dispatching = &world->dispatch_guard->active;
+    if (dispatching->exchange(true, std::memory_order_acquire))
+    {
+        jobs_parallel_for(world->archetype_count, 1, ecs_query_dispatch_archetypes, &context);
+        return;
+    }
+
+    u64 chunk_count = 0;
+    for (u32 a = 0; a < world->archetype_count; ++a)
+    {
+        ecs_archetype *archetype = world->archetypes + a;
+        if (!ecs_query_matches(query, archetype)) continue;
+        for (ecs_chunk *chunk = archetype->head; chunk != NULL; chunk = chunk->next)
+            context.chunks[chunk_count++] = chunk;
+    }
+
+    jobs_parallel_for(chunk_count, 1, ecs_query_dispatch_chunks, &context);
+    dispatching->store(false, std::memory_order_release);
+
+}
+
+// --- Command Buffers ---------------------------------------------------------
+
+void
+ecs_command_buffer_create(ecs_command_buffer *commands, ecs_world *world,
+        memory_arena *arena, u64 size)
+{
+
+    NX_ENSURE_POINTER(commands);
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(arena);
+
+    commands->world         = world;
+    commands->size          = ecs_align_up(size, ECS_COMMAND_ALIGNMENT);
+    commands->buffer        = (u8*)memory_arena_push(arena, commands->size + ECS_COMMAND_ALIGNMENT);
+    commands->buffer        = (u8*)ecs_align_up((u64)commands->buffer, ECS_COMMAND_ALIGNMENT);
+    commands->offset        = 0;
+    commands->pending_count = 0;
+
+}
+
+static ecs_command_header*
+ecs_command_push(ecs_command_buffer *commands, ecs_command_type type, ecs_entity entity,
+        u32 component, vptr data, u32 data_size)
+{
+
+    u64 record_size = ecs_align_up(sizeof(ecs_command_header) + data_size, ECS_COMMAND_ALIGNMENT);
+    NX_ASSERT(commands->offset + record_size <= commands->size); // Command buffer overflow.
+    if (commands->offset + record_size > commands->size) return NULL;
+
+    ecs_command_header *header = (ecs_command_header*)(commands->buffer + commands->offset);
+    header->type        = (u16)type;
+    header->component   = (u16)component;
+    header->entity      = entity;
+    header->mask        = 0;
+    header->data_size   = data_size;
+    header->record_size = (u32)record_size;
+    if (data_size > 0) memcpy(header + 1, data, data_size);
+
+    commands->offset += record_size;
+    return header;
+
+}
+
+ecs_entity
+ecs_command_create_entity(ecs_command_buffer *commands, ecs_mask components)
+{
+
+    NX_ENSURE_POINTER(commands);
+
+    // Pending handles are the record offset of their create command, so that
+    // playback can resolve them without any side table.
+    u64 offset = commands->offset;
+    ecs_command_header *header = ecs_command_push(commands, ECS_COMMAND_CREATE,
+            ECS_NULL_ENTITY, 0, NULL, 0);
+    if (header == NULL) return ECS_NULL_ENTITY;
+
+    header->mask = components;
+    commands->pending_count++;
+    return ECS_PENDING_BIT | (ecs_entity)(offset / ECS_COMMAND_ALIGNMENT);
+
+}
+
+void
+ecs_command_destroy_entity(ecs_command_buffer *commands, ecs_entity entity)
+{
+
+    NX_ENSURE_POINTER(commands);
+    ecs_command_push(commands, ECS_COMMAND_DESTROY, entity, 0, NULL, 0);
+
+}
+
+void
+ecs_command_add_component(ecs_command_buffer *commands, ecs_entity entity,
+        u32 component, vptr data)
+{
+
+    NX_ENSURE_POINTER(commands);
+    u32 size = (data != NULL) ? commands->world->components[component].size : 0;
+    ecs_command_push(commands, ECS_COMMAND_ADD, entity, component, data, size);
+
+}
+
+void
+ecs_command_set_component(ecs_command_buffer *commands, ecs_entity entity,
+        u32 component, vptr data)
+{
+
+    NX_ENSURE_POINTER(commands);
+    NX_ENSURE_POINTER(data);
+    u32 size = commands->world->components[component].size;
+    ecs_command_push(commands, ECS_COMMAND_SET, entity, component, data, size);
+
+}
+
+void
+ecs_command_remove_component(ecs_command_buffer *commands, ecs_entity entity,
+        u32 component)
+{
+
+    NX_ENSURE_POINTER(commands);
+    ecs_command_push(commands, ECS_COMMAND_REMOVE, entity, component, NULL, 0);
+
+}
+
+void
+ecs_command_buffer_playback(ecs_command_buffer *commands)
+{
+
+    NX_ENSURE_POINTER(commands);
+    ecs_world *world = commands->world;
+
+    u64 offset = 0;
+    while (offset < commands->offset)
+    {
+
+        ecs_command_header *header = (ecs_command_header*)(commands->buffer + offset);
+        vptr data = (header->data_size > 0) ? (vptr)(header + 1) : NULL;
+
+        ecs_entity entity = header->entity;
+        if (header->type != ECS_COMMAND_CREATE && entity != ECS_NULL_ENTITY &&
+            (entity & ECS_PENDING_BIT))
+        {
+            u64 create_offset = (u64)(entity & ~ECS_PENDING_BIT) * ECS_COMMAND_ALIGNMENT;
+            entity = ((ecs_command_header*)(commands->buffer + create_offset))->entity;
+        }
+
+        switch (header->type)
+        {
+            case ECS_COMMAND_CREATE:
+            {
+                header->entity = ecs_entity_create(world, header->mask);
+            } break;
+
+            case ECS_COMMAND_DESTROY:
+            {
+                ecs_entity_destroy(world, entity);
+            } break;
+
+            case ECS_COMMAND_ADD:
+            {
+                ecs_entity_add_component(world, entity, header->component, data);
+            } break;
+
+            case ECS_COMMAND_SET:
+            {
+                vptr target = ecs_entity_get_component(world, entity, header->component);
+                if (target != NULL) memcpy(target, data, header->data_size);
+            } break;
+
+            case ECS_COMMAND_REMOVE:
+            {
+                ecs_entity_remove_component(world, entity, header->component);
+            } break;
+        }
+
+        offset += header->record_size;
+
+    }
+
+    commands->offset = 0;
+    commands->pending_count = 0;
+
+}
@@ -0,0 +1,167 @@
+#ifndef SRC_ENGINE_ECS_H
+#define SRC_ENGINE_ECS_H
+#include <core/definitions.h>
+#include <core/arena.h>
+
+// --- Entity Component System -------------------------------------------------
+//
+// An archetype based entity component system. Every unique set of components is
+// an archetype, and every entity with exactly that set lives in one of the
+// archetype's chunks. A chunk is a fixed 16KB block carved out of the world's
+// arena which stores its entities as structure-of-arrays: one column for the
+// entity handles followed by one column per component. All chunks of an archetype
+// except the last are full, so iterating a query is a linear walk over tightly
+// packed columns with no per-entity indirection.
+//
+// Components are registered up front and identified by a small integer, which
+// also serves as its bit in an ecs_mask. There are at most 64 components.
+//
+// Structural changes (creating or destroying entities, adding or removing
+// components) move entities between chunks and invalidate column pointers. The
+// immediate functions are fine to call outside of a query. Inside a query, and
+// always from worker threads, record the change into an ecs_command_buffer and
+// play it back once the query has finished. Entities created through a command
+// buffer are returned as pending handles which are only valid for use with that
+// same command buffer until it has been played back.
+//
+// Queries are plain include/exclude masks. ecs_query_for_each walks matching
+// chunks on the calling thread; ecs_query_dispatch hands the same chunks out to
+// the job system, one chunk per job, with the worker index available so callers
+// can record into per-worker command buffers. Only one dispatch per world hands
+// out single chunks at a time; one nested in it, or issued from another thread
+// meanwhile, hands out whole archetypes instead.
+//
+// Entity handles hold a 20 bit index and an 11 bit generation, so a world has
+// at most 1M entities, and a stale handle is told apart from the entities which
+// reuse its slot for 2047 reuses. The 2048th entity in the slot has the same
+// handle again; don't keep handles around for that long.
+//
+
+#define ECS_CHUNK_SIZE              NX_KILOBYTES(16)
+#define ECS_MAX_COMPONENTS          64
+#define ECS_MAX_ARCHETYPES          256
+#define ECS_NULL_ENTITY             0xFFFFFFFF
+#define ECS_COMPONENT_BIT(id)       ((ecs_mask)1 << (id))
+
+typedef u32 ecs_entity;
+typedef u64 ecs_mask;
+
+typedef struct ecs_component_info
+{
+    u32 size;
+    u32 alignment;
+} ecs_component_info;
+
+typedef struct ecs_chunk
+{
+    struct ecs_archetype *archetype;
+    struct ecs_chunk *next;
+    struct ecs_chunk *previous;
+    u32 count;
+} ecs_chunk;
+
+typedef struct ecs_archetype
+{
+    ecs_mask mask;
+    u32 chunk_capacity;                         // Entities per chunk.
+    u32 entity_count;
+    u32 chunk_count;
+    u16 column_offsets[ECS_MAX_COMPONENTS];     // Byte offset in chunk, zero if absent.
+    u16 entity_column_offset;
+    ecs_chunk *head;
+    ecs_chunk *tail;                            // Only the tail may be partially full.
+} ecs_archetype;
+
+typedef struct ecs_entity_location
+{
+    ecs_chunk *chunk;
+    u32 row;
+    u32 generation;
+} ecs_entity_location;
+
+typedef struct ecs_world
+{
+
+    memory_arena chunk_arena;
+    ecs_chunk *free_chunks;
+    ecs_chunk **chunk_scratch;      // Collected chunks for dispatched queries.
+    struct ecs_dispatch_guard *dispatch_guard;  // Claims chunk_scratch for one dispatch.
+    u64 chunk_limit;
+
+    ecs_component_info components[ECS_MAX_COMPONENTS];
+    u32 component_count;
+
+    ecs_archetype archetypes[ECS_MAX_ARCHETYPES];
+    u32 archetype_count;
+
+    ecs_entity_location *entities;
+    u32 *free_entities;
+    u32 entity_capacity;
+    u32 entity_high_water;
+    u32 free_entity_count;
+    u32 live_entity_count;
+
+} ecs_world;
+
+typedef struct ecs_query
+{
+    ecs_mask include;
+    ecs_mask exclude;
+} ecs_query;
+
+typedef struct ecs_chunk_view
+{
+    ecs_chunk *chunk;
+    ecs_archetype *archetype;
+    ecs_entity *entities;
+    u32 count;
+} ecs_chunk_view;
+
+typedef void (*ecs_chunk_proc)(ecs_world *world, ecs_chunk_view *view, vptr user_data, u32 worker_index);
+
+typedef struct ecs_command_buffer
+{
+    ecs_world *world;
+    u8 *buffer;
+    u64 size;
+    u64 offset;
+    u32 pending_count;
+} ecs_command_buffer;
+
+// --- World & Entities --------------------------------------------------------
+
+void        ecs_world_create(ecs_world *world, memory_arena *arena, u32 entity_capacity, u64 chunk_limit);
+u32         ecs_component_register(ecs_world *world, u32 size, u32 alignment);
+
+ecs_entity  ecs_entity_create(ecs_world *world, ecs_mask components);
+void        ecs_entity_destroy(ecs_world *world, ecs_entity entity);
+b32         ecs_entity_is_alive(ecs_world *world, ecs_entity entity);
+ecs_mask    ecs_entity_get_mask(ecs_world *world, ecs_entity entity);
+vptr        ecs_entity_get_component(ecs_world *world, ecs_entity entity, u32 component);
+// False, leaving the entity as it was, if the entity is dead or the archetype or
+// chunk tables are full.
+b32         ecs_entity_add_component(ecs_world *world, ecs_entity entity, u32 component, vptr data);
+void        ecs_entity_remove_component(ecs_world *world, ecs_entity entity, u32 component);
+
+// --- Queries -----------------------------------------------------------------
+
+vptr        ecs_chunk_get_column(ecs_chunk_view *view, u32 component);
+u64         ecs_query_count(ecs_world *world, ecs_query *query);
+void        ecs_query_for_each(ecs_world *world, ecs_query *query, ecs_chunk_proc proc, vptr user_data);
+void        ecs_query_dispatch(ecs_world *world, ecs_query *query, ecs_chunk_proc proc, vptr user_data);
+
+// --- Command Buffers ---------------------------------------------------------
+
+void        ecs_command_buffer_create(ecs_command_buffer *commands, ecs_world *world,
+                memory_arena *arena, u64 size);
+ecs_entity  ecs_command_create_entity(ecs_command_buffer *commands, ecs_mask components);
+void        ecs_command_destroy_entity(ecs_command_buffer *commands, ecs_entity entity);
+void        ecs_command_add_component(ecs_command_buffer *commands, ecs_entity entity,
+                u32 component, vptr data);
+void        ecs_command_set_component(ecs_command_buffer *commands, ecs_entity entity,
+                u32 component, vptr data);
+void        ecs_command_remove_component(ecs_command_buffer *commands, ecs_entity entity,
+                u32 component);
+void        ecs_command_buffer_playback(ecs_command_buffer *commands);
+
+#endif
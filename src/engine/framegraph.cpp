@@ -0,0 +1,552 @@
+#include <engine/framegraph.h>
+#include <platform/system.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string.h>
+#include <stdio.h>
+
+#define FRAME_GRAPH_NO_NODE     0xFFFFFFFF
+
+typedef struct frame_graph_slot
+{
+    b32 active;
+    u64 frame_index;
+    u64 frame_begin;
+    u64 started;                        // Node masks.
+    u64 completed;
+    u64 node_begin[FRAME_GRAPH_MAX_NODES];
+    u64 node_end[FRAME_GRAPH_MAX_NODES];
+    u32 node_thread[FRAME_GRAPH_MAX_NODES];
+} frame_graph_slot;
+
+typedef struct frame_graph_state
+{
+    std::thread workers[FRAME_GRAPH_MAX_WORKERS];
+    std::mutex lock;
+    std::condition_variable signal;     // Any node finished, or a frame started.
+    frame_graph *graph;
+    b32 shutdown;
+    u64 all_nodes;
+    u64 main_nodes;
+    frame_graph_slot slots[FRAME_GRAPH_FRAMES_IN_FLIGHT];
+} frame_graph_state;
+
+static inline frame_graph_state* get_frame_graph_state() { static frame_graph_state fs; return &fs; }
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+frame_graph_bit(u32 index)
+{
+
+    return 1ULL << index;
+
+}
+
+static inline frame_graph_slot*
+frame_graph_previous_slot(frame_graph_state *state, frame_graph_slot *slot)
+{
+
+    if (slot->frame_index == 0) return NULL;
+    frame_graph_slot *previous = state->slots + ((slot->frame_index - 1) % FRAME_GRAPH_FRAMES_IN_FLIGHT);
+    if (!previous->active || previous->frame_index != slot->frame_index - 1) return NULL;
+    return previous;
+
+}
+
+static b32
+frame_graph_node_is_ready(frame_graph_state *state, frame_graph_slot *slot, u32 node_index)
+{
+
+    frame_graph_node *node = state->graph->nodes + node_index;
+    u64 bit = frame_graph_bit(node_index);
+    if (slot->started & bit) return false;
+    if ((node->dependencies & ~slot->completed) != 0) return false;
+
+    frame_graph_slot *previous = frame_graph_previous_slot(state, slot);
+    if (previous != NULL && (node->previous_dependencies & ~previous->completed) != 0) return false;
+    return true;
+
+}
+
+// Finds a ready node among the candidates of a slot, or FRAME_GRAPH_NO_NODE.
+static u32
+frame_graph_find_ready(frame_graph_state *state, frame_graph_slot *slot, u64 candidates)
+{
+
+    if (!slot->active) return FRAME_GRAPH_NO_NODE;
+
+    u64 remaining = candidates & ~slot->started;
+    for (u32 node_index = 0; remaining != 0; ++node_index)
+    {
+        u64 bit = frame_graph_bit(node_index);
+        if (!(remaining & bit)) continue;
+        remaining &= ~bit;
+        if (frame_graph_node_is_ready(state, slot, node_index)) return node_index;
+    }
+
+    return FRAME_GRAPH_NO_NODE;
+
+}
+
+// Moves the timings of a finished frame into the nodes.
+static void
+frame_graph_retire(frame_graph_state *state, frame_graph_slot *slot)
+{
+
+    frame_graph *graph = state->graph;
+    u64 frame_end = slot->frame_begin;
+    u32 last_node = FRAME_GRAPH_NO_NODE;
+
+    for (u32 i = 0; i < graph->node_count; ++i)
+    {
+
+        frame_graph_node *node = graph->nodes + i;
+        u64 ready = slot->frame_begin;
+        for (u32 j = 0; j < i; ++j)
+        {
+            if ((node->dependencies & frame_graph_bit(j)) && slot->node_end[j] > ready)
+                ready = slot->node_end[j];
+        }
+
+        node->begin_milliseconds = system_timestamp_difference_ms(slot->frame_begin, slot->node_begin[i]);
+        node->end_milliseconds = system_timestamp_difference_ms(slot->frame_begin, slot->node_end[i]);
+        node->wait_milliseconds = (slot->node_begin[i] > ready) ?
+            system_timestamp_difference_ms(ready, slot->node_begin[i]) : 0.0;
+        node->thread_index = slot->node_thread[i];
+
+        r64 duration = node->end_milliseconds - node->begin_milliseconds;
+        if (graph->completed_frames == 0) node->average_milliseconds = duration;
+        else node->average_milliseconds += (duration - node->average_milliseconds) / 16.0;
+
+        if (slot->node_end[i] >= frame_end)
+        {
+            frame_end = slot->node_end[i];
+            last_node = i;
+        }
+
+    }
+
+    // Walk back from the last node to finish through whichever dependency
+    // finished last each time.
+    graph->critical_path = 0;
+    while (last_node != FRAME_GRAPH_NO_NODE)
+    {
+        graph->critical_path |= frame_graph_bit(last_node);
+        u64 dependencies = graph->nodes[last_node].dependencies;
+        u32 latest = FRAME_GRAPH_NO_NODE;
+        for (u32 j = 0; j < graph->node_count; ++j)
+        {
+            if (!(dependencies & frame_graph_bit(j))) continue;
+            if (latest == FRAME_GRAPH_NO_NODE || slot->node_end[j] > slot->node_end[latest]) latest = j;
+        }
+        last_node = latest;
+    }
+
+    graph->frame_milliseconds = system_timestamp_difference_ms(slot->frame_begin, frame_end);
+    graph->completed_frames++;
+    slot->active = false;
+
+}
+
+// Runs a node with the lock released, then marks it done. The lock is held on
+// entry and on return.
+static void
+frame_graph_run_node(frame_graph_state *state, frame_graph_slot *slot, u32 node_index,
+        u32 thread_index, std::unique_lock<std::mutex> &lock)
+{
+
+    frame_graph_node *node = state->graph->nodes + node_index;
+    u64 frame_index = slot->frame_index;
+    slot->started |= frame_graph_bit(node_index);
+    slot->node_thread[node_index] = thread_index;
+    slot->node_begin[node_index] = system_timestamp();
+
+    lock.unlock();
+    node->proc(node->user_data, frame_index);
+    u64 end = system_timestamp();
+    lock.lock();
+
+    slot->node_end[node_index] = end;
+    slot->completed |= frame_graph_bit(node_index);
+    if (slot->completed == state->all_nodes) frame_graph_retire(state, slot);
+    state->signal.notify_all();
+
+}
+
+static void
+frame_graph_worker_main(u32 thread_index)
+{
+
+    frame_graph_state *state = get_frame_graph_state();
+    std::unique_lock<std::mutex> lock(state->lock);
+
+    for (;;)
+    {
+
+        // The older frame goes first.
+        frame_graph_slot *slot = NULL;
+        u32 node_index = FRAME_GRAPH_NO_NODE;
+        state->signal.wait(lock, [&]{
+            if (state->shutdown) return true;
+            frame_graph_slot *first = state->slots + 0;
+            frame_graph_slot *second = state->slots + 1;
+            if (first->active && second->active && second->frame_index < first->frame_index)
+            {
+                first = state->slots + 1;
+                second = state->slots + 0;
+            }
+
+            u64 workers = state->all_nodes & ~state->main_nodes;
+            slot = first;
+            node_index = frame_graph_find_ready(state, slot, workers);
+            if (node_index != FRAME_GRAPH_NO_NODE) return true;
+            slot = second;
+            node_index = frame_graph_find_ready(state, slot, workers);
+            return node_index != FRAME_GRAPH_NO_NODE;
+        });
+
+        if (state->shutdown) return;
+        frame_graph_run_node(state, slot, node_index, thread_index, lock);
+
+    }
+
+}
+
+// --- Frame Graph -------------------------------------------------------------
+
+b32
+frame_graph_create(frame_graph *graph, u32 worker_count)
+{
+
+    NX_ENSURE_POINTER(graph);
+    frame_graph_state *state = get_frame_graph_state();
+    NX_ASSERT(state->graph == NULL);
+    if (state->graph != NULL) return false;
+
+    // Worker stages need somewhere to run besides the main thread, which only
+    // helps out while it waits.
+    if (worker_count == 0)
+    {
+        u32 hardware_threads = std::thread::hardware_concurrency();
+        worker_count = (hardware_threads > 2) ? hardware_threads / 2 : 1;
+    }
+    if (worker_count > FRAME_GRAPH_MAX_WORKERS) worker_count = FRAME_GRAPH_MAX_WORKERS;
+
+    memset(graph, 0, sizeof(frame_graph));
+    graph->worker_count = worker_count;
+
+    state->graph = graph;
+    state->shutdown = false;
+    state->all_nodes = 0;
+    state->main_nodes = 0;
+    memset(state->slots, 0, sizeof(state->slots));
+    for (u32 i = 0; i < worker_count; ++i)
+        state->workers[i] = std::thread(frame_graph_worker_main, i + 1);
+
+    return true;
+
+}
+
+void
+frame_graph_delete(frame_graph *graph)
+{
+
+    NX_ENSURE_POINTER(graph);
+    frame_graph_state *state = get_frame_graph_state();
+    NX_ASSERT(state->graph == graph);
+
+    frame_graph_wait(graph);
+    {
+        std::lock_guard<std::mutex> lock(state->lock);
+        state->shutdown = true;
+    }
+    state->signal.notify_all();
+
+    for (u32 i = 0; i < graph->worker_count; ++i)
+        state->workers[i].join();
+
+    state->graph = NULL;
+
+}
+
+frame_resource
+frame_graph_add_resource(frame_graph *graph, ccptr name, u32 copies)
+{
+
+    NX_ENSURE_POINTER(graph);
+    NX_ASSERT(!graph->compiled);
+    NX_ASSERT(graph->resource_count < FRAME_GRAPH_MAX_RESOURCES);
+    NX_ASSERT(copies >= 1);
+
+    frame_resource resource = graph->resource_count++;
+    graph->resources[resource].name = name;
+    graph->resources[resource].copies = copies;
+    return resource;
+
+}
+
+frame_node
+frame_graph_add_node(frame_graph *graph, ccptr name, frame_node_proc proc, vptr user_data, u32 flags)
+{
+
+    NX_ENSURE_POINTER(graph);
+    NX_ENSURE_POINTER(proc);
+    NX_ASSERT(!graph->compiled);
+    NX_ASSERT(graph->node_count < FRAME_GRAPH_MAX_NODES);
+
+    frame_node node = graph->node_count++;
+    frame_graph_node *current = graph->nodes + node;
+    memset(current, 0, sizeof(frame_graph_node));
+    current->name = name;
+    current->proc = proc;
+    current->user_data = user_data;
+    current->flags = flags;
+    return node;
+
+}
+
+void
+frame_graph_node_access(frame_graph *graph, frame_node node, frame_resource resource, frame_access access)
+{
+
+    NX_ENSURE_POINTER(graph);
+    NX_ASSERT(!graph->compiled);
+    NX_ASSERT(node < graph->node_count);
+    NX_ASSERT(resource < graph->resource_count);
+
+    frame_graph_node *current = graph->nodes + node;
+    u64 bit = frame_graph_bit(resource);
+    switch (access)
+    {
+        case FRAME_ACCESS_READ:
+        {
+            current->reads |= bit;
+        } break;
+
+        case FRAME_ACCESS_WRITE:
+        {
+            current->writes |= bit;
+        } break;
+
+        case FRAME_ACCESS_READ_PREVIOUS:
+        {
+            // With one copy the previous frame's contents are already gone.
+            NX_ASSERT(graph->resources[resource].copies >= 2);
+            current->reads_previous |= bit;
+        } break;
+
+        default:
+        {
+            NX_ASSERT(!"Unknown frame access.");
+        } break;
+    }
+
+}
+
+void
+frame_graph_compile(frame_graph *graph)
+{
+
+    NX_ENSURE_POINTER(graph);
+    frame_graph_state *state = get_frame_graph_state();
+    NX_ASSERT(state->graph == graph);
+
+    // Copies are picked by frame index, so consecutive frames use the same copy
+    // of single copy resources, and frame N writes the copy frame N - 1 read as
+    // previous when there are exactly two.
+    u64 single_copy = 0;
+    u64 double_copy = 0;
+    for (u32 r = 0; r < graph->resource_count; ++r)
+    {
+        if (graph->resources[r].copies == 1) single_copy |= frame_graph_bit(r);
+        if (graph->resources[r].copies == 2) double_copy |= frame_graph_bit(r);
+    }
+
+    u64 all_nodes = 0;
+    u64 main_nodes = 0;
+    for (u32 i = 0; i < graph->node_count; ++i)
+    {
+
+        frame_graph_node *node = graph->nodes + i;
+        u64 touched = node->reads | node->writes;
+        node->dependencies = 0;
+        node->previous_dependencies = frame_graph_bit(i);
+
+        for (u32 j = 0; j < graph->node_count; ++j)
+        {
+
+            frame_graph_node *other = graph->nodes + j;
+            u64 same_copy = (other->writes & touched) | (other->reads & node->writes);
+
+            if (j < i && same_copy != 0)
+                node->dependencies |= frame_graph_bit(j);
+
+            u64 across = (same_copy & single_copy)
+                | (node->reads_previous & other->writes)
+                | (node->writes & other->reads_previous & double_copy);
+            if (across != 0)
+                node->previous_dependencies |= frame_graph_bit(j);
+
+        }
+
+        all_nodes |= frame_graph_bit(i);
+        if (node->flags & FRAME_NODE_MAIN_THREAD) main_nodes |= frame_graph_bit(i);
+
+    }
+
+    std::lock_guard<std::mutex> lock(state->lock);
+    state->all_nodes = all_nodes;
+    state->main_nodes = main_nodes;
+    graph->compiled = true;
+
+}
+
+void
+frame_graph_execute(frame_graph *graph)
+{
+
+    NX_ENSURE_POINTER(graph);
+    NX_ASSERT(graph->compiled);
+    frame_graph_state *state = get_frame_graph_state();
+    NX_ASSERT(state->graph == graph);
+
+    std::unique_lock<std::mutex> lock(state->lock);
+
+    // Frame N - 2 finished before the last execute returned.
+    frame_graph_slot *slot = state->slots + (graph->frame_index % FRAME_GRAPH_FRAMES_IN_FLIGHT);
+    NX_ASSERT(!slot->active);
+    slot->active = true;
+    slot->frame_index = graph->frame_index;
+    slot->frame_begin = system_timestamp();
+    slot->started = 0;
+    slot->completed = 0;
+    graph->frame_index++;
+
+    if (state->all_nodes == 0)
+    {
+        frame_graph_retire(state, slot);
+        return;
+    }
+
+    state->signal.notify_all();
+
+    u64 previous_workers = state->all_nodes & ~state->main_nodes;
+    for (;;)
+    {
+
+        frame_graph_slot *previous = frame_graph_previous_slot(state, slot);
+        b32 main_done = !slot->active || (slot->completed & state->main_nodes) == state->main_nodes;
+        if (main_done && previous == NULL) break;
+
+        u32 node_index = frame_graph_find_ready(state, slot, state->main_nodes);
+        if (node_index != FRAME_GRAPH_NO_NODE)
+        {
+            frame_graph_run_node(state, slot, node_index, 0, lock);
+            continue;
+        }
+
+        // Help finish the previous frame rather than sit idle.
+        if (previous != NULL)
+        {
+            node_index = frame_graph_find_ready(state, previous, previous_workers);
+            if (node_index != FRAME_GRAPH_NO_NODE)
+            {
+                frame_graph_run_node(state, previous, node_index, 0, lock);
+                continue;
+            }
+        }
+
+        state->signal.wait(lock);
+
+    }
+
+}
+
+void
+frame_graph_wait(frame_graph *graph)
+{
+
+    NX_ENSURE_POINTER(graph);
+    frame_graph_state *state = get_frame_graph_state();
+    NX_ASSERT(state->graph == graph);
+
+    std::unique_lock<std::mutex> lock(state->lock);
+    u64 workers = state->all_nodes & ~state->main_nodes;
+    for (;;)
+    {
+
+        b32 busy = false;
+        u32 node_index = FRAME_GRAPH_NO_NODE;
+        frame_graph_slot *slot = NULL;
+        for (u32 s = 0; s < FRAME_GRAPH_FRAMES_IN_FLIGHT; ++s)
+        {
+            frame_graph_slot *candidate = state->slots + s;
+            if (!candidate->active) continue;
+            busy = true;
+            u32 ready = frame_graph_find_ready(state, candidate, workers);
+            if (ready != FRAME_GRAPH_NO_NODE && (slot == NULL || candidate->frame_index < slot->frame_index))
+            {
+                slot = candidate;
+                node_index = ready;
+            }
+        }
+
+        if (!busy) break;
+        if (node_index != FRAME_GRAPH_NO_NODE) frame_graph_run_node(state, slot, node_index, 0, lock);
+        else state->signal.wait(lock);
+
+    }
+
+}
+
+void
+frame_graph_dump(frame_graph *graph)
+{
+
+    NX_ENSURE_POINTER(graph);
+    frame_graph_state *state = get_frame_graph_state();
+    std::lock_guard<std::mutex> lock(state->lock);
+
+    printf("-- Frame Graph (%u nodes, %u resources, %u workers, frame %llu took %.3f ms)\n",
+            graph->node_count, graph->resource_count, graph->worker_count,
+            graph->completed_frames, graph->frame_milliseconds);
+
+    const u32 bar_width = 40;
+    r64 scale = (graph->frame_milliseconds > 0.0) ? bar_width / graph->frame_milliseconds : 0.0;
+    for (u32 i = 0; i < graph->node_count; ++i)
+    {
+
+        frame_graph_node *node = graph->nodes + i;
+
+        char bar[64];
+        u32 bar_begin = (u32)(node->begin_milliseconds * scale);
+        u32 bar_end = (u32)(node->end_milliseconds * scale + 0.5);
+        if (bar_begin > bar_width) bar_begin = bar_width;
+        if (bar_end > bar_width) bar_end = bar_width;
+        if (bar_end <= bar_begin && bar_begin < bar_width) bar_end = bar_begin + 1;
+        for (u32 c = 0; c < bar_width; ++c)
+            bar[c] = (c >= bar_begin && c < bar_end) ? '#' : '.';
+        bar[bar_width] = '\0';
+
+        b32 critical = (graph->critical_path & frame_graph_bit(i)) != 0;
+        printf("--      %c %-22s : %s %8.3f - %8.3f ms, wait %7.3f ms, avg %7.3f ms, %s %u\n",
+                critical ? '*' : ' ', node->name, bar,
+                node->begin_milliseconds, node->end_milliseconds, node->wait_milliseconds,
+                node->average_milliseconds,
+                (node->flags & FRAME_NODE_MAIN_THREAD) ? "main" : "worker", node->thread_index);
+
+        printf("--        %-22s   after:", "");
+        for (u32 j = 0; j < graph->node_count; ++j)
+            if (node->dependencies & frame_graph_bit(j)) printf(" %s", graph->nodes[j].name);
+        printf(" | last frame's:");
+        for (u32 j = 0; j < graph->node_count; ++j)
+            if (node->previous_dependencies & frame_graph_bit(j)) printf(" %s", graph->nodes[j].name);
+        printf("\n");
+
+    }
+
+    printf("--      * critical path\n");
+
+}
@@ -0,0 +1,135 @@
+#ifndef SRC_ENGINE_FRAMEGRAPH_H
+#define SRC_ENGINE_FRAMEGRAPH_H
+#include <core/definitions.h>
+
+// --- Frame Graph -------------------------------------------------------------
+//
+// Describes a frame as stages which declare the resources they read and write,
+// instead of a fixed sequence. Resources are only names (input state, the sim
+// state, an instance buffer, the back buffer); the graph never touches them.
+// Compile derives the ordering from the declarations, and execute runs a frame
+// with every stage started as soon as the stages it depends on are done, so
+// stages which share nothing run at the same time on the graph's own threads.
+//
+// Dependencies:
+//      Within a frame, stages touching the same resource run in the order they
+//      were added when at least one of them writes it. Readers of a resource
+//      run together.
+//
+//      Resources may have more than one copy, used in turn by frame index, so
+//      a stage writing copy (frame % copies) doesn't collide with the stage of
+//      the previous frame reading the other one. Stages can also read a
+//      resource as the previous frame left it, which needs two or more copies.
+//      That's what lets frames overlap: a stage drawing last frame's instances
+//      runs alongside the stage simulating this frame's.
+//
+// Pipelining:
+//      Up to two frames are in flight. Execute starts frame N and returns once
+//      every main thread stage of frame N and every stage of frame N - 1 are
+//      done, so worker stages nothing on the main thread waits for carry on
+//      into the next iteration of the game loop. A stage never overlaps itself
+//      across frames, and stages of consecutive frames touching the same copy
+//      of a resource keep frame order. Wait finishes everything in flight; call
+//      it before touching a resource from outside the graph.
+//
+//      Stages flagged FRAME_NODE_MAIN_THREAD only run inside execute on the
+//      calling thread, which is what GL and window calls need. While it waits,
+//      the main thread also helps with the previous frame's worker stages.
+//      Stage procedures are handed the frame index, to pick the copies of their
+//      resources and any per-frame parameters.
+//
+// Dump prints the last completed frame: when each stage ran relative to the
+// start of the frame, where, and for how long, along with the critical path,
+// the chain of dependencies that ended last. Wait is the time a stage spent
+// ready in name only, held back by the previous frame or a busy pool.
+//
+// One graph can be created at a time, it owns the thread pool.
+//
+
+#define FRAME_GRAPH_MAX_NODES           64
+#define FRAME_GRAPH_MAX_RESOURCES       64
+#define FRAME_GRAPH_MAX_WORKERS         16
+#define FRAME_GRAPH_FRAMES_IN_FLIGHT    2
+
+typedef u32 frame_node;
+typedef u32 frame_resource;
+
+typedef void (*frame_node_proc)(vptr user_data, u64 frame_index);
+
+typedef enum frame_node_flags
+{
+    FRAME_NODE_WORKER       = 0,
+    FRAME_NODE_MAIN_THREAD  = 1 << 0,   // Runs on the thread calling execute.
+} frame_node_flags;
+
+typedef enum frame_access
+{
+    FRAME_ACCESS_READ,
+    FRAME_ACCESS_WRITE,
+    FRAME_ACCESS_READ_PREVIOUS,         // The copy the previous frame wrote.
+} frame_access;
+
+typedef struct frame_graph_resource
+{
+    ccptr name;
+    u32 copies;
+} frame_graph_resource;
+
+typedef struct frame_graph_node
+{
+
+    ccptr name;
+    frame_node_proc proc;
+    vptr user_data;
+    u32 flags;
+
+    u64 reads;                          // Resource masks.
+    u64 writes;
+    u64 reads_previous;
+
+    u64 dependencies;                   // Nodes of the same frame to wait for.
+    u64 previous_dependencies;          // Nodes of the previous frame to wait for.
+
+    // Timings of the last completed frame, relative to its start.
+    r64 begin_milliseconds;
+    r64 end_milliseconds;
+    r64 wait_milliseconds;
+    r64 average_milliseconds;
+    u32 thread_index;                   // Zero is the main thread.
+
+} frame_graph_node;
+
+typedef struct frame_graph
+{
+
+    frame_graph_node nodes[FRAME_GRAPH_MAX_NODES];
+    u32 node_count;
+    frame_graph_resource resources[FRAME_GRAPH_MAX_RESOURCES];
+    u32 resource_count;
+    u32 worker_count;
+    b32 compiled;
+
+    u64 frame_index;                    // Of the next frame to execute.
+    u64 completed_frames;
+
+    // The last completed frame.
+    r64 frame_milliseconds;
+    u64 critical_path;                  // Node mask.
+
+} frame_graph;
+
+b32             frame_graph_create(frame_graph *graph, u32 worker_count);
+void            frame_graph_delete(frame_graph *graph);
+
+frame_resource  frame_graph_add_resource(frame_graph *graph, ccptr name, u32 copies);
+frame_node      frame_graph_add_node(frame_graph *graph, ccptr name, frame_node_proc proc,
+                    vptr user_data, u32 flags);
+void            frame_graph_node_access(frame_graph *graph, frame_node node,
+                    frame_resource resource, frame_access access);
+void            frame_graph_compile(frame_graph *graph);
+
+void            frame_graph_execute(frame_graph *graph);
+void            frame_graph_wait(frame_graph *graph);
+void            frame_graph_dump(frame_graph *graph);
+
+#endif
@@ -0,0 +1,523 @@
+#include <engine/particles.h>
+#include <core/jobs.h>
+
+typedef struct particle_update_context
+{
+    particle_emitter *emitter;
+    particle_pool *source;
+    particle_pool *destination;
+    quad_layout *output;
+    u64 output_room;            // Instances the emitter can write before the end.
+    r32 delta_time;
+} particle_update_context;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+particle_random_next(u64 *state)
+{
+
+    // xorshift64*, plenty for visual randomness and trivially cheap.
+    u64 x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+
+}
+
+static inline r32
+particle_random_unit(u64 *state)
+{
+
+    return (r32)(particle_random_next(state) >> 40) * (1.0f / 16777216.0f);
+
+}
+
+static inline r32
+particle_random_range(u64 *state, r32 low, r32 high)
+{
+
+    return low + (high - low) * particle_random_unit(state);
+
+}
+
+static inline r32
+particle_curve_evaluate(particle_curve *curve, r32 t)
+{
+
+    r32 x = t * (r32)(PARTICLE_CURVE_KEYS - 1);
+    u32 index = (u32)x;
+    index = (index > PARTICLE_CURVE_KEYS - 2) ? PARTICLE_CURVE_KEYS - 2 : index;
+    r32 f = x - (r32)index;
+    return curve->keys[index] + (curve->keys[index + 1] - curve->keys[index]) * f;
+
+}
+
+// Keys outside [0, 1] would wrap around the byte, or overflow the cast when
+// negative, so every channel is clamped before it's scaled.
+static inline u32
+particle_color_channel(r32 value)
+{
+
+    value = (value < 0.0f) ? 0.0f : ((value > 1.0f) ? 1.0f : value);
+    return (u32)(value * 255.0f + 0.5f);
+
+}
+
+static inline u32
+particle_color_curve_evaluate(particle_color_curve *curve, r32 t)
+{
+
+    r32 x = t * (r32)(PARTICLE_CURVE_KEYS - 1);
+    u32 index = (u32)x;
+    index = (index > PARTICLE_CURVE_KEYS - 2) ? PARTICLE_CURVE_KEYS - 2 : index;
+    r32 f = x - (r32)index;
+
+    vec4 a = curve->keys[index];
+    vec4 b = curve->keys[index + 1];
+    u32 r = particle_color_channel(a.X + (b.X - a.X) * f);
+    u32 g = particle_color_channel(a.Y + (b.Y - a.Y) * f);
+    u32 bl = particle_color_channel(a.Z + (b.Z - a.Z) * f);
+    u32 al = particle_color_channel(a.W + (b.W - a.W) * f);
+    return r | (g << 8) | (bl << 16) | (al << 24);
+
+}
+
+static inline void
+particle_pool_allocate(particle_pool *pool, memory_arena *arena, u64 capacity)
+{
+
+    pool->position_x        = memory_arena_push_array(arena, r32, capacity);
+    pool->position_y        = memory_arena_push_array(arena, r32, capacity);
+    pool->velocity_x        = memory_arena_push_array(arena, r32, capacity);
+    pool->velocity_y        = memory_arena_push_array(arena, r32, capacity);
+    pool->age               = memory_arena_push_array(arena, r32, capacity);
+    pool->inverse_lifetime  = memory_arena_push_array(arena, r32, capacity);
+    pool->scale             = memory_arena_push_array(arena, r32, capacity);
+    pool->frame             = memory_arena_push_array(arena, u32, capacity);
+    pool->color             = memory_arena_push_array(arena, u32, capacity);
+    pool->count             = 0;
+
+}
+
+static void
+particle_emitter_spawn(particle_emitter *emitter, u64 count)
+{
+
+    particle_emitter_description *desc = &emitter->description;
+    particle_pool *pool = &emitter->pools[emitter->front];
+    u64 *rng = &emitter->random_state;
+
+    u32 initial_color = particle_color_curve_evaluate(&desc->color_curve, 0.0f);
+    u32 frame_count = (desc->frame_count > 0) ? desc->frame_count : 1;
+
+    u64 begin = pool->count;
+    u64 end = pool->count + count;
+    for (u64 i = begin; i < end; ++i)
+    {
+
+        pool->position_x[i] = desc->position.X +
+            particle_random_range(rng, -desc->spawn_extent.X, desc->spawn_extent.X);
+        pool->position_y[i] = desc->position.Y +
+            particle_random_range(rng, -desc->spawn_extent.Y, desc->spawn_extent.Y);
+        pool->velocity_x[i] = particle_random_range(rng, desc->velocity_min.X, desc->velocity_max.X);
+        pool->velocity_y[i] = particle_random_range(rng, desc->velocity_min.Y, desc->velocity_max.Y);
+        pool->age[i] = 0.0f;
+        pool->inverse_lifetime[i] = 1.0f /
+            particle_random_range(rng, desc->lifetime_min, desc->lifetime_max);
+        pool->scale[i] = particle_random_range(rng, desc->scale_min, desc->scale_max);
+        pool->color[i] = initial_color;
+
+        u32 frame_offset = (desc->frame_mode == PARTICLE_FRAME_RANDOM) ?
+            (u32)(particle_random_next(rng) % frame_count) : 0;
+        pool->frame[i] = desc->frame_start + frame_offset;
+
+    }
+
+    pool->count = end;
+
+}
+
+static inline u64
+particle_system_spawn_allowance(particle_system *system, particle_emitter *emitter,
+        u64 requested, u64 particle_budget, u64 *frame_spawn_budget)
+{
+
+    particle_pool *pool = &emitter->pools[emitter->front];
+    u64 emitter_room = emitter->description.capacity - pool->count;
+    u64 system_room = (particle_budget > system->live_count) ?
+        particle_budget - system->live_count : 0;
+
+    u64 allowance = requested;
+    if (allowance > emitter_room) allowance = emitter_room;
+    if (allowance > system_room) allowance = system_room;
+    if (allowance > *frame_spawn_budget) allowance = *frame_spawn_budget;
+    *frame_spawn_budget -= allowance;
+
+    return allowance;
+
+}
+
+// --- Update Passes -----------------------------------------------------------
+//
+// Pass one integrates each chunk in place and counts its survivors. Pass two
+// compacts each chunk into the back pool at its prefix offset, evaluating the
+// curves and writing the instance data as it goes.
+//
+
+static void
+particle_integrate_chunks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    particle_update_context *context = (particle_update_context*)user_data;
+    particle_emitter *emitter = context->emitter;
+    particle_emitter_description *desc = &emitter->description;
+    particle_pool *pool = context->source;
+
+    r32 dt = context->delta_time;
+    r32 acceleration_x = desc->acceleration.X * dt;
+    r32 acceleration_y = desc->acceleration.Y * dt;
+
+    for (u64 chunk = begin; chunk < end; ++chunk)
+    {
+
+        u64 first = chunk * PARTICLE_CHUNK_SIZE;
+        u64 last = first + PARTICLE_CHUNK_SIZE;
+        if (last > pool->count) last = pool->count;
+
+        u32 survivors = 0;
+        for (u64 i = first; i < last; ++i)
+        {
+
+            r32 t = pool->age[i] * pool->inverse_lifetime[i];
+            t = (t > 1.0f) ? 1.0f : t;
+            r32 speed = particle_curve_evaluate(&desc->velocity_curve, t) * dt;
+
+            pool->velocity_x[i] += acceleration_x;
+            pool->velocity_y[i] += acceleration_y;
+            pool->position_x[i] += pool->velocity_x[i] * speed;
+            pool->position_y[i] += pool->velocity_y[i] * speed;
+            pool->age[i] += dt;
+
+            survivors += (pool->age[i] * pool->inverse_lifetime[i] < 1.0f);
+
+        }
+
+        emitter->chunk_survivors[chunk] = survivors;
+
+    }
+
+}
+
+static void
+particle_compact_chunks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    particle_update_context *context = (particle_update_context*)user_data;
+    particle_emitter *emitter = context->emitter;
+    particle_emitter_description *desc = &emitter->description;
+    particle_pool *src = context->source;
+    particle_pool *dst = context->destination;
+
+    r32 cell_width = 1.0f / (r32)(desc->atlas_columns > 0 ? desc->atlas_columns : 1);
+    r32 cell_height = 1.0f / (r32)(desc->atlas_rows > 0 ? desc->atlas_rows : 1);
+    u32 columns = (desc->atlas_columns > 0) ? desc->atlas_columns : 1;
+    u32 frame_count = (desc->frame_count > 0) ? desc->frame_count : 1;
+    u32 animate = (desc->frame_mode == PARTICLE_FRAME_ANIMATED);
+
+    u16 survivor_index[PARTICLE_CHUNK_SIZE];
+
+    for (u64 chunk = begin; chunk < end; ++chunk)
+    {
+
+        u64 first = chunk * PARTICLE_CHUNK_SIZE;
+        u64 last = first + PARTICLE_CHUNK_SIZE;
+        if (last > src->count) last = src->count;
+
+        // Branchless selection: every particle writes its slot, only the
+        // survivors advance the cursor.
+        u32 write = 0;
+        for (u64 i = first; i < last; ++i)
+        {
+            survivor_index[write] = (u16)(i - first);
+            write += (src->age[i] * src->inverse_lifetime[i] < 1.0f);
+        }
+
+        NX_ASSERT(write == emitter->chunk_survivors[chunk]);
+        u64 offset = emitter->chunk_survivors[emitter->chunk_capacity + chunk];
+
+        for (u32 k = 0; k < write; ++k)
+        {
+
+            u64 s = first + survivor_index[k];
+            u64 d = offset + k;
+
+            r32 t = src->age[s] * src->inverse_lifetime[s];
+            r32 scale = src->scale[s] * particle_curve_evaluate(&desc->scale_curve, t);
+            u32 animated_frame = (u32)(t * (r32)frame_count);
+            animated_frame = (animated_frame >= frame_count) ? frame_count - 1 : animated_frame;
+            u32 frame = src->frame[s] + animated_frame * animate;
+
+            dst->position_x[d]          = src->position_x[s];
+            dst->position_y[d]          = src->position_y[s];
+            dst->velocity_x[d]          = src->velocity_x[s];
+            dst->velocity_y[d]          = src->velocity_y[s];
+            dst->age[d]                 = src->age[s];
+            dst->inverse_lifetime[d]    = src->inverse_lifetime[s];
+            dst->scale[d]               = src->scale[s];
+            dst->frame[d]               = src->frame[s];
+            dst->color[d]               = particle_color_curve_evaluate(&desc->color_curve, t);
+
+            if (d >= context->output_room) continue;
+            quad_layout *instance = context->output + d;
+            instance->transform.position    = { src->position_x[s], src->position_y[s] };
+            instance->transform.scale       = { scale, scale };
+            instance->texture.offset        = { cell_width * (r32)(frame % columns),
+                                                cell_height * (r32)(frame / columns) };
+            instance->texture.dimension     = { cell_width, cell_height };
+
+        }
+
+    }
+
+}
+
+// --- Particle System ---------------------------------------------------------
+
+void
+particle_system_create(particle_system *system, memory_arena *arena,
+        u32 emitter_capacity, u64 particle_budget, u64 spawn_budget)
+{
+
+    NX_ENSURE_POINTER(system);
+    NX_ENSURE_POINTER(arena);
+
+    system->emitters            = memory_arena_push_array(arena, particle_emitter, emitter_capacity);
+    system->emitter_count       = 0;
+    system->emitter_capacity    = emitter_capacity;
+    system->particle_budget     = particle_budget;
+    system->output_budget       = particle_budget;
+    system->spawn_budget        = spawn_budget;
+    system->live_count          = 0;
+    system->spawned_count       = 0;
+    system->killed_count        = 0;
+
+}
+
+particle_emitter*
+particle_system_add_emitter(particle_system *system, memory_arena *arena,
+        particle_emitter_description *description)
+{
+
+    NX_ENSURE_POINTER(system);
+    NX_ENSURE_POINTER(description);
+    NX_ASSERT(description->capacity > 0);
+
+    if (system->emitter_count >= system->emitter_capacity) return NULL;
+
+    particle_emitter *emitter = system->emitters + system->emitter_count;
+    emitter->description = *description;
+    emitter->front = 0;
+    emitter->spawn_accumulator = 0.0f;
+    emitter->random_state = 0x9E3779B97F4A7C15ULL ^ ((u64)system->emitter_count + 1) * 0xBF58476D1CE4E5B9ULL;
+    emitter->active = true;
+
+    // Survivor counts are stored in the lower half, prefix offsets in the upper.
+    u64 capacity = description->capacity;
+    emitter->chunk_capacity = (capacity + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+    emitter->chunk_survivors = memory_arena_push_array(arena, u32, emitter->chunk_capacity * 2);
+    particle_pool_allocate(&emitter->pools[0], arena, capacity);
+    particle_pool_allocate(&emitter->pools[1], arena, capacity);
+
+    system->emitter_count++;
+    return emitter;
+
+}
+
+void
+particle_system_clear(particle_system *system)
+{
+
+    NX_ENSURE_POINTER(system);
+
+    for (u32 i = 0; i < system->emitter_count; ++i)
+    {
+        particle_emitter *emitter = system->emitters + i;
+        emitter->pools[0].count = 0;
+        emitter->pools[1].count = 0;
+        emitter->spawn_accumulator = 0.0f;
+    }
+
+    system->live_count = 0;
+
+}
+
+void
+particle_emitter_burst(particle_system *system, particle_emitter *emitter, u64 count)
+{
+
+    NX_ENSURE_POINTER(system);
+    NX_ENSURE_POINTER(emitter);
+
+    // Bursts respect the pool and system budgets, but not the per-frame limit.
+    // The output's room is the one the last update had.
+    u64 unlimited = count;
+    u64 allowed = particle_system_spawn_allowance(system, emitter, count,
+            system->output_budget, &unlimited);
+    particle_emitter_spawn(emitter, allowed);
+    system->live_count += allowed;
+
+}
+
+void
+particle_emitter_set_active(particle_emitter *emitter, b32 active)
+{
+
+    NX_ENSURE_POINTER(emitter);
+    emitter->active = active;
+
+}
+
+u64
+particle_system_update(particle_system *system, r32 delta_time,
+        quad_render_buffer *output, u64 output_offset)
+{
+
+    NX_ENSURE_POINTER(system);
+    NX_ENSURE_POINTER(output);
+
+    // Never let the system grow past what the output can hold.
+    NX_ASSERT(output->instance_format == QUAD_INSTANCE_STANDARD);
+    u64 output_capacity = output->vertex_buffer_size / output->instance_stride;
+    NX_ASSERT(output_offset <= output_capacity);
+    u64 output_room = output_capacity - output_offset;
+    u64 particle_budget = (output_room < system->particle_budget) ? output_room : system->particle_budget;
+    system->output_budget = particle_budget;
+
+    u64 frame_spawn_budget = system->spawn_budget;
+    u64 spawned = 0;
+
+    for (u32 e = 0; e < system->emitter_count; ++e)
+    {
+
+        particle_emitter *emitter = system->emitters + e;
+        if (!emitter->active) continue;
+
+        emitter->spawn_accumulator += emitter->description.spawn_rate * delta_time;
+        u64 requested = (u64)emitter->spawn_accumulator;
+        emitter->spawn_accumulator -= (r32)requested;
+        if (requested > emitter->description.spawn_limit)
+            requested = emitter->description.spawn_limit;
+
+        u64 allowed = particle_system_spawn_allowance(system, emitter, requested,
+                particle_budget, &frame_spawn_budget);
+        particle_emitter_spawn(emitter, allowed);
+        system->live_count += allowed;
+        spawned += allowed;
+
+    }
+
+    u64 live = 0;
+    u64 killed = 0;
+    quad_layout *instances = output->vertex_buffer + output_offset;
+
+    for (u32 e = 0; e < system->emitter_count; ++e)
+    {
+
+        particle_emitter *emitter = system->emitters + e;
+        particle_pool *source = &emitter->pools[emitter->front];
+        particle_pool *destination = &emitter->pools[emitter->front ^ 1];
+        if (source->count == 0) continue;
+
+        particle_update_context context = {0};
+        context.emitter     = emitter;
+        context.source      = source;
+        context.destination = destination;
+        context.output      = instances + live;
+        context.output_room = (live < output_room) ? output_room - live : 0;
+        context.delta_time  = delta_time;
+
+        u64 chunk_count = (source->count + PARTICLE_CHUNK_SIZE - 1) / PARTICLE_CHUNK_SIZE;
+        jobs_parallel_for(chunk_count, 1, particle_integrate_chunks, &context);
+
+        u64 survivors = 0;
+        for (u64 c = 0; c < chunk_count; ++c)
+        {
+            emitter->chunk_survivors[emitter->chunk_capacity + c] = (u32)survivors;
+            survivors += emitter->chunk_survivors[c];
+        }
+
+        jobs_parallel_for(chunk_count, 1, particle_compact_chunks, &context);
+
+        killed += source->count - survivors;
+        destination->count = survivors;
+        source->count = 0;
+        emitter->front ^= 1;
+        live += survivors;
+
+    }
+
+    // Particles burst in since the last update, or left over from a bigger
+    // output, live on but aren't drawn until there's room.
+    system->live_count      = live;
+    system->spawned_count   = spawned;
+    system->killed_count    = killed;
+
+    return (live < output_room) ? live : output_room;
+
+}
+
+// --- Curves ------------------------------------------------------------------
+
+particle_curve
+particle_curve_constant(r32 value)
+{
+
+    particle_curve curve;
+    for (u32 i = 0; i < PARTICLE_CURVE_KEYS; ++i) curve.keys[i] = value;
+    return curve;
+
+}
+
+particle_curve
+particle_curve_linear(r32 start, r32 end)
+{
+
+    particle_curve curve;
+    for (u32 i = 0; i < PARTICLE_CURVE_KEYS; ++i)
+    {
+        r32 t = (r32)i / (r32)(PARTICLE_CURVE_KEYS - 1);
+        curve.keys[i] = start + (end - start) * t;
+    }
+    return curve;
+
+}
+
+particle_color_curve
+particle_color_curve_constant(vec4 value)
+{
+
+    particle_color_curve curve;
+    for (u32 i = 0; i < PARTICLE_CURVE_KEYS; ++i) curve.keys[i] = value;
+    return curve;
+
+}
+
+particle_color_curve
+particle_color_curve_linear(vec4 start, vec4 end)
+{
+
+    particle_color_curve curve;
+    for (u32 i = 0; i < PARTICLE_CURVE_KEYS; ++i)
+    {
+        r32 t = (r32)i / (r32)(PARTICLE_CURVE_KEYS - 1);
+        curve.keys[i].X = start.X + (end.X - start.X) * t;
+        curve.keys[i].Y = start.Y + (end.Y - start.Y) * t;
+        curve.keys[i].Z = start.Z + (end.Z - start.Z) * t;
+        curve.keys[i].W = start.W + (end.W - start.W) * t;
+    }
+    return curve;
+
+}
@@ -0,0 +1,143 @@
+#ifndef SRC_ENGINE_PARTICLES_H
+#define SRC_ENGINE_PARTICLES_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Particle System ---------------------------------------------------------
+//
+// The particle system is a collection of emitters, each of which owns a pool of
+// particles stored as structure-of-arrays. Every frame an emitter spawns new
+// particles according to its spawn rate, simulates the whole pool, removes the
+// dead particles and writes the survivors directly into the instance array of a
+// quad_render_buffer. Emitters are laid out in the instance array back to back,
+// so the entire system renders with a single instanced draw.
+//
+// Pools are double buffered. The update is done in two parallel passes over
+// fixed-size chunks: the first pass integrates and counts the survivors of each
+// chunk, the second pass compacts the survivors into the back pool at their
+// prefix offset and emits their quad_layout at the same time. Killing is done
+// with a branchless stream compaction, so dead particles cost no mispredicts.
+//
+// Budgets are enforced in two places. An emitter never holds more than its pool
+// capacity and never spawns more than spawn_limit particles in a single frame.
+// The system enforces particle_budget across all emitters as well as a global
+// spawn_budget each frame; spawns over budget are dropped, not deferred. The
+// particle budget is also clamped to the room left in the output after
+// output_offset, and bursts to the room the last update had. Survivors past the
+// end of the output are still simulated but not written, and update returns
+// the number of instances it wrote. Only the standard instance format is
+// supported.
+//
+// Curves are four evenly spaced keys across the lifetime of a particle and are
+// linearly interpolated. The color curve is evaluated into the color column
+// (packed RGBA8) since quad_layout carries no tint; instance formats that do
+// can read it from there.
+//
+
+#define PARTICLE_CURVE_KEYS     4
+#define PARTICLE_CHUNK_SIZE     4096
+
+typedef struct particle_curve
+{
+    r32 keys[PARTICLE_CURVE_KEYS];
+} particle_curve;
+
+typedef struct particle_color_curve
+{
+    vec4 keys[PARTICLE_CURVE_KEYS];
+} particle_color_curve;
+
+typedef enum particle_frame_mode
+{
+    PARTICLE_FRAME_FIXED,       // Every particle uses frame_start.
+    PARTICLE_FRAME_RANDOM,      // Random frame in [start, start + count) at spawn.
+    PARTICLE_FRAME_ANIMATED,    // Frames advance evenly over the particle lifetime.
+} particle_frame_mode;
+
+typedef struct particle_emitter_description
+{
+
+    vec2 position;              // Spawn origin.
+    vec2 spawn_extent;          // Half-extents of the spawn rectangle around the origin.
+    r32 spawn_rate;             // Particles per second.
+    u32 spawn_limit;            // Maximum spawns in one frame.
+    u32 capacity;               // Maximum live particles for this emitter.
+
+    r32 lifetime_min;           // Seconds.
+    r32 lifetime_max;
+    vec2 velocity_min;          // Initial velocity range, pixels per second.
+    vec2 velocity_max;
+    vec2 acceleration;          // Constant acceleration, e.g. gravity.
+    r32 scale_min;              // Base scale range, in pixels.
+    r32 scale_max;
+
+    particle_curve velocity_curve;      // Speed multiplier over lifetime.
+    particle_curve scale_curve;         // Scale multiplier over lifetime.
+    particle_color_curve color_curve;   // Color over lifetime.
+
+    u32 atlas_columns;          // Sprite sheet grid dimensions.
+    u32 atlas_rows;
+    u32 frame_start;            // Row-major cell index into the grid.
+    u32 frame_count;
+    particle_frame_mode frame_mode;
+
+} particle_emitter_description;
+
+typedef struct particle_pool
+{
+    r32 *position_x;
+    r32 *position_y;
+    r32 *velocity_x;
+    r32 *velocity_y;
+    r32 *age;
+    r32 *inverse_lifetime;
+    r32 *scale;
+    u32 *frame;
+    u32 *color;
+    u64 count;
+} particle_pool;
+
+typedef struct particle_emitter
+{
+    particle_emitter_description description;
+    particle_pool pools[2];     // Front pool is pools[front], back is pools[front^1].
+    u32 front;
+    u32 *chunk_survivors;       // Per-chunk survivor counts, then prefix offsets.
+    u64 chunk_capacity;
+    r32 spawn_accumulator;
+    u64 random_state;
+    b32 active;
+} particle_emitter;
+
+typedef struct particle_system
+{
+    particle_emitter *emitters;
+    u32 emitter_count;
+    u32 emitter_capacity;
+    u64 particle_budget;        // Maximum live particles across all emitters.
+    u64 output_budget;          // The budget clamped to the last update's output.
+    u64 spawn_budget;           // Maximum spawns across all emitters per frame.
+    u64 live_count;             // Statistics from the last update.
+    u64 spawned_count;
+    u64 killed_count;
+} particle_system;
+
+void                particle_system_create(particle_system *system, memory_arena *arena,
+                        u32 emitter_capacity, u64 particle_budget, u64 spawn_budget);
+particle_emitter*   particle_system_add_emitter(particle_system *system, memory_arena *arena,
+                        particle_emitter_description *description);
+u64                 particle_system_update(particle_system *system, r32 delta_time,
+                        quad_render_buffer *output, u64 output_offset);
+void                particle_system_clear(particle_system *system);
+
+void                particle_emitter_burst(particle_system *system, particle_emitter *emitter, u64 count);
+void                particle_emitter_set_active(particle_emitter *emitter, b32 active);
+
+particle_curve          particle_curve_constant(r32 value);
+particle_curve          particle_curve_linear(r32 start, r32 end);
+particle_color_curve    particle_color_curve_constant(vec4 value);
+particle_color_curve    particle_color_curve_linear(vec4 start, vec4 end);
+
+#endif
@@ -0,0 +1,1016 @@
+#include <engine/physics2d.h>
+#include <platform/system.h>
+#include <core/jobs.h>
+#include <string.h>
+#include <math.h>
+
+#define PHYSICS_BODY_BATCH          1024
+#define PHYSICS_PAIR_BATCH          256
+#define PHYSICS_ISLAND_BATCH        16
+#define PHYSICS_NULL_ISLAND         0xFFFFFFFF
+
+typedef struct physics_step_context
+{
+    physics_world *world;
+    sweep_prune_pair *pairs;
+    physics_contact *contacts;
+    u32 *island_start;          // Prefix sums into island_contacts, island_count + 1 entries.
+    u32 *island_contacts;
+    u32 *root_island;           // Island index of each union-find root.
+    r32 delta_time;
+    r32 inverse_delta_time;
+} physics_step_context;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline vec2
+physics_vec2(r32 x, r32 y)
+{
+
+    vec2 result = { x, y };
+    return result;
+
+}
+
+static inline vec2
+physics_add(vec2 a, vec2 b)
+{
+
+    return physics_vec2(a.X + b.X, a.Y + b.Y);
+
+}
+
+static inline vec2
+physics_sub(vec2 a, vec2 b)
+{
+
+    return physics_vec2(a.X - b.X, a.Y - b.Y);
+
+}
+
+static inline vec2
+physics_scale(vec2 a, r32 s)
+{
+
+    return physics_vec2(a.X * s, a.Y * s);
+
+}
+
+static inline r32
+physics_dot(vec2 a, vec2 b)
+{
+
+    return a.X * b.X + a.Y * b.Y;
+
+}
+
+static inline r32
+physics_cross(vec2 a, vec2 b)
+{
+
+    return a.X * b.Y - a.Y * b.X;
+
+}
+
+static inline vec2
+physics_rotate(vec2 v, r32 c, r32 s)
+{
+
+    return physics_vec2(c * v.X - s * v.Y, s * v.X + c * v.Y);
+
+}
+
+static inline u32
+physics_island_find(u32 *parent, u32 body)
+{
+
+    // Path halving, keeps the trees flat without recursion.
+    while (parent[body] != body)
+    {
+        parent[body] = parent[parent[body]];
+        body = parent[body];
+    }
+
+    return body;
+
+}
+
+static u32
+physics_body_allocate(physics_world *world, vec2 position, vec2 half_extents)
+{
+
+    NX_ASSERT(world->body_count < world->body_capacity);
+    if (world->body_count >= world->body_capacity) return PHYSICS_NULL_BODY;
+
+    u32 body = world->body_count++;
+    physics_bodies *bodies = &world->bodies;
+    bodies->position_x[body]        = position.X;
+    bodies->position_y[body]        = position.Y;
+    bodies->rotation_c[body]        = 1.0f;
+    bodies->rotation_s[body]        = 0.0f;
+    bodies->velocity_x[body]        = 0.0f;
+    bodies->velocity_y[body]        = 0.0f;
+    bodies->angular_velocity[body]  = 0.0f;
+    bodies->inverse_mass[body]      = 0.0f;
+    bodies->inverse_inertia[body]   = 0.0f;
+    bodies->friction[body]          = 0.4f;
+    bodies->restitution[body]       = 0.0f;
+    bodies->radius[body]            = 0.0f;
+    bodies->half_x[body]            = 0.0f;
+    bodies->half_y[body]            = 0.0f;
+    bodies->shape_type[body]        = PHYSICS_SHAPE_CIRCLE;
+    bodies->polygon_index[body]     = PHYSICS_NULL_BODY;
+    bodies->island[body]            = PHYSICS_NULL_ISLAND;
+
+    // Bodies are never removed, so broadphase handles match body indices.
+    vec2 min = physics_sub(position, half_extents);
+    vec2 max = physics_add(position, half_extents);
+    u32 handle = sweep_prune_insert(&world->broadphase, min, max);
+    NX_ASSERT(handle == body);
+
+    return body;
+
+}
+
+// Produces the world space outline of a box or polygon body.
+static inline void
+physics_body_world_polygon(physics_world *world, u32 body, physics_polygon *result)
+{
+
+    physics_bodies *bodies = &world->bodies;
+    vec2 position = physics_vec2(bodies->position_x[body], bodies->position_y[body]);
+
+    if (bodies->shape_type[body] == PHYSICS_SHAPE_BOX)
+    {
+
+        r32 hx = bodies->half_x[body];
+        r32 hy = bodies->half_y[body];
+        result->vertex_count = 4;
+        result->vertices[0] = physics_vec2(position.X - hx, position.Y - hy);
+        result->vertices[1] = physics_vec2(position.X + hx, position.Y - hy);
+        result->vertices[2] = physics_vec2(position.X + hx, position.Y + hy);
+        result->vertices[3] = physics_vec2(position.X - hx, position.Y + hy);
+        result->normals[0]  = physics_vec2( 0.0f, -1.0f);
+        result->normals[1]  = physics_vec2( 1.0f,  0.0f);
+        result->normals[2]  = physics_vec2( 0.0f,  1.0f);
+        result->normals[3]  = physics_vec2(-1.0f,  0.0f);
+        return;
+
+    }
+
+    physics_polygon *local = world->polygons + bodies->polygon_index[body];
+    r32 c = bodies->rotation_c[body];
+    r32 s = bodies->rotation_s[body];
+    result->vertex_count = local->vertex_count;
+    for (u32 i = 0; i < local->vertex_count; ++i)
+    {
+        result->vertices[i] = physics_add(position, physics_rotate(local->vertices[i], c, s));
+        result->normals[i]  = physics_rotate(local->normals[i], c, s);
+    }
+
+}
+
+// --- Narrowphase -------------------------------------------------------------
+//
+// Each routine fills in the normal, points and separations of the contact and
+// returns the point count, zero when the shapes don't touch. Normals point from
+// the first shape to the second.
+//
+
+static u32
+physics_collide_circles(vec2 center_a, r32 radius_a, vec2 center_b, r32 radius_b,
+        physics_contact *contact)
+{
+
+    vec2 delta = physics_sub(center_b, center_a);
+    r32 distance_squared = physics_dot(delta, delta);
+    r32 radii = radius_a + radius_b;
+    if (distance_squared > radii * radii) return 0;
+
+    r32 distance = sqrtf(distance_squared);
+    vec2 normal = (distance > 1e-6f) ? physics_scale(delta, 1.0f / distance) : physics_vec2(0.0f, 1.0f);
+
+    vec2 surface_a = physics_add(center_a, physics_scale(normal, radius_a));
+    vec2 surface_b = physics_sub(center_b, physics_scale(normal, radius_b));
+    contact->normal = normal;
+    contact->points[0] = physics_scale(physics_add(surface_a, surface_b), 0.5f);
+    contact->separation[0] = distance - radii;
+    return 1;
+
+}
+
+static u32
+physics_collide_polygon_circle(physics_polygon *polygon, vec2 center, r32 radius,
+        physics_contact *contact)
+{
+
+    // Face of greatest separation from the circle center.
+    u32 face = 0;
+    r32 separation = -INFINITY;
+    for (u32 i = 0; i < polygon->vertex_count; ++i)
+    {
+        r32 s = physics_dot(polygon->normals[i], physics_sub(center, polygon->vertices[i]));
+        if (s > radius) return 0;
+        if (s > separation)
+        {
+            separation = s;
+            face = i;
+        }
+    }
+
+    vec2 v1 = polygon->vertices[face];
+    vec2 v2 = polygon->vertices[(face + 1) % polygon->vertex_count];
+    vec2 normal = polygon->normals[face];
+    vec2 surface = physics_sub(center, physics_scale(normal, separation));
+
+    // Outside the face, the circle may be in the region of one of its vertices.
+    if (separation > 1e-6f)
+    {
+
+        vec2 corner = v1;
+        b32 in_corner = true;
+        if (physics_dot(physics_sub(center, v1), physics_sub(v2, v1)) <= 0.0f) corner = v1;
+        else if (physics_dot(physics_sub(center, v2), physics_sub(v1, v2)) <= 0.0f) corner = v2;
+        else in_corner = false;
+
+        if (in_corner)
+        {
+            vec2 delta = physics_sub(center, corner);
+            r32 distance_squared = physics_dot(delta, delta);
+            if (distance_squared > radius * radius) return 0;
+            r32 distance = sqrtf(distance_squared);
+            normal = (distance > 1e-6f) ? physics_scale(delta, 1.0f / distance) : normal;
+            separation = distance;
+            surface = corner;
+        }
+
+    }
+
+    vec2 circle_surface = physics_sub(center, physics_scale(normal, radius));
+    contact->normal = normal;
+    contact->points[0] = physics_scale(physics_add(surface, circle_surface), 0.5f);
+    contact->separation[0] = separation - radius;
+    return 1;
+
+}
+
+static r32
+physics_polygon_max_separation(physics_polygon *a, physics_polygon *b, u32 *edge)
+{
+
+    r32 best = -INFINITY;
+    for (u32 i = 0; i < a->vertex_count; ++i)
+    {
+
+        vec2 normal = a->normals[i];
+        vec2 vertex = a->vertices[i];
+        r32 deepest = INFINITY;
+        for (u32 j = 0; j < b->vertex_count; ++j)
+        {
+            r32 s = physics_dot(normal, physics_sub(b->vertices[j], vertex));
+            deepest = (s < deepest) ? s : deepest;
+        }
+
+        if (deepest > best)
+        {
+            best = deepest;
+            *edge = i;
+        }
+
+    }
+
+    return best;
+
+}
+
+static inline u32
+physics_clip_segment(vec2 *output, vec2 *input, vec2 normal, r32 offset)
+{
+
+    u32 count = 0;
+    r32 distance_0 = physics_dot(normal, input[0]) - offset;
+    r32 distance_1 = physics_dot(normal, input[1]) - offset;
+
+    if (distance_0 <= 0.0f) output[count++] = input[0];
+    if (distance_1 <= 0.0f) output[count++] = input[1];
+
+    if (distance_0 * distance_1 < 0.0f)
+    {
+        r32 t = distance_0 / (distance_0 - distance_1);
+        output[count++] = physics_add(input[0], physics_scale(physics_sub(input[1], input[0]), t));
+    }
+
+    return count;
+
+}
+
+static u32
+physics_collide_polygons(physics_polygon *a, physics_polygon *b, r32 linear_slop,
+        physics_contact *contact)
+{
+
+    u32 edge_a = 0;
+    r32 separation_a = physics_polygon_max_separation(a, b, &edge_a);
+    if (separation_a > 0.0f) return 0;
+
+    u32 edge_b = 0;
+    r32 separation_b = physics_polygon_max_separation(b, a, &edge_b);
+    if (separation_b > 0.0f) return 0;
+
+    // Prefer a's faces unless b's are clearly better, so the reference face
+    // doesn't flicker between the two on resting contacts.
+    physics_polygon *reference = a;
+    physics_polygon *incident = b;
+    u32 reference_edge = edge_a;
+    b32 flip = false;
+    if (separation_b > separation_a + 0.1f * linear_slop)
+    {
+        reference = b;
+        incident = a;
+        reference_edge = edge_b;
+        flip = true;
+    }
+
+    // Incident edge is the one most anti-parallel to the reference normal.
+    vec2 reference_normal = reference->normals[reference_edge];
+    u32 incident_edge = 0;
+    r32 lowest = INFINITY;
+    for (u32 i = 0; i < incident->vertex_count; ++i)
+    {
+        r32 d = physics_dot(reference_normal, incident->normals[i]);
+        if (d < lowest)
+        {
+            lowest = d;
+            incident_edge = i;
+        }
+    }
+
+    vec2 incident_points[2];
+    incident_points[0] = incident->vertices[incident_edge];
+    incident_points[1] = incident->vertices[(incident_edge + 1) % incident->vertex_count];
+
+    vec2 v1 = reference->vertices[reference_edge];
+    vec2 v2 = reference->vertices[(reference_edge + 1) % reference->vertex_count];
+    vec2 tangent = physics_sub(v2, v1);
+    r32 length = sqrtf(physics_dot(tangent, tangent));
+    tangent = physics_scale(tangent, 1.0f / length);
+
+    // Clip the incident edge to the side planes of the reference face.
+    vec2 clip_a[2];
+    vec2 clip_b[2];
+    if (physics_clip_segment(clip_a, incident_points, physics_scale(tangent, -1.0f),
+            -physics_dot(tangent, v1)) < 2) return 0;
+    if (physics_clip_segment(clip_b, clip_a, tangent, physics_dot(tangent, v2)) < 2) return 0;
+
+    r32 face_offset = physics_dot(reference_normal, v1);
+    u32 point_count = 0;
+    for (u32 i = 0; i < 2; ++i)
+    {
+
+        r32 separation = physics_dot(reference_normal, clip_b[i]) - face_offset;
+        if (separation > 0.0f) continue;
+
+        // Midway between the incident point and the reference face.
+        contact->points[point_count] = physics_sub(clip_b[i], physics_scale(reference_normal, separation * 0.5f));
+        contact->separation[point_count] = separation;
+        point_count++;
+
+    }
+
+    contact->normal = flip ? physics_scale(reference_normal, -1.0f) : reference_normal;
+    return point_count;
+
+}
+
+static void
+physics_collide(physics_world *world, u32 body_a, u32 body_b, physics_contact *contact)
+{
+
+    physics_bodies *bodies = &world->bodies;
+    contact->body_a = body_a;
+    contact->body_b = body_b;
+    contact->point_count = 0;
+
+    if (bodies->inverse_mass[body_a] == 0.0f && bodies->inverse_mass[body_b] == 0.0f) return;
+
+    vec2 center_a = physics_vec2(bodies->position_x[body_a], bodies->position_y[body_a]);
+    vec2 center_b = physics_vec2(bodies->position_x[body_b], bodies->position_y[body_b]);
+    b32 circle_a = bodies->shape_type[body_a] == PHYSICS_SHAPE_CIRCLE;
+    b32 circle_b = bodies->shape_type[body_b] == PHYSICS_SHAPE_CIRCLE;
+
+    physics_polygon polygon_a;
+    physics_polygon polygon_b;
+    if (!circle_a) physics_body_world_polygon(world, body_a, &polygon_a);
+    if (!circle_b) physics_body_world_polygon(world, body_b, &polygon_b);
+
+    u32 point_count = 0;
+    if (circle_a && circle_b)
+    {
+        point_count = physics_collide_circles(center_a, bodies->radius[body_a],
+                center_b, bodies->radius[body_b], contact);
+    }
+    else if (circle_a)
+    {
+        point_count = physics_collide_polygon_circle(&polygon_b, center_a, bodies->radius[body_a], contact);
+        contact->normal = physics_scale(contact->normal, -1.0f);
+    }
+    else if (circle_b)
+    {
+        point_count = physics_collide_polygon_circle(&polygon_a, center_b, bodies->radius[body_b], contact);
+    }
+    else
+    {
+        point_count = physics_collide_polygons(&polygon_a, &polygon_b, world->linear_slop, contact);
+    }
+
+    contact->point_count = point_count;
+    if (point_count == 0) return;
+
+    contact->friction = sqrtf(bodies->friction[body_a] * bodies->friction[body_b]);
+    contact->restitution = (bodies->restitution[body_a] > bodies->restitution[body_b]) ?
+        bodies->restitution[body_a] : bodies->restitution[body_b];
+
+}
+
+// --- Solver ------------------------------------------------------------------
+
+static inline vec2
+physics_point_velocity(physics_bodies *bodies, u32 body, vec2 offset)
+{
+
+    r32 w = bodies->angular_velocity[body];
+    return physics_vec2(bodies->velocity_x[body] - w * offset.Y, bodies->velocity_y[body] + w * offset.X);
+
+}
+
+static inline void
+physics_apply_impulse(physics_bodies *bodies, u32 body, vec2 offset, vec2 impulse)
+{
+
+    // Static bodies are shared between islands, never write to them.
+    r32 inverse_mass = bodies->inverse_mass[body];
+    if (inverse_mass == 0.0f) return;
+
+    bodies->velocity_x[body] += impulse.X * inverse_mass;
+    bodies->velocity_y[body] += impulse.Y * inverse_mass;
+    bodies->angular_velocity[body] += bodies->inverse_inertia[body] * physics_cross(offset, impulse);
+
+}
+
+static void
+physics_prepare_contact(physics_world *world, physics_contact *contact, r32 inverse_delta_time)
+{
+
+    physics_bodies *bodies = &world->bodies;
+    u32 a = contact->body_a;
+    u32 b = contact->body_b;
+    vec2 center_a = physics_vec2(bodies->position_x[a], bodies->position_y[a]);
+    vec2 center_b = physics_vec2(bodies->position_x[b], bodies->position_y[b]);
+    r32 mass_sum = bodies->inverse_mass[a] + bodies->inverse_mass[b];
+    r32 inertia_a = bodies->inverse_inertia[a];
+    r32 inertia_b = bodies->inverse_inertia[b];
+    vec2 normal = contact->normal;
+    vec2 tangent = physics_vec2(normal.Y, -normal.X);
+
+    for (u32 i = 0; i < contact->point_count; ++i)
+    {
+
+        vec2 offset_a = physics_sub(contact->points[i], center_a);
+        vec2 offset_b = physics_sub(contact->points[i], center_b);
+
+        r32 rn_a = physics_cross(offset_a, normal);
+        r32 rn_b = physics_cross(offset_b, normal);
+        r32 k_normal = mass_sum + inertia_a * rn_a * rn_a + inertia_b * rn_b * rn_b;
+        contact->normal_mass[i] = (k_normal > 0.0f) ? 1.0f / k_normal : 0.0f;
+
+        r32 rt_a = physics_cross(offset_a, tangent);
+        r32 rt_b = physics_cross(offset_b, tangent);
+        r32 k_tangent = mass_sum + inertia_a * rt_a * rt_a + inertia_b * rt_b * rt_b;
+        contact->tangent_mass[i] = (k_tangent > 0.0f) ? 1.0f / k_tangent : 0.0f;
+
+        // Bounce off fast approaches, otherwise push out the penetration.
+        vec2 relative = physics_sub(physics_point_velocity(bodies, b, offset_b),
+                physics_point_velocity(bodies, a, offset_a));
+        r32 approach = physics_dot(relative, normal);
+        r32 bounce = (approach < -world->restitution_threshold) ? -contact->restitution * approach : 0.0f;
+        r32 penetration = -contact->separation[i] - world->linear_slop;
+        r32 correction = (penetration > 0.0f) ? world->baumgarte * inverse_delta_time * penetration : 0.0f;
+        contact->velocity_bias[i] = (bounce > correction) ? bounce : correction;
+
+        contact->normal_impulse[i] = 0.0f;
+        contact->tangent_impulse[i] = 0.0f;
+
+    }
+
+}
+
+static void
+physics_solve_contact(physics_bodies *bodies, physics_contact *contact)
+{
+
+    u32 a = contact->body_a;
+    u32 b = contact->body_b;
+    vec2 center_a = physics_vec2(bodies->position_x[a], bodies->position_y[a]);
+    vec2 center_b = physics_vec2(bodies->position_x[b], bodies->position_y[b]);
+    vec2 normal = contact->normal;
+    vec2 tangent = physics_vec2(normal.Y, -normal.X);
+
+    for (u32 i = 0; i < contact->point_count; ++i)
+    {
+
+        vec2 offset_a = physics_sub(contact->points[i], center_a);
+        vec2 offset_b = physics_sub(contact->points[i], center_b);
+
+        // Friction first, bounded by the normal impulse of the last iteration.
+        vec2 relative = physics_sub(physics_point_velocity(bodies, b, offset_b),
+                physics_point_velocity(bodies, a, offset_a));
+        r32 lambda = -contact->tangent_mass[i] * physics_dot(relative, tangent);
+        r32 limit = contact->friction * contact->normal_impulse[i];
+        r32 accumulated = contact->tangent_impulse[i] + lambda;
+        accumulated = (accumulated < -limit) ? -limit : ((accumulated > limit) ? limit : accumulated);
+        lambda = accumulated - contact->tangent_impulse[i];
+        contact->tangent_impulse[i] = accumulated;
+
+        vec2 impulse = physics_scale(tangent, lambda);
+        physics_apply_impulse(bodies, a, offset_a, physics_scale(impulse, -1.0f));
+        physics_apply_impulse(bodies, b, offset_b, impulse);
+
+        relative = physics_sub(physics_point_velocity(bodies, b, offset_b),
+                physics_point_velocity(bodies, a, offset_a));
+        lambda = -contact->normal_mass[i] * (physics_dot(relative, normal) - contact->velocity_bias[i]);
+        accumulated = contact->normal_impulse[i] + lambda;
+        accumulated = (accumulated > 0.0f) ? accumulated : 0.0f;
+        lambda = accumulated - contact->normal_impulse[i];
+        contact->normal_impulse[i] = accumulated;
+
+        impulse = physics_scale(normal, lambda);
+        physics_apply_impulse(bodies, a, offset_a, physics_scale(impulse, -1.0f));
+        physics_apply_impulse(bodies, b, offset_b, impulse);
+
+    }
+
+}
+
+// --- Step Passes -------------------------------------------------------------
+
+static void
+physics_integrate_velocities_proc(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    physics_step_context *context = (physics_step_context*)user_data;
+    physics_world *world = context->world;
+    physics_bodies *bodies = &world->bodies;
+    vec2 gravity = physics_scale(world->gravity, context->delta_time);
+
+    for (u64 i = begin; i < end; ++i)
+    {
+
+        if (bodies->inverse_mass[i] > 0.0f)
+        {
+            bodies->velocity_x[i] += gravity.X;
+            bodies->velocity_y[i] += gravity.Y;
+        }
+
+        // Refresh the broadphase bounds, each body owns its own slot.
+        vec2 position = physics_vec2(bodies->position_x[i], bodies->position_y[i]);
+        vec2 extent;
+        switch (bodies->shape_type[i])
+        {
+
+            case PHYSICS_SHAPE_CIRCLE:
+            {
+                extent = physics_vec2(bodies->radius[i], bodies->radius[i]);
+            } break;
+
+            case PHYSICS_SHAPE_BOX:
+            {
+                extent = physics_vec2(bodies->half_x[i], bodies->half_y[i]);
+            } break;
+
+            default:
+            {
+                physics_polygon *polygon = world->polygons + bodies->polygon_index[i];
+                r32 c = bodies->rotation_c[i];
+                r32 s = bodies->rotation_s[i];
+                extent = physics_vec2(0.0f, 0.0f);
+                for (u32 v = 0; v < polygon->vertex_count; ++v)
+                {
+                    vec2 vertex = physics_rotate(polygon->vertices[v], c, s);
+                    extent.X = (fabsf(vertex.X) > extent.X) ? fabsf(vertex.X) : extent.X;
+                    extent.Y = (fabsf(vertex.Y) > extent.Y) ? fabsf(vertex.Y) : extent.Y;
+                }
+            } break;
+
+        }
+
+        sweep_prune_update(&world->broadphase, (u32)i, physics_sub(position, extent),
+                physics_add(position, extent));
+
+    }
+
+}
+
+static void
+physics_narrowphase_proc(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    physics_step_context *context = (physics_step_context*)user_data;
+    for (u64 i = begin; i < end; ++i)
+    {
+        sweep_prune_pair *pair = context->pairs + i;
+        physics_collide(context->world, pair->a, pair->b, context->contacts + i);
+    }
+
+}
+
+static void
+physics_solve_islands_proc(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    physics_step_context *context = (physics_step_context*)user_data;
+    physics_world *world = context->world;
+
+    for (u64 island = begin; island < end; ++island)
+    {
+
+        u32 first = context->island_start[island];
+        u32 last = context->island_start[island + 1];
+
+        for (u32 i = first; i < last; ++i)
+        {
+            physics_contact *contact = context->contacts + context->island_contacts[i];
+            physics_prepare_contact(world, contact, context->inverse_delta_time);
+        }
+
+        for (u32 iteration = 0; iteration < world->velocity_iterations; ++iteration)
+        {
+            for (u32 i = first; i < last; ++i)
+                physics_solve_contact(&world->bodies, context->contacts + context->island_contacts[i]);
+        }
+
+    }
+
+}
+
+static void
+physics_integrate_positions_proc(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    physics_step_context *context = (physics_step_context*)user_data;
+    physics_bodies *bodies = &context->world->bodies;
+    r32 delta_time = context->delta_time;
+
+    for (u64 i = begin; i < end; ++i)
+    {
+
+        // Resolve the union-find root into the island index for the caller.
+        u32 root = bodies->island[i];
+        bodies->island[i] = context->root_island[root];
+
+        if (bodies->inverse_mass[i] == 0.0f) continue;
+        bodies->position_x[i] += bodies->velocity_x[i] * delta_time;
+        bodies->position_y[i] += bodies->velocity_y[i] * delta_time;
+
+        // Advance the rotation along its tangent and renormalize, exact enough
+        // for the small angles of a single step and no trig involved.
+        r32 w = bodies->angular_velocity[i] * delta_time;
+        if (w == 0.0f) continue;
+        r32 c = bodies->rotation_c[i] - w * bodies->rotation_s[i];
+        r32 s = bodies->rotation_s[i] + w * bodies->rotation_c[i];
+        r32 inverse_length = 1.0f / sqrtf(c * c + s * s);
+        bodies->rotation_c[i] = c * inverse_length;
+        bodies->rotation_s[i] = s * inverse_length;
+
+    }
+
+}
+
+// --- Physics World -----------------------------------------------------------
+
+void
+physics_world_create(physics_world *world, memory_arena *arena, u32 body_capacity,
+        u32 polygon_capacity, u64 scratch_size)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(arena);
+
+    memset(world, 0, sizeof(physics_world));
+    world->body_capacity = body_capacity;
+    world->polygon_capacity = polygon_capacity;
+
+    physics_bodies *bodies = &world->bodies;
+    bodies->position_x          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->position_y          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->rotation_c          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->rotation_s          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->velocity_x          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->velocity_y          = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->angular_velocity    = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->inverse_mass        = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->inverse_inertia     = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->friction            = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->restitution         = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->radius              = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->half_x              = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->half_y              = memory_arena_push_array(arena, r32, body_capacity);
+    bodies->shape_type          = memory_arena_push_array(arena, u32, body_capacity);
+    bodies->polygon_index       = memory_arena_push_array(arena, u32, body_capacity);
+    bodies->island              = memory_arena_push_array(arena, u32, body_capacity);
+
+    world->polygons = memory_arena_push_array(arena, physics_polygon, polygon_capacity);
+
+    sweep_prune_create(&world->broadphase, arena, body_capacity);
+    memory_arena_partition(arena, &world->scratch, scratch_size);
+
+    world->gravity                  = physics_vec2(0.0f, -980.0f);
+    world->fixed_delta              = 1.0f / 60.0f;
+    world->max_steps_per_update     = 4;
+    world->velocity_iterations      = 10;
+    world->baumgarte                = 0.3f;
+    world->linear_slop              = 0.5f;
+    world->restitution_threshold    = 30.0f;
+
+}
+
+u32
+physics_world_update(physics_world *world, r32 delta_time)
+{
+
+    NX_ENSURE_POINTER(world);
+
+    world->accumulator += delta_time;
+
+    u32 steps = 0;
+    while (world->accumulator >= world->fixed_delta && steps < world->max_steps_per_update)
+    {
+        physics_world_step(world, world->fixed_delta);
+        world->accumulator -= world->fixed_delta;
+        steps++;
+    }
+
+    // Past the step limit, drop the backlog rather than spiral further behind.
+    if (world->accumulator >= world->fixed_delta)
+        world->accumulator = fmodf(world->accumulator, world->fixed_delta);
+
+    world->interpolation_alpha = world->accumulator / world->fixed_delta;
+    return steps;
+
+}
+
+void
+physics_world_step(physics_world *world, r32 delta_time)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(delta_time > 0.0f);
+
+    u64 begin = system_timestamp();
+    u64 scratch_state = memory_arena_save(&world->scratch);
+    u32 body_count = world->body_count;
+    physics_bodies *bodies = &world->bodies;
+
+    physics_step_context context = {0};
+    context.world = world;
+    context.delta_time = delta_time;
+    context.inverse_delta_time = 1.0f / delta_time;
+
+    jobs_parallel_for(body_count, PHYSICS_BODY_BATCH, physics_integrate_velocities_proc, &context);
+
+    sweep_prune_pair *pairs = NULL;
+    u64 pair_count = sweep_prune_find_pairs(&world->broadphase, &world->scratch, &pairs);
+    context.pairs = pairs;
+    context.contacts = memory_arena_push_array(&world->scratch, physics_contact, pair_count);
+    jobs_parallel_for(pair_count, PHYSICS_PAIR_BATCH, physics_narrowphase_proc, &context);
+
+    // Join dynamic bodies through their contacts. Static bodies stay out of
+    // the islands, otherwise the ground would join everything into one.
+    u32 *parent = bodies->island;
+    for (u32 i = 0; i < body_count; ++i) parent[i] = i;
+
+    u64 contact_count = 0;
+    for (u64 i = 0; i < pair_count; ++i)
+    {
+
+        physics_contact *contact = context.contacts + i;
+        if (contact->point_count == 0) continue;
+        contact_count++;
+
+        if (bodies->inverse_mass[contact->body_a] == 0.0f) continue;
+        if (bodies->inverse_mass[contact->body_b] == 0.0f) continue;
+        u32 root_a = physics_island_find(parent, contact->body_a);
+        u32 root_b = physics_island_find(parent, contact->body_b);
+        if (root_a != root_b) parent[root_a] = root_b;
+
+    }
+
+    for (u32 i = 0; i < body_count; ++i) parent[i] = physics_island_find(parent, i);
+
+    // Number the islands in contact order and bucket the contacts by island.
+    context.root_island = memory_arena_push_array(&world->scratch, u32, body_count);
+    memset(context.root_island, 0xFF, sizeof(u32) * body_count);
+    u32 *contact_island = memory_arena_push_array(&world->scratch, u32, pair_count);
+
+    u32 island_count = 0;
+    for (u64 i = 0; i < pair_count; ++i)
+    {
+
+        physics_contact *contact = context.contacts + i;
+        contact_island[i] = PHYSICS_NULL_ISLAND;
+        if (contact->point_count == 0) continue;
+
+        u32 body = (bodies->inverse_mass[contact->body_a] > 0.0f) ? contact->body_a : contact->body_b;
+        u32 root = parent[body];
+        if (context.root_island[root] == PHYSICS_NULL_ISLAND) context.root_island[root] = island_count++;
+        contact_island[i] = context.root_island[root];
+
+    }
+
+    context.island_start = memory_arena_push_array(&world->scratch, u32, island_count + 1);
+    u32 *island_cursor = memory_arena_push_array(&world->scratch, u32, island_count + 1);
+    context.island_contacts = memory_arena_push_array(&world->scratch, u32, contact_count);
+    memset(context.island_start, 0, sizeof(u32) * (island_count + 1));
+
+    for (u64 i = 0; i < pair_count; ++i)
+        if (contact_island[i] != PHYSICS_NULL_ISLAND) context.island_start[contact_island[i] + 1]++;
+    for (u32 i = 0; i < island_count; ++i)
+        context.island_start[i + 1] += context.island_start[i];
+
+    memcpy(island_cursor, context.island_start, sizeof(u32) * (island_count + 1));
+    for (u64 i = 0; i < pair_count; ++i)
+        if (contact_island[i] != PHYSICS_NULL_ISLAND) context.island_contacts[island_cursor[contact_island[i]]++] = (u32)i;
+
+    jobs_parallel_for(island_count, PHYSICS_ISLAND_BATCH, physics_solve_islands_proc, &context);
+    jobs_parallel_for(body_count, PHYSICS_BODY_BATCH, physics_integrate_positions_proc, &context);
+
+    world->pair_count = pair_count;
+    world->contact_count = contact_count;
+    world->island_count = island_count;
+
+    memory_arena_restore(&world->scratch, scratch_state);
+    world->step_milliseconds = system_timestamp_difference_ms(begin, system_timestamp());
+
+}
+
+void
+physics_world_copy_to_quads(physics_world *world, quad_layout *quads, u32 first_body, u32 count)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(quads);
+    NX_ASSERT(first_body + count <= world->body_count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        quads[i].transform.position.X = world->bodies.position_x[first_body + i];
+        quads[i].transform.position.Y = world->bodies.position_y[first_body + i];
+    }
+
+}
+
+// --- Bodies ------------------------------------------------------------------
+
+u32
+physics_body_create_circle(physics_world *world, vec2 position, r32 radius, r32 density)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(radius > 0.0f);
+
+    u32 body = physics_body_allocate(world, position, physics_vec2(radius, radius));
+    if (body == PHYSICS_NULL_BODY) return body;
+
+    world->bodies.shape_type[body] = PHYSICS_SHAPE_CIRCLE;
+    world->bodies.radius[body] = radius;
+
+    if (density > 0.0f)
+    {
+        r32 mass = density * 3.14159265f * radius * radius;
+        world->bodies.inverse_mass[body] = 1.0f / mass;
+        world->bodies.inverse_inertia[body] = 1.0f / (0.5f * mass * radius * radius);
+    }
+
+    return body;
+
+}
+
+u32
+physics_body_create_box(physics_world *world, vec2 position, vec2 half_extents, r32 density)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(half_extents.X > 0.0f && half_extents.Y > 0.0f);
+
+    u32 body = physics_body_allocate(world, position, half_extents);
+    if (body == PHYSICS_NULL_BODY) return body;
+
+    world->bodies.shape_type[body] = PHYSICS_SHAPE_BOX;
+    world->bodies.half_x[body] = half_extents.X;
+    world->bodies.half_y[body] = half_extents.Y;
+    world->bodies.radius[body] = sqrtf(physics_dot(half_extents, half_extents));
+
+    // Boxes stay axis-aligned, they have mass but no rotational inertia.
+    if (density > 0.0f)
+        world->bodies.inverse_mass[body] = 1.0f / (density * 4.0f * half_extents.X * half_extents.Y);
+
+    return body;
+
+}
+
+u32
+physics_body_create_polygon(physics_world *world, vec2 position, vec2 *vertices,
+        u32 vertex_count, r32 density)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ENSURE_POINTER(vertices);
+    NX_ASSERT(vertex_count >= 3 && vertex_count <= PHYSICS_MAX_POLYGON_VERTICES);
+    NX_ASSERT(world->polygon_count < world->polygon_capacity);
+    if (world->polygon_count >= world->polygon_capacity) return PHYSICS_NULL_BODY;
+
+    // Centroid and winding from the signed area of the fan around vertex zero.
+    r32 area = 0.0f;
+    vec2 centroid = physics_vec2(0.0f, 0.0f);
+    for (u32 i = 1; i + 1 < vertex_count; ++i)
+    {
+        vec2 e1 = physics_sub(vertices[i], vertices[0]);
+        vec2 e2 = physics_sub(vertices[i + 1], vertices[0]);
+        r32 triangle = 0.5f * physics_cross(e1, e2);
+        area += triangle;
+        centroid = physics_add(centroid, physics_scale(physics_add(e1, e2), triangle / 3.0f));
+    }
+
+    NX_ASSERT(area != 0.0f);
+    centroid = physics_add(vertices[0], physics_scale(centroid, 1.0f / area));
+
+    physics_polygon *polygon = world->polygons + world->polygon_count;
+    polygon->vertex_count = vertex_count;
+    for (u32 i = 0; i < vertex_count; ++i)
+    {
+        u32 source = (area > 0.0f) ? i : vertex_count - 1 - i;
+        polygon->vertices[i] = physics_sub(vertices[source], centroid);
+    }
+
+    r32 radius = 0.0f;
+    r32 inertia = 0.0f;
+    for (u32 i = 0; i < vertex_count; ++i)
+    {
+
+        vec2 e1 = polygon->vertices[i];
+        vec2 e2 = polygon->vertices[(i + 1) % vertex_count];
+        vec2 edge = physics_sub(e2, e1);
+        r32 length = sqrtf(physics_dot(edge, edge));
+        polygon->normals[i] = physics_vec2(edge.Y / length, -edge.X / length);
+
+        r32 d = physics_cross(e1, e2);
+        r32 x2 = e1.X * e1.X + e1.X * e2.X + e2.X * e2.X;
+        r32 y2 = e1.Y * e1.Y + e1.Y * e2.Y + e2.Y * e2.Y;
+        inertia += (d / 12.0f) * (x2 + y2);
+
+        r32 distance = sqrtf(physics_dot(e1, e1));
+        radius = (distance > radius) ? distance : radius;
+
+    }
+
+    u32 body = physics_body_allocate(world, position, physics_vec2(radius, radius));
+    if (body == PHYSICS_NULL_BODY) return body;
+
+    world->bodies.shape_type[body] = PHYSICS_SHAPE_POLYGON;
+    world->bodies.polygon_index[body] = world->polygon_count++;
+    world->bodies.radius[body] = radius;
+
+    if (density > 0.0f)
+    {
+        world->bodies.inverse_mass[body] = 1.0f / (density * fabsf(area));
+        world->bodies.inverse_inertia[body] = 1.0f / (density * inertia);
+    }
+
+    return body;
+
+}
+
+void
+physics_body_set_velocity(physics_world *world, u32 body, vec2 velocity, r32 angular_velocity)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(body < world->body_count);
+
+    world->bodies.velocity_x[body] = velocity.X;
+    world->bodies.velocity_y[body] = velocity.Y;
+    if (world->bodies.inverse_inertia[body] > 0.0f)
+        world->bodies.angular_velocity[body] = angular_velocity;
+
+}
+
+void
+physics_body_set_material(physics_world *world, u32 body, r32 friction, r32 restitution)
+{
+
+    NX_ENSURE_POINTER(world);
+    NX_ASSERT(body < world->body_count);
+
+    world->bodies.friction[body] = friction;
+    world->bodies.restitution[body] = restitution;
+
+}
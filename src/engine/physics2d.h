@@ -0,0 +1,147 @@
+#ifndef SRC_ENGINE_PHYSICS2D_H
+#define SRC_ENGINE_PHYSICS2D_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/sweepprune.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Physics 2D --------------------------------------------------------------
+//
+// A small impulse based rigid body solver for circles, axis-aligned boxes and
+// convex polygons. Body state is stored as structure-of-arrays in memory taken
+// from an arena at creation, and bodies are referred to by their index. Boxes
+// never rotate (they are axis-aligned by definition), circles and polygons do.
+// Rotation is stored as a cosine and sine pair and integrated directly, so the
+// step never calls into trig functions. A body with zero density is static.
+//
+// The world steps at a fixed rate independent of the frame rate. Call
+// physics_world_update once per frame with the frame's delta time; it runs as
+// many fixed steps as have accumulated, up to max_steps_per_update, and leaves
+// the leftover fraction in interpolation_alpha for rendering.
+//
+// Each step:
+//      1. Integrates gravity into the velocities of dynamic bodies.
+//      2. Refreshes the bounds in the sweep-and-prune broadphase and sweeps.
+//      3. Builds contact manifolds for the pairs, in parallel.
+//      4. Groups dynamic bodies touching through contacts into islands with a
+//         union-find; static bodies never join islands.
+//      5. Solves each island's contacts with sequential impulses, with the
+//         islands spread across the job system.
+//      6. Integrates positions.
+//
+// Contacts are not cached between steps, so there is no warm starting; raise
+// velocity_iterations for tall stacks. Islands are the unit of parallelism, so a
+// single pile of touching bodies is solved on one thread.
+//
+// Polygon vertices may be given in either winding and are re-centered on their
+// centroid, which is placed at the given position.
+//
+// Bodies can't be removed; create a new world from a restored arena instead.
+// The scratch arena holds the pairs and contacts of a step, budget roughly 512
+// bytes per body.
+//
+
+#define PHYSICS_MAX_POLYGON_VERTICES    8
+#define PHYSICS_NULL_BODY               0xFFFFFFFF
+
+typedef enum physics_shape_type
+{
+    PHYSICS_SHAPE_CIRCLE,
+    PHYSICS_SHAPE_BOX,
+    PHYSICS_SHAPE_POLYGON,
+} physics_shape_type;
+
+typedef struct physics_polygon
+{
+    u32 vertex_count;
+    vec2 vertices[PHYSICS_MAX_POLYGON_VERTICES];    // Counter-clockwise, around the centroid.
+    vec2 normals[PHYSICS_MAX_POLYGON_VERTICES];
+} physics_polygon;
+
+typedef struct physics_contact
+{
+    u32 body_a;
+    u32 body_b;
+    u32 point_count;
+    vec2 normal;                // From a to b.
+    vec2 points[2];             // World space.
+    r32 separation[2];          // Negative when penetrating.
+    r32 normal_impulse[2];
+    r32 tangent_impulse[2];
+    r32 normal_mass[2];
+    r32 tangent_mass[2];
+    r32 velocity_bias[2];
+    r32 friction;
+    r32 restitution;
+} physics_contact;
+
+typedef struct physics_bodies
+{
+    r32 *position_x;
+    r32 *position_y;
+    r32 *rotation_c;            // Rotation as a unit cosine and sine pair.
+    r32 *rotation_s;
+    r32 *velocity_x;
+    r32 *velocity_y;
+    r32 *angular_velocity;
+    r32 *inverse_mass;
+    r32 *inverse_inertia;
+    r32 *friction;
+    r32 *restitution;
+    r32 *radius;                // Circle radius, or the bounding radius of a polygon.
+    r32 *half_x;                // Box half extents.
+    r32 *half_y;
+    u32 *shape_type;
+    u32 *polygon_index;
+    u32 *island;                // Union-find parent during a step, island index after.
+} physics_bodies;
+
+typedef struct physics_world
+{
+
+    physics_bodies bodies;
+    u32 body_count;
+    u32 body_capacity;
+
+    physics_polygon *polygons;
+    u32 polygon_count;
+    u32 polygon_capacity;
+
+    sweep_prune broadphase;
+    memory_arena scratch;       // Reset every step.
+
+    vec2 gravity;
+    r32 fixed_delta;
+    r32 accumulator;
+    r32 interpolation_alpha;
+    u32 max_steps_per_update;
+    u32 velocity_iterations;
+
+    // Solver tuning, in world units. The defaults assume pixels.
+    r32 baumgarte;              // Fraction of the penetration corrected per step.
+    r32 linear_slop;            // Penetration allowed before correction kicks in.
+    r32 restitution_threshold;  // Closing speed below which contacts don't bounce.
+
+    // Statistics from the last step.
+    u64 pair_count;
+    u64 contact_count;
+    u32 island_count;
+    r64 step_milliseconds;
+
+} physics_world;
+
+void    physics_world_create(physics_world *world, memory_arena *arena, u32 body_capacity,
+            u32 polygon_capacity, u64 scratch_size);
+u32     physics_world_update(physics_world *world, r32 delta_time);
+void    physics_world_step(physics_world *world, r32 delta_time);
+void    physics_world_copy_to_quads(physics_world *world, quad_layout *quads, u32 first_body, u32 count);
+
+u32     physics_body_create_circle(physics_world *world, vec2 position, r32 radius, r32 density);
+u32     physics_body_create_box(physics_world *world, vec2 position, vec2 half_extents, r32 density);
+u32     physics_body_create_polygon(physics_world *world, vec2 position, vec2 *vertices,
+            u32 vertex_count, r32 density);
+void    physics_body_set_velocity(physics_world *world, u32 body, vec2 velocity, r32 angular_velocity);
+void    physics_body_set_material(physics_world *world, u32 body, r32 friction, r32 restitution);
+
+#endif
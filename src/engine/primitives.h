@@ -33,9 +33,9 @@ void cube()
 
         // The buffer.
         glGenBuffers(1, &cube_vertex_buffer);
-        glBindBuffer(GL_ARRAY_BUFFER, cube_vertex_buffer);
+        opengl_state_bind_buffer(GL_ARRAY_BUFFER, cube_vertex_buffer);
         glBufferData(GL_ARRAY_BUFFER, sizeof(r32) * 9, cube_vertices, GL_STATIC_DRAW);
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
 
         // Pull the sources into memory.
         ccptr cube_vertex_shader = NULL;
@@ -68,17 +68,12 @@ void cube()
         NX_ASSERT(cube_vertex_shader != NULL);
         NX_ASSERT(cube_fragment_shader != NULL);
 
-        // Compiling and linking the shader program.
-        GLuint vertex_shader = opengl_shader_create(GL_VERTEX_SHADER);
-        GLuint fragment_shader = opengl_shader_create(GL_FRAGMENT_SHADER);
-        opengl_shader_compile(vertex_shader, cube_vertex_shader);
-        opengl_shader_compile(fragment_shader, cube_fragment_shader);
-        cube_program = opengl_program_create();
-        opengl_program_attach(cube_program, vertex_shader);
-        opengl_program_attach(cube_program, fragment_shader);
-        opengl_program_link(cube_program);
-        opengl_shader_release(vertex_shader);
-        opengl_shader_release(fragment_shader);
+        // Compiling and linking the shader program, unless the cache has it.
+        program_cache_stage stages[2] = {
+            { GL_VERTEX_SHADER, cube_vertex_shader },
+            { GL_FRAGMENT_SHADER, cube_fragment_shader },
+        };
+        cube_program = program_cache_load(runtime_get_program_cache(), stages, 2);
 
         // Restore the arena state.
         memory_arena_restore(primary_arena, arena_save_state);
@@ -88,12 +83,12 @@ void cube()
     }
 
     glEnableVertexAttribArray(0);
-    glBindBuffer(GL_ARRAY_BUFFER, cube_vertex_buffer);
-    glUseProgram(cube_program);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, cube_vertex_buffer);
+    opengl_state_use_program(cube_program);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (vptr)0);
     glDrawArrays(GL_TRIANGLES, 0, 3);
     glDisableVertexAttribArray(0);
-    glUseProgram(0);
+    opengl_state_use_program(0);
 
 }
 
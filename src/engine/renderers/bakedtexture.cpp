@@ -0,0 +1,103 @@
+#include <engine/renderers/bakedtexture.h>
+#include <platform/filesystem.h>
+#include <platform/system.h>
+
+// The S3TC formats are an extension, so the core loader doesn't define them.
+#define BAKED_TEXTURE_RGB_S3TC_DXT1     0x83F0
+#define BAKED_TEXTURE_RGBA_S3TC_DXT5    0x83F3
+
+static GLenum
+baked_texture_internal_format(texture_bake_format format)
+{
+
+    switch (format)
+    {
+        case TEXTURE_BAKE_RGBA8:    return GL_RGBA8;
+        case TEXTURE_BAKE_BC1:      return BAKED_TEXTURE_RGB_S3TC_DXT1;
+        case TEXTURE_BAKE_BC3:      return BAKED_TEXTURE_RGBA_S3TC_DXT5;
+        case TEXTURE_BAKE_BC7:      return GL_COMPRESSED_RGBA_BPTC_UNORM;
+        default:                    return GL_NONE;
+    }
+
+}
+
+// --- Baked Textures ----------------------------------------------------------
+
+b32
+baked_texture_format_supported(texture_bake_format format)
+{
+
+    if (format == TEXTURE_BAKE_BC1 || format == TEXTURE_BAKE_BC3)
+        return opengl_extension_supported("GL_EXT_texture_compression_s3tc");
+    return format < TEXTURE_BAKE_FORMAT_COUNT;
+
+}
+
+GLuint
+baked_texture_load(ccptr path, memory_arena *scratch, baked_texture_info *info)
+{
+
+    NX_ENSURE_POINTER(path);
+    NX_ENSURE_POINTER(scratch);
+
+    u64 load_begin = system_timestamp();
+    if (!file_exists(path)) return 0;
+
+    u64 size = file_size(path);
+    if (!memory_arena_can_accomodate(scratch, size)) return 0;
+
+    u64 save_point = memory_arena_save(scratch);
+    vptr contents = memory_arena_push(scratch, size);
+    texture_bake_header *header = NULL;
+    if (file_read_all(path, contents, size) == size) header = texture_bake_parse(contents, size);
+
+    texture_bake_format format = (header != NULL) ? (texture_bake_format)header->format : TEXTURE_BAKE_FORMAT_COUNT;
+    if (header == NULL || !baked_texture_format_supported(format))
+    {
+        memory_arena_restore(scratch, save_point);
+        return 0;
+    }
+
+    GLuint texture = 0;
+    GLenum internal_format = baked_texture_internal_format(format);
+    glGenTextures(1, &texture);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, header->level_count, internal_format, header->width, header->height);
+
+    u64 texture_bytes = 0;
+    for (u32 i = 0; i < header->level_count; ++i)
+    {
+        texture_bake_level *level = header->levels + i;
+        u8 *pixels = (u8*)contents + level->offset;
+        if (format == TEXTURE_BAKE_RGBA8)
+        {
+            glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level->width, level->height,
+                    GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+        }
+        else
+        {
+            glCompressedTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level->width, level->height,
+                    internal_format, (GLsizei)level->size, pixels);
+        }
+        texture_bytes += level->size;
+    }
+
+    b32 mipmapped = (header->level_count > 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, (mipmapped) ? GL_LINEAR_MIPMAP_LINEAR : GL_NEAREST);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    if (info != NULL)
+    {
+        info->format = format;
+        info->width = header->width;
+        info->height = header->height;
+        info->level_count = header->level_count;
+        info->texture_bytes = texture_bytes;
+        info->load_milliseconds = system_timestamp_difference_ms(load_begin, system_timestamp());
+    }
+
+    memory_arena_restore(scratch, save_point);
+    return texture;
+
+}
@@ -0,0 +1,34 @@
+#ifndef SRC_ENGINE_RENDERERS_BAKEDTEXTURE_H
+#define SRC_ENGINE_RENDERERS_BAKEDTEXTURE_H
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+#include <engine/texturebake.h>
+
+// --- Baked Textures ----------------------------------------------------------
+//
+// Loads the files texbake writes, see texturebake.h. The whole file is read into
+// scratch and each level goes to the driver as stored, through immutable storage
+// and glCompressedTexSubImage2D, so nothing is decoded on the way. Textures with
+// mips are filtered trilinearly when minified and stay nearest when magnified,
+// like the other sprite textures.
+//
+// Returns 0, leaving the caller to fall back to the source image, when the file
+// is missing or malformed, or the driver can't sample its format. BC1 and BC3
+// need EXT_texture_compression_s3tc; BC7 and RGBA8 are always there.
+//
+
+typedef struct baked_texture_info
+{
+    texture_bake_format format;
+    u32 width;
+    u32 height;
+    u32 level_count;
+    u64 texture_bytes;                  // Summed over the levels, as uploaded.
+    r64 load_milliseconds;              // Reading the file and creating the texture.
+} baked_texture_info;
+
+b32     baked_texture_format_supported(texture_bake_format format);
+GLuint  baked_texture_load(ccptr path, memory_arena *scratch, baked_texture_info *info);
+
+#endif
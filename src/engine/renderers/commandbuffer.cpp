@@ -0,0 +1,309 @@
+#include <engine/renderers/commandbuffer.h>
+#include <platform/system.h>
+#include <core/jobs.h>
+#include <string.h>
+
+#define RENDER_KEY_ORDER_BITS       30
+#define RENDER_KEY_TEXTURE_BITS     14
+#define RENDER_KEY_PROGRAM_BITS     10
+#define RENDER_PAYLOAD_ALIGNMENT    16
+#define RENDER_COMMAND_INDEX_BITS   26
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+render_command_align(u64 value, u64 alignment)
+{
+
+    return (value + alignment - 1) / alignment * alignment;
+
+}
+
+static render_command*
+render_command_push(render_command_buffer *buffer, u32 stream_index, render_command_type type, u64 key)
+{
+
+    NX_ASSERT(stream_index < buffer->stream_count);
+    render_command_stream *stream = buffer->streams + stream_index;
+
+    // Over capacity commands are dropped and counted, size the streams for the
+    // busiest frame.
+    if (stream->command_count >= stream->command_capacity)
+    {
+        stream->dropped_count++;
+        return NULL;
+    }
+
+    u32 index = stream->command_count++;
+    render_command *command = stream->commands + index;
+    command->type = type;
+    stream->keys[index] = key;
+    return command;
+
+}
+
+// --- Render Command Buffer ---------------------------------------------------
+
+void
+render_command_buffer_create(render_command_buffer *buffer, memory_arena *arena,
+        u32 commands_per_stream, u64 payload_per_stream)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(commands_per_stream > 0);
+    NX_ASSERT(commands_per_stream <= (1 << RENDER_COMMAND_INDEX_BITS));
+
+    memset(buffer, 0, sizeof(render_command_buffer));
+
+    // One stream per worker that can be handed out by the job system.
+    buffer->stream_count = jobs_worker_count();
+    if (buffer->stream_count > RENDER_COMMAND_MAX_STREAMS)
+        buffer->stream_count = RENDER_COMMAND_MAX_STREAMS;
+
+    payload_per_stream = render_command_align(payload_per_stream, RENDER_PAYLOAD_ALIGNMENT);
+    for (u32 i = 0; i < buffer->stream_count; ++i)
+    {
+
+        render_command_stream *stream = buffer->streams + i;
+        stream->command_capacity = commands_per_stream;
+        stream->commands = memory_arena_push_array(arena, render_command, commands_per_stream);
+        stream->keys = memory_arena_push_array(arena, u64, commands_per_stream);
+        stream->payload_capacity = payload_per_stream;
+        if (payload_per_stream > 0)
+            stream->payload = memory_arena_push_array(arena, u8, payload_per_stream);
+
+    }
+
+    buffer->sort_capacity = commands_per_stream * buffer->stream_count;
+    buffer->sorted_keys = memory_arena_push_array(arena, u64, buffer->sort_capacity);
+    buffer->sorted_commands = memory_arena_push_array(arena, u32, buffer->sort_capacity);
+    buffer->key_scratch = memory_arena_push_array(arena, u64, buffer->sort_capacity);
+    buffer->command_scratch = memory_arena_push_array(arena, u32, buffer->sort_capacity);
+
+}
+
+void
+render_command_buffer_reset(render_command_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+
+    for (u32 i = 0; i < buffer->stream_count; ++i)
+    {
+        render_command_stream *stream = buffer->streams + i;
+        stream->command_count = 0;
+        stream->draw_count = 0;
+        stream->payload_used = 0;
+        stream->dropped_count = 0;
+    }
+
+    buffer->sorted_count = 0;
+    buffer->is_sorted = false;
+
+}
+
+u64
+render_command_make_key(u32 layer, render_blend_mode blend, GLuint program, GLuint texture, u32 order)
+{
+
+    u64 key = (u64)(layer & 0xFF) << 56;
+    key |= (u64)(blend & 0x3) << 54;
+    key |= (u64)(program & ((1 << RENDER_KEY_PROGRAM_BITS) - 1)) << 44;
+    key |= (u64)(texture & ((1 << RENDER_KEY_TEXTURE_BITS) - 1)) << RENDER_KEY_ORDER_BITS;
+    key |= (u64)(order & ((1 << RENDER_KEY_ORDER_BITS) - 1));
+    return key;
+
+}
+
+void
+render_command_draw_quads(render_command_buffer *buffer, u32 stream, u64 key,
+        render_draw_state *state, quad_render_buffer *quads, u32 first, u32 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ENSURE_POINTER(state);
+    NX_ENSURE_POINTER(quads);
+    NX_ASSERT(state->blend < RENDER_BLEND_MODE_COUNT);
+    if (count == 0) return;
+
+    render_command *command = render_command_push(buffer, stream, RENDER_COMMAND_DRAW_QUADS, key);
+    if (command == NULL) return;
+
+    command->draw_quads.state = *state;
+    command->draw_quads.quads = quads;
+    command->draw_quads.first = first;
+    command->draw_quads.count = count;
+    buffer->streams[stream].draw_count++;
+
+}
+
+void
+render_command_upload_quads(render_command_buffer *buffer, u32 stream,
+        quad_render_buffer *quads, u64 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ENSURE_POINTER(quads);
+
+    render_command *command = render_command_push(buffer, stream, RENDER_COMMAND_UPLOAD_QUADS, 0);
+    if (command == NULL) return;
+
+    command->upload_quads.quads = quads;
+    command->upload_quads.count = count;
+
+}
+
+void
+render_command_upload_buffer(render_command_buffer *buffer, u32 stream,
+        GLuint target_buffer, u64 offset, vptr data, u64 size)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ENSURE_POINTER(data);
+    NX_ASSERT(stream < buffer->stream_count);
+    if (size == 0) return;
+
+    // Check the payload first so a dropped upload doesn't leave a command behind.
+    render_command_stream *command_stream = buffer->streams + stream;
+    u64 payload_offset = command_stream->payload_used;
+    if (payload_offset + size > command_stream->payload_capacity)
+    {
+        command_stream->dropped_count++;
+        return;
+    }
+
+    render_command *command = render_command_push(buffer, stream, RENDER_COMMAND_UPLOAD_BUFFER, 0);
+    if (command == NULL) return;
+
+    u8 *payload = command_stream->payload + payload_offset;
+    memcpy(payload, data, size);
+    command_stream->payload_used = render_command_align(payload_offset + size, RENDER_PAYLOAD_ALIGNMENT);
+
+    command->upload_buffer.buffer = target_buffer;
+    command->upload_buffer.offset = offset;
+    command->upload_buffer.size = size;
+    command->upload_buffer.data = payload;
+
+}
+
+void
+render_command_buffer_sort(render_command_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+
+    u64 sort_begin = system_timestamp();
+
+    // Gather the draws stream by stream, so the stable sort keeps each stream's
+    // recording order among equal keys.
+    u32 count = 0;
+    buffer->command_count = 0;
+    buffer->dropped_count = 0;
+    for (u32 s = 0; s < buffer->stream_count; ++s)
+    {
+
+        render_command_stream *stream = buffer->streams + s;
+        buffer->command_count += stream->command_count;
+        buffer->dropped_count += stream->dropped_count;
+
+        for (u32 i = 0; i < stream->command_count; ++i)
+        {
+            if (stream->commands[i].type != RENDER_COMMAND_DRAW_QUADS) continue;
+            buffer->sorted_keys[count] = stream->keys[i];
+            buffer->sorted_commands[count] = (s << RENDER_COMMAND_INDEX_BITS) | i;
+            count++;
+        }
+
+    }
+
+    u64 *sorted = render_key_sort(buffer->sorted_keys, buffer->sorted_commands, buffer->key_scratch,
+            buffer->command_scratch, count, 0, &buffer->sort_passes);
+
+    // Keep the result in sorted, an odd number of passes ends in the scratch.
+    if (sorted != buffer->sorted_keys)
+    {
+        u32 *commands = buffer->command_scratch;
+        buffer->key_scratch = buffer->sorted_keys;
+        buffer->command_scratch = buffer->sorted_commands;
+        buffer->sorted_keys = sorted;
+        buffer->sorted_commands = commands;
+    }
+
+    buffer->sorted_count = count;
+    buffer->is_sorted = true;
+    buffer->sort_milliseconds = system_timestamp_difference_ms(sort_begin, system_timestamp());
+
+}
+
+void
+render_command_buffer_submit(render_command_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    if (!buffer->is_sorted) render_command_buffer_sort(buffer);
+
+    u64 submit_begin = system_timestamp();
+
+    // Uploads, in recording order.
+    quad_render_buffer *uploaded[RENDER_COMMAND_MAX_QUAD_UPLOADS];
+    u32 uploaded_count = 0;
+    for (u32 s = 0; s < buffer->stream_count; ++s)
+    {
+
+        render_command_stream *stream = buffer->streams + s;
+        if (stream->command_count == stream->draw_count) continue;
+
+        for (u32 i = 0; i < stream->command_count; ++i)
+        {
+
+            render_command *command = stream->commands + i;
+            switch (command->type)
+            {
+                case RENDER_COMMAND_UPLOAD_QUADS:
+                {
+                    NX_ASSERT(uploaded_count < RENDER_COMMAND_MAX_QUAD_UPLOADS);
+                    if (uploaded_count >= RENDER_COMMAND_MAX_QUAD_UPLOADS) break;
+                    renderer2d_upload_quad_render_context(command->upload_quads.quads,
+                            command->upload_quads.count);
+                    uploaded[uploaded_count++] = command->upload_quads.quads;
+                } break;
+
+                case RENDER_COMMAND_UPLOAD_BUFFER:
+                {
+                    opengl_state_bind_buffer(GL_COPY_WRITE_BUFFER, command->upload_buffer.buffer);
+                    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)command->upload_buffer.offset,
+                            (GLsizeiptr)command->upload_buffer.size, command->upload_buffer.data);
+                } break;
+
+                default: break;
+            }
+
+        }
+
+    }
+
+    // Draws, in key order. The state cache drops whatever doesn't change.
+    for (u32 i = 0; i < buffer->sorted_count; ++i)
+    {
+
+        u32 packed = buffer->sorted_commands[i];
+        u32 index = packed & ((1 << RENDER_COMMAND_INDEX_BITS) - 1);
+        render_command *command = buffer->streams[packed >> RENDER_COMMAND_INDEX_BITS].commands + index;
+        render_draw_state *state = &command->draw_quads.state;
+
+        opengl_state_use_program(state->program);
+        render_key_apply_blend(state->blend);
+        opengl_state_bind_texture(0, state->texture_array ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D,
+                state->texture);
+        renderer2d_draw_quad_range(command->draw_quads.quads, command->draw_quads.first,
+                command->draw_quads.count);
+
+    }
+
+    for (u32 i = 0; i < uploaded_count; ++i)
+        renderer2d_end_quad_render_context(uploaded[i]);
+
+    buffer->submit_milliseconds = system_timestamp_difference_ms(submit_begin, system_timestamp());
+
+}
@@ -0,0 +1,160 @@
+#ifndef SRC_ENGINE_RENDERERS_COMMANDBUFFER_H
+#define SRC_ENGINE_RENDERERS_COMMANDBUFFER_H
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+#include <engine/renderers/quad2d.h>
+#include <engine/renderers/renderkey.h>
+
+// --- Render Command Buffer ---------------------------------------------------
+//
+// Lets any thread describe rendering while only the GL thread talks to GL.
+// Commands are small structs recorded into one stream per job worker, so a
+// jobs_parallel_for over the scene can record from every core without locks:
+// pass the worker index the job hands you as the stream. Each stream has its
+// own command array and payload memory from the arena, sized at create.
+//
+// Draws carry a 64-bit sort key and the full state they need (program, texture
+// and blend mode) rather than relying on whatever an earlier command set. After
+// recording, sort gathers the draw keys of every stream and radix sorts them,
+// and submit walks the result on the GL thread, setting each draw's state
+// through the GL state cache and issuing it. Neighbouring draws which share
+// state cost no state calls at all, so keys which group state are cheaper to
+// submit; render_command_make_key packs the usual order of layer, blend mode,
+// program and texture with a per-draw order in the low bits.
+//
+// Uploads aren't sorted. Submit runs every upload first, stream by stream in
+// recording order, then every draw in key order, then ends the frame of each
+// quad buffer uploaded. A quad upload covers instances [0, count) of the buffer,
+// so workers fill disjoint ranges of its instance memory and one of them (or
+// the GL thread) records the upload. Buffer uploads copy their data into the
+// stream's payload at record time, so the source can be reused straight away.
+//
+// Sort Order:
+//      Keys are sorted in increasing order. Draws with equal keys keep their
+//      recording order within a stream, but the order between streams isn't
+//      fixed, since which worker records which part of a dispatch changes from
+//      one frame to the next. Draws whose order is visible need distinct keys.
+//
+// Key Layout (render_command_make_key):
+//      63..56  layer
+//      55..54  blend mode
+//      53..44  program, low 10 bits of the name
+//      43..30  texture, low 14 bits of the name
+//      29..0   order
+//
+//      Names past the bits only group less well; the draw still gets its state.
+//
+// Recording is per stream, so two threads must never share a stream index.
+// Dispatches nested inside a job run inline and keep the outer job's worker
+// index, so the worker index a job is handed is always safe to record into.
+// Reset before recording the next frame.
+//
+
+#define RENDER_COMMAND_MAX_STREAMS          64
+#define RENDER_COMMAND_MAX_QUAD_UPLOADS     16
+
+typedef enum render_command_type
+{
+    RENDER_COMMAND_DRAW_QUADS,      // Range of an uploaded quad buffer.
+    RENDER_COMMAND_UPLOAD_QUADS,    // Instances [0, count) of a quad buffer.
+    RENDER_COMMAND_UPLOAD_BUFFER,   // Payload bytes into a buffer object.
+} render_command_type;
+
+typedef struct render_draw_state
+{
+    GLuint program;
+    GLuint texture;                 // Bound to unit 0.
+    b32 texture_array;              // GL_TEXTURE_2D_ARRAY rather than GL_TEXTURE_2D.
+    render_blend_mode blend;
+} render_draw_state;
+
+typedef struct render_command
+{
+
+    render_command_type type;
+    union
+    {
+
+        struct
+        {
+            render_draw_state state;
+            quad_render_buffer *quads;
+            u32 first;
+            u32 count;
+        } draw_quads;
+
+        struct
+        {
+            quad_render_buffer *quads;
+            u64 count;
+        } upload_quads;
+
+        struct
+        {
+            GLuint buffer;
+            u64 offset;
+            u64 size;
+            vptr data;              // In the stream's payload.
+        } upload_buffer;
+
+    };
+
+} render_command;
+
+// Streams are written by different threads, keep them on their own cache lines.
+typedef struct alignas(64) render_command_stream
+{
+
+    render_command *commands;
+    u64 *keys;                      // One per command, unused for uploads.
+    u32 command_count;
+    u32 command_capacity;
+    u32 draw_count;
+
+    u8 *payload;
+    u64 payload_used;
+    u64 payload_capacity;
+    u32 dropped_count;              // Commands which didn't fit.
+
+} render_command_stream;
+
+typedef struct render_command_buffer
+{
+
+    render_command_stream streams[RENDER_COMMAND_MAX_STREAMS];
+    u32 stream_count;
+
+    u64 *sorted_keys;
+    u32 *sorted_commands;           // Stream and command index of each key.
+    u64 *key_scratch;
+    u32 *command_scratch;
+    u32 sorted_count;
+    u32 sort_capacity;
+    b32 is_sorted;
+
+    // Statistics from the last sort and submit.
+    u32 command_count;
+    u32 dropped_count;
+    u32 sort_passes;
+    r64 sort_milliseconds;
+    r64 submit_milliseconds;
+
+} render_command_buffer;
+
+void    render_command_buffer_create(render_command_buffer *buffer, memory_arena *arena,
+            u32 commands_per_stream, u64 payload_per_stream);
+void    render_command_buffer_reset(render_command_buffer *buffer);
+void    render_command_buffer_sort(render_command_buffer *buffer);
+void    render_command_buffer_submit(render_command_buffer *buffer);
+
+u64     render_command_make_key(u32 layer, render_blend_mode blend, GLuint program, GLuint texture, u32 order);
+
+void    render_command_draw_quads(render_command_buffer *buffer, u32 stream, u64 key,
+            render_draw_state *state, quad_render_buffer *quads, u32 first, u32 count);
+void    render_command_upload_quads(render_command_buffer *buffer, u32 stream,
+            quad_render_buffer *quads, u64 count);
+void    render_command_upload_buffer(render_command_buffer *buffer, u32 stream,
+            GLuint target_buffer, u64 offset, vptr data, u64 size);
+
+#endif
@@ -0,0 +1,203 @@
+#include <engine/renderers/frameprofiler.h>
+#include <platform/system.h>
+#include <string.h>
+#include <stdio.h>
+
+// --- Helpers -----------------------------------------------------------------
+
+// Adds the GPU times of a frame's set into the scopes, if the GPU is done with
+// every query in it. Checking the lot first keeps a frame from counting twice.
+static void
+frame_profiler_read_frame(frame_profiler *profiler, frame_profiler_frame *frame)
+{
+
+    if (frame->issued == 0) return;
+
+    for (u32 scope = 0; scope < profiler->scope_count; ++scope)
+    {
+
+        if (!(frame->issued & (1 << scope))) continue;
+
+        GLint available = 0;
+        glGetQueryObjectiv(frame->queries[scope][1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+        {
+            profiler->frames_dropped++;
+            frame->issued = 0;
+            return;
+        }
+
+    }
+
+    for (u32 scope = 0; scope < profiler->scope_count; ++scope)
+    {
+
+        if (!(frame->issued & (1 << scope))) continue;
+
+        GLuint64 begin = 0;
+        GLuint64 end = 0;
+        glGetQueryObjectui64v(frame->queries[scope][0], GL_QUERY_RESULT, &begin);
+        glGetQueryObjectui64v(frame->queries[scope][1], GL_QUERY_RESULT, &end);
+        profiler->scopes[scope].gpu_total += (r64)(end - begin) / 1000000.0;
+        profiler->scopes[scope].gpu_samples++;
+
+    }
+
+    profiler->frames_read++;
+    frame->issued = 0;
+
+}
+
+// --- Frame Profiler ----------------------------------------------------------
+
+void
+frame_profiler_create(frame_profiler *profiler)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    memset(profiler, 0, sizeof(frame_profiler));
+
+    GLint counter_bits = 0;
+    glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &counter_bits);
+    profiler->gpu_supported = (counter_bits > 0);
+
+    for (u32 i = 0; i < FRAME_PROFILER_LATENCY; ++i)
+        glGenQueries(FRAME_PROFILER_MAX_SCOPES * 2, &profiler->frames[i].queries[0][0]);
+
+    frame_profiler_scope_create(profiler, "Frame", true);
+
+}
+
+void
+frame_profiler_delete(frame_profiler *profiler)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    for (u32 i = 0; i < FRAME_PROFILER_LATENCY; ++i)
+        glDeleteQueries(FRAME_PROFILER_MAX_SCOPES * 2, &profiler->frames[i].queries[0][0]);
+    memset(profiler, 0, sizeof(frame_profiler));
+
+}
+
+profiler_scope
+frame_profiler_scope_create(frame_profiler *profiler, ccptr name, b32 gpu)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    NX_ENSURE_POINTER(name);
+    NX_ASSERT(profiler->scope_count < FRAME_PROFILER_MAX_SCOPES);
+
+    profiler_scope scope = profiler->scope_count++;
+    profiler->scopes[scope].name = name;
+    profiler->scopes[scope].gpu = gpu && profiler->gpu_supported;
+    return scope;
+
+}
+
+void
+frame_profiler_begin_frame(frame_profiler *profiler)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    NX_ASSERT(!profiler->frame_active);
+
+    profiler->frame_index = (profiler->frame_index + 1) % FRAME_PROFILER_LATENCY;
+    frame_profiler_read_frame(profiler, profiler->frames + profiler->frame_index);
+
+    profiler->frame_active = true;
+    profiler->open = 0;
+    profiler->timed = 0;
+    frame_profiler_begin(profiler, FRAME_PROFILER_FRAME_SCOPE);
+
+}
+
+void
+frame_profiler_end_frame(frame_profiler *profiler)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    NX_ASSERT(profiler->frame_active);
+
+    frame_profiler_end(profiler, FRAME_PROFILER_FRAME_SCOPE);
+    NX_ASSERT(profiler->open == 0);
+    profiler->frame_active = false;
+
+}
+
+void
+frame_profiler_begin(frame_profiler *profiler, profiler_scope scope)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    NX_ASSERT(profiler->frame_active);
+    NX_ASSERT(scope < profiler->scope_count);
+    NX_ASSERT(!(profiler->timed & (1 << scope)));
+
+    frame_profiler_scope *current = profiler->scopes + scope;
+    profiler->open |= (1 << scope);
+    profiler->timed |= (1 << scope);
+    if (current->gpu)
+        glQueryCounter(profiler->frames[profiler->frame_index].queries[scope][0], GL_TIMESTAMP);
+    current->cpu_begin = system_timestamp();
+
+}
+
+void
+frame_profiler_end(frame_profiler *profiler, profiler_scope scope)
+{
+
+    NX_ENSURE_POINTER(profiler);
+    NX_ASSERT(scope < profiler->scope_count);
+    NX_ASSERT(profiler->open & (1 << scope));
+
+    frame_profiler_scope *current = profiler->scopes + scope;
+    current->cpu_total += system_timestamp_difference_ms(current->cpu_begin, system_timestamp());
+    current->cpu_samples++;
+    profiler->open &= ~(1 << scope);
+
+    if (current->gpu)
+    {
+        frame_profiler_frame *frame = profiler->frames + profiler->frame_index;
+        glQueryCounter(frame->queries[scope][1], GL_TIMESTAMP);
+        frame->issued |= (1 << scope);
+    }
+
+}
+
+void
+frame_profiler_report(frame_profiler *profiler)
+{
+
+    NX_ENSURE_POINTER(profiler);
+
+    printf("-- Frame profile, %llu frames, %llu GPU frames read, %llu dropped:\n",
+            profiler->scopes[FRAME_PROFILER_FRAME_SCOPE].cpu_samples,
+            profiler->frames_read, profiler->frames_dropped);
+    for (u32 i = 0; i < profiler->scope_count; ++i)
+    {
+
+        frame_profiler_scope *scope = profiler->scopes + i;
+        if (scope->cpu_samples == 0) continue;
+
+        r64 cpu_average = scope->cpu_total / (r64)scope->cpu_samples;
+        if (scope->gpu_samples > 0)
+        {
+            printf("--      %-24s : CPU %8.3f ms, GPU %8.3f ms\n", scope->name,
+                    cpu_average, scope->gpu_total / (r64)scope->gpu_samples);
+        }
+        else
+        {
+            printf("--      %-24s : CPU %8.3f ms\n", scope->name, cpu_average);
+        }
+
+        scope->cpu_total = 0.0;
+        scope->cpu_samples = 0;
+        scope->gpu_total = 0.0;
+        scope->gpu_samples = 0;
+
+    }
+
+    profiler->frames_read = 0;
+    profiler->frames_dropped = 0;
+
+}
@@ -0,0 +1,88 @@
+#ifndef SRC_ENGINE_RENDERERS_FRAMEPROFILER_H
+#define SRC_ENGINE_RENDERERS_FRAMEPROFILER_H
+#include <core/definitions.h>
+#include <platform/opengl.h>
+
+// --- Frame Profiler ----------------------------------------------------------
+//
+// Named timing scopes measured on both sides of the frame, so a slow frame can
+// be pinned on the CPU or the GPU. Every scope records how long the CPU spent
+// between begin and end; scopes created with gpu set also place a GL_TIMESTAMP
+// query at each end, and the difference is how long the GPU took to get from
+// the commands issued before begin to those issued before end.
+//
+// Timestamps are used rather than GL_TIME_ELAPSED since only one elapsed query
+// can be active at a time, and scopes nest: the upload and draw of the quads sit
+// inside the render scope. Begin frame and end frame open and close a scope of
+// their own, named "Frame". On the GPU that one spans from the first command of
+// the frame to the last, time spent idle waiting for the CPU included, which the
+// scopes inside it don't count.
+//
+// Queries are never waited on. Each frame has its own set, in a ring of
+// FRAME_PROFILER_LATENCY frames; begin frame reads back the results of the frame
+// which last used the set it's about to reuse, if the GPU has them all, and
+// drops them otherwise. Results build up into averages until report prints them
+// and starts over. A scope is timed once per frame at most, and everything here
+// must happen on the thread with the context.
+//
+
+#define FRAME_PROFILER_MAX_SCOPES   16
+#define FRAME_PROFILER_LATENCY      4
+#define FRAME_PROFILER_FRAME_SCOPE  0
+
+typedef u32 profiler_scope;
+
+typedef struct frame_profiler_scope
+{
+
+    ccptr name;
+    b32 gpu;
+
+    u64 cpu_begin;                      // Timestamp of the open scope.
+    r64 cpu_total;                      // Milliseconds since the last report.
+    u64 cpu_samples;
+    r64 gpu_total;
+    u64 gpu_samples;
+
+} frame_profiler_scope;
+
+typedef struct frame_profiler_frame
+{
+    GLuint queries[FRAME_PROFILER_MAX_SCOPES][2];
+    u32 issued;                         // Scopes with both queries placed, by bit.
+} frame_profiler_frame;
+
+typedef struct frame_profiler
+{
+
+    frame_profiler_scope scopes[FRAME_PROFILER_MAX_SCOPES];
+    u32 scope_count;
+    u32 open;                           // Scopes begun and not ended, by bit.
+    u32 timed;                          // Scopes timed this frame, by bit.
+
+    frame_profiler_frame frames[FRAME_PROFILER_LATENCY];
+    u32 frame_index;
+    b32 frame_active;
+    b32 gpu_supported;                  // False if the timestamp counter has no bits.
+
+    // Statistics since the last report.
+    u64 frames_read;
+    u64 frames_dropped;                 // Read back before the GPU had them.
+
+} frame_profiler;
+
+void            frame_profiler_create(frame_profiler *profiler);
+void            frame_profiler_delete(frame_profiler *profiler);
+
+// The name isn't copied, it must outlive the profiler.
+profiler_scope  frame_profiler_scope_create(frame_profiler *profiler, ccptr name, b32 gpu);
+
+void            frame_profiler_begin_frame(frame_profiler *profiler);
+void            frame_profiler_end_frame(frame_profiler *profiler);
+void            frame_profiler_begin(frame_profiler *profiler, profiler_scope scope);
+void            frame_profiler_end(frame_profiler *profiler, profiler_scope scope);
+
+// Prints the averages on the debug console and starts them over.
+void            frame_profiler_report(frame_profiler *profiler);
+
+#endif
@@ -0,0 +1,335 @@
+#include <engine/renderers/programcache.h>
+#include <platform/filesystem.h>
+#include <platform/system.h>
+#include <stdio.h>
+#include <string.h>
+
+#define PROGRAM_CACHE_MAGIC     0x4250584E      // "NXPB"
+#define PROGRAM_CACHE_VERSION   1
+
+typedef struct program_cache_header
+{
+    u32 magic;
+    u32 version;
+    u64 key;
+    u32 binary_format;
+    u32 binary_size;
+    r64 compile_milliseconds;
+} program_cache_header;
+
+// FNV-1a, over a few kilobytes of source per program at load time.
+static u64
+program_cache_hash(u64 hash, const void *data, u64 size)
+{
+
+    const u8 *bytes = (const u8*)data;
+    for (u64 i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+
+}
+
+static u64
+program_cache_hash_string(u64 hash, ccptr string)
+{
+
+    if (string == NULL) return hash;
+    return program_cache_hash(hash, string, strlen(string) + 1);
+
+}
+
+// Reads the binary for the key, returning 0 if it's missing, stale, or the driver
+// won't take it.
+static GLuint
+program_cache_load_binary(program_cache *cache, ccptr path, u64 key, r64 *compile_milliseconds)
+{
+
+    u64 size = file_size(path);
+    if (size < sizeof(program_cache_header)) return 0;
+
+    u8 *contents = (u8*)memory_arena_push(cache->arena, size);
+    if (file_read_all(path, contents, size) != size) return 0;
+
+    program_cache_header *header = (program_cache_header*)contents;
+    if (header->magic != PROGRAM_CACHE_MAGIC || header->version != PROGRAM_CACHE_VERSION) return 0;
+    if (header->key != key) return 0;
+    if (sizeof(program_cache_header) + header->binary_size != size) return 0;
+
+    GLuint program = opengl_program_create();
+    glProgramBinary(program, header->binary_format, contents + sizeof(program_cache_header),
+            header->binary_size);
+
+    GLint link_status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    if (link_status == GL_FALSE)
+    {
+        opengl_program_release(program);
+        return 0;
+    }
+
+    *compile_milliseconds = header->compile_milliseconds;
+    return program;
+
+}
+
+// Issues every compile and the link, without asking for any status.
+static void
+program_cache_compile_begin(program_cache *cache, program_cache_build *build,
+        program_cache_stage *stages, u32 stage_count)
+{
+
+    build->program = opengl_program_create();
+    build->shader_count = stage_count;
+    for (u32 i = 0; i < stage_count; ++i)
+    {
+        build->shaders[i] = opengl_shader_create(stages[i].type);
+        opengl_shader_compile_begin(build->shaders[i], stages[i].source);
+        opengl_program_attach(build->program, build->shaders[i]);
+    }
+
+    if (cache->binaries_supported)
+        glProgramParameteri(build->program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+
+    opengl_program_link_begin(build->program);
+
+}
+
+// Waits for the build, the shaders are kept until now for their logs.
+static b32
+program_cache_compile_end(program_cache_build *build)
+{
+
+    b32 compiled = true;
+    for (u32 i = 0; i < build->shader_count; ++i)
+    {
+        if (!opengl_shader_compile_end(build->shaders[i])) compiled = false;
+    }
+
+    b32 linked = compiled && opengl_program_link_end(build->program);
+    for (u32 i = 0; i < build->shader_count; ++i)
+        opengl_shader_release(build->shaders[i]);
+    build->shader_count = 0;
+
+    return linked;
+
+}
+
+static b32
+program_cache_store_binary(program_cache *cache, ccptr path, u64 key, GLuint program,
+        r64 compile_milliseconds)
+{
+
+    GLint binary_length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binary_length);
+    if (binary_length <= 0) return false;
+
+    u64 size = sizeof(program_cache_header) + (u64)binary_length;
+    u8 *contents = (u8*)memory_arena_push(cache->arena, size);
+    program_cache_header *header = (program_cache_header*)contents;
+
+    GLsizei written = 0;
+    GLenum binary_format = 0;
+    glGetProgramBinary(program, binary_length, &written, &binary_format,
+            contents + sizeof(program_cache_header));
+    if (written <= 0) return false;
+
+    header->magic = PROGRAM_CACHE_MAGIC;
+    header->version = PROGRAM_CACHE_VERSION;
+    header->key = key;
+    header->binary_format = binary_format;
+    header->binary_size = (u32)written;
+    header->compile_milliseconds = compile_milliseconds;
+
+    size = sizeof(program_cache_header) + (u64)written;
+    return file_write_all(path, contents, size) == size;
+
+}
+
+static void
+program_cache_path(program_cache *cache, u64 key, cptr path, u64 path_size)
+{
+
+    snprintf(path, path_size, "%s/%016llx.bin", cache->directory, (unsigned long long)key);
+
+}
+
+// --- Program Cache -----------------------------------------------------------
+
+void
+program_cache_create(program_cache *cache, memory_arena *arena, ccptr directory)
+{
+
+    NX_ENSURE_POINTER(cache);
+    NX_ENSURE_POINTER(arena);
+    NX_ENSURE_POINTER(directory);
+
+    memset(cache, 0, sizeof(program_cache));
+    cache->arena = arena;
+    snprintf(cache->directory, sizeof(cache->directory), "%s", directory);
+
+    // Binaries are only good for the driver which produced them.
+    u64 hash = 14695981039346656037ULL;
+    hash = program_cache_hash_string(hash, (ccptr)glGetString(GL_VENDOR));
+    hash = program_cache_hash_string(hash, (ccptr)glGetString(GL_RENDERER));
+    hash = program_cache_hash_string(hash, (ccptr)glGetString(GL_VERSION));
+    hash = program_cache_hash_string(hash, (ccptr)glGetString(GL_SHADING_LANGUAGE_VERSION));
+    cache->driver_hash = hash;
+
+    GLint binary_formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &binary_formats);
+    cache->binaries_supported = (binary_formats > 0) && file_create_directory(directory);
+
+    if (!cache->binaries_supported)
+        printf("-- Program cache unavailable, programs will be compiled every launch.\n");
+
+}
+
+GLuint
+program_cache_load(program_cache *cache, program_cache_stage *stages, u32 stage_count)
+{
+
+    program_build build = program_cache_submit(cache, stages, stage_count);
+    return program_cache_finish(cache, build);
+
+}
+
+program_build
+program_cache_submit(program_cache *cache, program_cache_stage *stages, u32 stage_count)
+{
+
+    NX_ENSURE_POINTER(cache);
+    NX_ENSURE_POINTER(stages);
+    NX_ASSERT(stage_count > 0 && stage_count <= PROGRAM_CACHE_MAX_STAGES);
+
+    program_build handle = PROGRAM_BUILD_NONE;
+    for (u32 i = 0; i < PROGRAM_CACHE_MAX_BUILDS; ++i)
+    {
+        if (!cache->builds[i].active)
+        {
+            handle = i;
+            break;
+        }
+    }
+
+    NX_ASSERT(handle != PROGRAM_BUILD_NONE);
+    if (handle == PROGRAM_BUILD_NONE) return PROGRAM_BUILD_NONE;
+
+    u64 submit_begin = system_timestamp();
+    program_cache_build *build = cache->builds + handle;
+    memset(build, 0, sizeof(program_cache_build));
+    build->active = true;
+
+    build->key = cache->driver_hash;
+    for (u32 i = 0; i < stage_count; ++i)
+    {
+        build->key = program_cache_hash(build->key, &stages[i].type, sizeof(GLenum));
+        build->key = program_cache_hash_string(build->key, stages[i].source);
+    }
+
+    char path[320];
+    program_cache_path(cache, build->key, path, sizeof(path));
+    if (cache->binaries_supported && file_exists(path))
+    {
+
+        r64 compile_milliseconds = 0.0;
+        u64 save_point = memory_arena_save(cache->arena);
+        build->program = program_cache_load_binary(cache, path, build->key, &compile_milliseconds);
+        memory_arena_restore(cache->arena, save_point);
+        if (build->program != 0)
+        {
+            build->from_binary = true;
+            cache->statistics.programs_loaded++;
+            cache->statistics.load_milliseconds += system_timestamp_difference_ms(submit_begin, system_timestamp());
+            cache->statistics.saved_milliseconds += compile_milliseconds;
+            return handle;
+        }
+
+        cache->statistics.binaries_rejected++;
+
+    }
+
+    program_cache_compile_begin(cache, build, stages, stage_count);
+    build->submit_milliseconds = system_timestamp_difference_ms(submit_begin, system_timestamp());
+    cache->statistics.compile_milliseconds += build->submit_milliseconds;
+    return handle;
+
+}
+
+b32
+program_cache_is_ready(program_cache *cache, program_build handle)
+{
+
+    NX_ENSURE_POINTER(cache);
+    NX_ASSERT(handle < PROGRAM_CACHE_MAX_BUILDS && cache->builds[handle].active);
+
+    program_cache_build *build = cache->builds + handle;
+    if (build->from_binary) return true;
+    return opengl_program_link_is_done(build->program);
+
+}
+
+GLuint
+program_cache_finish(program_cache *cache, program_build handle)
+{
+
+    NX_ENSURE_POINTER(cache);
+    if (handle == PROGRAM_BUILD_NONE) return 0;
+    NX_ASSERT(handle < PROGRAM_CACHE_MAX_BUILDS && cache->builds[handle].active);
+
+    program_cache_build *build = cache->builds + handle;
+    GLuint program = build->program;
+    build->active = false;
+    if (build->from_binary) return program;
+
+    u64 finish_begin = system_timestamp();
+    if (!program_cache_compile_end(build))
+    {
+        opengl_program_release(program);
+        cache->statistics.compile_milliseconds += system_timestamp_difference_ms(finish_begin, system_timestamp());
+        return 0;
+    }
+
+    // What compiling cost the caller, a later hit on the binary saves this much.
+    r64 compile_milliseconds = build->submit_milliseconds +
+        system_timestamp_difference_ms(finish_begin, system_timestamp());
+
+    if (cache->binaries_supported)
+    {
+        char path[320];
+        program_cache_path(cache, build->key, path, sizeof(path));
+        u64 save_point = memory_arena_save(cache->arena);
+        if (program_cache_store_binary(cache, path, build->key, program, compile_milliseconds))
+            cache->statistics.binaries_written++;
+        memory_arena_restore(cache->arena, save_point);
+    }
+
+    cache->statistics.programs_compiled++;
+    cache->statistics.compile_milliseconds += system_timestamp_difference_ms(finish_begin, system_timestamp());
+    return program;
+
+}
+
+void
+program_cache_print_statistics(program_cache *cache)
+{
+
+    NX_ENSURE_POINTER(cache);
+    program_cache_statistics *statistics = &cache->statistics;
+
+    printf("-- Program cache: %u loaded in %.2f ms, %u compiled in %.2f ms, %u rejected, %u written.\n",
+            statistics->programs_loaded, statistics->load_milliseconds,
+            statistics->programs_compiled, statistics->compile_milliseconds,
+            statistics->binaries_rejected, statistics->binaries_written);
+
+    if (statistics->programs_loaded > 0)
+    {
+        printf("-- Program cache: compiling the loaded programs took %.2f ms, saving %.2f ms.\n",
+                statistics->saved_milliseconds,
+                statistics->saved_milliseconds - statistics->load_milliseconds);
+    }
+
+}
@@ -0,0 +1,94 @@
+#ifndef SRC_ENGINE_RENDERERS_PROGRAMCACHE_H
+#define SRC_ENGINE_RENDERERS_PROGRAMCACHE_H
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+
+// --- Program Cache -----------------------------------------------------------
+//
+// Keeps linked programs on disk so that later launches skip compiling them.
+// Every program built through the cache is linked with the binary retrievable
+// hint, then glGetProgramBinary's output is written to the cache directory in a
+// file named after the program's key. Next time the binary is handed straight
+// to glProgramBinary instead.
+//
+// The key is a hash of the driver's vendor, renderer and version strings along
+// with every stage's type and source, so editing a shader or updating the driver
+// picks a different file. The file repeats the full key and the binary's size
+// and format; anything that doesn't match, or a binary the driver refuses to
+// link, falls back to compiling and the file is written over. A driver which
+// reports no binary formats leaves the cache compiling every time.
+//
+// Builds:
+//      Submit starts a program and returns a build handle without waiting on
+//      the driver. A binary in the cache is loaded right there, it's quick.
+//      Otherwise every stage's compile and the link are issued and nothing is
+//      asked of them, so the driver can work through them, on its own threads
+//      with parallel_shader_compile, while the caller submits the rest and
+//      goes on to load other assets. Finish waits for the build, reports any
+//      errors, writes the binary, and returns the program, or 0 on failure;
+//      the handle is free again after it. Is ready says whether finish would
+//      return without waiting. Load is submit and finish together.
+//
+//      Sources only need to live until submit returns. There's room for
+//      PROGRAM_CACHE_MAX_BUILDS unfinished builds.
+//
+// The statistics split the time spent into programs loaded from binaries and
+// programs compiled. Each file also records how long compiling its program held
+// up the caller, in submit and finish, so a run which hits the cache reports
+// what it saved.
+//
+
+#define PROGRAM_CACHE_MAX_STAGES    4
+#define PROGRAM_CACHE_MAX_BUILDS    64
+#define PROGRAM_BUILD_NONE          0xFFFFFFFF
+
+typedef u32 program_build;
+
+typedef struct program_cache_stage
+{
+    GLenum type;                        // GL_VERTEX_SHADER, GL_COMPUTE_SHADER, ...
+    ccptr source;
+} program_cache_stage;
+
+typedef struct program_cache_statistics
+{
+    u32 programs_loaded;                // From a binary.
+    u32 programs_compiled;              // Missing, stale or rejected by the driver.
+    u32 binaries_rejected;              // Found, but stale or refused.
+    u32 binaries_written;
+    r64 load_milliseconds;              // Reading and linking binaries.
+    r64 compile_milliseconds;           // Submitting, waiting on and writing compiled programs.
+    r64 saved_milliseconds;             // Compile times recorded for the loaded binaries.
+} program_cache_statistics;
+
+typedef struct program_cache_build
+{
+    b32 active;
+    b32 from_binary;
+    u64 key;
+    GLuint program;
+    GLuint shaders[PROGRAM_CACHE_MAX_STAGES];
+    u32 shader_count;
+    r64 submit_milliseconds;
+} program_cache_build;
+
+typedef struct program_cache
+{
+    char directory[256];
+    memory_arena *arena;                // Scratch for binaries, restored after each load.
+    u64 driver_hash;
+    b32 binaries_supported;
+    program_cache_statistics statistics;
+    program_cache_build builds[PROGRAM_CACHE_MAX_BUILDS];
+} program_cache;
+
+void            program_cache_create(program_cache *cache, memory_arena *arena, ccptr directory);
+GLuint          program_cache_load(program_cache *cache, program_cache_stage *stages, u32 stage_count);
+void            program_cache_print_statistics(program_cache *cache);
+
+program_build   program_cache_submit(program_cache *cache, program_cache_stage *stages, u32 stage_count);
+b32             program_cache_is_ready(program_cache *cache, program_build build);
+GLuint          program_cache_finish(program_cache *cache, program_build build);
+
+#endif
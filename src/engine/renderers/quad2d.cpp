@@ -1,16 +1,287 @@
 #include <engine/renderers/quad2d.h>
+#include <immintrin.h>
+#include <string.h>
+#include <math.h>
 
-void 
-renderer2d_create_quad_render_context(quad_render_buffer *buffer, memory_arena *arena, u64 count)
+// --- Helpers -----------------------------------------------------------------
+
+static void
+quad2d_bind_instance_attributes(quad_render_buffer *buffer)
+{
+
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+    glEnableVertexAttribArray(2);
+    glEnableVertexAttribArray(3);
+    glEnableVertexAttribArray(4);
+    glEnableVertexAttribArray(5);
+
+    if (buffer->instance_format == QUAD_INSTANCE_COMPACT)
+    {
+        GLsizei stride = sizeof(quad_compact_layout);
+        glVertexAttribPointer(2, 2, GL_SHORT, GL_FALSE, stride, (void*)0);
+        glVertexAttribPointer(3, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)(sizeof(u16)*2));
+        glVertexAttribIPointer(4, 2, GL_UNSIGNED_SHORT, stride, (void*)(sizeof(u16)*4));
+        glVertexAttribPointer(5, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(sizeof(u16)*6));
+    }
+    else
+    {
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)0);
+        glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*2));
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*4));
+        glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*6));
+    }
+
+    glVertexAttribDivisor(2, 1);
+    glVertexAttribDivisor(3, 1);
+    glVertexAttribDivisor(4, 1);
+    glVertexAttribDivisor(5, 1);
+
+}
+
+static inline u64
+quad2d_capacity(quad_render_buffer *buffer)
+{
+
+    return buffer->vertex_buffer_size / buffer->instance_stride;
+
+}
+
+static void
+quad2d_wait_region(quad_render_buffer *buffer, u32 region)
+{
+
+    GLsync fence = buffer->region_fences[region];
+    if (fence == NULL) return;
+
+    // Poll first so that only real waits are counted as stalls.
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        buffer->fence_stalls++;
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    buffer->region_fences[region] = NULL;
+
+}
+
+// Points the format's public instance pointer at the given memory.
+static inline void
+quad2d_set_instance_pointer(quad_render_buffer *buffer, vptr instances)
+{
+
+    if (buffer->instance_format == QUAD_INSTANCE_COMPACT)
+        buffer->compact_buffer = (quad_compact_layout*)instances;
+    else
+        buffer->vertex_buffer = (quad_layout*)instances;
+
+}
+
+static vptr
+quad2d_map_region(quad_render_buffer *buffer)
+{
+
+    if (buffer->mapped_buffer == NULL) return buffer->staging_buffer;
+
+    u64 region_size = quad2d_capacity(buffer) * buffer->instance_stride;
+    vptr region = buffer->mapped_buffer + region_size * buffer->region_index;
+    if (!buffer->region_mapped)
+    {
+        quad2d_wait_region(buffer, buffer->region_index);
+        quad2d_set_instance_pointer(buffer, region);
+        buffer->region_mapped = true;
+    }
+
+    return region;
+
+}
+
+static inline void
+quad2d_mark_all_dirty(quad_render_buffer *buffer)
+{
+
+    for (u32 region = 0; region < QUAD_UPLOAD_REGIONS; ++region)
+        memset(buffer->dirty_blocks[region], 0xFF, sizeof(u64) * buffer->dirty_block_words);
+
+}
+
+// Copies instances [first, first + count) from the arena copy into the instance
+// storage of the current region, the array buffer must be bound.
+static inline void
+quad2d_upload_range(quad_render_buffer *buffer, u64 first, u64 count, u64 region_offset)
+{
+
+    u64 offset = first * buffer->instance_stride;
+    u64 size = count * buffer->instance_stride;
+    u8 *source = (u8*)buffer->staging_buffer + offset;
+
+    if (buffer->mapped_buffer == NULL)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, offset, size, source);
+    }
+    else
+    {
+        memcpy(buffer->mapped_buffer + region_offset + offset, source, size);
+        if (buffer->upload_mode == QUAD_UPLOAD_PERSISTENT_FLUSH)
+            glFlushMappedBufferRange(GL_ARRAY_BUFFER, region_offset + offset, size);
+    }
+
+    buffer->upload_bytes += size;
+    buffer->upload_ranges++;
+
+}
+
+// Uploads every run of dirty blocks below count as one range and clears them.
+static void
+quad2d_upload_dirty(quad_render_buffer *buffer, u64 count, u64 region_offset)
+{
+
+    u64 *bits = buffer->dirty_blocks[buffer->region_index];
+    u64 word_count = buffer->dirty_block_words;
+    u64 block_count = (count + QUAD_DIRTY_BLOCK_SIZE - 1) / QUAD_DIRTY_BLOCK_SIZE;
+
+    u64 block = 0;
+    while (block < block_count)
+    {
+
+        // Find the start of the next run.
+        u64 word = block >> 6;
+        u64 set = bits[word] & (~0ULL << (block & 63));
+        while (set == 0 && ++word < word_count) set = bits[word];
+        if (set == 0) break;
+
+        u64 first = (word << 6) + _tzcnt_u64(set);
+        if (first >= block_count) break;
+
+        // And its end, the next clear bit.
+        u64 clear = ~bits[word] & (~0ULL << (first & 63));
+        while (clear == 0 && ++word < word_count) clear = ~bits[word];
+        u64 last = (clear == 0) ? word_count << 6 : (word << 6) + _tzcnt_u64(clear);
+        if (last > block_count) last = block_count;
+
+        // A block cut short by count stays dirty, its tail has yet to go up.
+        u64 first_instance = first * QUAD_DIRTY_BLOCK_SIZE;
+        u64 last_instance = last * QUAD_DIRTY_BLOCK_SIZE;
+        u64 clean = last;
+        if (last_instance > count)
+        {
+            last_instance = count;
+            clean = last - 1;
+        }
+
+        for (u64 b = first; b < clean; ++b)
+            bits[b >> 6] &= ~(1ULL << (b & 63));
+
+        quad2d_upload_range(buffer, first_instance, last_instance - first_instance, region_offset);
+
+        block = last;
+
+    }
+
+}
+
+static void
+quad2d_release_instance_storage(quad_render_buffer *buffer)
+{
+
+    for (u32 i = 0; i < QUAD_UPLOAD_REGIONS; ++i)
+        quad2d_wait_region(buffer, i);
+
+    if (buffer->mapped_buffer != NULL)
+    {
+        opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
+        buffer->mapped_buffer = NULL;
+    }
+
+    opengl_state_delete_buffers(1, &buffer->instance_vbo);
+    buffer->instance_vbo = 0;
+    quad2d_set_instance_pointer(buffer, buffer->staging_buffer);
+    buffer->region_index = 0;
+    buffer->region_mapped = false;
+
+}
+
+static void
+quad2d_create_instance_storage(quad_render_buffer *buffer, quad_upload_mode mode)
+{
+
+    glGenBuffers(1, &buffer->instance_vbo);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+
+    if (mode == QUAD_UPLOAD_PERSISTENT || mode == QUAD_UPLOAD_PERSISTENT_FLUSH)
+    {
+
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT;
+        flags |= (mode == QUAD_UPLOAD_PERSISTENT) ? GL_MAP_COHERENT_BIT : 0;
+        GLsizeiptr size = (GLsizeiptr)buffer->vertex_buffer_size * QUAD_UPLOAD_REGIONS;
+        glBufferStorage(GL_ARRAY_BUFFER, size, NULL, flags);
+
+        GLbitfield access = flags;
+        access |= (mode == QUAD_UPLOAD_PERSISTENT_FLUSH) ? GL_MAP_FLUSH_EXPLICIT_BIT : 0;
+        buffer->mapped_buffer = (u8*)glMapBufferRange(GL_ARRAY_BUFFER, 0, size, access);
+        NX_ASSERT(buffer->mapped_buffer != NULL);
+
+    }
+    else
+    {
+
+        GLenum usage = (mode == QUAD_UPLOAD_ORPHAN) ? GL_STREAM_DRAW : GL_DYNAMIC_DRAW;
+        glBufferData(GL_ARRAY_BUFFER, buffer->vertex_buffer_size, buffer->staging_buffer, usage);
+
+    }
+
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
+    buffer->upload_mode = mode;
+
+}
+
+// --- Quad Renderer -----------------------------------------------------------
+
+static void
+quad2d_create_context(quad_render_buffer *buffer, memory_arena *arena, u64 count,
+        quad_instance_format format)
 {
 
     NX_ENSURE_POINTER(buffer);
     NX_ENSURE_POINTER(arena);
 
-    quad_layout *quad_buffer = memory_arena_push_array(arena, quad_layout, count);
-    buffer->vertex_buffer_size          = sizeof(quad_layout) * count;
+    u32 stride = (format == QUAD_INSTANCE_COMPACT) ? sizeof(quad_compact_layout) : sizeof(quad_layout);
+    vptr quad_buffer = memory_arena_push(arena, (u64)stride * count);
+    buffer->vertex_buffer_size          = stride * count;
     buffer->vertex_buffer_count         = count;
-    buffer->vertex_buffer               = quad_buffer;
+    buffer->instance_format             = format;
+    buffer->instance_stride             = stride;
+    buffer->vertex_buffer               = NULL;
+    buffer->compact_buffer              = NULL;
+    buffer->staging_buffer              = quad_buffer;
+    buffer->mapped_buffer               = NULL;
+    buffer->atlas_ubo                   = 0;
+    buffer->atlas_cell_count            = 0;
+    buffer->draw_path                   = QUAD_DRAW_INSTANCED;
+    buffer->pull_vao                    = 0;
+    buffer->pull_ibo                    = 0;
+    buffer->dirty_tracking              = false;
+    buffer->upload_bytes                = 0;
+    buffer->upload_ranges               = 0;
+    buffer->draw_base_instance          = 0;
+    quad2d_set_instance_pointer(buffer, quad_buffer);
+    buffer->region_index                = 0;
+    buffer->region_mapped               = false;
+    buffer->fence_stalls                = 0;
+    memset(buffer->region_fences, 0, sizeof(buffer->region_fences));
+
+    u64 block_count = (count + QUAD_DIRTY_BLOCK_SIZE - 1) / QUAD_DIRTY_BLOCK_SIZE;
+    buffer->dirty_block_words = (u32)((block_count + 63) / 64);
+    for (u32 region = 0; region < QUAD_UPLOAD_REGIONS; ++region)
+        buffer->dirty_blocks[region] = memory_arena_push_array(arena, u64, buffer->dirty_block_words);
+    quad2d_mark_all_dirty(buffer);
+
     buffer->index_buffer[0] = 0;
     buffer->index_buffer[1] = 1;
     buffer->index_buffer[2] = 2;
@@ -30,45 +301,53 @@ renderer2d_create_quad_render_context(quad_render_buffer *buffer, memory_arena *
     buffer->mesh = mesh;
 
     glGenVertexArrays(1, &buffer->vao);
-    glGenBuffers(1, &buffer->instance_vbo);
     glGenBuffers(1, &buffer->vbo);
     glGenBuffers(1, &buffer->ibo);
 
-    glBindVertexArray(buffer->vao);
+    opengl_state_bind_vertex_array(buffer->vao);
 
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quad_mesh), mesh, GL_STATIC_DRAW);   
-    glBindBuffer(GL_ARRAY_BUFFER, NULL);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
 
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
-    glBufferData(GL_ARRAY_BUFFER, buffer->vertex_buffer_size, quad_buffer, GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, NULL);
+    quad2d_create_instance_storage(buffer, QUAD_UPLOAD_SUBDATA);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->ibo);
+    opengl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, buffer->ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(u32) * 6, buffer->index_buffer, GL_STATIC_DRAW);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, NULL);
 
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->vbo);
     glEnableVertexAttribArray(0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)0);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(sizeof(float)*2));
 
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
-    glEnableVertexAttribArray(2);
-    glEnableVertexAttribArray(3);
-    glEnableVertexAttribArray(4);
-    glEnableVertexAttribArray(5);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)0);
-    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*2));
-    glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*4));
-    glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 8, (void*)(sizeof(float)*6));
-    glVertexAttribDivisor(2, 1);
-    glVertexAttribDivisor(3, 1);
-    glVertexAttribDivisor(4, 1);
-    glVertexAttribDivisor(5, 1);
+    quad2d_bind_instance_attributes(buffer);
+
+    opengl_state_bind_vertex_array(0);
+
+    if (format == QUAD_INSTANCE_COMPACT)
+    {
+        glGenBuffers(1, &buffer->atlas_ubo);
+        opengl_state_bind_buffer(GL_UNIFORM_BUFFER, buffer->atlas_ubo);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(vec4) * QUAD_ATLAS_MAX_CELLS, NULL, GL_STATIC_DRAW);
+        opengl_state_bind_buffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+}
+
+void 
+renderer2d_create_quad_render_context(quad_render_buffer *buffer, memory_arena *arena, u64 count)
+{
+
+    quad2d_create_context(buffer, arena, count, QUAD_INSTANCE_STANDARD);
+
+}
+
+void
+renderer2d_create_quad_compact_render_context(quad_render_buffer *buffer, memory_arena *arena, u64 count)
+{
 
-    glBindVertexArray(NULL);
+    quad2d_create_context(buffer, arena, count, QUAD_INSTANCE_COMPACT);
 
 }
 
@@ -77,15 +356,147 @@ renderer2d_delete_quad_render_context(quad_render_buffer *buffer)
 {
 
     assert(buffer != NULL);
-    glDeleteBuffers(1, &buffer->vbo);
-    glDeleteBuffers(1, &buffer->instance_vbo);
-    glDeleteBuffers(1, &buffer->ibo);
-    glDeleteVertexArrays(1, &buffer->vao);
+    quad2d_release_instance_storage(buffer);
+    opengl_state_delete_buffers(1, &buffer->vbo);
+    opengl_state_delete_buffers(1, &buffer->ibo);
+    opengl_state_delete_vertex_arrays(1, &buffer->vao);
+    if (buffer->atlas_ubo != 0) opengl_state_delete_buffers(1, &buffer->atlas_ubo);
+    if (buffer->pull_ibo != 0) opengl_state_delete_buffers(1, &buffer->pull_ibo);
+    if (buffer->pull_vao != 0) opengl_state_delete_vertex_arrays(1, &buffer->pull_vao);
+
+    buffer->atlas_ubo       = 0;
+    buffer->pull_ibo        = 0;
+    buffer->pull_vao        = 0;
+    buffer->vbo             = 0;
+    buffer->instance_vbo    = 0;
+    buffer->ibo             = 0;
+    buffer->vao             = 0;
+
+}
+
+void
+renderer2d_upload_quad_render_context(quad_render_buffer *buffer, u64 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(count <= quad2d_capacity(buffer));
 
-    buffer->vbo             = NULL;
-    buffer->instance_vbo    = NULL;
-    buffer->ibo             = NULL;
-    buffer->vao             = NULL;
+    u64 upload_size = (u64)buffer->instance_stride * count;
+    u32 base_instance = 0;
+    buffer->upload_bytes = 0;
+    buffer->upload_ranges = 0;
+    switch (buffer->upload_mode)
+    {
+
+        case QUAD_UPLOAD_SUBDATA:
+        {
+            opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+            if (buffer->dirty_tracking) quad2d_upload_dirty(buffer, count, 0);
+            else quad2d_upload_range(buffer, 0, count, 0);
+        } break;
+
+        case QUAD_UPLOAD_ORPHAN:
+        {
+            // Handing the driver new storage means it never has to wait for the
+            // GPU to finish with last frame's copy before accepting this one.
+            opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+            glBufferData(GL_ARRAY_BUFFER, buffer->vertex_buffer_size, NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_ARRAY_BUFFER, 0, upload_size, buffer->staging_buffer);
+            buffer->upload_bytes = upload_size;
+            buffer->upload_ranges = 1;
+        } break;
+
+        case QUAD_UPLOAD_PERSISTENT:
+        case QUAD_UPLOAD_PERSISTENT_FLUSH:
+        {
+
+            u32 region = buffer->region_index;
+            u64 capacity = quad2d_capacity(buffer);
+            u64 region_offset = capacity * buffer->instance_stride * region;
+            opengl_state_bind_buffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
+            if (buffer->region_mapped)
+            {
+
+                // Written in place, everything up to count is new.
+                if (buffer->upload_mode == QUAD_UPLOAD_PERSISTENT_FLUSH)
+                    glFlushMappedBufferRange(GL_ARRAY_BUFFER, region_offset, upload_size);
+                buffer->upload_bytes = upload_size;
+                buffer->upload_ranges = 1;
+
+            }
+            else
+            {
+
+                quad2d_wait_region(buffer, region);
+                if (buffer->dirty_tracking) quad2d_upload_dirty(buffer, count, region_offset);
+                else quad2d_upload_range(buffer, 0, count, region_offset);
+
+            }
+
+            base_instance = (u32)(capacity * region);
+
+        } break;
+
+        default:
+        {
+            NX_ASSERT(!"Unknown quad upload mode.");
+        } break;
+
+    }
+
+    buffer->draw_base_instance = base_instance;
+
+}
+
+void
+renderer2d_draw_quad_range(quad_render_buffer *buffer, u64 first, u64 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    if (count == 0) return;
+
+    u64 base_instance = buffer->draw_base_instance + first;
+    if (buffer->atlas_ubo != 0)
+        opengl_state_bind_buffer_base(GL_UNIFORM_BUFFER, QUAD_ATLAS_BINDING, buffer->atlas_ubo);
+
+    if (buffer->draw_path == QUAD_DRAW_PULLED)
+    {
+
+        // The base vertex carries the instance offset, gl_VertexID / 4 lands on
+        // the absolute instance in the storage buffer.
+        opengl_state_bind_vertex_array(buffer->pull_vao);
+        opengl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, QUAD_INSTANCE_BINDING, buffer->instance_vbo);
+        for (u64 offset = 0; offset < count; offset += QUAD_PULL_BATCH)
+        {
+            u64 batch = (count - offset < QUAD_PULL_BATCH) ? count - offset : QUAD_PULL_BATCH;
+            GLint base_vertex = (GLint)((base_instance + offset) * 4);
+            glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)(batch * 6), GL_UNSIGNED_INT, (void*)0, base_vertex);
+        }
+
+    }
+    else
+    {
+        opengl_state_bind_vertex_array(buffer->vao);
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0,
+                (GLsizei)count, (GLuint)base_instance);
+    }
+
+}
+
+void
+renderer2d_end_quad_render_context(quad_render_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+
+    // Fence the region behind the draw and move on to the next one.
+    if (buffer->mapped_buffer != NULL)
+    {
+        buffer->region_fences[buffer->region_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        buffer->region_index = (buffer->region_index + 1) % QUAD_UPLOAD_REGIONS;
+        buffer->region_mapped = false;
+        quad2d_set_instance_pointer(buffer, buffer->staging_buffer);
+    }
 
 }
 
@@ -93,18 +504,261 @@ void
 renderer2d_render_quad_render_context(quad_render_buffer *buffer, u64 count)
 {
 
-    glBindVertexArray(buffer->vao);
+    renderer2d_upload_quad_render_context(buffer, count);
+    renderer2d_draw_quad_range(buffer, 0, count);
+    renderer2d_end_quad_render_context(buffer);
+
+}
+
+void
+renderer2d_set_quad_upload_mode(quad_render_buffer *buffer, quad_upload_mode mode)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(mode < QUAD_UPLOAD_MODE_COUNT);
+    if (buffer->upload_mode == mode) return;
+
+    // Persistent storage is immutable, so every switch gets a fresh buffer
+    // and the instance attributes are pointed at it.
+    quad2d_release_instance_storage(buffer);
+    quad2d_create_instance_storage(buffer, mode);
+    quad2d_mark_all_dirty(buffer);
+
+    opengl_state_bind_vertex_array(buffer->vao);
+    quad2d_bind_instance_attributes(buffer);
+    opengl_state_bind_vertex_array(0);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
+
+}
+
+void
+renderer2d_set_quad_dirty_tracking(quad_render_buffer *buffer, b32 enabled)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    if (enabled && !buffer->dirty_tracking) quad2d_mark_all_dirty(buffer);
+    buffer->dirty_tracking = enabled;
+
+}
+
+void
+renderer2d_mark_quad_range_dirty(quad_render_buffer *buffer, u64 first, u64 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(first + count <= quad2d_capacity(buffer));
+    if (count == 0) return;
+
+    u64 first_block = first / QUAD_DIRTY_BLOCK_SIZE;
+    u64 last_block = (first + count - 1) / QUAD_DIRTY_BLOCK_SIZE;
+    for (u32 region = 0; region < QUAD_UPLOAD_REGIONS; ++region)
+    {
+        u64 *bits = buffer->dirty_blocks[region];
+        for (u64 block = first_block; block <= last_block; ++block)
+            bits[block >> 6] |= 1ULL << (block & 63);
+    }
+
+}
+
+void
+renderer2d_set_quad_draw_path(quad_render_buffer *buffer, quad_draw_path path)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(path < QUAD_DRAW_PATH_COUNT);
+
+    // The pull index buffer is only built the first time it is needed.
+    if (path == QUAD_DRAW_PULLED && buffer->pull_vao == 0)
+    {
+
+        GLsizeiptr index_size = sizeof(u32) * QUAD_PULL_BATCH * 6;
+        glGenVertexArrays(1, &buffer->pull_vao);
+        glGenBuffers(1, &buffer->pull_ibo);
+        opengl_state_bind_vertex_array(buffer->pull_vao);
+        opengl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, buffer->pull_ibo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, index_size, NULL, GL_STATIC_DRAW);
+
+        u32 *indices = (u32*)glMapBufferRange(GL_ELEMENT_ARRAY_BUFFER, 0, index_size,
+                GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        NX_ENSURE_POINTER(indices);
+        for (u32 quad = 0; quad < QUAD_PULL_BATCH; ++quad)
+        {
+            for (u32 i = 0; i < 6; ++i)
+                indices[quad * 6 + i] = quad * 4 + buffer->index_buffer[i];
+        }
+
+        glUnmapBuffer(GL_ELEMENT_ARRAY_BUFFER);
+        opengl_state_bind_vertex_array(0);
+
+    }
+
+    buffer->draw_path = path;
+
+}
+
+quad_layout*
+renderer2d_map_quad_render_context(quad_render_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(buffer->instance_format == QUAD_INSTANCE_STANDARD);
+    return (quad_layout*)quad2d_map_region(buffer);
+
+}
+
+quad_compact_layout*
+renderer2d_map_quad_compact_render_context(quad_render_buffer *buffer)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(buffer->instance_format == QUAD_INSTANCE_COMPACT);
+    return (quad_compact_layout*)quad2d_map_region(buffer);
+
+}
+
+ccptr
+renderer2d_quad_upload_mode_name(quad_upload_mode mode)
+{
+
+    switch (mode)
+    {
+        case QUAD_UPLOAD_SUBDATA:           return "SubData";
+        case QUAD_UPLOAD_ORPHAN:            return "Orphan + SubData";
+        case QUAD_UPLOAD_PERSISTENT:        return "Persistent Coherent";
+        case QUAD_UPLOAD_PERSISTENT_FLUSH:  return "Persistent Flush";
+        default:                            return "Unknown";
+    }
+
+}
+
+ccptr
+renderer2d_quad_draw_path_name(quad_draw_path path)
+{
+
+    switch (path)
+    {
+        case QUAD_DRAW_INSTANCED:   return "Instanced Attributes";
+        case QUAD_DRAW_PULLED:      return "Vertex Pulling";
+        default:                    return "Unknown";
+    }
+
+}
+
+// --- Compact Instances -------------------------------------------------------
+
+void
+renderer2d_set_quad_atlas(quad_render_buffer *buffer, vec4 *cells, u32 count)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ENSURE_POINTER(cells);
+    NX_ASSERT(buffer->atlas_ubo != 0);
+    NX_ASSERT(count <= QUAD_ATLAS_MAX_CELLS);
+
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, buffer->atlas_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(vec4) * count, cells);
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, 0);
+    buffer->atlas_cell_count = count;
+
+}
+
+void
+renderer2d_set_quad_atlas_grid(quad_render_buffer *buffer, u32 columns, u32 rows)
+{
+
+    NX_ENSURE_POINTER(buffer);
+    NX_ASSERT(columns * rows <= QUAD_ATLAS_MAX_CELLS);
+
+    // Row major, matching the cell index the pack routine derives from offsets.
+    vec4 cells[QUAD_ATLAS_MAX_CELLS];
+    r32 width = 1.0f / (r32)columns;
+    r32 height = 1.0f / (r32)rows;
+    for (u32 y = 0; y < rows; ++y)
+    {
+        for (u32 x = 0; x < columns; ++x)
+            cells[y * columns + x] = { (r32)x * width, (r32)y * height, width, height };
+    }
+
+    renderer2d_set_quad_atlas(buffer, cells, columns * rows);
+
+}
+
+static inline i16
+quad2d_compact_position(r32 value)
+{
+
+    r32 fixed = value * QUAD_COMPACT_POSITION_SCALE;
+    fixed = (fixed < -32768.0f) ? -32768.0f : ((fixed > 32767.0f) ? 32767.0f : fixed);
+    return (i16)lrintf(fixed);
+
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, buffer->instance_vbo);
-    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad_layout) * count, buffer->vertex_buffer);
-    glBindBuffer(GL_ARRAY_BUFFER, NULL);
+void
+renderer2d_quad_compact_pack(quad_compact_layout *quad, vec2 position, vec2 scale,
+        r32 turns, u32 atlas_cell, u32 atlas_layer, u32 tint)
+{
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->ibo);
-    glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)0, count);
+    NX_ENSURE_POINTER(quad);
+    NX_ASSERT(atlas_cell < QUAD_ATLAS_MAX_CELLS);
+    NX_ASSERT(atlas_layer < QUAD_ATLAS_MAX_LAYERS);
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->ibo);
-    glBindVertexArray(buffer->vao);
+    quad->position[0]   = quad2d_compact_position(position.X);
+    quad->position[1]   = quad2d_compact_position(position.Y);
+    quad->scale[0]      = _cvtss_sh(scale.X, _MM_FROUND_TO_NEAREST_INT);
+    quad->scale[1]      = _cvtss_sh(scale.Y, _MM_FROUND_TO_NEAREST_INT);
+    quad->rotation      = (u16)((u32)lrintf((turns - floorf(turns)) * 65536.0f) & 0xFFFF);
+    quad->atlas_cell    = (u16)((atlas_layer << QUAD_ATLAS_CELL_BITS) | atlas_cell);
+    quad->tint          = tint;
 
 }
 
+void
+renderer2d_quad_compact_pack_layouts(quad_compact_layout *destination, quad_layout *source,
+        u64 count, u32 atlas_columns, u32 atlas_rows, u32 atlas_layer)
+{
+
+    NX_ENSURE_POINTER(destination);
+    NX_ENSURE_POINTER(source);
+    NX_ASSERT(atlas_layer < QUAD_ATLAS_MAX_LAYERS);
+
+    u32 layer_bits = atlas_layer << QUAD_ATLAS_CELL_BITS;
+
+    r32 columns = (r32)atlas_columns;
+    r32 rows = (r32)atlas_rows;
+    __m128 position_scale = _mm_set1_ps(QUAD_COMPACT_POSITION_SCALE);
+    __m128 position_min = _mm_set1_ps(-32768.0f);
+    __m128 position_max = _mm_set1_ps(32767.0f);
 
+    // Each quad_layout is eight floats; position and scale are the first four,
+    // so one load covers a quad and converts in a single pass.
+    for (u64 i = 0; i < count; ++i)
+    {
+
+        quad_layout *quad = source + i;
+        __m128 transform = _mm_loadu_ps(&quad->transform.position.X);
+
+        __m128 position = _mm_mul_ps(transform, position_scale);
+        position = _mm_min_ps(_mm_max_ps(position, position_min), position_max);
+        __m128i fixed = _mm_cvtps_epi32(position);
+        fixed = _mm_packs_epi32(fixed, fixed);
+        __m128i halves = _mm_cvtps_ph(_mm_movehl_ps(transform, transform), _MM_FROUND_TO_NEAREST_INT);
+
+        quad_compact_layout *packed = destination + i;
+        u32 fixed_bits = (u32)_mm_cvtsi128_si32(fixed);
+        u32 half_bits = (u32)_mm_cvtsi128_si32(halves);
+        memcpy(packed->position, &fixed_bits, sizeof(u32));
+        memcpy(packed->scale, &half_bits, sizeof(u32));
+
+        // Offsets at or past the far edge would round onto the next row or
+        // layer, so the cell is clamped to the grid.
+        long cell_x = lrintf(quad->texture.offset.X * columns);
+        long cell_y = lrintf(quad->texture.offset.Y * rows);
+        cell_x = (cell_x < 0) ? 0 : (cell_x > (long)atlas_columns - 1) ? (long)atlas_columns - 1 : cell_x;
+        cell_y = (cell_y < 0) ? 0 : (cell_y > (long)atlas_rows - 1) ? (long)atlas_rows - 1 : cell_y;
+        packed->rotation = 0;
+        packed->atlas_cell = (u16)(layer_bits | ((u32)cell_y * atlas_columns + (u32)cell_x));
+        packed->tint = 0xFFFFFFFF;
+
+    }
+
+}
@@ -4,6 +4,7 @@
 #include <core/linear.h>
 #include <core/arena.h>
 #include <platform/opengl.h>
+#include <engine/renderers/uniformring.h>
 
 typedef struct quad_mesh_vertex
 {
@@ -43,6 +44,66 @@ typedef struct quad_layout
 
 } quad_layout;
 
+#define QUAD_UPLOAD_REGIONS             3
+#define QUAD_ATLAS_MAX_CELLS            1024
+#define QUAD_ATLAS_CELL_BITS            10
+#define QUAD_ATLAS_MAX_LAYERS           64
+#define QUAD_ATLAS_BINDING              0
+#define QUAD_INSTANCE_BINDING           1
+#define QUAD_FRAME_BINDING              1
+#define QUAD_PULL_BATCH                 65536
+#define QUAD_DIRTY_BLOCK_SIZE           256
+#define QUAD_COMPACT_POSITION_SCALE     8.0f
+
+// The per-frame constants of every quad shader, read from the quad_frame uniform
+// block at QUAD_FRAME_BINDING. The pulled shaders only use the product.
+typedef struct quad_frame_constants
+{
+    mat4 projection;
+    mat4 camera;
+    mat4 view_projection;
+} quad_frame_constants;
+
+UNIFORM_STD140_FIRST(quad_frame_constants, projection);
+UNIFORM_STD140_NEXT(quad_frame_constants, projection, camera);
+UNIFORM_STD140_NEXT(quad_frame_constants, camera, view_projection);
+UNIFORM_STD140_SIZE(quad_frame_constants);
+
+// The compact instance is half the size of quad_layout. Positions are 13.3 fixed
+// point pixels, so they cover [-4096, 4096) in eighths of a pixel, and the
+// texture region is an index into the atlas cells uploaded to a uniform block.
+// The top bits of the cell pick the texture array layer the cell is read from.
+typedef struct quad_compact_layout
+{
+    i16 position[2];                // Pixels, multiplied by QUAD_COMPACT_POSITION_SCALE.
+    u16 scale[2];                   // Half floats.
+    u16 rotation;                   // Fraction of a full counter-clockwise turn.
+    u16 atlas_cell;                 // Cell in the low QUAD_ATLAS_CELL_BITS, array layer above.
+    u32 tint;                       // RGBA8, red in the low byte.
+} quad_compact_layout;
+
+typedef enum quad_instance_format
+{
+    QUAD_INSTANCE_STANDARD,         // quad_layout, 32 bytes.
+    QUAD_INSTANCE_COMPACT,          // quad_compact_layout, 16 bytes.
+} quad_instance_format;
+
+typedef enum quad_draw_path
+{
+    QUAD_DRAW_INSTANCED,            // Instanced attributes with a divisor, one mesh.
+    QUAD_DRAW_PULLED,               // Instances fetched from an SSBO, no vertex attributes.
+    QUAD_DRAW_PATH_COUNT,
+} quad_draw_path;
+
+typedef enum quad_upload_mode
+{
+    QUAD_UPLOAD_SUBDATA,            // glBufferSubData into the same storage every frame.
+    QUAD_UPLOAD_ORPHAN,             // Orphan the storage with glBufferData, then glBufferSubData.
+    QUAD_UPLOAD_PERSISTENT,         // Persistent coherent mapping split into fenced regions.
+    QUAD_UPLOAD_PERSISTENT_FLUSH,   // Persistent mapping with explicit flushes of the written range.
+    QUAD_UPLOAD_MODE_COUNT,
+} quad_upload_mode;
+
 typedef struct quad_render_buffer
 {
     u32 index_buffer[6];            // Indexing order of vertices.
@@ -54,6 +115,31 @@ typedef struct quad_render_buffer
     GLuint vbo;                     // Vertex buffer object.
     GLuint instance_vbo;            // Per-instance vbo.
     GLuint ibo;                     // Index buffer object.
+
+    quad_instance_format instance_format;
+    u32 instance_stride;            // Size of one instance in bytes.
+    quad_compact_layout *compact_buffer;    // The buffer of quads for the compact format.
+    GLuint atlas_ubo;               // Atlas cells for the compact format.
+    u32 atlas_cell_count;
+
+    quad_draw_path draw_path;
+    GLuint pull_vao;                // Attribute-less VAO holding pull_ibo.
+    GLuint pull_ibo;                // Six indices per quad for QUAD_PULL_BATCH quads.
+
+    quad_upload_mode upload_mode;   // How the instances reach instance_vbo.
+    vptr staging_buffer;            // The arena copy of the quads, used when not mapped.
+    u8 *mapped_buffer;              // Persistent mapping, QUAD_UPLOAD_REGIONS regions.
+    GLsync region_fences[QUAD_UPLOAD_REGIONS];
+    u32 region_index;               // Region the next frame writes to.
+    b32 region_mapped;              // The frame writes straight into the mapped region.
+    u64 fence_stalls;               // Times a region was still in use by the GPU.
+
+    b32 dirty_tracking;             // Upload only the blocks marked dirty.
+    u64 *dirty_blocks[QUAD_UPLOAD_REGIONS];     // One bit per QUAD_DIRTY_BLOCK_SIZE instances.
+    u32 dirty_block_words;
+    u64 upload_bytes;               // Bytes uploaded by the last render.
+    u32 upload_ranges;              // Upload (or flush) calls made by the last render.
+    u32 draw_base_instance;         // Where this frame's instances start in instance_vbo.
 } quad_render_buffer;
 
 // --- Renderer2D Quad Renderer ------------------------------------------------
@@ -64,8 +150,42 @@ typedef struct quad_render_buffer
 // core transformational components.
 //
 // You can use this to easily render off a single sprite sheet very quickly.
-// This setup has been tested to handle over one million quads (2 million triangles)
-// over 60FPS. This is pretty typical for modern GPUs.
+// This setup has been tested to handle over one million quads (2 million
+// triangles) over 60FPS. This is pretty typical for modern GPUs.
+//
+// Compact Instances:
+//      The compact context stores quad_compact_layout in compact_buffer, half
+//      the upload. Texture regions are atlas cells, with the array layer above
+//      them. Draw it with the quad2d_compact shaders, and use
+//      quad2d_compact_array_fragment to read the layer.
+//
+// Upload Modes:
+//      See quad_upload_mode. The persistent modes keep QUAD_UPLOAD_REGIONS
+//      fenced regions mapped and draw each frame from the next one. After the
+//      map routine, vertex_buffer or compact_buffer points into that region
+//      until the next render; it's write-combined, so never read it back.
+//
+// Split Rendering:
+//      Render is upload, draw and end. Batchers upload once, draw each range,
+//      then end, which fences the region; don't draw from the buffer after it.
+//      Binds go through the GL state cache and are left in place, so bind a
+//      vertex array of your own before touching attribute state.
+//
+// Dirty Tracking:
+//      Only blocks of QUAD_DIRTY_BLOCK_SIZE instances marked dirty since their
+//      last upload are sent, so mark every instance you change. Orphaning and
+//      mapped writes always upload everything.
+//
+// Vertex Pulling:
+//      The pulled path reads instances from the storage buffer at
+//      QUAD_INSTANCE_BINDING, instance gl_VertexID / 4 and corner
+//      gl_VertexID % 4, in draws of QUAD_PULL_BATCH quads. Draw it with the
+//      quad2d_pull shaders.
+//
+// Frame Constants:
+//      Every quad shader reads its matrices from the std140 quad_frame block,
+//      laid out as quad_frame_constants. Push them into a uniform_ring once a
+//      frame and bind the allocation to QUAD_FRAME_BINDING before drawing.
 //
 // Shader Program Reference:
 //      layout (location = 0) in vec2 in_position;
@@ -74,11 +194,46 @@ typedef struct quad_render_buffer
 //      layout (location = 3) in vec2 v_scale;
 //      layout (location = 4) in vec2 v_texture_offset;
 //      layout (location = 5) in vec2 v_texture_dimensions;
+//      layout (std140, binding = 1) uniform quad_frame { ... };
 //      gl_VertexID will provide which of the four mesh coordinates you are on.
 //
+// Compact Shader Program Reference:
+//      layout (location = 2) in vec2 v_position;     Fixed point, unscaled.
+//      layout (location = 3) in vec2 v_scale;
+//      layout (location = 4) in uvec2 v_rotation_cell;
+//      layout (location = 5) in vec4 v_tint;
+//      layout (std140, binding = 0) uniform quad_atlas { ... };
+//
+// Pulled Shader Program Reference:
+//      layout (std430, binding = 1) readonly buffer quad_instances { ... };
+//
 
 void renderer2d_create_quad_render_context(quad_render_buffer *buffer, memory_arena *arena, u64 count);
 void renderer2d_delete_quad_render_context(quad_render_buffer *buffer);
 void renderer2d_render_quad_render_context(quad_render_buffer *buffer, u64 count);
 
+void renderer2d_upload_quad_render_context(quad_render_buffer *buffer, u64 count);
+void renderer2d_draw_quad_range(quad_render_buffer *buffer, u64 first, u64 count);
+void renderer2d_end_quad_render_context(quad_render_buffer *buffer);
+
+void renderer2d_create_quad_compact_render_context(quad_render_buffer *buffer, memory_arena *arena, u64 count);
+
+void                    renderer2d_set_quad_upload_mode(quad_render_buffer *buffer, quad_upload_mode mode);
+quad_layout*            renderer2d_map_quad_render_context(quad_render_buffer *buffer);
+quad_compact_layout*    renderer2d_map_quad_compact_render_context(quad_render_buffer *buffer);
+ccptr                   renderer2d_quad_upload_mode_name(quad_upload_mode mode);
+
+void                    renderer2d_set_quad_dirty_tracking(quad_render_buffer *buffer, b32 enabled);
+void                    renderer2d_mark_quad_range_dirty(quad_render_buffer *buffer, u64 first, u64 count);
+
+void                    renderer2d_set_quad_draw_path(quad_render_buffer *buffer, quad_draw_path path);
+ccptr                   renderer2d_quad_draw_path_name(quad_draw_path path);
+
+void    renderer2d_set_quad_atlas(quad_render_buffer *buffer, vec4 *cells, u32 count);
+void    renderer2d_set_quad_atlas_grid(quad_render_buffer *buffer, u32 columns, u32 rows);
+void    renderer2d_quad_compact_pack(quad_compact_layout *quad, vec2 position, vec2 scale,
+            r32 turns, u32 atlas_cell, u32 atlas_layer, u32 tint);
+void    renderer2d_quad_compact_pack_layouts(quad_compact_layout *destination, quad_layout *source,
+            u64 count, u32 atlas_columns, u32 atlas_rows, u32 atlas_layer);
+
 #endif
@@ -0,0 +1,449 @@
+#include <engine/renderers/quadcull.h>
+#include <platform/system.h>
+#include <core/jobs.h>
+#include <immintrin.h>
+#include <string.h>
+#include <math.h>
+#include <stddef.h>
+
+#define QUAD_CULL_MIN_BLOCK     16384
+
+// Lane indices of the set bits of each mask, packed to the front.
+static u32 quad_cull_pack_table[256][8];
+static b32 quad_cull_pack_table_ready;
+
+typedef struct quad_cull_context
+{
+    quad_culler *culler;
+    quad_layout *source;
+    quad_layout *destination;
+    u64 count;
+    u64 block_size;             // Multiple of the group size.
+    r32 view_min_x;
+    r32 view_min_y;
+    r32 view_max_x;
+    r32 view_max_y;
+} quad_cull_context;
+
+// --- Helpers -----------------------------------------------------------------
+
+static void
+quad_cull_build_pack_table()
+{
+
+    for (u32 mask = 0; mask < 256; ++mask)
+    {
+        u32 packed = 0;
+        for (u32 lane = 0; lane < 8; ++lane)
+        {
+            if (mask & (1 << lane)) quad_cull_pack_table[mask][packed++] = lane;
+        }
+        while (packed < 8) quad_cull_pack_table[mask][packed++] = 0;
+    }
+
+    quad_cull_pack_table_ready = true;
+
+}
+
+static inline __m256
+quad_cull_load_pair(r32 *low, r32 *high)
+{
+
+    return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(low)), _mm_loadu_ps(high), 1);
+
+}
+
+static inline b32
+quad_cull_test(quad_layout *quad, quad_cull_context *context)
+{
+
+    r32 half_x = fabsf(quad->transform.scale.X) * 0.5f;
+    r32 half_y = fabsf(quad->transform.scale.Y) * 0.5f;
+    r32 x = quad->transform.position.X;
+    r32 y = quad->transform.position.Y;
+    return (x + half_x >= context->view_min_x) && (x - half_x <= context->view_max_x) &&
+        (y + half_y >= context->view_min_y) && (y - half_y <= context->view_max_y);
+
+}
+
+static void
+quad_cull_test_blocks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_cull_context *context = (quad_cull_context*)user_data;
+    quad_culler *culler = context->culler;
+
+    __m256 view_min_x = _mm256_set1_ps(context->view_min_x);
+    __m256 view_min_y = _mm256_set1_ps(context->view_min_y);
+    __m256 view_max_x = _mm256_set1_ps(context->view_max_x);
+    __m256 view_max_y = _mm256_set1_ps(context->view_max_y);
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 sign = _mm256_set1_ps(-0.0f);
+
+    for (u64 block = begin; block < end; ++block)
+    {
+
+        u64 first = block * context->block_size;
+        u64 last = first + context->block_size;
+        if (last > context->count) last = context->count;
+
+        u64 visible = 0;
+        u64 i = first;
+        for (; i + QUAD_CULL_GROUP_SIZE <= last; i += QUAD_CULL_GROUP_SIZE)
+        {
+
+            // Only position and scale matter, the first four floats of each quad.
+            // Pair quads four apart into the two lanes, then transpose each lane.
+            r32 *quads = (r32*)(context->source + i);
+            __m256 q04 = quad_cull_load_pair(quads + 0 * 8, quads + 4 * 8);
+            __m256 q15 = quad_cull_load_pair(quads + 1 * 8, quads + 5 * 8);
+            __m256 q26 = quad_cull_load_pair(quads + 2 * 8, quads + 6 * 8);
+            __m256 q37 = quad_cull_load_pair(quads + 3 * 8, quads + 7 * 8);
+
+            __m256 position_01 = _mm256_unpacklo_ps(q04, q15);
+            __m256 scale_01 = _mm256_unpackhi_ps(q04, q15);
+            __m256 position_23 = _mm256_unpacklo_ps(q26, q37);
+            __m256 scale_23 = _mm256_unpackhi_ps(q26, q37);
+
+            __m256 x = _mm256_shuffle_ps(position_01, position_23, _MM_SHUFFLE(1, 0, 1, 0));
+            __m256 y = _mm256_shuffle_ps(position_01, position_23, _MM_SHUFFLE(3, 2, 3, 2));
+            __m256 half_x = _mm256_mul_ps(_mm256_andnot_ps(sign,
+                        _mm256_shuffle_ps(scale_01, scale_23, _MM_SHUFFLE(1, 0, 1, 0))), half);
+            __m256 half_y = _mm256_mul_ps(_mm256_andnot_ps(sign,
+                        _mm256_shuffle_ps(scale_01, scale_23, _MM_SHUFFLE(3, 2, 3, 2))), half);
+
+            __m256 inside_x = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_add_ps(x, half_x), view_min_x, _CMP_GE_OQ),
+                    _mm256_cmp_ps(_mm256_sub_ps(x, half_x), view_max_x, _CMP_LE_OQ));
+            __m256 inside_y = _mm256_and_ps(
+                    _mm256_cmp_ps(_mm256_add_ps(y, half_y), view_min_y, _CMP_GE_OQ),
+                    _mm256_cmp_ps(_mm256_sub_ps(y, half_y), view_max_y, _CMP_LE_OQ));
+
+            u32 mask = (u32)_mm256_movemask_ps(_mm256_and_ps(inside_x, inside_y));
+            culler->group_masks[i / QUAD_CULL_GROUP_SIZE] = (u8)mask;
+            visible += _mm_popcnt_u32(mask);
+
+        }
+
+        // Only the last block can end part way through a group.
+        if (i < last)
+        {
+            u32 mask = 0;
+            for (u32 lane = 0; i + lane < last; ++lane)
+            {
+                if (quad_cull_test(context->source + i + lane, context)) mask |= 1 << lane;
+            }
+            culler->group_masks[i / QUAD_CULL_GROUP_SIZE] = (u8)mask;
+            visible += _mm_popcnt_u32(mask);
+        }
+
+        culler->block_visible[block] = visible;
+
+    }
+
+}
+
+static void
+quad_cull_compact_blocks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_cull_context *context = (quad_cull_context*)user_data;
+    quad_culler *culler = context->culler;
+
+    for (u64 block = begin; block < end; ++block)
+    {
+
+        u64 first = block * context->block_size;
+        u64 last = first + context->block_size;
+        if (last > context->count) last = context->count;
+
+        quad_layout *destination = context->destination + culler->block_visible[block];
+        for (u64 i = first; i < last; i += QUAD_CULL_GROUP_SIZE)
+        {
+
+            u32 mask = culler->group_masks[i / QUAD_CULL_GROUP_SIZE];
+            if (mask == 0) continue;
+
+            __m256 *source = (__m256*)(context->source + i);
+            if (mask == 0xFF)
+            {
+                for (u32 lane = 0; lane < QUAD_CULL_GROUP_SIZE; ++lane)
+                    _mm256_storeu_ps((r32*)(destination + lane), _mm256_loadu_ps((r32*)(source + lane)));
+                destination += QUAD_CULL_GROUP_SIZE;
+                continue;
+            }
+
+            // The table holds the visible lanes packed to the front; they index
+            // from source, which already points at the group.
+            u32 *lanes = quad_cull_pack_table[mask];
+
+            u32 visible = _mm_popcnt_u32(mask);
+            for (u32 k = 0; k < visible; ++k)
+                _mm256_storeu_ps((r32*)(destination + k), _mm256_loadu_ps((r32*)(source + lanes[k])));
+            destination += visible;
+
+        }
+
+    }
+
+}
+
+// --- Quad Culler -------------------------------------------------------------
+
+void
+quad_culler_create(quad_culler *culler, memory_arena *arena, u64 capacity)
+{
+
+    NX_ENSURE_POINTER(culler);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(sizeof(quad_layout) == sizeof(__m256));
+
+    memset(culler, 0, sizeof(quad_culler));
+    culler->capacity = capacity;
+    culler->group_masks = memory_arena_push_array(arena, u8,
+            (capacity + QUAD_CULL_GROUP_SIZE - 1) / QUAD_CULL_GROUP_SIZE);
+
+    if (!quad_cull_pack_table_ready) quad_cull_build_pack_table();
+
+}
+
+u64
+quad_culler_cull(quad_culler *culler, quad_layout *destination, quad_layout *source,
+        u64 count, vec2 view_min, vec2 view_max)
+{
+
+    NX_ENSURE_POINTER(culler);
+    NX_ENSURE_POINTER(destination);
+    NX_ENSURE_POINTER(source);
+    NX_ASSERT(destination != source);
+    NX_ASSERT(count <= culler->capacity);
+    if (count > culler->capacity) count = culler->capacity;
+
+    u64 cull_begin = system_timestamp();
+    culler->block_count = 0;
+    culler->visible_count = 0;
+    culler->culled_count = 0;
+    culler->cull_milliseconds = 0.0;
+    if (count == 0) return 0;
+
+    u32 block_count = jobs_worker_count();
+    if (block_count > QUAD_CULL_MAX_BLOCKS) block_count = QUAD_CULL_MAX_BLOCKS;
+    if (count < QUAD_CULL_MIN_BLOCK) block_count = 1;
+
+    quad_cull_context context = {0};
+    context.culler          = culler;
+    context.source          = source;
+    context.destination     = destination;
+    context.count           = count;
+    context.view_min_x      = view_min.X;
+    context.view_min_y      = view_min.Y;
+    context.view_max_x      = view_max.X;
+    context.view_max_y      = view_max.Y;
+
+    // Blocks start on a group so no group is split between two of them.
+    u64 block_size = (count + block_count - 1) / block_count;
+    block_size = (block_size + QUAD_CULL_GROUP_SIZE - 1) & ~(u64)(QUAD_CULL_GROUP_SIZE - 1);
+    block_count = (u32)((count + block_size - 1) / block_size);
+    context.block_size = block_size;
+    culler->block_count = block_count;
+
+    jobs_parallel_for(block_count, 1, quad_cull_test_blocks, &context);
+
+    u64 running = 0;
+    for (u32 block = 0; block < block_count; ++block)
+    {
+        u64 visible = culler->block_visible[block];
+        culler->block_visible[block] = running;
+        running += visible;
+    }
+
+    jobs_parallel_for(block_count, 1, quad_cull_compact_blocks, &context);
+
+    culler->visible_count = running;
+    culler->culled_count = count - running;
+    culler->cull_milliseconds = system_timestamp_difference_ms(cull_begin, system_timestamp());
+    return running;
+
+}
+
+// --- GPU Culling -------------------------------------------------------------
+
+typedef struct quad_gpu_draw_command
+{
+    u32 element_count;
+    u32 instance_count;
+    u32 first_index;
+    i32 base_vertex;
+    u32 base_instance;
+} quad_gpu_draw_command;
+
+void
+quad_gpu_culler_create(quad_gpu_culler *culler, GLuint cull_program, u64 capacity)
+{
+
+    NX_ENSURE_POINTER(culler);
+    NX_ASSERT(cull_program != 0);
+    NX_ASSERT(capacity > 0);
+
+    // One dimensional dispatches cap the group count.
+    GLint max_groups = 0;
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_COUNT, 0, &max_groups);
+    NX_ASSERT(capacity <= (u64)max_groups * QUAD_GPU_CULL_GROUP_SIZE);
+
+    memset(culler, 0, sizeof(quad_gpu_culler));
+    culler->program = cull_program;
+    culler->capacity = capacity;
+    opengl_program_reflect(&culler->reflection, cull_program);
+    culler->quad_count_uniform = opengl_program_uniform(&culler->reflection, "u_quad_count");
+    culler->view_uniform = opengl_program_uniform(&culler->reflection, "u_view");
+
+    u64 storage_size = sizeof(quad_layout) * capacity;
+    glGenBuffers(1, &culler->instance_ssbo);
+    opengl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, culler->instance_ssbo);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, storage_size, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+    // Only the GPU ever writes the survivors.
+    glGenBuffers(1, &culler->visible_ssbo);
+    opengl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, culler->visible_ssbo);
+    glBufferStorage(GL_SHADER_STORAGE_BUFFER, storage_size, NULL, 0);
+    opengl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+    quad_gpu_draw_command command = {0};
+    command.element_count = 6;
+    glGenBuffers(1, &culler->command_buffer);
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, culler->command_buffer);
+    glBufferStorage(GL_DRAW_INDIRECT_BUFFER, sizeof(quad_gpu_draw_command), &command, GL_DYNAMIC_STORAGE_BIT);
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    // The same mesh and instance layout as the standard quad renderer.
+    quad_mesh mesh = {0};
+    mesh.bottom_left.position       = { -0.5f, -0.5f };
+    mesh.top_left.position          = { -0.5f,  0.5f };
+    mesh.top_right.position         = {  0.5f,  0.5f };
+    mesh.bottom_right.position      = {  0.5f, -0.5f };
+    mesh.bottom_left.texture        = {  0.0f,  0.0f };
+    mesh.top_left.texture           = {  0.0f,  1.0f };
+    mesh.top_right.texture          = {  1.0f,  1.0f };
+    mesh.bottom_right.texture       = {  1.0f,  0.0f };
+    u32 indices[6] = { 0, 1, 2, 0, 2, 3 };
+
+    glGenVertexArrays(1, &culler->vao);
+    glGenBuffers(1, &culler->vbo);
+    glGenBuffers(1, &culler->ibo);
+    opengl_state_bind_vertex_array(culler->vao);
+
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, culler->vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad_mesh), &mesh, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(float) * 4, (void*)(sizeof(float)*2));
+
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, culler->visible_ssbo);
+    for (u32 attribute = 2; attribute <= 5; ++attribute)
+    {
+        glEnableVertexAttribArray(attribute);
+        glVertexAttribPointer(attribute, 2, GL_FLOAT, GL_FALSE, sizeof(quad_layout),
+                (void*)(sizeof(float) * 2 * (attribute - 2)));
+        glVertexAttribDivisor(attribute, 1);
+    }
+
+    opengl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, culler->ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+
+    opengl_state_bind_vertex_array(0);
+    opengl_state_bind_buffer(GL_ARRAY_BUFFER, 0);
+    opengl_state_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+}
+
+void
+quad_gpu_culler_delete(quad_gpu_culler *culler)
+{
+
+    NX_ENSURE_POINTER(culler);
+    opengl_state_delete_buffers(1, &culler->instance_ssbo);
+    opengl_state_delete_buffers(1, &culler->visible_ssbo);
+    opengl_state_delete_buffers(1, &culler->command_buffer);
+    opengl_state_delete_buffers(1, &culler->vbo);
+    opengl_state_delete_buffers(1, &culler->ibo);
+    opengl_state_delete_vertex_arrays(1, &culler->vao);
+    memset(culler, 0, sizeof(quad_gpu_culler));
+
+}
+
+void
+quad_gpu_culler_update(quad_gpu_culler *culler, quad_layout *quads, u64 first, u64 count)
+{
+
+    NX_ENSURE_POINTER(culler);
+    NX_ENSURE_POINTER(quads);
+    NX_ASSERT(first + count <= culler->capacity);
+    if (count == 0) return;
+
+    opengl_state_bind_buffer(GL_SHADER_STORAGE_BUFFER, culler->instance_ssbo);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, sizeof(quad_layout) * first,
+            sizeof(quad_layout) * count, quads + first);
+
+}
+
+void
+quad_gpu_culler_cull(quad_gpu_culler *culler, u64 count, vec2 view_min, vec2 view_max)
+{
+
+    NX_ENSURE_POINTER(culler);
+    NX_ASSERT(count <= culler->capacity);
+    if (count > culler->capacity) count = culler->capacity;
+    culler->count = count;
+
+    // Only the counter is reset, the rest of the command never changes.
+    u32 zero = 0;
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, culler->command_buffer);
+    glBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(quad_gpu_draw_command, instance_count),
+            sizeof(u32), &zero);
+    if (count == 0) return;
+
+    u32 quad_count = (u32)count;
+    vec4 view = { view_min.X, view_min.Y, view_max.X, view_max.Y };
+    opengl_state_use_program(culler->program);
+    opengl_program_set_u32(&culler->reflection, culler->quad_count_uniform, &quad_count, 1);
+    opengl_program_set_vec4(&culler->reflection, culler->view_uniform, &view, 1);
+
+    opengl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, QUAD_GPU_CULL_INSTANCE_BINDING, culler->instance_ssbo);
+    opengl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, QUAD_GPU_CULL_VISIBLE_BINDING, culler->visible_ssbo);
+    opengl_state_bind_buffer_base(GL_SHADER_STORAGE_BUFFER, QUAD_GPU_CULL_COMMAND_BINDING, culler->command_buffer);
+    glDispatchCompute((GLuint)((count + QUAD_GPU_CULL_GROUP_SIZE - 1) / QUAD_GPU_CULL_GROUP_SIZE), 1, 1);
+
+    // The draw reads the command and the survivors the dispatch just wrote.
+    glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+
+}
+
+void
+quad_gpu_culler_draw(quad_gpu_culler *culler)
+{
+
+    NX_ENSURE_POINTER(culler);
+    if (culler->count == 0) return;
+
+    opengl_state_bind_vertex_array(culler->vao);
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, culler->command_buffer);
+    glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0);
+
+}
+
+u32
+quad_gpu_culler_read_visible_count(quad_gpu_culler *culler)
+{
+
+    NX_ENSURE_POINTER(culler);
+
+    u32 visible = 0;
+    glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, culler->command_buffer);
+    glGetBufferSubData(GL_DRAW_INDIRECT_BUFFER, offsetof(quad_gpu_draw_command, instance_count),
+            sizeof(u32), &visible);
+    opengl_state_bind_buffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    return visible;
+
+}
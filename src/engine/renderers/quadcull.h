@@ -0,0 +1,99 @@
+#ifndef SRC_ENGINE_RENDERERS_QUADCULL_H
+#define SRC_ENGINE_RENDERERS_QUADCULL_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Quad Culling ------------------------------------------------------------
+//
+// Drops quads which fall outside the view before they're uploaded, so upload and
+// vertex work follow what is on screen rather than what is in the world. A cull
+// reads a quad_layout array, tests each quad's bounds against the view rectangle
+// and writes the visible quads, in their original order, to the destination.
+// The destination is usually the mapped region of a second render buffer, so
+// the visible set goes straight into the upload.
+//
+// The cull runs in two passes over blocks spread across the job system. The
+// first tests eight quads at a time with AVX2 and keeps one visibility byte per
+// group of eight, along with a count per block. After a prefix sum over the
+// block counts the second pass left-packs the indices of each group's visible
+// quads with a shuffle and copies those quads out. Groups with nothing visible
+// cost a byte read, and every destination quad is written exactly once, which
+// keeps write-combined mappings happy.
+//
+// Bounds are the untransformed quad mesh, [-0.5, 0.5] scaled by the quad's scale
+// around its position, so they are exact for the quad shaders. Quads touching
+// the edge of the view count as visible.
+//
+// GPU Culling:
+//      The GPU culler keeps the quads resident in a storage buffer and never
+//      brings anything back to the CPU. Update the ranges of quads which change,
+//      then cull: quad2d_cull_compute tests every quad with the same bounds and
+//      appends the survivors to a second buffer, taking slots from an atomic
+//      counter which is the instance count of an indirect draw command. The draw
+//      is glDrawElementsIndirect from that command with the survivors as the
+//      instance attributes, so draw it with the standard quad2d shaders.
+//
+//      Each work group reserves one range of the output for all its survivors,
+//      so the survivors are in no particular order between groups. Quads which
+//      overlap can change draw order from one frame to the next; keep to the CPU
+//      culler when the order of overlapping quads matters.
+//
+//      Cull leaves the compute program bound, bind the draw program after it.
+//      Reading the visible count waits for the GPU and is only for statistics.
+//
+
+#define QUAD_CULL_MAX_BLOCKS            64
+#define QUAD_CULL_GROUP_SIZE            8
+#define QUAD_GPU_CULL_GROUP_SIZE        256
+#define QUAD_GPU_CULL_INSTANCE_BINDING  1
+#define QUAD_GPU_CULL_VISIBLE_BINDING   2
+#define QUAD_GPU_CULL_COMMAND_BINDING   3
+
+typedef struct quad_culler
+{
+
+    u8 *group_masks;            // Visibility bits, one byte per eight quads.
+    u64 capacity;
+
+    u32 block_count;
+    u64 block_visible[QUAD_CULL_MAX_BLOCKS];
+
+    // Statistics from the last cull.
+    u64 visible_count;
+    u64 culled_count;
+    r64 cull_milliseconds;
+
+} quad_culler;
+
+typedef struct quad_gpu_culler
+{
+
+    GLuint program;             // quad2d_cull_compute.
+    opengl_program_reflection reflection;
+    opengl_uniform quad_count_uniform;
+    opengl_uniform view_uniform;
+    GLuint instance_ssbo;       // Resident quads.
+    GLuint visible_ssbo;        // Survivors, also the instance attributes of the draw.
+    GLuint command_buffer;      // DrawElementsIndirectCommand, instance count is the counter.
+    GLuint vao;
+    GLuint vbo;
+    GLuint ibo;
+    u64 capacity;
+    u64 count;                  // Quads tested by the last cull.
+
+} quad_gpu_culler;
+
+void    quad_culler_create(quad_culler *culler, memory_arena *arena, u64 capacity);
+u64     quad_culler_cull(quad_culler *culler, quad_layout *destination, quad_layout *source,
+            u64 count, vec2 view_min, vec2 view_max);
+
+void    quad_gpu_culler_create(quad_gpu_culler *culler, GLuint cull_program, u64 capacity);
+void    quad_gpu_culler_delete(quad_gpu_culler *culler);
+void    quad_gpu_culler_update(quad_gpu_culler *culler, quad_layout *quads, u64 first, u64 count);
+void    quad_gpu_culler_cull(quad_gpu_culler *culler, u64 count, vec2 view_min, vec2 view_max);
+void    quad_gpu_culler_draw(quad_gpu_culler *culler);
+u32     quad_gpu_culler_read_visible_count(quad_gpu_culler *culler);
+
+#endif
@@ -0,0 +1,441 @@
+#include <engine/renderers/quadraster.h>
+#include <core/jobs.h>
+#include <immintrin.h>
+#include <string.h>
+#include <math.h>
+
+#define QUAD_RASTER_CLEAR_ROWS      32
+
+// What every job of a pass reads. The quads and rectangles are the pass's own,
+// index 0 is its first quad.
+typedef struct quad_raster_pass
+{
+    quad_rasterizer *rasterizer;
+    quad_layout *quads;
+    u64 count;
+    u64 chunk_size;
+    u32 chunk_count;
+    image *texture;
+    quad_raster_blend blend;
+
+    // Instance space to target pixels, taken from the view projection.
+    r32 scale_x;
+    r32 offset_x;
+    r32 scale_y;
+    r32 offset_y;
+} quad_raster_pass;
+
+typedef struct quad_raster_clear_context
+{
+    quad_rasterizer *rasterizer;
+    u32 color;
+} quad_raster_clear_context;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline i32
+quad_raster_pixel_edge(r32 edge, i32 limit)
+{
+
+    // The first pixel whose centre is at or past the edge, within the target.
+    r32 centre = edge - 0.5f;
+    if (!(centre > 0.0f)) return 0;
+    if (centre > (r32)limit) return limit;
+    return (i32)ceilf(centre);
+
+}
+
+static inline i32
+quad_raster_texel(r32 coordinate, r32 size)
+{
+
+    r32 texel = floorf(coordinate * size);
+    texel = (texel > 0.0f) ? texel : 0.0f;
+    texel = (texel < size - 1.0f) ? texel : size - 1.0f;
+    return (i32)texel;
+
+}
+
+static inline u32
+quad_raster_blend_pixel(u32 source, u32 destination)
+{
+
+    u32 alpha = source >> 24;
+    u32 result = 0;
+    for (u32 shift = 0; shift < 32; shift += 8)
+    {
+        u32 value = ((source >> shift) & 0xFF) * alpha + ((destination >> shift) & 0xFF) * (255 - alpha) + 128;
+        value = (value + (value >> 8)) >> 8;
+        result |= value << shift;
+    }
+
+    return result;
+
+}
+
+// The same as the pixel at a time blend, in 16 bit lanes; the products and their
+// rounding stay under 65536.
+static inline __m256i
+quad_raster_blend_pixels(__m256i source, __m256i destination)
+{
+
+    __m256i zero = _mm256_setzero_si256();
+    __m256i full = _mm256_set1_epi16(255);
+    __m256i bias = _mm256_set1_epi16(128);
+
+    __m256i source_low = _mm256_unpacklo_epi8(source, zero);
+    __m256i source_high = _mm256_unpackhi_epi8(source, zero);
+    __m256i alpha_low = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source_low, 0xFF), 0xFF);
+    __m256i alpha_high = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(source_high, 0xFF), 0xFF);
+
+    __m256i low = _mm256_add_epi16(_mm256_mullo_epi16(source_low, alpha_low),
+            _mm256_mullo_epi16(_mm256_unpacklo_epi8(destination, zero), _mm256_sub_epi16(full, alpha_low)));
+    __m256i high = _mm256_add_epi16(_mm256_mullo_epi16(source_high, alpha_high),
+            _mm256_mullo_epi16(_mm256_unpackhi_epi8(destination, zero), _mm256_sub_epi16(full, alpha_high)));
+
+    low = _mm256_add_epi16(low, bias);
+    high = _mm256_add_epi16(high, bias);
+    low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+    high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+    return _mm256_packus_epi16(low, high);
+
+}
+
+static void
+quad_raster_setup(quad_raster_pass *pass, quad_layout *quad, quad_raster_rect *rect)
+{
+
+    image *target = &pass->rasterizer->target;
+    r32 half_x = quad->transform.scale.X * 0.5f;
+    r32 half_y = quad->transform.scale.Y * 0.5f;
+    r32 left = (quad->transform.position.X - half_x) * pass->scale_x + pass->offset_x;
+    r32 right = (quad->transform.position.X + half_x) * pass->scale_x + pass->offset_x;
+    r32 bottom = (quad->transform.position.Y - half_y) * pass->scale_y + pass->offset_y;
+    r32 top = (quad->transform.position.Y + half_y) * pass->scale_y + pass->offset_y;
+
+    r32 u_left = quad->texture.offset.X;
+    r32 u_right = quad->texture.offset.X + quad->texture.dimension.X;
+    r32 v_bottom = quad->texture.offset.Y;
+    r32 v_top = quad->texture.offset.Y + quad->texture.dimension.Y;
+
+    // Negative scales mirror the quad, its texture goes with it.
+    if (left > right)
+    {
+        r32 swap = left; left = right; right = swap;
+        swap = u_left; u_left = u_right; u_right = swap;
+    }
+
+    if (bottom > top)
+    {
+        r32 swap = bottom; bottom = top; top = swap;
+        swap = v_bottom; v_bottom = v_top; v_top = swap;
+    }
+
+    rect->x0 = quad_raster_pixel_edge(left, (i32)target->width);
+    rect->x1 = quad_raster_pixel_edge(right, (i32)target->width);
+    rect->y0 = quad_raster_pixel_edge(bottom, (i32)target->height);
+    rect->y1 = quad_raster_pixel_edge(top, (i32)target->height);
+    if (rect->x0 >= rect->x1 || rect->y0 >= rect->y1)
+    {
+        rect->x0 = rect->x1 = 0;
+        return;
+    }
+
+    rect->du = (u_right - u_left) / (right - left);
+    rect->dv = (v_top - v_bottom) / (top - bottom);
+    rect->u = u_left + (0.5f - left) * rect->du;
+    rect->v = v_bottom + (0.5f - bottom) * rect->dv;
+
+}
+
+static void
+quad_raster_fill(quad_raster_pass *pass, quad_raster_rect *rect, i32 x0, i32 y0, i32 x1, i32 y1)
+{
+
+    image *texture = pass->texture;
+    image *target = &pass->rasterizer->target;
+    r32 texture_width = (r32)texture->width;
+    r32 texture_height = (r32)texture->height;
+    b32 blended = (pass->blend == QUAD_RASTER_ALPHA);
+
+    __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    __m256 u_origin = _mm256_set1_ps(rect->u);
+    __m256 u_step = _mm256_set1_ps(rect->du);
+    __m256 width_scale = _mm256_set1_ps(texture_width);
+    __m256 texel_min = _mm256_setzero_ps();
+    __m256 texel_max = _mm256_set1_ps(texture_width - 1.0f);
+
+    for (i32 y = y0; y < y1; ++y)
+    {
+
+        r32 v = rect->v + (r32)y * rect->dv;
+        i32 texel_y = quad_raster_texel(v, texture_height);
+        u32 *texels = (u32*)((u8*)texture->buffer + (u64)texel_y * texture->pitch);
+        u32 *pixels = (u32*)((u8*)target->buffer + (u64)y * target->pitch);
+
+        i32 x = x0;
+        for (; x + 8 <= x1; x += 8)
+        {
+
+            __m256 position = _mm256_add_ps(_mm256_set1_ps((r32)x), lanes);
+            __m256 u = _mm256_add_ps(u_origin, _mm256_mul_ps(position, u_step));
+            __m256 texel = _mm256_floor_ps(_mm256_mul_ps(u, width_scale));
+            texel = _mm256_min_ps(_mm256_max_ps(texel, texel_min), texel_max);
+            __m256i source = _mm256_i32gather_epi32((const int*)texels, _mm256_cvttps_epi32(texel), 4);
+
+            __m256i *destination = (__m256i*)(pixels + x);
+            if (blended) source = quad_raster_blend_pixels(source, _mm256_loadu_si256(destination));
+            _mm256_storeu_si256(destination, source);
+
+        }
+
+        for (; x < x1; ++x)
+        {
+            u32 source = texels[quad_raster_texel(rect->u + (r32)x * rect->du, texture_width)];
+            pixels[x] = (blended) ? quad_raster_blend_pixel(source, pixels[x]) : source;
+        }
+
+    }
+
+}
+
+// --- Jobs --------------------------------------------------------------------
+
+// Sets up the chunk's rectangles and counts how many of them land in each tile.
+static void
+quad_raster_bin_count(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_raster_pass *pass = (quad_raster_pass*)user_data;
+    quad_rasterizer *rasterizer = pass->rasterizer;
+    u32 tile_count = rasterizer->tiles_x * rasterizer->tiles_y;
+
+    for (u64 chunk = begin; chunk < end; ++chunk)
+    {
+
+        u32 *counts = rasterizer->chunk_tiles + chunk * tile_count;
+        memset(counts, 0, sizeof(u32) * tile_count);
+
+        u64 first = chunk * pass->chunk_size;
+        u64 last = (first + pass->chunk_size < pass->count) ? first + pass->chunk_size : pass->count;
+        for (u64 i = first; i < last; ++i)
+        {
+
+            quad_raster_rect *rect = rasterizer->rects + i;
+            quad_raster_setup(pass, pass->quads + i, rect);
+            if (rect->x0 >= rect->x1) continue;
+
+            for (i32 tile_y = rect->y0 / QUAD_RASTER_TILE_SIZE; tile_y <= (rect->y1 - 1) / QUAD_RASTER_TILE_SIZE; ++tile_y)
+            {
+                for (i32 tile_x = rect->x0 / QUAD_RASTER_TILE_SIZE; tile_x <= (rect->x1 - 1) / QUAD_RASTER_TILE_SIZE; ++tile_x)
+                    counts[tile_y * rasterizer->tiles_x + tile_x]++;
+            }
+
+        }
+
+    }
+
+}
+
+// The counts have become the offsets each chunk writes its entries from.
+static void
+quad_raster_bin_fill(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_raster_pass *pass = (quad_raster_pass*)user_data;
+    quad_rasterizer *rasterizer = pass->rasterizer;
+    u32 tile_count = rasterizer->tiles_x * rasterizer->tiles_y;
+
+    for (u64 chunk = begin; chunk < end; ++chunk)
+    {
+
+        u32 *offsets = rasterizer->chunk_tiles + chunk * tile_count;
+        u64 first = chunk * pass->chunk_size;
+        u64 last = (first + pass->chunk_size < pass->count) ? first + pass->chunk_size : pass->count;
+        for (u64 i = first; i < last; ++i)
+        {
+
+            quad_raster_rect *rect = rasterizer->rects + i;
+            if (rect->x0 >= rect->x1) continue;
+
+            for (i32 tile_y = rect->y0 / QUAD_RASTER_TILE_SIZE; tile_y <= (rect->y1 - 1) / QUAD_RASTER_TILE_SIZE; ++tile_y)
+            {
+                for (i32 tile_x = rect->x0 / QUAD_RASTER_TILE_SIZE; tile_x <= (rect->x1 - 1) / QUAD_RASTER_TILE_SIZE; ++tile_x)
+                    rasterizer->bins[offsets[tile_y * rasterizer->tiles_x + tile_x]++] = (u32)i;
+            }
+
+        }
+
+    }
+
+}
+
+static void
+quad_raster_draw_tiles(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_raster_pass *pass = (quad_raster_pass*)user_data;
+    quad_rasterizer *rasterizer = pass->rasterizer;
+
+    for (u64 tile = begin; tile < end; ++tile)
+    {
+
+        i32 tile_x0 = (i32)(tile % rasterizer->tiles_x) * QUAD_RASTER_TILE_SIZE;
+        i32 tile_y0 = (i32)(tile / rasterizer->tiles_x) * QUAD_RASTER_TILE_SIZE;
+        i32 tile_x1 = tile_x0 + QUAD_RASTER_TILE_SIZE;
+        i32 tile_y1 = tile_y0 + QUAD_RASTER_TILE_SIZE;
+
+        for (u32 entry = rasterizer->tile_offsets[tile]; entry < rasterizer->tile_offsets[tile + 1]; ++entry)
+        {
+            quad_raster_rect *rect = rasterizer->rects + rasterizer->bins[entry];
+            i32 x0 = (rect->x0 > tile_x0) ? rect->x0 : tile_x0;
+            i32 y0 = (rect->y0 > tile_y0) ? rect->y0 : tile_y0;
+            i32 x1 = (rect->x1 < tile_x1) ? rect->x1 : tile_x1;
+            i32 y1 = (rect->y1 < tile_y1) ? rect->y1 : tile_y1;
+            quad_raster_fill(pass, rect, x0, y0, x1, y1);
+        }
+
+    }
+
+}
+
+static void
+quad_raster_clear_rows(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    quad_raster_clear_context *context = (quad_raster_clear_context*)user_data;
+    image *target = &context->rasterizer->target;
+    for (u64 y = begin; y < end; ++y)
+    {
+        u32 *pixels = (u32*)((u8*)target->buffer + y * target->pitch);
+        for (u32 x = 0; x < target->width; ++x) pixels[x] = context->color;
+    }
+
+}
+
+// --- Software Quad Rasterizer ------------------------------------------------
+
+void
+quad_rasterizer_create(quad_rasterizer *rasterizer, memory_arena *arena,
+        u32 width, u32 height, u64 quad_capacity)
+{
+
+    NX_ENSURE_POINTER(rasterizer);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(width > 0 && height > 0 && quad_capacity > 0);
+    memset(rasterizer, 0, sizeof(quad_rasterizer));
+
+    rasterizer->target.width = width;
+    rasterizer->target.height = height;
+    rasterizer->target.pitch = width * 4;
+    rasterizer->target.bits_per_pixel = 32;
+    rasterizer->target.buffer = memory_arena_push(arena, (u64)width * height * 4);
+
+    rasterizer->tiles_x = (width + QUAD_RASTER_TILE_SIZE - 1) / QUAD_RASTER_TILE_SIZE;
+    rasterizer->tiles_y = (height + QUAD_RASTER_TILE_SIZE - 1) / QUAD_RASTER_TILE_SIZE;
+    u32 tile_count = rasterizer->tiles_x * rasterizer->tiles_y;
+
+    // A quad no bigger than a tile lands in four at most; the tile count on top
+    // means a single quad of any size always fits in a pass.
+    rasterizer->quad_capacity = quad_capacity;
+    rasterizer->bin_capacity = quad_capacity * 4 + tile_count;
+    rasterizer->rects = memory_arena_push_array(arena, quad_raster_rect, quad_capacity);
+    rasterizer->chunk_tiles = memory_arena_push_array(arena, u32, (u64)QUAD_RASTER_MAX_CHUNKS * tile_count);
+    rasterizer->tile_offsets = memory_arena_push_array(arena, u32, tile_count + 1);
+    rasterizer->bins = memory_arena_push_array(arena, u32, rasterizer->bin_capacity);
+
+}
+
+void
+quad_rasterizer_clear(quad_rasterizer *rasterizer, u32 color)
+{
+
+    NX_ENSURE_POINTER(rasterizer);
+
+    quad_raster_clear_context context = {0};
+    context.rasterizer = rasterizer;
+    context.color = color;
+    jobs_parallel_for(rasterizer->target.height, QUAD_RASTER_CLEAR_ROWS, quad_raster_clear_rows, &context);
+
+}
+
+void
+quad_rasterizer_draw(quad_rasterizer *rasterizer, quad_layout *quads, u64 count,
+        image *texture, mat4 *view_projection, quad_raster_blend blend)
+{
+
+    NX_ENSURE_POINTER(rasterizer);
+    NX_ENSURE_POINTER(texture);
+    NX_ENSURE_POINTER(view_projection);
+    NX_ASSERT(texture->bits_per_pixel == 32);
+    NX_ASSERT(view_projection->Elements[1][0] == 0.0f && view_projection->Elements[0][1] == 0.0f);
+
+    rasterizer->bin_entries = 0;
+    rasterizer->passes = 0;
+    if (count == 0) return;
+    NX_ENSURE_POINTER(quads);
+
+    // Clip space x and y are scaled and moved into the target's pixels.
+    r32 width = (r32)rasterizer->target.width;
+    r32 height = (r32)rasterizer->target.height;
+    quad_raster_pass pass = {0};
+    pass.rasterizer = rasterizer;
+    pass.texture = texture;
+    pass.blend = blend;
+    pass.scale_x = view_projection->Elements[0][0] * 0.5f * width;
+    pass.offset_x = (view_projection->Elements[3][0] * 0.5f + 0.5f) * width;
+    pass.scale_y = view_projection->Elements[1][1] * 0.5f * height;
+    pass.offset_y = (view_projection->Elements[3][1] * 0.5f + 0.5f) * height;
+
+    u32 tile_count = rasterizer->tiles_x * rasterizer->tiles_y;
+    u64 first = 0;
+    while (first < count)
+    {
+
+        // Bin as much as fits, halving the pass until it does.
+        u64 pass_count = (count - first < rasterizer->quad_capacity) ? count - first : rasterizer->quad_capacity;
+        u64 total = 0;
+        for (;;)
+        {
+
+            pass.quads = quads + first;
+            pass.count = pass_count;
+            pass.chunk_count = (u32)((pass_count + QUAD_RASTER_CHUNK_SIZE - 1) / QUAD_RASTER_CHUNK_SIZE);
+            if (pass.chunk_count > QUAD_RASTER_MAX_CHUNKS) pass.chunk_count = QUAD_RASTER_MAX_CHUNKS;
+            pass.chunk_size = (pass_count + pass.chunk_count - 1) / pass.chunk_count;
+            jobs_parallel_for(pass.chunk_count, 1, quad_raster_bin_count, &pass);
+
+            total = 0;
+            for (u64 i = 0; i < (u64)pass.chunk_count * tile_count; ++i) total += rasterizer->chunk_tiles[i];
+            if (total <= rasterizer->bin_capacity) break;
+
+            NX_ASSERT(pass_count > 1);
+            pass_count = (pass_count + 1) / 2;
+
+        }
+
+        // Each tile's list holds the chunks in order, so the quads stay in order.
+        u32 offset = 0;
+        for (u32 tile = 0; tile < tile_count; ++tile)
+        {
+            rasterizer->tile_offsets[tile] = offset;
+            for (u32 chunk = 0; chunk < pass.chunk_count; ++chunk)
+            {
+                u32 *entry = rasterizer->chunk_tiles + (u64)chunk * tile_count + tile;
+                u32 entries = *entry;
+                *entry = offset;
+                offset += entries;
+            }
+        }
+        rasterizer->tile_offsets[tile_count] = offset;
+
+        jobs_parallel_for(pass.chunk_count, 1, quad_raster_bin_fill, &pass);
+        jobs_parallel_for(tile_count, 1, quad_raster_draw_tiles, &pass);
+
+        rasterizer->bin_entries += total;
+        rasterizer->passes++;
+        first += pass_count;
+
+    }
+
+}
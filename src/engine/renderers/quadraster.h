@@ -0,0 +1,92 @@
+#ifndef SRC_ENGINE_RENDERERS_QUADRASTER_H
+#define SRC_ENGINE_RENDERERS_QUADRASTER_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Software Quad Rasterizer ------------------------------------------------
+//
+// Draws the quad2d instances into an image on the CPU, no GL context needed. It
+// takes the same quad_layout arrays and texture pixels the quad renderer does,
+// so a frame can be drawn headless, as a fallback, or as a reference to compare
+// the GPU's output against.
+//
+// It follows the quad2d shaders: the unit mesh's corners at +-0.5 are scaled and
+// moved by the instance, then by the view projection into the target, and the
+// texture region runs from offset at the bottom left corner to offset plus
+// dimension at the top right. Quads carry no rotation, so the view projection
+// must only scale and translate too. Pixels whose centres fall inside the quad
+// are drawn, textures are sampled nearest, and coordinates outside [0, 1] clamp
+// to the edge rather than repeat. Row 0 of the target is the bottom, like the
+// framebuffer and the images file_image_load returns, so glReadPixels output
+// compares directly.
+//
+// Frames:
+//      The target is split into QUAD_RASTER_TILE_SIZE square tiles. Quads are
+//      set up into screen rectangles and binned into every tile they touch, a
+//      chunk of quads per job: each chunk counts its tiles, the counts are
+//      turned into offsets so a tile's list holds the chunks in order, then
+//      each chunk writes its entries. Every tile then draws its list on one
+//      worker, in submission order, so blending comes out as drawn in order and
+//      no two threads ever write the same pixel.
+//
+//      Spans are filled eight pixels at a time with AVX2: texel coordinates
+//      for the eight, one gather from the texture row, and the blend in 16 bit
+//      lanes. The ends of spans are done a pixel at a time.
+//
+//      Draws needing more bin entries than there's room for, or more quads
+//      than the capacity, are split into passes which are drawn one after
+//      another. Opaque overwrites; alpha blends with SRC_ALPHA and
+//      ONE_MINUS_SRC_ALPHA on all four channels.
+//
+
+#define QUAD_RASTER_TILE_SIZE       64
+#define QUAD_RASTER_MAX_CHUNKS      64
+#define QUAD_RASTER_CHUNK_SIZE      4096    // Fewest quads worth a binning job.
+
+typedef enum quad_raster_blend
+{
+    QUAD_RASTER_OPAQUE,
+    QUAD_RASTER_ALPHA,
+} quad_raster_blend;
+
+typedef struct quad_raster_rect
+{
+    i32 x0;                         // Covered pixels are [x0, x1) by [y0, y1),
+    i32 y0;                         // clipped to the target; empty if x0 >= x1.
+    i32 x1;
+    i32 y1;
+    r32 u;                          // Texture coordinate at the centre of pixel (0, 0),
+    r32 v;                          // from where it steps linearly.
+    r32 du;
+    r32 dv;
+} quad_raster_rect;
+
+typedef struct quad_rasterizer
+{
+
+    image target;                   // RGBA8, red in the low byte.
+    u32 tiles_x;
+    u32 tiles_y;
+
+    u64 quad_capacity;
+    quad_raster_rect *rects;        // One per quad of the pass.
+    u32 *chunk_tiles;               // Per chunk and tile, counts and then write offsets.
+    u32 *tile_offsets;              // Where each tile's list starts, and the total at the end.
+    u32 *bins;                      // Quad indices within the pass.
+    u64 bin_capacity;
+
+    // Statistics of the last draw.
+    u64 bin_entries;
+    u32 passes;
+
+} quad_rasterizer;
+
+void    quad_rasterizer_create(quad_rasterizer *rasterizer, memory_arena *arena,
+            u32 width, u32 height, u64 quad_capacity);
+void    quad_rasterizer_clear(quad_rasterizer *rasterizer, u32 color);
+void    quad_rasterizer_draw(quad_rasterizer *rasterizer, quad_layout *quads, u64 count,
+            image *texture, mat4 *view_projection, quad_raster_blend blend);
+
+#endif
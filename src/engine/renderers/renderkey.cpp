@@ -0,0 +1,112 @@
+#include <engine/renderers/renderkey.h>
+#include <string.h>
+
+// --- Render Keys -------------------------------------------------------------
+
+void
+render_key_apply_blend(render_blend_mode blend)
+{
+
+    switch (blend)
+    {
+        case RENDER_BLEND_OPAQUE:
+        {
+            opengl_state_disable(GL_BLEND);
+        } break;
+
+        case RENDER_BLEND_ALPHA:
+        {
+            opengl_state_enable(GL_BLEND);
+            opengl_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        } break;
+
+        case RENDER_BLEND_ADDITIVE:
+        {
+            opengl_state_enable(GL_BLEND);
+            opengl_state_blend_func(GL_SRC_ALPHA, GL_ONE);
+        } break;
+
+        default:
+        {
+            NX_ASSERT(!"Unknown render blend mode.");
+        } break;
+    }
+
+}
+
+u64*
+render_key_sort(u64 *keys, u32 *values, u64 *key_scratch, u32 *value_scratch,
+        u32 count, u32 first_byte, u32 *pass_count)
+{
+
+    NX_ENSURE_POINTER(keys);
+    NX_ENSURE_POINTER(key_scratch);
+    NX_ENSURE_POINTER(pass_count);
+    NX_ASSERT(first_byte < 8);
+    NX_ASSERT(values == NULL || value_scratch != NULL);
+
+    *pass_count = 0;
+    if (count == 0) return keys;
+
+    u32 histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u64 key = keys[i];
+        for (u32 b = first_byte; b < 8; ++b)
+            histograms[b][(key >> (b * 8)) & 0xFF]++;
+    }
+
+    u64 *source = keys;
+    u64 *destination = key_scratch;
+    u32 *source_values = values;
+    u32 *destination_values = value_scratch;
+    for (u32 b = first_byte; b < 8; ++b)
+    {
+
+        u32 *histogram = histograms[b];
+        u32 shift = b * 8;
+        if (histogram[(source[0] >> shift) & 0xFF] == count) continue;
+
+        u32 offset = 0;
+        for (u32 digit = 0; digit < 256; ++digit)
+        {
+            u32 digit_count = histogram[digit];
+            histogram[digit] = offset;
+            offset += digit_count;
+        }
+
+        if (source_values != NULL)
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                u64 key = source[i];
+                u32 slot = histogram[(key >> shift) & 0xFF]++;
+                destination[slot] = key;
+                destination_values[slot] = source_values[i];
+            }
+
+            u32 *swap_values = source_values;
+            source_values = destination_values;
+            destination_values = swap_values;
+        }
+        else
+        {
+            for (u32 i = 0; i < count; ++i)
+            {
+                u64 key = source[i];
+                destination[histogram[(key >> shift) & 0xFF]++] = key;
+            }
+        }
+
+        u64 *swap = source;
+        source = destination;
+        destination = swap;
+        (*pass_count)++;
+
+    }
+
+    return source;
+
+}
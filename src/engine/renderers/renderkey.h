@@ -0,0 +1,37 @@
+#ifndef SRC_ENGINE_RENDERERS_RENDERKEY_H
+#define SRC_ENGINE_RENDERERS_RENDERKEY_H
+#include <core/definitions.h>
+#include <platform/opengl.h>
+
+// --- Render Keys -------------------------------------------------------------
+//
+// What the sprite batch and the render command buffer share for drawing in key
+// order: the blend modes both put in their keys, setting a blend mode through
+// the state cache, and the radix sort their keys go through.
+//
+// Sort:
+//      A stable LSD radix sort of 64-bit keys, one byte per pass from the
+//      lowest byte up. Every histogram is built in one read, and a byte which
+//      is the same for every key is skipped without a pass. Bytes below first
+//      byte aren't sorted on at all, for keys that keep an index in their low
+//      bits only to find their item again.
+//
+//      Values are optional, one u32 per key moved along with it. The sort goes
+//      back and forth between the buffers and their scratch, and returns the
+//      buffer holding the sorted keys; the sorted values are in values when
+//      that's keys, and in value scratch when it's key scratch.
+//
+
+typedef enum render_blend_mode
+{
+    RENDER_BLEND_OPAQUE,
+    RENDER_BLEND_ALPHA,
+    RENDER_BLEND_ADDITIVE,
+    RENDER_BLEND_MODE_COUNT,
+} render_blend_mode;
+
+void    render_key_apply_blend(render_blend_mode blend);
+u64*    render_key_sort(u64 *keys, u32 *values, u64 *key_scratch, u32 *value_scratch,
+            u32 count, u32 first_byte, u32 *pass_count);
+
+#endif
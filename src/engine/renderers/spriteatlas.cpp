@@ -0,0 +1,79 @@
+#include <engine/renderers/spriteatlas.h>
+#include <engine/renderers/quad2d.h>
+#include <string.h>
+
+// --- Sprite Atlas ------------------------------------------------------------
+
+void
+sprite_atlas_create(sprite_atlas *atlas, u32 width, u32 height, u32 layer_capacity)
+{
+
+    NX_ENSURE_POINTER(atlas);
+    NX_ASSERT(width > 0 && height > 0);
+    NX_ASSERT(layer_capacity > 0);
+
+    // Compact quads can only address so many layers.
+    NX_ASSERT(layer_capacity <= QUAD_ATLAS_MAX_LAYERS);
+
+    GLint max_layers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &max_layers);
+    NX_ASSERT(layer_capacity <= (u32)max_layers);
+
+    memset(atlas, 0, sizeof(sprite_atlas));
+    atlas->width = width;
+    atlas->height = height;
+    atlas->layer_capacity = layer_capacity;
+
+    glGenTextures(1, &atlas->texture);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, atlas->texture);
+    glTexStorage3D(GL_TEXTURE_2D_ARRAY, 1, GL_RGBA8, width, height, layer_capacity);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, 0);
+
+}
+
+void
+sprite_atlas_delete(sprite_atlas *atlas)
+{
+
+    NX_ENSURE_POINTER(atlas);
+    opengl_texture_delete(atlas->texture);
+    atlas->texture = 0;
+    atlas->layer_count = 0;
+
+}
+
+u32
+sprite_atlas_add_sheet(sprite_atlas *atlas, image *sheet)
+{
+
+    NX_ENSURE_POINTER(atlas);
+    NX_ENSURE_POINTER(sheet);
+
+    if (sheet->width != atlas->width || sheet->height != atlas->height)
+        return SPRITE_ATLAS_INVALID_LAYER;
+    if (sheet->bits_per_pixel != 32)
+        return SPRITE_ATLAS_INVALID_LAYER;
+    if (atlas->layer_count >= atlas->layer_capacity)
+        return SPRITE_ATLAS_INVALID_LAYER;
+
+    u32 layer = atlas->layer_count++;
+    opengl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, atlas->texture);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, sheet->pitch / 4);
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, layer, sheet->width, sheet->height, 1,
+            GL_RGBA, GL_UNSIGNED_BYTE, sheet->buffer);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D_ARRAY, 0);
+    return layer;
+
+}
+
+void
+sprite_atlas_bind(sprite_atlas *atlas, u32 texture_unit)
+{
+
+    NX_ENSURE_POINTER(atlas);
+    opengl_state_bind_texture(texture_unit, GL_TEXTURE_2D_ARRAY, atlas->texture);
+
+}
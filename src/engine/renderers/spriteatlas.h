@@ -0,0 +1,40 @@
+#ifndef SRC_ENGINE_RENDERERS_SPRITEATLAS_H
+#define SRC_ENGINE_RENDERERS_SPRITEATLAS_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <platform/opengl.h>
+
+// --- Sprite Atlas ------------------------------------------------------------
+//
+// A set of same sized sprite sheets held as the layers of one RGBA8 texture
+// array. Sheets which would otherwise be separate textures, and so separate
+// draws, become layers of one binding; compact quads carry the layer next to
+// their atlas cell, so a frame drawing from several sheets is still one draw.
+//
+// The storage is immutable and sized for every layer up front, so adding a
+// sheet is only an upload. A sheet which isn't 32 bits per pixel at the atlas
+// dimensions, or one past the layer capacity, returns
+// SPRITE_ATLAS_INVALID_LAYER. The cell grid isn't checked: every sheet is read
+// through the one grid given to renderer2d_set_quad_atlas_grid, so lay them all
+// out on it.
+//
+// Bind with sprite_atlas_bind and draw with quad2d_compact_array_fragment.
+//
+
+#define SPRITE_ATLAS_INVALID_LAYER      0xFFFFFFFF
+
+typedef struct sprite_atlas
+{
+    GLuint texture;             // GL_TEXTURE_2D_ARRAY
+    u32 width;
+    u32 height;
+    u32 layer_count;
+    u32 layer_capacity;
+} sprite_atlas;
+
+void    sprite_atlas_create(sprite_atlas *atlas, u32 width, u32 height, u32 layer_capacity);
+void    sprite_atlas_delete(sprite_atlas *atlas);
+u32     sprite_atlas_add_sheet(sprite_atlas *atlas, image *sheet);
+void    sprite_atlas_bind(sprite_atlas *atlas, u32 texture_unit);
+
+#endif
@@ -0,0 +1,219 @@
+#include <engine/renderers/spritebatch.h>
+#include <platform/system.h>
+#include <core/jobs.h>
+#include <string.h>
+
+#define SPRITE_KEY_INDEX_BITS       24
+#define SPRITE_KEY_INDEX_MASK       ((1ULL << SPRITE_KEY_INDEX_BITS) - 1)
+#define SPRITE_KEY_DEPTH_BITS       18
+#define SPRITE_KEY_TEXTURE_BITS     12
+#define SPRITE_KEY_FIRST_BYTE       (SPRITE_KEY_INDEX_BITS / 8)
+#define SPRITE_GATHER_BATCH         16384
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+sprite_batch_make_key(u32 layer, render_blend_mode blend, u32 texture_slot, r32 depth, u32 index)
+{
+
+    depth = (depth < 0.0f) ? 0.0f : ((depth > 1.0f) ? 1.0f : depth);
+    u64 depth_key = (u64)((1.0f - depth) * (r32)((1 << SPRITE_KEY_DEPTH_BITS) - 1) + 0.5f);
+
+    // Alpha blended sprites sort on depth before texture, the rest the other way.
+    u64 order;
+    if (blend == RENDER_BLEND_ALPHA)
+        order = (depth_key << SPRITE_KEY_TEXTURE_BITS) | texture_slot;
+    else
+        order = ((u64)texture_slot << SPRITE_KEY_DEPTH_BITS) | depth_key;
+
+    u64 key = (u64)(layer & 0xFF) << 56;
+    key |= (u64)blend << 54;
+    key |= order << SPRITE_KEY_INDEX_BITS;
+    key |= index;
+    return key;
+
+}
+
+static inline u32
+sprite_batch_key_slot(u64 key)
+{
+
+    u64 order = (key >> SPRITE_KEY_INDEX_BITS) & ((1ULL << 30) - 1);
+    render_blend_mode blend = (render_blend_mode)((key >> 54) & 0x3);
+    if (blend == RENDER_BLEND_ALPHA)
+        return (u32)(order & ((1 << SPRITE_KEY_TEXTURE_BITS) - 1));
+    return (u32)(order >> SPRITE_KEY_DEPTH_BITS);
+
+}
+
+static u32
+sprite_batch_texture_slot(sprite_batch *batch, GLuint texture)
+{
+
+    if (batch->texture_count > 0 && texture == batch->last_texture)
+        return batch->last_texture_slot;
+
+    u32 slot = 0;
+    while (slot < batch->texture_count && batch->textures[slot] != texture) ++slot;
+    if (slot == batch->texture_count)
+    {
+        NX_ASSERT(batch->texture_count < SPRITE_BATCH_MAX_TEXTURES);
+        batch->textures[batch->texture_count++] = texture;
+    }
+
+    batch->last_texture = texture;
+    batch->last_texture_slot = slot;
+    return slot;
+
+}
+
+typedef struct sprite_gather_context
+{
+    u64 *keys;
+    quad_layout *source;
+    quad_layout *destination;
+} sprite_gather_context;
+
+static void
+sprite_batch_gather(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    sprite_gather_context *context = (sprite_gather_context*)user_data;
+    u64 *keys = context->keys;
+    quad_layout *source = context->source;
+    quad_layout *destination = context->destination;
+
+    for (u64 i = begin; i < end; ++i)
+        destination[i] = source[keys[i] & SPRITE_KEY_INDEX_MASK];
+
+}
+
+// --- Sprite Batch ------------------------------------------------------------
+
+void
+sprite_batch_create(sprite_batch *batch, memory_arena *arena, u32 capacity)
+{
+
+    NX_ENSURE_POINTER(batch);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(capacity <= SPRITE_BATCH_MAX_SPRITES);
+
+    memset(batch, 0, sizeof(sprite_batch));
+    renderer2d_create_quad_render_context(&batch->quads, arena, capacity);
+
+    batch->sprite_capacity  = capacity;
+    batch->submitted        = memory_arena_push_array(arena, quad_layout, capacity);
+    batch->keys             = memory_arena_push_array(arena, u64, capacity);
+    batch->sort_scratch     = memory_arena_push_array(arena, u64, capacity);
+    batch->textures         = memory_arena_push_array(arena, GLuint, SPRITE_BATCH_MAX_TEXTURES);
+    batch->draw_capacity    = capacity;
+    batch->draws            = memory_arena_push_array(arena, sprite_batch_draw, capacity);
+
+}
+
+void
+sprite_batch_delete(sprite_batch *batch)
+{
+
+    NX_ENSURE_POINTER(batch);
+    renderer2d_delete_quad_render_context(&batch->quads);
+
+}
+
+void
+sprite_batch_begin(sprite_batch *batch)
+{
+
+    NX_ENSURE_POINTER(batch);
+    batch->sprite_count = 0;
+    batch->texture_count = 0;
+    batch->draw_count = 0;
+
+}
+
+void
+sprite_batch_submit(sprite_batch *batch, sprite_submission *sprite)
+{
+
+    NX_ENSURE_POINTER(batch);
+    NX_ENSURE_POINTER(sprite);
+    NX_ASSERT(sprite->blend < RENDER_BLEND_MODE_COUNT);
+    NX_ASSERT(sprite->layer <= 0xFF);
+
+    // Over capacity sprites are dropped, like particles over budget.
+    NX_ASSERT(batch->sprite_count < batch->sprite_capacity);
+    if (batch->sprite_count >= batch->sprite_capacity) return;
+
+    u32 index = batch->sprite_count++;
+    u32 slot = sprite_batch_texture_slot(batch, sprite->texture);
+    batch->submitted[index] = sprite->quad;
+    batch->keys[index] = sprite_batch_make_key(sprite->layer, sprite->blend, slot, sprite->depth, index);
+
+}
+
+void
+sprite_batch_end(sprite_batch *batch)
+{
+
+    NX_ENSURE_POINTER(batch);
+
+    u32 count = batch->sprite_count;
+    batch->draw_count = 0;
+    if (count == 0) return;
+
+    u64 sort_begin = system_timestamp();
+    u64 *sorted = render_key_sort(batch->keys, NULL, batch->sort_scratch, NULL, count,
+            SPRITE_KEY_FIRST_BYTE, &batch->sort_passes);
+    u64 sort_end = system_timestamp();
+    batch->sort_milliseconds = system_timestamp_difference_ms(sort_begin, sort_end);
+
+    // Gather the quads in sorted order straight into the upload.
+    sprite_gather_context context = {0};
+    context.keys = sorted;
+    context.source = batch->submitted;
+    context.destination = renderer2d_map_quad_render_context(&batch->quads);
+    jobs_parallel_for(count, SPRITE_GATHER_BATCH, sprite_batch_gather, &context);
+    batch->gather_milliseconds = system_timestamp_difference_ms(sort_end, system_timestamp());
+
+    // Split into runs sharing texture and blend mode; layers and depth don't
+    // need a new draw on their own.
+    sprite_batch_draw *draw = NULL;
+    u32 draw_texture_slot = 0xFFFFFFFF;
+    render_blend_mode draw_blend = RENDER_BLEND_MODE_COUNT;
+    for (u32 i = 0; i < count; ++i)
+    {
+
+        u64 key = sorted[i];
+        render_blend_mode blend = (render_blend_mode)((key >> 54) & 0x3);
+        u32 slot = sprite_batch_key_slot(key);
+        if (draw == NULL || slot != draw_texture_slot || blend != draw_blend)
+        {
+            draw = batch->draws + batch->draw_count++;
+            draw->first = i;
+            draw->count = 0;
+            draw->texture = batch->textures[slot];
+            draw->blend = blend;
+            draw_texture_slot = slot;
+            draw_blend = blend;
+        }
+
+        draw->count++;
+
+    }
+
+    renderer2d_upload_quad_render_context(&batch->quads, count);
+
+    // The state cache drops the texture and blend changes that change nothing.
+    for (u32 i = 0; i < batch->draw_count; ++i)
+    {
+
+        sprite_batch_draw *current = batch->draws + i;
+        render_key_apply_blend(current->blend);
+        opengl_state_bind_texture(0, GL_TEXTURE_2D, current->texture);
+        renderer2d_draw_quad_range(&batch->quads, current->first, current->count);
+
+    }
+
+    renderer2d_end_quad_render_context(&batch->quads);
+
+}
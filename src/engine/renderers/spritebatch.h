@@ -0,0 +1,101 @@
+#ifndef SRC_ENGINE_RENDERERS_SPRITEBATCH_H
+#define SRC_ENGINE_RENDERERS_SPRITEBATCH_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+#include <engine/renderers/quad2d.h>
+#include <engine/renderers/renderkey.h>
+
+// --- Sprite Batch ------------------------------------------------------------
+//
+// A front end to the quad renderer for scenes which draw from more than one
+// texture and need an order. Sprites are submitted in any order between begin
+// and end with a layer, texture, blend mode and depth. At end the batch packs a
+// 64-bit sort key per sprite, radix sorts the keys, gathers the quads into one
+// shared instance upload in sorted order and draws each run of sprites sharing
+// a texture and blend mode with a single instanced draw. The number of draws is
+// bounded by the state changes in the sorted order, not the sprite count.
+//
+// Sort Order:
+//      Layers are drawn in increasing order. Within a layer opaque sprites come
+//      first, then alpha blended ones, then additive ones. Opaque and additive
+//      sprites are grouped by texture and then drawn back to front; alpha blended
+//      sprites are drawn back to front first and grouped by texture only where
+//      depths tie, since their order is visible. Depth is [0, 1] with 1 at the
+//      back, and ties keep submission order.
+//
+//      There's no depth buffer involved, so opaque sprites in the same layer that
+//      overlap with different textures draw in texture order. Give them their
+//      own layers, or alpha blend them, when that matters.
+//
+// Key Layout:
+//      63..56  layer
+//      55..54  blend mode
+//      53..24  texture slot (12 bits) and inverted depth (18 bits), swapped for
+//              alpha blended sprites
+//      23..0   submission index
+//
+//      The radix sort is stable and only sorts the bytes above the index, so the
+//      index is there to find the quad again and never costs a pass. Bytes which
+//      are the same for every key are skipped.
+//
+// The caller binds the program and sets its uniforms; the batch binds each
+// texture to unit 0 and sets the blend state per draw, leaving both as the last
+// draw had them. Up to SPRITE_BATCH_MAX_TEXTURES distinct textures can be used
+// per frame.
+//
+
+#define SPRITE_BATCH_MAX_TEXTURES       4096
+#define SPRITE_BATCH_MAX_SPRITES        (1 << 24)
+
+typedef struct sprite_submission
+{
+    quad_layout quad;
+    GLuint texture;
+    u32 layer;                  // [0, 255], drawn in increasing order.
+    render_blend_mode blend;
+    r32 depth;                  // [0, 1] within a layer, 1 is furthest back.
+} sprite_submission;
+
+typedef struct sprite_batch_draw
+{
+    u32 first;                  // Range of the shared upload.
+    u32 count;
+    GLuint texture;
+    render_blend_mode blend;
+} sprite_batch_draw;
+
+typedef struct sprite_batch
+{
+
+    quad_render_buffer quads;   // Shared instance buffer, filled in sorted order.
+    quad_layout *submitted;     // Quads in submission order.
+    u64 *keys;
+    u64 *sort_scratch;
+    u32 sprite_count;
+    u32 sprite_capacity;
+
+    GLuint *textures;           // Texture slot to texture name, for this frame.
+    u32 texture_count;
+    GLuint last_texture;        // Most submissions repeat the previous texture.
+    u32 last_texture_slot;
+
+    sprite_batch_draw *draws;
+    u32 draw_count;
+    u32 draw_capacity;
+
+    // Statistics from the last end.
+    r64 sort_milliseconds;
+    r64 gather_milliseconds;
+    u32 sort_passes;
+
+} sprite_batch;
+
+void    sprite_batch_create(sprite_batch *batch, memory_arena *arena, u32 capacity);
+void    sprite_batch_delete(sprite_batch *batch);
+void    sprite_batch_begin(sprite_batch *batch);
+void    sprite_batch_submit(sprite_batch *batch, sprite_submission *sprite);
+void    sprite_batch_end(sprite_batch *batch);
+
+#endif
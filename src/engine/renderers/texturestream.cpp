@@ -0,0 +1,327 @@
+#include <engine/renderers/texturestream.h>
+#include <platform/system.h>
+#include <string.h>
+
+// Offsets into the unpack buffer only have to be a multiple of the pixel size,
+// a cache line keeps the decoders writing into it from sharing lines.
+#define TEXTURE_STREAM_ALIGNMENT        64
+#define TEXTURE_STREAM_PLACEHOLDER_SIZE 8
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+texture_stream_align(u64 value, u64 alignment)
+{
+
+    return (value + alignment - 1) / alignment * alignment;
+
+}
+
+static GLuint
+texture_stream_create_texture(u32 width, u32 height)
+{
+
+    GLuint texture = 0;
+    glGenTextures(1, &texture);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, texture);
+    glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, width, height);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    return texture;
+
+}
+
+// Finds room for size bytes between head and tail, or returns false.
+static b32
+texture_stream_allocate(texture_stream *stream, u64 size, u64 *offset)
+{
+
+    if (size > stream->capacity) return false;
+
+    if (stream->upload_count == 0)
+    {
+        stream->head = 0;
+        stream->tail = 0;
+    }
+
+    // Free space runs from head to the end and from the start to tail, unless
+    // head has wrapped, when it runs from head to tail. Head on tail is full.
+    u64 start = stream->head;
+    u64 limit = stream->capacity;
+    if (stream->upload_count == 0 || stream->head > stream->tail)
+    {
+        if (start + size > stream->capacity)
+        {
+            if (stream->upload_count != 0 && size > stream->tail) return false;
+            start = 0;
+            limit = (stream->upload_count != 0) ? stream->tail : stream->capacity;
+        }
+    }
+    else
+    {
+        if (stream->head == stream->tail || start + size > stream->tail) return false;
+        limit = stream->tail;
+    }
+
+    *offset = start;
+    stream->head = texture_stream_align(start + size, TEXTURE_STREAM_ALIGNMENT);
+    if (stream->head > limit) stream->head = limit;
+    return true;
+
+}
+
+// --- Texture Stream ----------------------------------------------------------
+
+void
+texture_stream_create(texture_stream *stream, u64 staging_capacity)
+{
+
+    NX_ENSURE_POINTER(stream);
+    NX_ASSERT(staging_capacity > 0);
+    memset(stream, 0, sizeof(texture_stream));
+
+    stream->capacity = texture_stream_align(staging_capacity, TEXTURE_STREAM_ALIGNMENT);
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    glGenBuffers(1, &stream->pixel_buffer);
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, stream->pixel_buffer);
+    glBufferStorage(GL_PIXEL_UNPACK_BUFFER, (GLsizeiptr)stream->capacity, NULL, flags);
+    stream->mapped_buffer = (u8*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0,
+            (GLsizeiptr)stream->capacity, flags);
+    NX_ASSERT(stream->mapped_buffer != NULL);
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    // The placeholder is small enough to upload the plain way.
+    u32 pixels[TEXTURE_STREAM_PLACEHOLDER_SIZE * TEXTURE_STREAM_PLACEHOLDER_SIZE];
+    for (u32 y = 0; y < TEXTURE_STREAM_PLACEHOLDER_SIZE; ++y)
+    {
+        for (u32 x = 0; x < TEXTURE_STREAM_PLACEHOLDER_SIZE; ++x)
+            pixels[y * TEXTURE_STREAM_PLACEHOLDER_SIZE + x] = ((x ^ y) & 1) ? 0xFFFFFFFF : 0xFF808080;
+    }
+
+    stream->placeholder = texture_stream_create_texture(TEXTURE_STREAM_PLACEHOLDER_SIZE,
+            TEXTURE_STREAM_PLACEHOLDER_SIZE);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, TEXTURE_STREAM_PLACEHOLDER_SIZE,
+            TEXTURE_STREAM_PLACEHOLDER_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+}
+
+void
+texture_stream_delete(texture_stream *stream)
+{
+
+    NX_ENSURE_POINTER(stream);
+
+    for (u32 i = 0; i < stream->upload_count; ++i)
+    {
+        texture_stream_upload *upload = stream->uploads +
+            ((stream->upload_first + i) % TEXTURE_STREAM_MAX_TEXTURES);
+        glDeleteSync(upload->fence);
+    }
+    stream->upload_count = 0;
+
+    for (u32 i = 0; i < TEXTURE_STREAM_MAX_TEXTURES; ++i)
+    {
+        if (stream->slots[i].in_use) opengl_texture_delete(stream->slots[i].texture);
+        stream->slots[i].in_use = false;
+    }
+
+    opengl_texture_delete(stream->placeholder);
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, stream->pixel_buffer);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    opengl_state_delete_buffers(1, &stream->pixel_buffer);
+    stream->pixel_buffer = 0;
+    stream->mapped_buffer = NULL;
+
+}
+
+void
+texture_stream_update(texture_stream *stream)
+{
+
+    NX_ENSURE_POINTER(stream);
+
+    // Uploads finish in the order they were made, the first one still copying
+    // holds back the rest.
+    while (stream->upload_count > 0)
+    {
+
+        texture_stream_upload *upload = stream->uploads + stream->upload_first;
+        GLenum status = glClientWaitSync(upload->fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+        glDeleteSync(upload->fence);
+        stream->tail = upload->offset + upload->size;
+        stream->upload_first = (stream->upload_first + 1) % TEXTURE_STREAM_MAX_TEXTURES;
+        stream->upload_count--;
+
+        // A texture released while its upload was in flight has no slot left.
+        if (upload->handle != TEXTURE_STREAM_NONE)
+            stream->slots[upload->handle].resident = true;
+        stream->textures_streamed++;
+        stream->bytes_streamed += upload->size;
+        stream->last_upload_milliseconds = system_timestamp_difference_ms(upload->commit_time,
+                system_timestamp());
+
+    }
+
+}
+
+vptr
+texture_stream_map(texture_stream *stream, u64 size)
+{
+
+    NX_ENSURE_POINTER(stream);
+    NX_ASSERT(!stream->reserved);
+    NX_ASSERT(size > 0);
+
+    u64 offset = 0;
+    if (stream->upload_count == TEXTURE_STREAM_MAX_TEXTURES || !texture_stream_allocate(stream, size, &offset))
+    {
+        stream->staging_full++;
+        return NULL;
+    }
+
+    stream->reserved = true;
+    stream->reserved_offset = offset;
+    stream->reserved_size = size;
+    return stream->mapped_buffer + offset;
+
+}
+
+streamed_texture
+texture_stream_commit(texture_stream *stream, image *img)
+{
+
+    NX_ENSURE_POINTER(stream);
+    NX_ENSURE_POINTER(img);
+    NX_ASSERT(stream->reserved);
+    NX_ASSERT(img->buffer == stream->mapped_buffer + stream->reserved_offset);
+    NX_ASSERT((u64)img->width * img->height * 4 <= stream->reserved_size);
+
+    streamed_texture handle = TEXTURE_STREAM_NONE;
+    for (u32 i = 0; i < TEXTURE_STREAM_MAX_TEXTURES; ++i)
+    {
+        if (!stream->slots[i].in_use)
+        {
+            handle = i;
+            break;
+        }
+    }
+
+    // Give the staging memory back, it sits at the head with nothing after it.
+    stream->reserved = false;
+    if (handle == TEXTURE_STREAM_NONE)
+    {
+        stream->head = stream->reserved_offset;
+        return TEXTURE_STREAM_NONE;
+    }
+
+    texture_stream_slot *slot = stream->slots + handle;
+    slot->texture = texture_stream_create_texture(img->width, img->height);
+    slot->in_use = true;
+    slot->resident = false;
+
+    // With a buffer bound to the unpack target, the pointer is an offset into it.
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, stream->pixel_buffer);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, img->width, img->height, GL_RGBA, GL_UNSIGNED_BYTE,
+            (vptr)stream->reserved_offset);
+    opengl_state_bind_buffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, 0);
+
+    texture_stream_upload *upload = stream->uploads +
+        ((stream->upload_first + stream->upload_count) % TEXTURE_STREAM_MAX_TEXTURES);
+    upload->handle = handle;
+    upload->offset = stream->reserved_offset;
+    upload->size = stream->reserved_size;
+    upload->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    upload->commit_time = system_timestamp();
+    stream->upload_count++;
+
+    // Make sure the fence reaches the GPU, update only polls it.
+    glFlush();
+    return handle;
+
+}
+
+void
+texture_stream_cancel(texture_stream *stream)
+{
+
+    NX_ENSURE_POINTER(stream);
+    NX_ASSERT(stream->reserved);
+
+    stream->reserved = false;
+    stream->head = stream->reserved_offset;
+
+}
+
+streamed_texture
+texture_stream_load_image(texture_stream *stream, image *img)
+{
+
+    NX_ENSURE_POINTER(stream);
+    NX_ENSURE_POINTER(img);
+    NX_ASSERT(img->bits_per_pixel == 32);
+
+    u64 size = (u64)img->width * img->height * 4;
+    vptr staging = texture_stream_map(stream, size);
+    if (staging == NULL) return TEXTURE_STREAM_NONE;
+
+    // Rows are copied one at a time in case the image is padded.
+    u64 row_size = (u64)img->width * 4;
+    for (u32 row = 0; row < img->height; ++row)
+        memcpy((u8*)staging + row * row_size, (u8*)img->buffer + (u64)row * img->pitch, row_size);
+
+    image staged = *img;
+    staged.buffer = staging;
+    staged.pitch = (u32)row_size;
+    return texture_stream_commit(stream, &staged);
+
+}
+
+void
+texture_stream_release(texture_stream *stream, streamed_texture handle)
+{
+
+    NX_ENSURE_POINTER(stream);
+    if (handle == TEXTURE_STREAM_NONE) return;
+    NX_ASSERT(handle < TEXTURE_STREAM_MAX_TEXTURES && stream->slots[handle].in_use);
+
+    // Deleting is fine with the copy in flight, GL keeps the storage alive until
+    // it's done; the fence still returns the staging memory.
+    for (u32 i = 0; i < stream->upload_count; ++i)
+    {
+        texture_stream_upload *upload = stream->uploads +
+            ((stream->upload_first + i) % TEXTURE_STREAM_MAX_TEXTURES);
+        if (upload->handle == handle) upload->handle = TEXTURE_STREAM_NONE;
+    }
+
+    texture_stream_slot *slot = stream->slots + handle;
+    opengl_texture_delete(slot->texture);
+    slot->texture = 0;
+    slot->in_use = false;
+    slot->resident = false;
+
+}
+
+b32
+texture_stream_is_resident(texture_stream *stream, streamed_texture handle)
+{
+
+    NX_ENSURE_POINTER(stream);
+    if (handle == TEXTURE_STREAM_NONE) return false;
+    NX_ASSERT(handle < TEXTURE_STREAM_MAX_TEXTURES);
+    return stream->slots[handle].in_use && stream->slots[handle].resident;
+
+}
+
+GLuint
+texture_stream_get_texture(texture_stream *stream, streamed_texture handle)
+{
+
+    if (!texture_stream_is_resident(stream, handle)) return stream->placeholder;
+    return stream->slots[handle].texture;
+
+}
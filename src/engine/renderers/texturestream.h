@@ -0,0 +1,96 @@
+#ifndef SRC_ENGINE_RENDERERS_TEXTURESTREAM_H
+#define SRC_ENGINE_RENDERERS_TEXTURESTREAM_H
+#include <core/definitions.h>
+#include <platform/opengl.h>
+
+// --- Texture Stream ----------------------------------------------------------
+//
+// Uploads textures without stalling the frame on the driver's copy. Pixels are
+// staged in a pixel unpack buffer, allocated with glBufferStorage and kept
+// persistently mapped, and the texture is filled with glTexSubImage2D from an
+// offset into it, which returns as soon as the copy is queued. Each upload is
+// fenced; update polls the fences without waiting, marks the textures whose
+// copies are done as resident and hands their staging memory back.
+//
+// The staging buffer is used as a ring of bytes, uploads take the next stretch
+// of it, wrapping to the start when the end is too short, and it's reclaimed in
+// the order the uploads were made. When there's no room, map returns NULL and
+// load returns TEXTURE_STREAM_NONE rather than waiting: try again next frame,
+// after update has reclaimed what the GPU is done with.
+//
+// Map reserves staging memory for the next upload and returns the pointer, so
+// the pixels can be decoded straight into it, from any thread, with no copy in
+// between. Commit then creates the texture and issues the upload; the image it's
+// given describes the pixels, and its buffer must be the mapped pointer. Only one
+// reservation can be outstanding; cancel gives it back when the decode failed.
+// Load image does the three with a memcpy.
+//
+// Until its upload lands, get texture returns the placeholder, a small grey and
+// white checkerboard, so draws can use the handle right away. Everything apart
+// from writing to the mapped memory must happen on the thread with the context.
+//
+
+#define TEXTURE_STREAM_MAX_TEXTURES     64
+#define TEXTURE_STREAM_NONE             0xFFFFFFFF
+
+typedef u32 streamed_texture;
+
+typedef struct texture_stream_slot
+{
+    GLuint texture;
+    b32 in_use;
+    b32 resident;
+} texture_stream_slot;
+
+typedef struct texture_stream_upload
+{
+    streamed_texture handle;
+    u64 offset;
+    u64 size;
+    GLsync fence;
+    u64 commit_time;
+} texture_stream_upload;
+
+typedef struct texture_stream
+{
+
+    GLuint pixel_buffer;
+    u8 *mapped_buffer;                  // Persistent coherent mapping, write only.
+    u64 capacity;
+
+    // Staging space goes from tail to head, uploads in flight are in commit order.
+    u64 head;
+    u64 tail;
+    texture_stream_upload uploads[TEXTURE_STREAM_MAX_TEXTURES];
+    u32 upload_first;
+    u32 upload_count;
+
+    b32 reserved;                       // A map waiting for its commit.
+    u64 reserved_offset;
+    u64 reserved_size;
+
+    GLuint placeholder;
+    texture_stream_slot slots[TEXTURE_STREAM_MAX_TEXTURES];
+
+    // Statistics.
+    u64 textures_streamed;              // Uploads which became resident.
+    u64 bytes_streamed;
+    u32 staging_full;                   // Maps and loads turned away for lack of room.
+    r64 last_upload_milliseconds;       // Commit to resident, as seen by update.
+
+} texture_stream;
+
+void                texture_stream_create(texture_stream *stream, u64 staging_capacity);
+void                texture_stream_delete(texture_stream *stream);
+void                texture_stream_update(texture_stream *stream);
+
+vptr                texture_stream_map(texture_stream *stream, u64 size);
+streamed_texture    texture_stream_commit(texture_stream *stream, image *img);
+void                texture_stream_cancel(texture_stream *stream);
+streamed_texture    texture_stream_load_image(texture_stream *stream, image *img);
+void                texture_stream_release(texture_stream *stream, streamed_texture handle);
+
+b32                 texture_stream_is_resident(texture_stream *stream, streamed_texture handle);
+GLuint              texture_stream_get_texture(texture_stream *stream, streamed_texture handle);
+
+#endif
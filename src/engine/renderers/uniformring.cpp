@@ -0,0 +1,154 @@
+#include <engine/renderers/uniformring.h>
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+uniform_ring_align(u64 value, u64 alignment)
+{
+
+    return (value + alignment - 1) / alignment * alignment;
+
+}
+
+static void
+uniform_ring_wait_region(uniform_ring *ring, u32 region)
+{
+
+    GLsync fence = ring->region_fences[region];
+    if (fence == NULL) return;
+
+    // Poll first so that only real waits are counted as stalls.
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        ring->fence_stalls++;
+        do
+        {
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        } while (status == GL_TIMEOUT_EXPIRED);
+    }
+
+    glDeleteSync(fence);
+    ring->region_fences[region] = NULL;
+
+}
+
+// --- Uniform Ring ------------------------------------------------------------
+
+void
+uniform_ring_create(uniform_ring *ring, u64 frame_size)
+{
+
+    NX_ENSURE_POINTER(ring);
+    NX_ASSERT(frame_size > 0);
+    memset(ring, 0, sizeof(uniform_ring));
+
+    GLint offset_alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offset_alignment);
+    ring->offset_alignment = (offset_alignment > 0) ? (u64)offset_alignment : 256;
+
+    // Each region starts on an aligned offset, so the first push in it does too.
+    ring->region_size = uniform_ring_align(frame_size, ring->offset_alignment);
+    ring->region_index = UNIFORM_RING_FRAMES - 1;
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLsizeiptr size = (GLsizeiptr)(ring->region_size * UNIFORM_RING_FRAMES);
+    glGenBuffers(1, &ring->buffer);
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glBufferStorage(GL_UNIFORM_BUFFER, size, NULL, flags);
+    ring->mapped_buffer = (u8*)glMapBufferRange(GL_UNIFORM_BUFFER, 0, size, flags);
+    NX_ASSERT(ring->mapped_buffer != NULL);
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, 0);
+
+}
+
+void
+uniform_ring_delete(uniform_ring *ring)
+{
+
+    NX_ENSURE_POINTER(ring);
+
+    for (u32 region = 0; region < UNIFORM_RING_FRAMES; ++region)
+    {
+        if (ring->region_fences[region] != NULL)
+            glDeleteSync(ring->region_fences[region]);
+        ring->region_fences[region] = NULL;
+    }
+
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, ring->buffer);
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+    opengl_state_bind_buffer(GL_UNIFORM_BUFFER, 0);
+    opengl_state_delete_buffers(1, &ring->buffer);
+    ring->buffer = 0;
+    ring->mapped_buffer = NULL;
+
+}
+
+void
+uniform_ring_begin_frame(uniform_ring *ring)
+{
+
+    NX_ENSURE_POINTER(ring);
+    NX_ASSERT(!ring->frame_active);
+
+    ring->region_index = (ring->region_index + 1) % UNIFORM_RING_FRAMES;
+    uniform_ring_wait_region(ring, ring->region_index);
+    ring->region_used = 0;
+    ring->frame_active = true;
+
+}
+
+void
+uniform_ring_end_frame(uniform_ring *ring)
+{
+
+    NX_ENSURE_POINTER(ring);
+    NX_ASSERT(ring->frame_active);
+
+    ring->region_fences[ring->region_index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    ring->frame_bytes = ring->region_used;
+    if (ring->region_used > ring->peak_bytes) ring->peak_bytes = ring->region_used;
+    ring->frame_active = false;
+
+}
+
+uniform_allocation
+uniform_ring_push(uniform_ring *ring, u64 size)
+{
+
+    NX_ENSURE_POINTER(ring);
+    NX_ASSERT(ring->frame_active);
+    NX_ASSERT(size > 0);
+
+    uniform_allocation allocation = {0};
+    u64 offset = uniform_ring_align(ring->region_used, ring->offset_alignment);
+
+    // Over budget constants are dropped, the ring is sized for the worst frame.
+    NX_ASSERT(offset + size <= ring->region_size);
+    if (offset + size > ring->region_size)
+    {
+        ring->overflows++;
+        return allocation;
+    }
+
+    ring->region_used = offset + size;
+
+    allocation.buffer   = ring->buffer;
+    allocation.offset   = ring->region_index * ring->region_size + offset;
+    allocation.size     = size;
+    allocation.data     = ring->mapped_buffer + allocation.offset;
+    return allocation;
+
+}
+
+void
+uniform_ring_bind(uniform_allocation *allocation, u32 binding)
+{
+
+    NX_ENSURE_POINTER(allocation);
+    if (allocation->data == NULL) return;
+
+    opengl_state_bind_buffer_range(GL_UNIFORM_BUFFER, binding, allocation->buffer,
+            allocation->offset, allocation->size);
+
+}
@@ -0,0 +1,166 @@
+#ifndef SRC_ENGINE_RENDERERS_UNIFORMRING_H
+#define SRC_ENGINE_RENDERERS_UNIFORMRING_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <platform/opengl.h>
+#include <stddef.h>
+#include <string.h>
+#include <type_traits>
+
+// --- Uniform Ring ------------------------------------------------------------
+//
+// A ring of uniform buffer memory for constants which change every frame. One
+// buffer is allocated with glBufferStorage and kept persistently mapped, split
+// into UNIFORM_RING_FRAMES regions like the quad renderer's persistent upload.
+// Begin frame moves to the next region, waiting on its fence if the GPU is
+// still reading it, and end frame fences it again once the frame's draws are
+// issued.
+//
+// Between the two, push sub-allocates from the region with the start of every
+// allocation rounded up to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and returns both
+// the mapped pointer to write the constants through and the offset to bind.
+// Bind attaches the allocation to a uniform block binding with
+// glBindBufferRange through the state cache, so a frame's per-frame and
+// per-draw constants all sit in one contiguous run of the same buffer and
+// switching between them is a bind, not an upload. The mapping is coherent and
+// write-combined: write each allocation once, in order, and never read it back.
+//
+// A region that fills up returns an empty allocation, which bind ignores; size
+// the ring for the worst frame. Peak bytes is there to find out what that is.
+//
+// Std140 Layout:
+//      The C++ structs pushed into the ring must match the std140 layout of the
+//      GLSL block they're read as. The STD140 checks compare each member's
+//      offset to where std140 would put it, given the member before it. Check
+//      the members the GLSL block declares, in order, and leave out any padding
+//      members the C++ struct needs to line them up:
+//
+//          UNIFORM_STD140_FIRST(quad_frame_constants, projection);
+//          UNIFORM_STD140_NEXT(quad_frame_constants, projection, camera);
+//          UNIFORM_STD140_SIZE(quad_frame_constants);
+//
+//      Scalars (r32, i32, u32), vec2, vec3, vec4, mat4 and arrays of them are
+//      understood. Arrays round their element stride up to a vec4, so an r32 or
+//      vec2 array only matches as an array of structs padded out to 16 bytes.
+//      There's no mat3 here, since its columns are padded to vec4s in std140; a
+//      member of any other type fails to compile. Blocks are used as arrays of
+//      vec4 on some drivers, so the size check also requires a multiple of 16.
+//
+
+#define UNIFORM_RING_FRAMES         3
+
+typedef struct uniform_allocation
+{
+    vptr data;                  // Mapped memory to write the constants to.
+    GLuint buffer;
+    u64 offset;                 // From the start of buffer, for glBindBufferRange.
+    u64 size;
+} uniform_allocation;
+
+typedef struct uniform_ring
+{
+
+    GLuint buffer;
+    u8 *mapped_buffer;          // Persistent coherent mapping of all the regions.
+    u64 region_size;            // Bytes per frame, a multiple of the offset alignment.
+    u64 offset_alignment;       // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+
+    GLsync region_fences[UNIFORM_RING_FRAMES];
+    u32 region_index;           // Region the current frame pushes into.
+    u64 region_used;            // Bytes pushed into it so far.
+    b32 frame_active;
+
+    // Statistics.
+    u64 fence_stalls;           // Times a region was still in use by the GPU.
+    u64 frame_bytes;            // Bytes used by the last completed frame, with padding.
+    u64 peak_bytes;
+    u32 overflows;              // Pushes dropped for lack of space.
+
+} uniform_ring;
+
+void                uniform_ring_create(uniform_ring *ring, u64 frame_size);
+void                uniform_ring_delete(uniform_ring *ring);
+void                uniform_ring_begin_frame(uniform_ring *ring);
+void                uniform_ring_end_frame(uniform_ring *ring);
+uniform_allocation  uniform_ring_push(uniform_ring *ring, u64 size);
+void                uniform_ring_bind(uniform_allocation *allocation, u32 binding);
+
+// Pushes a copy of a std140 struct and returns where it went.
+template <typename T> inline uniform_allocation
+uniform_ring_push_value(uniform_ring *ring, const T *value)
+{
+
+    static_assert(sizeof(T) % 16 == 0, "Uniform structs are padded to a multiple of 16 bytes.");
+
+    uniform_allocation allocation = uniform_ring_push(ring, sizeof(T));
+    if (allocation.data != NULL) memcpy(allocation.data, value, sizeof(T));
+    return allocation;
+
+}
+
+// --- Std140 Layout Checks ----------------------------------------------------
+
+template <typename T> struct uniform_std140_type;
+
+#define UNIFORM_STD140_TYPE(type, type_alignment, type_size)    \
+    template <> struct uniform_std140_type<type>                \
+    {                                                           \
+        static constexpr u64 alignment = type_alignment;        \
+        static constexpr u64 size = type_size;                  \
+    }
+
+UNIFORM_STD140_TYPE(r32,  4,  4);
+UNIFORM_STD140_TYPE(i32,  4,  4);
+UNIFORM_STD140_TYPE(u32,  4,  4);
+UNIFORM_STD140_TYPE(vec2, 8,  8);
+UNIFORM_STD140_TYPE(vec3, 16, 12);
+UNIFORM_STD140_TYPE(vec4, 16, 16);
+UNIFORM_STD140_TYPE(mat4, 16, 64);
+
+template <typename T, u64 N> struct uniform_std140_type<T[N]>
+{
+    static constexpr u64 alignment = (uniform_std140_type<T>::alignment + 15) & ~15ULL;
+    static constexpr u64 stride = (uniform_std140_type<T>::size + 15) & ~15ULL;
+    static constexpr u64 size = stride * N;
+};
+
+// Where std140 puts a member of type Next after one of type Previous.
+template <typename Previous, typename Next> constexpr u64
+uniform_std140_next_offset(u64 previous_offset)
+{
+
+    return (previous_offset + uniform_std140_type<Previous>::size + uniform_std140_type<Next>::alignment - 1)
+        & ~(uniform_std140_type<Next>::alignment - 1);
+
+}
+
+template <typename T> constexpr b32
+uniform_std140_matches_stride()
+{
+
+    return sizeof(T) == uniform_std140_type<T>::size;
+
+}
+
+#define UNIFORM_STD140_MEMBER_TYPE(block, member) \
+    std::remove_reference<decltype(((block*)0)->member)>::type
+
+#define UNIFORM_STD140_FIRST(block, member)                                                     \
+    static_assert(offsetof(block, member) == 0,                                                 \
+        #block "::" #member " must be the first member.");                                      \
+    static_assert(uniform_std140_matches_stride<UNIFORM_STD140_MEMBER_TYPE(block, member)>(),   \
+        #block "::" #member " doesn't have the std140 size; arrays need 16 byte elements.")
+
+#define UNIFORM_STD140_NEXT(block, previous, member)                                            \
+    static_assert(offsetof(block, member) == uniform_std140_next_offset<                        \
+            UNIFORM_STD140_MEMBER_TYPE(block, previous),                                        \
+            UNIFORM_STD140_MEMBER_TYPE(block, member)>(offsetof(block, previous)),              \
+        #block "::" #member " isn't at its std140 offset, add padding before it.");             \
+    static_assert(uniform_std140_matches_stride<UNIFORM_STD140_MEMBER_TYPE(block, member)>(),   \
+        #block "::" #member " doesn't have the std140 size; arrays need 16 byte elements.")
+
+#define UNIFORM_STD140_SIZE(block)                                                              \
+    static_assert(sizeof(block) % 16 == 0,                                                      \
+        #block " must be padded to a multiple of 16 bytes.")
+
+#endif
@@ -0,0 +1,236 @@
+#include <engine/renderthread.h>
+#include <platform/system.h>
+#include <platform/window.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <string.h>
+
+typedef struct render_thread_state
+{
+    std::thread thread;
+    std::mutex lock;
+    std::condition_variable signal_submitted;
+    std::condition_variable signal_completed;
+
+    render_frame_packet *packets;
+    render_frame_proc proc;
+    vptr user_data;
+    b32 running;
+    b32 stop_requested;
+    b32 start_result;
+    b32 start_finished;
+
+    // Packet i % RENDER_THREAD_PACKETS is the i-th submitted. The game thread
+    // may fill the next one while fewer than RENDER_THREAD_PACKETS are in flight.
+    u64 submitted_count;
+    u64 completed_count;
+    b32 packet_acquired;
+
+    render_thread_statistics statistics;
+} render_thread_state;
+
+static inline render_thread_state* get_render_thread_state() { static render_thread_state rs; return &rs; }
+
+static void
+render_thread_main()
+{
+
+    render_thread_state *state = get_render_thread_state();
+
+    {
+        b32 result = set_opengl_render_context_current(true);
+        std::lock_guard<std::mutex> lock(state->lock);
+        state->start_result = result;
+        state->start_finished = true;
+    }
+    state->signal_completed.notify_all();
+    if (!state->start_result) return;
+
+    for (;;)
+    {
+
+        // Submitted packets are drawn before a stop is honoured.
+        render_frame_packet *packet = NULL;
+        {
+            u64 wait_begin = system_timestamp();
+            std::unique_lock<std::mutex> lock(state->lock);
+            state->signal_submitted.wait(lock, [&]{
+                return state->stop_requested || state->submitted_count > state->completed_count;
+            });
+            if (state->submitted_count == state->completed_count) break;
+            packet = state->packets + (state->completed_count % RENDER_THREAD_PACKETS);
+            state->statistics.render_wait_milliseconds +=
+                system_timestamp_difference_ms(wait_begin, system_timestamp());
+        }
+
+        u64 render_begin = system_timestamp();
+        opengl_state_begin_frame();
+        state->proc(packet, state->user_data);
+        window_swap_buffers();
+        opengl_state_get_statistics(&packet->statistics);
+        packet->render_milliseconds = system_timestamp_difference_ms(render_begin, system_timestamp());
+
+        {
+            std::lock_guard<std::mutex> lock(state->lock);
+            state->completed_count++;
+            state->statistics.frames_rendered++;
+        }
+        state->signal_completed.notify_all();
+
+    }
+
+    set_opengl_render_context_current(false);
+
+}
+
+// --- Frame Packets -----------------------------------------------------------
+
+void
+render_frame_packet_create(render_frame_packet *packet, memory_arena *arena,
+        u64 instance_capacity, u32 commands_per_stream)
+{
+
+    NX_ENSURE_POINTER(packet);
+    NX_ENSURE_POINTER(arena);
+
+    memset(packet, 0, sizeof(render_frame_packet));
+    renderer2d_create_quad_render_context(&packet->quads, arena, instance_capacity);
+    render_command_buffer_create(&packet->commands, arena, commands_per_stream, 0);
+
+}
+
+void
+render_frame_packet_delete(render_frame_packet *packet)
+{
+
+    NX_ENSURE_POINTER(packet);
+    NX_ASSERT(!render_thread_is_running());
+    renderer2d_delete_quad_render_context(&packet->quads);
+
+}
+
+// --- Render Thread -----------------------------------------------------------
+
+b32
+render_thread_start(render_frame_packet *packets, render_frame_proc proc, vptr user_data)
+{
+
+    NX_ENSURE_POINTER(packets);
+    NX_ENSURE_POINTER(proc);
+
+    render_thread_state *state = get_render_thread_state();
+    if (state->running) return true;
+
+    // Anything queued on this thread has to reach the driver before the context
+    // moves; a flush is enough since both threads feed the same context.
+    glFlush();
+    if (!set_opengl_render_context_current(false)) return false;
+
+    state->packets = packets;
+    state->proc = proc;
+    state->user_data = user_data;
+    state->stop_requested = false;
+    state->start_result = false;
+    state->start_finished = false;
+    state->submitted_count = 0;
+    state->completed_count = 0;
+    state->packet_acquired = false;
+    state->thread = std::thread(render_thread_main);
+
+    {
+        std::unique_lock<std::mutex> lock(state->lock);
+        state->signal_completed.wait(lock, [&]{ return state->start_finished; });
+    }
+
+    if (!state->start_result)
+    {
+        state->thread.join();
+        set_opengl_render_context_current(true);
+        return false;
+    }
+
+    state->running = true;
+    return true;
+
+}
+
+void
+render_thread_stop()
+{
+
+    render_thread_state *state = get_render_thread_state();
+    if (!state->running) return;
+    NX_ASSERT(!state->packet_acquired);
+
+    {
+        std::lock_guard<std::mutex> lock(state->lock);
+        state->stop_requested = true;
+    }
+    state->signal_submitted.notify_all();
+    state->thread.join();
+
+    state->running = false;
+    set_opengl_render_context_current(true);
+
+}
+
+b32
+render_thread_is_running()
+{
+
+    render_thread_state *state = get_render_thread_state();
+    return state->running;
+
+}
+
+render_frame_packet*
+render_thread_acquire_packet()
+{
+
+    render_thread_state *state = get_render_thread_state();
+    NX_ASSERT(state->running);
+    NX_ASSERT(!state->packet_acquired);
+
+    u64 wait_begin = system_timestamp();
+    std::unique_lock<std::mutex> lock(state->lock);
+    state->signal_completed.wait(lock, [&]{
+        return state->submitted_count - state->completed_count < RENDER_THREAD_PACKETS;
+    });
+    state->statistics.game_wait_milliseconds += system_timestamp_difference_ms(wait_begin, system_timestamp());
+
+    render_frame_packet *packet = state->packets + (state->submitted_count % RENDER_THREAD_PACKETS);
+    packet->frame_index = state->submitted_count;
+    state->packet_acquired = true;
+    return packet;
+
+}
+
+void
+render_thread_submit_packet(render_frame_packet *packet)
+{
+
+    render_thread_state *state = get_render_thread_state();
+    NX_ENSURE_POINTER(packet);
+    NX_ASSERT(state->packet_acquired);
+    NX_ASSERT(packet == state->packets + (state->submitted_count % RENDER_THREAD_PACKETS));
+
+    {
+        std::lock_guard<std::mutex> lock(state->lock);
+        state->submitted_count++;
+        state->packet_acquired = false;
+    }
+    state->signal_submitted.notify_one();
+
+}
+
+void
+render_thread_get_statistics(render_thread_statistics *statistics)
+{
+
+    NX_ENSURE_POINTER(statistics);
+    render_thread_state *state = get_render_thread_state();
+    std::lock_guard<std::mutex> lock(state->lock);
+    *statistics = state->statistics;
+
+}
@@ -0,0 +1,74 @@
+#ifndef SRC_ENGINE_RENDERTHREAD_H
+#define SRC_ENGINE_RENDERTHREAD_H
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <platform/opengl.h>
+#include <engine/renderers/quad2d.h>
+#include <engine/renderers/commandbuffer.h>
+
+// --- Render Thread -----------------------------------------------------------
+//
+// Moves GL submission off the game thread so that simulating one frame overlaps
+// with the driver work of the one before it. Starting the render thread hands it
+// the GL context; from then on the game thread fills frame packets and never
+// calls GL, and the render thread turns each packet into GL calls and swaps.
+//
+// There are RENDER_THREAD_PACKETS packets, used in turn. Acquire returns the next
+// one once the render thread is done with it, waiting only if the game thread
+// is a full packet ahead. Everything the frame needs goes into the packet: the
+// instances, the camera, and the draws recorded into its command buffer, sorted
+// before submitting. After submit the packet belongs to the render thread and
+// must not be touched until it comes back from acquire.
+//
+// On the render thread each packet is passed to the render procedure given at
+// start, then the buffers are swapped and the packet's statistics are filled
+// in for the game thread to read when it acquires the packet again. The GL state
+// cache moves with the context, so it stays valid across start and stop.
+//
+// Stopping renders whatever was submitted, then gives the context back to the
+// calling thread. Stop around anything on the game thread which needs GL, such
+// as benchmarks or changing the packets' upload modes.
+//
+
+#define RENDER_THREAD_PACKETS       2
+
+typedef struct render_frame_packet
+{
+
+    u64 frame_index;
+    i32 viewport_width;
+    i32 viewport_height;
+    vec4 clear_color;
+    quad_frame_constants frame_constants;
+
+    quad_render_buffer quads;       // Write the frame's instances to quads.vertex_buffer.
+    u64 instance_count;
+    render_command_buffer commands;
+
+    // Filled in by the render thread once the packet has been drawn.
+    opengl_state_statistics statistics;
+    r64 render_milliseconds;        // Render procedure and swap.
+
+} render_frame_packet;
+
+typedef struct render_thread_statistics
+{
+    u64 frames_rendered;
+    r64 game_wait_milliseconds;     // Spent in acquire, over every frame so far.
+    r64 render_wait_milliseconds;   // Render thread idle, waiting for a packet.
+} render_thread_statistics;
+
+typedef void (*render_frame_proc)(render_frame_packet *packet, vptr user_data);
+
+void    render_frame_packet_create(render_frame_packet *packet, memory_arena *arena,
+            u64 instance_capacity, u32 commands_per_stream);
+void    render_frame_packet_delete(render_frame_packet *packet);
+
+b32                     render_thread_start(render_frame_packet *packets, render_frame_proc proc, vptr user_data);
+void                    render_thread_stop();
+b32                     render_thread_is_running();
+render_frame_packet*    render_thread_acquire_packet();
+void                    render_thread_submit_packet(render_frame_packet *packet);
+void                    render_thread_get_statistics(render_thread_statistics *statistics);
+
+#endif
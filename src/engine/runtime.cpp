@@ -7,14 +7,29 @@
 #include <core/definitions.h>
 #include <core/linear.h>
 #include <core/arena.h>
+#include <core/jobs.h>
 
 #include <engine/primitives.h>
+#include <engine/particles.h>
+#include <engine/benchmarks.h>
 #include <engine/renderers/quad2d.h>
+#include <engine/renderers/quadcull.h>
+#include <engine/renderers/spriteatlas.h>
+#include <engine/renderers/spritebatch.h>
+#include <engine/renderers/uniformring.h>
+#include <engine/renderers/commandbuffer.h>
+#include <engine/renderers/programcache.h>
+#include <engine/renderers/texturestream.h>
+#include <engine/renderers/bakedtexture.h>
+#include <engine/renderers/frameprofiler.h>
+#include <engine/renderthread.h>
+#include <engine/framegraph.h>
 
 #include <math.h>
 #include <time.h>
 #include <cstdlib>
 #include <thread>
+#include <atomic>
 #include <random>
 
 inline r32
@@ -37,10 +52,36 @@ generate_u32_in_range(u32 low, u32 high)
 
 }
 
+typedef enum runtime_cull_mode
+{
+    RUNTIME_CULL_OFF,
+    RUNTIME_CULL_CPU,
+    RUNTIME_CULL_GPU,
+    RUNTIME_CULL_MODE_COUNT,
+} runtime_cull_mode;
+
+static ccptr runtime_cull_mode_names[RUNTIME_CULL_MODE_COUNT] = { "Off", "CPU", "GPU" };
+
+// The quad programs with their sampler uniform resolved once at load. The
+// matrices come from the quad_frame block, shared by all of them.
+typedef struct runtime_quad_shader
+{
+    GLuint program;
+    opengl_program_reflection reflection;
+    opengl_uniform texture_index;
+} runtime_quad_shader;
+
 static memory_arena primary_arena;
 static b32 runtime_flag;
-static GLuint quad_program;
+static runtime_quad_shader quad_shader;
+static runtime_quad_shader quad_compact_shader;
+static runtime_quad_shader quad_pull_shader;
+static runtime_quad_shader quad_compact_pull_shader;
+static GLuint quad_cull_program;
 static GLuint base_texture;
+static GLuint base_texture_alt;
+static sprite_atlas demo_atlas;
+static program_cache shader_cache;
 
 memory_arena *
 runtime_get_primary_arena()
@@ -48,107 +89,198 @@ runtime_get_primary_arena()
     return &primary_arena;
 }
 
-b32 
-runtime_init(buffer heap)
+program_cache *
+runtime_get_program_cache()
 {
+    return &shader_cache;
+}
 
-    // Rather than dealing with the raw heap buffer, convert it to a memory arena.
-    memory_arena_initialize(&primary_arena, heap.ptr, heap.size);
-
-    // Create the window, automatically show it to the user after it is made.
-    b32 window_created = window_initialize("Ninetails Game Engine", 1280, 720, false);
-    if (window_created == false) return false;
-
-    // When the window is created, we can now initialize a render context.
-    if (!create_opengl_render_context(window_get_handle())) return false;
-
-    if (!set_opengl_vertical_sync(0))
-    {
-        printf("-- Unable to set swap interval to desired value.\n");
-    }
-
-    // Set some OpenGL context stuff.
-    glEnable(GL_BLEND);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
-
-    // Preset values, swap frame afterwards to show it.
-    glViewport(0, 0, window_get_width(), window_get_height());
-    glClear(GL_COLOR_BUFFER_BIT);
-    glClear(GL_DEPTH_BUFFER_BIT);
-    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-    window_swap_buffers();
-
-    // Generate our quad shaders.
-    GLuint q2d_vertex_shader = opengl_shader_create(GL_VERTEX_SHADER);
-    GLuint q2d_fragment_shader = opengl_shader_create(GL_FRAGMENT_SHADER);
-    ccptr quad_vertex_shader_path = "./res/quad2d_vertex.glsl";
-    ccptr quad_fragment_shader_path = "./res/quad2d_fragment.glsl";
+// Programs are submitted to the cache and collected later, the driver builds
+// them in between. A submit which fails returns no build, which finishes as 0.
+static program_build
+runtime_submit_program(ccptr vertex_shader_path, ccptr fragment_shader_path)
+{
 
-    if (!file_exists(quad_vertex_shader_path))
+    if (!file_exists(vertex_shader_path))
     {
-        printf("-- Critical shader missing, quad2d_vertex.glsl\n");
-        return false;
+        printf("-- Critical shader missing, %s\n", vertex_shader_path);
+        return PROGRAM_BUILD_NONE;
     }
 
-    if (!file_exists(quad_fragment_shader_path))
+    if (!file_exists(fragment_shader_path))
     {
-        printf("-- Critical shader missing, quad2d_fragment.glsl\n");
-        return false;
+        printf("-- Critical shader missing, %s\n", fragment_shader_path);
+        return PROGRAM_BUILD_NONE;
     }
 
-    u64 vertex_shader_size = file_size(quad_vertex_shader_path);
-    u64 fragment_shader_size = file_size(quad_fragment_shader_path);
+    u64 vertex_shader_size = file_size(vertex_shader_path);
+    u64 fragment_shader_size = file_size(fragment_shader_path);
     if (vertex_shader_size == 0 || fragment_shader_size == 0)
     {
         printf("-- Critical shader error, size for either fragment or vertex shader is zero.\n");
-        return false;
+        return PROGRAM_BUILD_NONE;
     }
 
+    // The sources are only needed until they're submitted.
     u64 shader_save_point = memory_arena_save(&primary_arena);
     cptr vertex_shader = (cptr)memory_arena_push(&primary_arena, vertex_shader_size + 1);
     cptr fragment_shader = (cptr)memory_arena_push(&primary_arena, fragment_shader_size + 1);
-    u64 vertex_read_size = file_read_all(quad_vertex_shader_path, vertex_shader, vertex_shader_size);
-    u64 fragment_read_size = file_read_all(quad_fragment_shader_path, fragment_shader, fragment_shader_size);
+    u64 vertex_read_size = file_read_all(vertex_shader_path, vertex_shader, vertex_shader_size);
+    u64 fragment_read_size = file_read_all(fragment_shader_path, fragment_shader, fragment_shader_size);
+    vertex_shader[vertex_shader_size] = '\0';
+    fragment_shader[fragment_shader_size] = '\0';
+
+    // The cache compiles only when it has no binary for these sources.
+    program_build build = PROGRAM_BUILD_NONE;
     if (vertex_read_size != vertex_shader_size)
     {
         printf("-- Critical shader error, read size mismatch for vertex shader.\n");
-        return false;
     }
-
-    if (fragment_read_size != fragment_shader_size)
+    else if (fragment_read_size != fragment_shader_size)
     {
         printf("-- Critical shader error, read size mismatch for fragment shader.\n");
-        return false;
     }
+    else
+    {
 
-    vertex_shader[vertex_shader_size] = '\0';
-    fragment_shader[fragment_shader_size] = '\0';
+        program_cache_stage stages[2] = {
+            { GL_VERTEX_SHADER, vertex_shader },
+            { GL_FRAGMENT_SHADER, fragment_shader },
+        };
 
-    if (!opengl_shader_compile(q2d_vertex_shader, vertex_shader))
+        build = program_cache_submit(&shader_cache, stages, 2);
+
+    }
+
+    memory_arena_restore(&primary_arena, shader_save_point);
+    return build;
+
+}
+
+static program_build
+runtime_submit_compute_program(ccptr compute_shader_path)
+{
+
+    if (!file_exists(compute_shader_path))
     {
-        printf("-- Critical shader error, unable to compile vertex shader.\n");
-        return false;
+        printf("-- Critical shader missing, %s\n", compute_shader_path);
+        return PROGRAM_BUILD_NONE;
     }
 
-    if (!opengl_shader_compile(q2d_fragment_shader, fragment_shader))
+    u64 compute_shader_size = file_size(compute_shader_path);
+    if (compute_shader_size == 0)
     {
-        printf("-- Critical shader error, unable to compile fragment shader.\n");
-        return false;
+        printf("-- Critical shader error, size for compute shader is zero.\n");
+        return PROGRAM_BUILD_NONE;
     }
 
-    quad_program = opengl_program_create();
-    opengl_program_attach(quad_program, q2d_vertex_shader);
-    opengl_program_attach(quad_program, q2d_fragment_shader);
-    if (!opengl_program_link(quad_program))
+    u64 shader_save_point = memory_arena_save(&primary_arena);
+    cptr compute_shader = (cptr)memory_arena_push(&primary_arena, compute_shader_size + 1);
+    u64 compute_read_size = file_read_all(compute_shader_path, compute_shader, compute_shader_size);
+    compute_shader[compute_shader_size] = '\0';
+
+    program_build build = PROGRAM_BUILD_NONE;
+    if (compute_read_size != compute_shader_size)
     {
-        printf("-- Critical shader error, unable to link program.\n");
-        return false;
+        printf("-- Critical shader error, read size mismatch for compute shader.\n");
     }
+    else
+    {
+
+        program_cache_stage stage = { GL_COMPUTE_SHADER, compute_shader };
+        build = program_cache_submit(&shader_cache, &stage, 1);
+
+    }
+
+    memory_arena_restore(&primary_arena, shader_save_point);
+    return build;
+
+}
 
-    opengl_shader_release(q2d_vertex_shader);
-    opengl_shader_release(q2d_fragment_shader);
+static GLuint
+runtime_finish_program(program_build build, ccptr name)
+{
+
+    GLuint program = program_cache_finish(&shader_cache, build);
+    if (program == 0) printf("-- Critical shader error, unable to build %s.\n", name);
+    return program;
+
+}
+
+static b32
+runtime_finish_quad_shader(runtime_quad_shader *shader, program_build build, ccptr name)
+{
+
+    shader->program = runtime_finish_program(build, name);
+    if (shader->program == 0) return false;
+    if (!opengl_program_reflect(&shader->reflection, shader->program)) return false;
+
+    shader->texture_index = opengl_program_uniform(&shader->reflection, "u_texture_index");
+    return true;
+
+}
 
+b32 
+runtime_init(buffer heap)
+{
+
+    // Rather than dealing with the raw heap buffer, convert it to a memory arena.
+    u64 init_begin = system_timestamp();
+    memory_arena_initialize(&primary_arena, heap.ptr, heap.size);
+
+    // Spin up the worker pool used by the data-parallel engine subsystems.
+    jobs_initialize(0);
+    printf("-- Job system started with %u threads.\n", jobs_worker_count());
+
+    // Create the window, automatically show it to the user after it is made.
+    b32 window_created = window_initialize("Ninetails Game Engine", 1280, 720, false);
+    if (window_created == false) return false;
+
+    // When the window is created, we can now initialize a render context.
+    if (!create_opengl_render_context(window_get_handle())) return false;
+
+    if (!set_opengl_vertical_sync(0))
+    {
+        printf("-- Unable to set swap interval to desired value.\n");
+    }
+
+    // Set some OpenGL context stuff.
+    opengl_state_enable(GL_BLEND);
+    opengl_state_enable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+
+    // Preset values, swap frame afterwards to show it.
+    opengl_state_viewport(0, 0, window_get_width(), window_get_height());
+    glClear(GL_COLOR_BUFFER_BIT);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    opengl_state_clear_color(0.1f, 0.1f, 0.1f, 1.0f);
+    window_swap_buffers();
+
+    // Programs come out of the binary cache when this driver has built them
+    // before, the timing below shows what that saves over compiling. Those it
+    // has to compile are only submitted here, and collected once the textures
+    // are loaded, so the driver builds them in the meantime.
+    u64 submit_begin = system_timestamp();
+    program_cache_create(&shader_cache, &primary_arena, "./cache");
+
+    // Generate our quad shaders, the compact variant reads 16 byte instances and
+    // samples the demo atlas layer each instance carries.
+    program_build quad_build = runtime_submit_program("./res/quad2d_vertex.glsl",
+            "./res/quad2d_fragment.glsl");
+    program_build quad_compact_build = runtime_submit_program("./res/quad2d_compact_vertex.glsl",
+            "./res/quad2d_compact_array_fragment.glsl");
+
+    // Vertex pulling variants, these fetch the instances from a storage buffer.
+    program_build quad_pull_build = runtime_submit_program("./res/quad2d_pull_vertex.glsl",
+            "./res/quad2d_fragment.glsl");
+    program_build quad_compact_pull_build = runtime_submit_program("./res/quad2d_compact_pull_vertex.glsl",
+            "./res/quad2d_compact_array_fragment.glsl");
+
+    program_build quad_cull_build = runtime_submit_compute_program("./res/quad2d_cull_compute.glsl");
+    r64 submit_milliseconds = system_timestamp_difference_ms(submit_begin, system_timestamp());
+
+    u64 texture_begin = system_timestamp();
+    u64 texture_save_point = memory_arena_save(&primary_arena);
 
     // Load the texture.
     ccptr test_image_path = "./res/testtex1024x1024.png";
@@ -169,7 +301,64 @@ runtime_init(buffer heap)
 
     base_texture = opengl_texture_create(&test_image);
 
-    memory_arena_restore(&primary_arena, shader_save_point);
+    // A second texture object from the same image gives the sprite batch demo
+    // two textures to sort between.
+    base_texture_alt = opengl_texture_create(&test_image);
+
+    // When texbake has baked the sheet, the second texture is that instead; it
+    // loads without decoding and is mipmapped, so it looks smoother minified.
+    //
+    //      texbake ./res/testtex1024x1024.png ./res/testtex1024x1024.nxtex bc7
+    //
+    baked_texture_info baked_info = {};
+    GLuint baked_texture = baked_texture_load("./res/testtex1024x1024.nxtex", &primary_arena, &baked_info);
+    if (baked_texture != 0)
+    {
+        opengl_texture_delete(base_texture_alt);
+        base_texture_alt = baked_texture;
+        printf("-- Baked texture: %ux%u %s, %u levels, %llu bytes against %llu as RGBA8, loaded in %.2f ms.\n",
+                baked_info.width, baked_info.height, texture_bake_format_name(baked_info.format),
+                baked_info.level_count, baked_info.texture_bytes, test_image_size,
+                baked_info.load_milliseconds);
+    }
+
+    // The compact demo draws from two sheets in one call, the second is the
+    // test image with red and blue swapped so the layers are told apart.
+    sprite_atlas_create(&demo_atlas, test_image.width, test_image.height, 2);
+    sprite_atlas_add_sheet(&demo_atlas, &test_image);
+
+    u32 *pixels = (u32*)test_image.buffer;
+    u64 pixel_count = (u64)test_image.width * test_image.height;
+    for (u64 i = 0; i < pixel_count; ++i)
+    {
+        u32 pixel = pixels[i];
+        pixels[i] = (pixel & 0xFF00FF00) | ((pixel >> 16) & 0xFF) | ((pixel & 0xFF) << 16);
+    }
+
+    sprite_atlas_add_sheet(&demo_atlas, &test_image);
+
+    memory_arena_restore(&primary_arena, texture_save_point);
+    r64 texture_milliseconds = system_timestamp_difference_ms(texture_begin, system_timestamp());
+
+    // Waits only on the programs the driver hasn't finished yet.
+    u64 finish_begin = system_timestamp();
+    if (!runtime_finish_quad_shader(&quad_shader, quad_build, "quad2d")) return false;
+    if (!runtime_finish_quad_shader(&quad_compact_shader, quad_compact_build, "quad2d_compact")) return false;
+    if (!runtime_finish_quad_shader(&quad_pull_shader, quad_pull_build, "quad2d_pull")) return false;
+    if (!runtime_finish_quad_shader(&quad_compact_pull_shader, quad_compact_pull_build,
+                "quad2d_compact_pull")) return false;
+
+    quad_cull_program = runtime_finish_program(quad_cull_build, "quad2d_cull_compute");
+    if (quad_cull_program == 0) return false;
+    r64 finish_milliseconds = system_timestamp_difference_ms(finish_begin, system_timestamp());
+
+    program_cache_print_statistics(&shader_cache);
+    printf("-- Startup took %.2f ms: programs %.2f ms submitting and %.2f ms waiting (%s),"
+            " textures %.2f ms in between.\n",
+            system_timestamp_difference_ms(init_begin, system_timestamp()),
+            submit_milliseconds, finish_milliseconds,
+            opengl_parallel_compile_supported() ? "parallel compile" : "driver order",
+            texture_milliseconds);
 
     // Return true to indicate that init succeeded.
     return true;
@@ -283,6 +472,176 @@ update_quads_within_range(r32 delta_time, u64 start, u64 total, quad_layout *arr
     }
 }
 
+#define RUNTIME_COMMAND_CHUNK 65536
+#define RUNTIME_TEXTURE_STAGING_SIZE (16 * 1024 * 1024)
+
+// The command demo updates the falling quads a chunk per job and records the
+// chunk's draw from the worker which updated it.
+typedef struct runtime_command_context
+{
+    r32 delta_time;
+    quad_layout *quads;
+    quad_layout *snapshot;          // Where to copy the updated chunk, if anywhere.
+    quad_render_buffer *renderer;
+    render_command_buffer *commands;
+    render_draw_state states[2];
+} runtime_command_context;
+
+static void
+update_and_record_quads(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    runtime_command_context *context = (runtime_command_context*)user_data;
+    update_quads_within_range(context->delta_time, begin, end, context->quads);
+    if (context->snapshot != NULL)
+        memcpy(context->snapshot + begin, context->quads + begin, sizeof(quad_layout) * (end - begin));
+
+    // Chunks alternate textures; the key groups them so each is bound once.
+    u32 chunk = (u32)(begin / RUNTIME_COMMAND_CHUNK);
+    render_draw_state *state = context->states + (chunk & 1);
+    u64 key = render_command_make_key(0, state->blend, state->program, state->texture, chunk);
+    render_command_draw_quads(context->commands, worker_index, key, state, context->renderer,
+            (u32)begin, (u32)(end - begin));
+
+}
+
+// Runs on the render thread, which owns the frame uniforms while it's running.
+static void
+runtime_render_packet(render_frame_packet *packet, vptr user_data)
+{
+
+    uniform_ring *frame_uniforms = (uniform_ring*)user_data;
+
+    opengl_state_viewport(0, 0, packet->viewport_width, packet->viewport_height);
+    opengl_state_clear_color(packet->clear_color.X, packet->clear_color.Y,
+            packet->clear_color.Z, packet->clear_color.W);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    i32 texture_slot = 0;
+    opengl_program_set_i32(&quad_shader.reflection, quad_shader.texture_index, &texture_slot, 1);
+    opengl_program_set_i32(&quad_pull_shader.reflection, quad_pull_shader.texture_index, &texture_slot, 1);
+
+    uniform_ring_begin_frame(frame_uniforms);
+    uniform_allocation frame_allocation = uniform_ring_push_value(frame_uniforms, &packet->frame_constants);
+    uniform_ring_bind(&frame_allocation, QUAD_FRAME_BINDING);
+
+    render_command_buffer_submit(&packet->commands);
+
+    opengl_state_enable(GL_BLEND);
+    opengl_state_blend_func(GL_ONE, GL_ZERO);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, base_texture);
+    uniform_ring_end_frame(frame_uniforms);
+
+}
+
+// Keys whose handlers call GL from the game thread.
+static b32
+runtime_gl_key_pressed()
+{
+
+    if (input_key_is_pressed(NxKeyO) || input_key_is_pressed(NxKeyV)) return true;
+    if (input_key_is_pressed(NxKeyF1) || input_key_is_pressed(NxKeyF2)) return true;
+    if (input_key_is_pressed(NxKeyF3) || input_key_is_pressed(NxKeyF4)) return true;
+    if (input_key_is_pressed(NxKeyF5) || input_key_is_pressed(NxKeyF6)) return true;
+    if (input_key_is_pressed(NxKeyF7) || input_key_is_pressed(NxKeyF8)) return true;
+    if (input_key_is_pressed(NxKeyF9) || input_key_is_pressed(NxKeyF10)) return true;
+    if (input_key_is_pressed(NxKeyF11) || input_key_is_pressed(NxKeyE)) return true;
+    return input_key_is_pressed(NxKeyF12);
+
+}
+
+// Graph mode runs the frame as stages, drawing frame N - 1's packet while frame
+// N is simulated into the other one. The parameters set before each execute are
+// kept per packet, since the previous frame's stages may still be reading them.
+typedef struct runtime_graph_frame
+{
+    r32 delta_time;
+    quad_layout *quads;
+    i64 instance_count;
+    GLuint sheet_texture;
+    i32 viewport_width;
+    i32 viewport_height;
+} runtime_graph_frame;
+
+typedef struct runtime_graph_context
+{
+    render_frame_packet *packets;
+    uniform_ring *frame_uniforms;
+    runtime_graph_frame frames[RENDER_THREAD_PACKETS];
+    u64 first_frame;                // Nothing was simulated before it to draw.
+} runtime_graph_context;
+
+static void
+runtime_graph_simulate(vptr user_data, u64 frame_index)
+{
+
+    runtime_graph_context *context = (runtime_graph_context*)user_data;
+    runtime_graph_frame *frame = context->frames + (frame_index % RENDER_THREAD_PACKETS);
+    render_frame_packet *packet = context->packets + (frame_index % RENDER_THREAD_PACKETS);
+    packet->frame_index = frame_index;
+    packet->instance_count = frame->instance_count;
+
+    b32 packet_pulled = (packet->quads.draw_path == QUAD_DRAW_PULLED);
+    runtime_command_context command_context = {0};
+    command_context.delta_time  = frame->delta_time;
+    command_context.quads       = frame->quads;
+    command_context.snapshot    = packet->quads.vertex_buffer;
+    command_context.renderer    = &packet->quads;
+    command_context.commands    = &packet->commands;
+    for (u32 i = 0; i < 2; ++i)
+    {
+        command_context.states[i].program   = (packet_pulled) ? quad_pull_shader.program : quad_shader.program;
+        command_context.states[i].texture   = (i == 0) ? base_texture : frame->sheet_texture;
+        command_context.states[i].blend     = RENDER_BLEND_OPAQUE;
+    }
+
+    render_command_buffer_reset(&packet->commands);
+    render_command_upload_quads(&packet->commands, 0, &packet->quads, frame->instance_count);
+    jobs_parallel_for(frame->instance_count, RUNTIME_COMMAND_CHUNK, update_and_record_quads, &command_context);
+    render_command_buffer_sort(&packet->commands);
+
+}
+
+static void
+runtime_graph_camera(vptr user_data, u64 frame_index)
+{
+
+    runtime_graph_context *context = (runtime_graph_context*)user_data;
+    runtime_graph_frame *frame = context->frames + (frame_index % RENDER_THREAD_PACKETS);
+    render_frame_packet *packet = context->packets + (frame_index % RENDER_THREAD_PACKETS);
+
+    packet->viewport_width = frame->viewport_width;
+    packet->viewport_height = frame->viewport_height;
+    packet->clear_color = { 0.1f, 0.1f, 0.1f, 1.0f };
+    packet->frame_constants.projection = orthographic_rh_no(0.0f, (r32)frame->viewport_width,
+            0.0f, (r32)frame->viewport_height, -10.0f, 10.0f);
+    packet->frame_constants.camera = translate({ 0.0f, 0.0f, 0.0f });
+    packet->frame_constants.view_projection = packet->frame_constants.projection *
+        packet->frame_constants.camera;
+
+}
+
+static void
+runtime_graph_submit(vptr user_data, u64 frame_index)
+{
+
+    runtime_graph_context *context = (runtime_graph_context*)user_data;
+    if (frame_index == context->first_frame) return;
+    render_frame_packet *packet = context->packets + ((frame_index - 1) % RENDER_THREAD_PACKETS);
+    runtime_render_packet(packet, context->frame_uniforms);
+
+}
+
+static void
+runtime_graph_swap(vptr user_data, u64 frame_index)
+{
+
+    runtime_graph_context *context = (runtime_graph_context*)user_data;
+    if (frame_index == context->first_frame) return;
+    window_swap_buffers();
+
+}
+
 b32 
 runtime_main(buffer heap)
 {
@@ -293,7 +652,7 @@ runtime_main(buffer heap)
     // OpenGL setup.
     GLuint vertex_array_object;
     glGenVertexArrays(1, &vertex_array_object);
-    glBindVertexArray(vertex_array_object);
+    opengl_state_bind_vertex_array(vertex_array_object);
 
     // Set up frame averaging.
     u32 frame_index = 0;
@@ -307,6 +666,85 @@ runtime_main(buffer heap)
     quad_render_buffer test_quad_renderer = {0};
     renderer2d_create_quad_render_context(&test_quad_renderer, &primary_arena, quads_limit);
 
+    // The compact renderer draws the same quads, packed to 16 bytes per frame.
+    b32 compact_mode = false;
+    quad_render_buffer compact_quad_renderer = {0};
+    renderer2d_create_quad_compact_render_context(&compact_quad_renderer, &primary_arena, quads_limit);
+    renderer2d_set_quad_atlas_grid(&compact_quad_renderer, 8, 8);
+
+    // Culling leaves the falling quads in the test renderer as the world and
+    // writes the ones in view to a renderer of their own. The GPU culler keeps
+    // its own copy of the world and draws the survivors itself.
+    runtime_cull_mode cull_mode = RUNTIME_CULL_OFF;
+    quad_render_buffer culled_quad_renderer = {0};
+    renderer2d_create_quad_render_context(&culled_quad_renderer, &primary_arena, quads_limit);
+    quad_culler demo_culler = {0};
+    quad_culler_create(&demo_culler, &primary_arena, quads_limit);
+    quad_gpu_culler demo_gpu_culler = {0};
+    quad_gpu_culler_create(&demo_gpu_culler, quad_cull_program, quads_limit);
+
+    // Constants which change every frame are pushed into a ring of uniform
+    // buffer regions; the quad frame block is the only one so far.
+    uniform_ring frame_uniforms = {0};
+    uniform_ring_create(&frame_uniforms, 4096);
+
+    // The sprite batch draws the same quads spread over layers, textures and
+    // blend modes, sorted into as few draws as the state changes allow.
+    b32 batch_mode = false;
+    sprite_batch demo_batch = {0};
+    sprite_batch_create(&demo_batch, &primary_arena, (u32)quads_limit);
+
+    // The command demo records from the job workers and submits on this thread.
+    b32 command_mode = false;
+    render_command_buffer demo_commands;
+    render_command_buffer_create(&demo_commands, &primary_arena,
+            (u32)(quads_limit / RUNTIME_COMMAND_CHUNK) + 2, 0);
+
+    // With the render thread running this thread only fills frame packets; the
+    // render thread draws them and swaps while the next frame is simulated.
+    render_frame_packet frame_packets[RENDER_THREAD_PACKETS];
+    for (u32 i = 0; i < RENDER_THREAD_PACKETS; ++i)
+    {
+        render_frame_packet_create(frame_packets + i, &primary_arena, quads_limit,
+                (u32)(quads_limit / RUNTIME_COMMAND_CHUNK) + 2);
+    }
+    opengl_state_statistics render_statistics = {0};
+
+    // Graph mode uses the same packets on this thread, through the stages below.
+    // Input and the sim state go straight into the simulate stage's parameters,
+    // the GL state cache and back buffer belong to the main thread stages.
+    b32 graph_mode = false;
+    frame_graph demo_graph;
+    runtime_graph_context graph_context = {0};
+    graph_context.packets = frame_packets;
+    graph_context.frame_uniforms = &frame_uniforms;
+
+    frame_graph_create(&demo_graph, 2);
+    frame_resource graph_sim = frame_graph_add_resource(&demo_graph, "sim state", 1);
+    frame_resource graph_instances = frame_graph_add_resource(&demo_graph, "instances", RENDER_THREAD_PACKETS);
+    frame_resource graph_camera = frame_graph_add_resource(&demo_graph, "camera", RENDER_THREAD_PACKETS);
+    frame_resource graph_backbuffer = frame_graph_add_resource(&demo_graph, "back buffer", 1);
+
+    frame_node simulate_node = frame_graph_add_node(&demo_graph, "simulate",
+            runtime_graph_simulate, &graph_context, FRAME_NODE_WORKER);
+    frame_graph_node_access(&demo_graph, simulate_node, graph_sim, FRAME_ACCESS_WRITE);
+    frame_graph_node_access(&demo_graph, simulate_node, graph_instances, FRAME_ACCESS_WRITE);
+
+    frame_node camera_node = frame_graph_add_node(&demo_graph, "camera",
+            runtime_graph_camera, &graph_context, FRAME_NODE_WORKER);
+    frame_graph_node_access(&demo_graph, camera_node, graph_camera, FRAME_ACCESS_WRITE);
+
+    frame_node submit_node = frame_graph_add_node(&demo_graph, "submit",
+            runtime_graph_submit, &graph_context, FRAME_NODE_MAIN_THREAD);
+    frame_graph_node_access(&demo_graph, submit_node, graph_instances, FRAME_ACCESS_READ_PREVIOUS);
+    frame_graph_node_access(&demo_graph, submit_node, graph_camera, FRAME_ACCESS_READ_PREVIOUS);
+    frame_graph_node_access(&demo_graph, submit_node, graph_backbuffer, FRAME_ACCESS_WRITE);
+
+    frame_node swap_node = frame_graph_add_node(&demo_graph, "swap",
+            runtime_graph_swap, &graph_context, FRAME_NODE_MAIN_THREAD);
+    frame_graph_node_access(&demo_graph, swap_node, graph_backbuffer, FRAME_ACCESS_READ);
+    frame_graph_compile(&demo_graph);
+
     quad_layout* first = test_quad_renderer.vertex_buffer + 0;
     first->transform.position   = { 100.0f, 100.0f };
     first->transform.scale      = { 32.0f, 32.0f };
@@ -322,10 +760,63 @@ runtime_main(buffer heap)
 
     }
 
-    // Pre-activate the program and texture binding.
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, base_texture); 
-    glUseProgram(quad_program);
+    // The particle demo is the same falling quads, driven by an emitter instead.
+    b32 particle_mode = false;
+    particle_system demo_particles = {0};
+    particle_system_create(&demo_particles, &primary_arena, 1, quads_limit, quads_limit);
+
+    particle_emitter_description demo_description = {0};
+    demo_description.spawn_limit        = (u32)quads_limit;
+    demo_description.capacity           = (u32)quads_limit;
+    demo_description.lifetime_min       = 8.0f / SCALE_REDUCTION;
+    demo_description.lifetime_max       = 32.0f / SCALE_REDUCTION;
+    demo_description.velocity_min       = { 0.0f, -FALL_REDUCTION };
+    demo_description.velocity_max       = { 0.0f, -FALL_REDUCTION };
+    demo_description.scale_min          = 8.0f;
+    demo_description.scale_max          = 32.0f;
+    demo_description.velocity_curve     = particle_curve_constant(1.0f);
+    demo_description.scale_curve        = particle_curve_linear(1.0f, 0.0f);
+    demo_description.color_curve        = particle_color_curve_constant({ 1.0f, 1.0f, 1.0f, 1.0f });
+    demo_description.atlas_columns      = 8;
+    demo_description.atlas_rows         = 8;
+    demo_description.frame_count        = 64;
+    demo_description.frame_mode         = PARTICLE_FRAME_RANDOM;
+    particle_emitter *demo_emitter = particle_system_add_emitter(&demo_particles,
+            &primary_arena, &demo_description);
+
+    // Pre-activate the program and texture binding. The atlas shares unit 0 on
+    // its own target.
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, base_texture);
+    sprite_atlas_bind(&demo_atlas, 0);
+    opengl_state_use_program(quad_shader.program);
+
+    // L streams the test sheet in again to replace the alternate texture. It's
+    // decoded on a loader thread straight into the staging memory and uploaded
+    // once that's done, the quads using the placeholder until it lands. The sheet
+    // it replaces is kept for the frames in flight which may still draw it.
+    texture_stream texture_streamer = {0};
+    texture_stream_create(&texture_streamer, RUNTIME_TEXTURE_STAGING_SIZE);
+    streamed_texture streamed_sheet = TEXTURE_STREAM_NONE;
+    streamed_texture retired_sheet = TEXTURE_STREAM_NONE;
+    u32 retired_sheet_frames = 0;
+    b32 streamed_sheet_reported = true;
+
+    ccptr sheet_path = "./res/testtex1024x1024.png";
+    std::thread sheet_loader;
+    std::atomic<b32> sheet_decoded(false);
+    b32 sheet_loaded = false;
+    image sheet_image = {0};
+    u64 sheet_request_time = 0;
+
+    // Timings of the frames drawn on this thread, printed along with the delta
+    // time on F. The render thread and the frame graph aren't profiled.
+    frame_profiler profiler;
+    frame_profiler_create(&profiler);
+    profiler_scope profile_update = frame_profiler_scope_create(&profiler, "Update", false);
+    profiler_scope profile_render = frame_profiler_scope_create(&profiler, "Render", true);
+    profiler_scope profile_upload = frame_profiler_scope_create(&profiler, "Quad upload", true);
+    profiler_scope profile_draw = frame_profiler_scope_create(&profiler, "Quad draw", true);
+    profiler_scope profile_swap = frame_profiler_scope_create(&profiler, "Swap", false);
 
     // Runtime loop delta time.
     u64 frequency = system_timestamp_frequency();
@@ -334,7 +825,7 @@ runtime_main(buffer heap)
     r32 frame_interval = 0.0f;
     r32 delta_time = 1.0f / 60.0f; // Default, for first frame.
     
-    char window_title_buffer[100];
+    char window_title_buffer[160];
 
     // Standard runtime loop.
     runtime_flag = true;
@@ -344,6 +835,8 @@ runtime_main(buffer heap)
         // Pre-loop stuff.
         window_process_events();
         if (window_should_close()) break;
+        b32 threaded = render_thread_is_running();
+        if (!threaded) opengl_state_begin_frame();
 
         // Prevents keys sticking when window focus changes.
         if (window_did_focus_change() && !window_is_focused())
@@ -372,14 +865,40 @@ runtime_main(buffer heap)
             frame_interval = 0.0f;
         }
 
-        sprintf_s(window_title_buffer, 100, "Ninetails Game Engine - %.2f FPS - %llu",
-                1.0f / frame_average, quads_rendered);
+        // The render thread reports the statistics of each packet it draws.
+        opengl_state_statistics gl_statistics = render_statistics;
+        if (!threaded) opengl_state_get_statistics(&gl_statistics);
+        if (cull_mode == RUNTIME_CULL_CPU)
+        {
+            sprintf_s(window_title_buffer, 160, "Ninetails Game Engine - %.2f FPS - %llu (%llu visible)"
+                    " - GL %llu issued, %llu elided",
+                    1.0f / frame_average, quads_rendered, demo_culler.visible_count,
+                    gl_statistics.frame_issued_calls, gl_statistics.frame_elided_calls);
+        }
+        else
+        {
+            sprintf_s(window_title_buffer, 160, "Ninetails Game Engine - %.2f FPS - %llu"
+                    " - GL %llu issued, %llu elided",
+                    1.0f / frame_average, quads_rendered,
+                    gl_statistics.frame_issued_calls, gl_statistics.frame_elided_calls);
+        }
+
         window_set_title(window_title_buffer);
 
+        // Handlers touching the falling quads or GL wait for the frames in
+        // flight. The frame simulated last is dropped rather than drawn, its
+        // packet may not match the renderer's modes anymore.
+        if (graph_mode && (runtime_gl_key_pressed() || input_key_is_pressed(NxKeyM)))
+        {
+            frame_graph_wait(&demo_graph);
+            graph_context.first_frame = demo_graph.frame_index;
+        }
+
         if (input_key_is_pressed(NxKeyF))
         {
             
             printf("Deltatime is: %.8f or %.2f frames/second.\n", delta_time, 1.0f / delta_time);
+            frame_profiler_report(&profiler);
 
         }
 
@@ -466,7 +985,376 @@ runtime_main(buffer heap)
             if (quads_rendered <= 0) quads_rendered = 0;
         }
 
-        update_quads_within_range(delta_time, 0, quads_rendered, test_quad_renderer.vertex_buffer);
+        if (input_key_is_pressed(NxKeyP))
+        {
+            particle_mode = !particle_mode;
+            particle_system_clear(&demo_particles);
+        }
+
+        if (input_key_is_pressed(NxKeyC))
+        {
+            compact_mode = !compact_mode;
+            printf("-- Quad instance format: %s\n", compact_mode ? "Compact" : "Standard");
+        }
+
+        if (input_key_is_pressed(NxKeyB))
+        {
+            batch_mode = !batch_mode;
+            printf("-- Sprite batching: %s\n", batch_mode ? "On" : "Off");
+        }
+
+        if (input_key_is_pressed(NxKeyR))
+        {
+            command_mode = !command_mode;
+            printf("-- Render commands: %s\n", command_mode ? "On" : "Off");
+        }
+
+        // The render thread draws the falling quads through recorded commands;
+        // the other modes come back once it's stopped.
+        if (input_key_is_pressed(NxKeyT))
+        {
+            if (threaded)
+            {
+                render_thread_stop();
+            }
+            else
+            {
+                if (graph_mode) frame_graph_wait(&demo_graph);
+                graph_mode = false;
+                render_thread_start(frame_packets, runtime_render_packet, &frame_uniforms);
+            }
+            threaded = render_thread_is_running();
+            printf("-- Render thread: %s\n", threaded ? "On" : "Off");
+        }
+
+        // Graph mode draws the same way as the render thread, which it replaces.
+        if (input_key_is_pressed(NxKeyG))
+        {
+            if (graph_mode)
+            {
+                frame_graph_wait(&demo_graph);
+            }
+            else
+            {
+                render_thread_stop();
+                threaded = false;
+                graph_context.first_frame = demo_graph.frame_index;
+            }
+            graph_mode = !graph_mode;
+            printf("-- Frame graph: %s\n", graph_mode ? "On" : "Off");
+        }
+
+        if (input_key_is_pressed(NxKeyH))
+        {
+            frame_graph_dump(&demo_graph);
+        }
+
+        // The handlers below which need GL get the context back for the frame.
+        b32 resume_render_thread = false;
+        if (threaded && runtime_gl_key_pressed())
+        {
+            render_thread_stop();
+            resume_render_thread = true;
+        }
+
+        if (input_key_is_pressed(NxKeyK))
+        {
+            cull_mode = (runtime_cull_mode)((cull_mode + 1) % RUNTIME_CULL_MODE_COUNT);
+            printf("-- Quad culling: %s\n", runtime_cull_mode_names[cull_mode]);
+        }
+
+        if (input_key_is_pressed(NxKeyV))
+        {
+            quad_draw_path path = (quad_draw_path)((test_quad_renderer.draw_path + 1) % QUAD_DRAW_PATH_COUNT);
+            renderer2d_set_quad_draw_path(&test_quad_renderer, path);
+            renderer2d_set_quad_draw_path(&compact_quad_renderer, path);
+            renderer2d_set_quad_draw_path(&culled_quad_renderer, path);
+            renderer2d_set_quad_draw_path(&demo_batch.quads, path);
+            for (u32 i = 0; i < RENDER_THREAD_PACKETS; ++i)
+                renderer2d_set_quad_draw_path(&frame_packets[i].quads, path);
+            printf("-- Quad draw path: %s\n", renderer2d_quad_draw_path_name(path));
+        }
+
+        if (input_key_is_pressed(NxKeyF1))
+        {
+            benchmark_particles(&primary_arena);
+        }
+
+        if (input_key_is_pressed(NxKeyF2))
+        {
+            benchmark_spatial_grid(&primary_arena);
+        }
+
+        if (input_key_is_pressed(NxKeyF3))
+        {
+            benchmark_sweep_prune(&primary_arena);
+        }
+
+        if (input_key_is_pressed(NxKeyF4))
+        {
+            benchmark_physics2d(&primary_arena);
+        }
+
+        if (input_key_is_pressed(NxKeyE))
+        {
+            benchmark_ecs(&primary_arena);
+        }
+
+        if (input_key_is_pressed(NxKeyF5))
+        {
+            benchmark_quad_upload(&primary_arena, quad_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF6))
+        {
+            benchmark_quad_compact(&primary_arena, quad_shader.program, quad_compact_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF7))
+        {
+            benchmark_quad_draw_path(&primary_arena, quad_shader.program, quad_pull_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF8))
+        {
+            benchmark_quad_dirty(&primary_arena, quad_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF9))
+        {
+            benchmark_sprite_batch(&primary_arena, quad_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF10))
+        {
+            benchmark_quad_cull(&primary_arena, quad_shader.program, quad_cull_program);
+        }
+
+        if (input_key_is_pressed(NxKeyF11))
+        {
+            benchmark_render_commands(&primary_arena, quad_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyF12))
+        {
+            benchmark_quad_raster(&primary_arena, quad_shader.program);
+        }
+
+        if (input_key_is_pressed(NxKeyO))
+        {
+            quad_upload_mode mode = (quad_upload_mode)((test_quad_renderer.upload_mode + 1) % QUAD_UPLOAD_MODE_COUNT);
+            renderer2d_set_quad_upload_mode(&test_quad_renderer, mode);
+            renderer2d_set_quad_upload_mode(&compact_quad_renderer, mode);
+            renderer2d_set_quad_upload_mode(&culled_quad_renderer, mode);
+            for (u32 i = 0; i < RENDER_THREAD_PACKETS; ++i)
+                renderer2d_set_quad_upload_mode(&frame_packets[i].quads, mode);
+            printf("-- Quad upload mode: %s\n", renderer2d_quad_upload_mode_name(mode));
+        }
+
+        if (resume_render_thread)
+            render_thread_start(frame_packets, runtime_render_packet, &frame_uniforms);
+
+        if (input_key_is_pressed(NxKeyL) && !sheet_loader.joinable())
+        {
+
+            u64 sheet_size = file_image_size(sheet_path);
+            vptr staging = (sheet_size > 0) ? texture_stream_map(&texture_streamer, sheet_size) : NULL;
+            if (sheet_size == 0)
+            {
+                printf("-- Streamed sheet couldn't be loaded.\n");
+            }
+            else if (staging == NULL)
+            {
+                printf("-- Texture staging is full, try again in a moment.\n");
+            }
+            else
+            {
+                sheet_decoded = false;
+                sheet_request_time = system_timestamp();
+                sheet_loader = std::thread([&, staging, sheet_size]()
+                {
+                    sheet_loaded = file_image_load(sheet_path, &sheet_image, staging, sheet_size);
+                    sheet_decoded = true;
+                });
+            }
+
+        }
+
+        // The streamer is polled on the frames this thread has the context, it
+        // picks up where it left off once the render thread is stopped.
+        if (!threaded)
+        {
+
+            texture_stream_update(&texture_streamer);
+            if (retired_sheet != TEXTURE_STREAM_NONE && --retired_sheet_frames == 0)
+            {
+                texture_stream_release(&texture_streamer, retired_sheet);
+                retired_sheet = TEXTURE_STREAM_NONE;
+            }
+
+            if (sheet_loader.joinable() && sheet_decoded)
+            {
+
+                sheet_loader.join();
+                streamed_texture sheet = TEXTURE_STREAM_NONE;
+                if (sheet_loaded) sheet = texture_stream_commit(&texture_streamer, &sheet_image);
+                else texture_stream_cancel(&texture_streamer);
+
+                if (sheet != TEXTURE_STREAM_NONE)
+                {
+                    texture_stream_release(&texture_streamer, retired_sheet);
+                    retired_sheet = streamed_sheet;
+                    retired_sheet_frames = RENDER_THREAD_PACKETS + 1;
+                    streamed_sheet = sheet;
+                    streamed_sheet_reported = false;
+                }
+                else
+                {
+                    printf("-- Streamed sheet couldn't be loaded.\n");
+                }
+
+            }
+
+            if (!streamed_sheet_reported && texture_stream_is_resident(&texture_streamer, streamed_sheet))
+            {
+                printf("-- Streamed sheet resident %.2f ms after the request, the upload took %.2f ms;"
+                        " %llu textures, %.2f MB streamed.\n",
+                        system_timestamp_difference_ms(sheet_request_time, system_timestamp()),
+                        texture_streamer.last_upload_milliseconds, texture_streamer.textures_streamed,
+                        texture_streamer.bytes_streamed / (1024.0 * 1024.0));
+                streamed_sheet_reported = true;
+            }
+
+        }
+
+        GLuint sheet_texture = (streamed_sheet != TEXTURE_STREAM_NONE) ?
+            texture_stream_get_texture(&texture_streamer, streamed_sheet) : base_texture_alt;
+
+        if (threaded)
+        {
+
+            // Waits only if the render thread is still on the packet from two
+            // frames ago. The chunks are updated, copied into the packet and
+            // recorded by the workers, and sorted here, so the packet is ready
+            // to submit as is.
+            render_frame_packet *packet = render_thread_acquire_packet();
+            render_statistics = packet->statistics;
+
+            packet->viewport_width = window_get_width();
+            packet->viewport_height = window_get_height();
+            packet->clear_color = { 0.1f, 0.1f, 0.1f, 1.0f };
+            packet->frame_constants.projection = orthographic_rh_no(0.0f, window_get_width(),
+                    0.0f, window_get_height(), -10.0f, 10.0f);
+            packet->frame_constants.camera = translate({ 0.0f, 0.0f, 0.0f });
+            packet->frame_constants.view_projection = packet->frame_constants.projection *
+                packet->frame_constants.camera;
+            packet->instance_count = quads_rendered;
+
+            b32 packet_pulled = (packet->quads.draw_path == QUAD_DRAW_PULLED);
+            runtime_command_context command_context = {0};
+            command_context.delta_time  = delta_time;
+            command_context.quads       = test_quad_renderer.vertex_buffer;
+            command_context.snapshot    = packet->quads.vertex_buffer;
+            command_context.renderer    = &packet->quads;
+            command_context.commands    = &packet->commands;
+            for (u32 i = 0; i < 2; ++i)
+            {
+                command_context.states[i].program   = (packet_pulled) ? quad_pull_shader.program : quad_shader.program;
+                command_context.states[i].texture   = (i == 0) ? base_texture : sheet_texture;
+                command_context.states[i].blend     = RENDER_BLEND_OPAQUE;
+            }
+
+            render_command_buffer_reset(&packet->commands);
+            render_command_upload_quads(&packet->commands, 0, &packet->quads, quads_rendered);
+            jobs_parallel_for(quads_rendered, RUNTIME_COMMAND_CHUNK, update_and_record_quads, &command_context);
+            render_command_buffer_sort(&packet->commands);
+            render_thread_submit_packet(packet);
+
+            // The render thread draws and swaps, only the frame timing is left.
+            u64 frame_end_time = system_timestamp();
+            delta_time = system_timestamp_difference_ss(frame_begin_time, frame_end_time);
+            frame_begin_time = system_timestamp();
+            continue;
+
+        }
+
+        if (graph_mode)
+        {
+
+            // Returns once this frame's submit and swap are done, which drew the
+            // previous frame. This frame's simulate may still be running, the
+            // next execute picks up after it.
+            runtime_graph_frame *frame = graph_context.frames + (demo_graph.frame_index % RENDER_THREAD_PACKETS);
+            frame->delta_time = delta_time;
+            frame->quads = test_quad_renderer.vertex_buffer;
+            frame->instance_count = quads_rendered;
+            frame->sheet_texture = sheet_texture;
+            frame->viewport_width = window_get_width();
+            frame->viewport_height = window_get_height();
+            frame_graph_execute(&demo_graph);
+
+            u64 frame_end_time = system_timestamp();
+            delta_time = system_timestamp_difference_ss(frame_begin_time, frame_end_time);
+            frame_begin_time = system_timestamp();
+            continue;
+
+        }
+
+        frame_profiler_begin_frame(&profiler);
+        frame_profiler_begin(&profiler, profile_update);
+
+        // Batching takes over from the command demo, which takes over from the
+        // compact format and culling.
+        b32 draw_batched = batch_mode && !particle_mode;
+        b32 draw_commands = command_mode && !particle_mode && !draw_batched;
+        b32 draw_pulled = (test_quad_renderer.draw_path == QUAD_DRAW_PULLED);
+
+        i64 instance_count = quads_rendered;
+        if (particle_mode)
+        {
+
+            // Spawn at the rate which keeps roughly quads_rendered alive.
+            r32 average_lifetime = (demo_emitter->description.lifetime_min +
+                    demo_emitter->description.lifetime_max) * 0.5f;
+            demo_emitter->description.spawn_rate = (r32)quads_rendered / average_lifetime;
+            demo_emitter->description.position = { window_get_width() * 0.5f,
+                window_get_height() * 0.5f };
+            demo_emitter->description.spawn_extent = { window_get_width() * 0.5f + 100.0f,
+                window_get_height() * 0.5f + 100.0f };
+
+            // Particles are rebuilt every frame, so they can go straight into
+            // the mapped region when the upload mode allows it.
+            renderer2d_map_quad_render_context(&test_quad_renderer);
+            instance_count = particle_system_update(&demo_particles, delta_time,
+                    &test_quad_renderer, 0);
+
+        }
+        else if (draw_commands)
+        {
+
+            runtime_command_context command_context = {0};
+            command_context.delta_time  = delta_time;
+            command_context.quads       = test_quad_renderer.vertex_buffer;
+            command_context.renderer    = &test_quad_renderer;
+            command_context.commands    = &demo_commands;
+            for (u32 i = 0; i < 2; ++i)
+            {
+                command_context.states[i].program   = (draw_pulled) ? quad_pull_shader.program : quad_shader.program;
+                command_context.states[i].texture   = (i == 0) ? base_texture : sheet_texture;
+                command_context.states[i].blend     = RENDER_BLEND_OPAQUE;
+            }
+
+            render_command_buffer_reset(&demo_commands);
+            render_command_upload_quads(&demo_commands, 0, &test_quad_renderer, quads_rendered);
+            jobs_parallel_for(quads_rendered, RUNTIME_COMMAND_CHUNK, update_and_record_quads, &command_context);
+
+        }
+        else
+        {
+            update_quads_within_range(delta_time, 0, quads_rendered, test_quad_renderer.vertex_buffer);
+        }
+
+        frame_profiler_end(&profiler, profile_update);
 
         // --- Rendering -------------------------------------------------------
         //
@@ -474,28 +1362,145 @@ runtime_main(buffer heap)
         // and fire off the quad renderer routine and clear the state.
         //
 
-        glViewport(0, 0, window_get_width(), window_get_height());
+        frame_profiler_begin(&profiler, profile_render);
+        opengl_state_viewport(0, 0, window_get_width(), window_get_height());
         glClear(GL_COLOR_BUFFER_BIT);
         glClear(GL_DEPTH_BUFFER_BIT);
-        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
-
-        u32 texture_slot = 0;
-        opengl_shader_set_uniform_u32(quad_program, "u_texture_index", &texture_slot, 1);
-
-        mat4 projection = orthographic_rh_no(0.0f, window_get_width(),
+        opengl_state_clear_color(0.1f, 0.1f, 0.1f, 1.0f);
+
+        // Particles are written straight into the standard renderer's mapped
+        // region, so only the falling quads are drawn through the compact path.
+        b32 draw_compact = compact_mode && !particle_mode && !draw_batched && !draw_commands;
+        runtime_quad_shader *shader = (draw_compact) ? &quad_compact_shader : &quad_shader;
+        if (draw_pulled) shader = (draw_compact) ? &quad_compact_pull_shader : &quad_pull_shader;
+        GLuint program = shader->program;
+        opengl_state_use_program(program);
+
+        // The textures are set every frame, the state cache makes it free unless
+        // something (a benchmark) bound others since.
+        opengl_state_bind_texture(0, GL_TEXTURE_2D, base_texture);
+        sprite_atlas_bind(&demo_atlas, 0);
+
+        i32 texture_slot = 0;
+        opengl_program_set_i32(&shader->reflection, shader->texture_index, &texture_slot, 1);
+
+        // The frame's matrices go into the uniform ring in one write, and every
+        // quad program reads them from the same binding. The pulled shaders take
+        // the product, saving a matrix multiply per vertex.
+        quad_frame_constants frame_constants = {0};
+        frame_constants.projection = orthographic_rh_no(0.0f, window_get_width(),
                 0.0f, window_get_height(), 
                 -10.0f, 10.0f);
+        frame_constants.camera = translate({ 0.0f, 0.0f, 0.0f });
+        frame_constants.view_projection = frame_constants.projection * frame_constants.camera;
+
+        uniform_ring_begin_frame(&frame_uniforms);
+        uniform_allocation frame_allocation = uniform_ring_push_value(&frame_uniforms, &frame_constants);
+        uniform_ring_bind(&frame_allocation, QUAD_FRAME_BINDING);
+
+        // Culled quads go straight into the upload for the standard format; the
+        // compact format packs from them, so they stay in cached memory. The GPU
+        // culler draws through the standard instanced shaders, the other formats
+        // and paths fall back to culling on the CPU.
+        vec2 view_min = { 0.0f, 0.0f };
+        vec2 view_max = { (r32)window_get_width(), (r32)window_get_height() };
+        b32 draw_culled = (cull_mode != RUNTIME_CULL_OFF) && !particle_mode && !draw_batched && !draw_commands;
+        b32 draw_gpu_culled = draw_culled && (cull_mode == RUNTIME_CULL_GPU) && !draw_compact && !draw_pulled;
+        quad_layout *frame_quads = test_quad_renderer.vertex_buffer;
+        quad_render_buffer *frame_renderer = &test_quad_renderer;
+        if (draw_culled && !draw_gpu_culled)
+        {
+            quad_layout *visible = (draw_compact) ? culled_quad_renderer.vertex_buffer :
+                renderer2d_map_quad_render_context(&culled_quad_renderer);
+            instance_count = quad_culler_cull(&demo_culler, visible, frame_quads,
+                    instance_count, view_min, view_max);
+            frame_quads = culled_quad_renderer.vertex_buffer;
+            frame_renderer = &culled_quad_renderer;
+        }
 
-        mat4 camera = translate({ 0.0f, 0.0f, 0.0f });
+        if (draw_batched)
+        {
 
-        opengl_shader_set_uniform_mat4(quad_program, "u_projection", &projection, 1);
-        opengl_shader_set_uniform_mat4(quad_program, "u_camera", &camera, 1);
+            // Layers 0 and 1 are opaque and alternate textures, layers 2 and 3 are
+            // alpha blended from one texture with the bigger quads in front.
+            sprite_batch_begin(&demo_batch);
+            for (i64 i = 0; i < instance_count; ++i)
+            {
+                sprite_submission sprite = {0};
+                sprite.quad     = test_quad_renderer.vertex_buffer[i];
+                sprite.layer    = (u32)(i & 3);
+                sprite.blend    = (sprite.layer < 2) ? RENDER_BLEND_OPAQUE : RENDER_BLEND_ALPHA;
+                sprite.texture  = (sprite.layer < 2 && (i & 4)) ? sheet_texture : base_texture;
+                sprite.depth    = 1.0f - sprite.quad.transform.scale.X / 32.0f;
+                sprite_batch_submit(&demo_batch, &sprite);
+            }
+
+            sprite_batch_end(&demo_batch);
+
+            // Put back the state the other paths expect.
+            opengl_state_enable(GL_BLEND);
+            opengl_state_blend_func(GL_ONE, GL_ZERO);
+            opengl_state_bind_texture(0, GL_TEXTURE_2D, base_texture);
+
+        }
+        else if (draw_commands)
+        {
+
+            render_command_buffer_sort(&demo_commands);
+            render_command_buffer_submit(&demo_commands);
+
+            opengl_state_enable(GL_BLEND);
+            opengl_state_blend_func(GL_ONE, GL_ZERO);
+            opengl_state_bind_texture(0, GL_TEXTURE_2D, base_texture);
+
+        }
+        else if (draw_gpu_culled)
+        {
+
+            // The falling quads all move, so all of them are sent every frame.
+            // Scenery would only send the ranges which changed.
+            quad_gpu_culler_update(&demo_gpu_culler, test_quad_renderer.vertex_buffer, 0, instance_count);
+            quad_gpu_culler_cull(&demo_gpu_culler, instance_count, view_min, view_max);
+            opengl_state_use_program(program);
+            quad_gpu_culler_draw(&demo_gpu_culler);
+
+        }
+        else if (draw_compact)
+        {
+            // Half the quads come from each atlas sheet, still in a single draw.
+            quad_compact_layout *compact = renderer2d_map_quad_compact_render_context(&compact_quad_renderer);
+            u64 first_sheet_count = instance_count / 2;
+            renderer2d_quad_compact_pack_layouts(compact, frame_quads,
+                    first_sheet_count, 8, 8, 0);
+            renderer2d_quad_compact_pack_layouts(compact + first_sheet_count,
+                    frame_quads + first_sheet_count,
+                    instance_count - first_sheet_count, 8, 8, 1);
+            renderer2d_render_quad_render_context(&compact_quad_renderer, instance_count);
+        }
+        else
+        {
+
+            // Upload and draw are timed apart, the two sides of the quad path.
+            test_quad_renderer.vertex_buffer_count = 1;
+            frame_profiler_begin(&profiler, profile_upload);
+            renderer2d_upload_quad_render_context(frame_renderer, instance_count);
+            frame_profiler_end(&profiler, profile_upload);
+
+            frame_profiler_begin(&profiler, profile_draw);
+            renderer2d_draw_quad_range(frame_renderer, 0, instance_count);
+            renderer2d_end_quad_render_context(frame_renderer);
+            frame_profiler_end(&profiler, profile_draw);
+
+        }
 
-        test_quad_renderer.vertex_buffer_count = 1;
-        renderer2d_render_quad_render_context(&test_quad_renderer, quads_rendered);
+        uniform_ring_end_frame(&frame_uniforms);
+        frame_profiler_end(&profiler, profile_render);
 
         // Swap the buffers at the end.
+        frame_profiler_begin(&profiler, profile_swap);
         window_swap_buffers();
+        frame_profiler_end(&profiler, profile_swap);
+        frame_profiler_end_frame(&profiler);
 
         // Calculate the next frames delta time.
         u64 frame_end_time = system_timestamp();
@@ -506,7 +1511,13 @@ runtime_main(buffer heap)
         
     }
 
+    frame_graph_delete(&demo_graph);
+    render_thread_stop();
+    frame_profiler_delete(&profiler);
+    if (sheet_loader.joinable()) sheet_loader.join();
+    texture_stream_delete(&texture_streamer);
     window_close();
+    jobs_shutdown();
 
     return 0; // Return zero for success here.
 
@@ -2,9 +2,11 @@
 #define SRC_ENGINE_RUNTIME_H
 #include <core/definitions.h>
 #include <core/arena.h>
+#include <engine/renderers/programcache.h>
 
 b32 runtime_init(buffer heap);
 b32 runtime_main(buffer heap);
 memory_arena* runtime_get_primary_arena();
+program_cache* runtime_get_program_cache();
 
 #endif
@@ -0,0 +1,529 @@
+#include <engine/spatialgrid.h>
+#include <core/jobs.h>
+#include <math.h>
+#include <string.h>
+#include <atomic>
+
+#define SPATIAL_GRID_PAIR_BATCH     1024
+#define SPATIAL_GRID_LOCAL_PAIRS    256
+
+typedef enum spatial_grid_shape
+{
+    SPATIAL_GRID_SHAPE_RECT,
+    SPATIAL_GRID_SHAPE_CIRCLE,
+} spatial_grid_shape;
+
+typedef struct spatial_grid_source
+{
+    r32 *position_x;
+    r32 *position_y;
+    r32 *half_extent;
+    quad_layout *quads;
+} spatial_grid_source;
+
+typedef struct spatial_grid_build_context
+{
+    spatial_grid *grid;
+    spatial_grid_source *source;
+    u64 block_size;
+    r32 block_max_half_extent[SPATIAL_GRID_MAX_BLOCKS];
+} spatial_grid_build_context;
+
+typedef struct spatial_grid_pair_context
+{
+    spatial_grid *grid;
+    spatial_grid_pair *pairs;
+    u64 max_pairs;
+    std::atomic<u64> pair_count;
+} spatial_grid_pair_context;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline i32
+spatial_grid_cell(spatial_grid *grid, r32 value)
+{
+
+    return (i32)floorf(value * grid->inverse_cell_size);
+
+}
+
+static inline u32
+spatial_grid_hash(spatial_grid *grid, i32 cell_x, i32 cell_y)
+{
+
+    u32 hash = ((u32)cell_x * 73856093u) ^ ((u32)cell_y * 19349663u);
+    return hash & grid->bucket_mask;
+
+}
+
+static inline void
+spatial_grid_source_read(spatial_grid_source *source, u64 index, r32 *x, r32 *y, r32 *half_extent)
+{
+
+    if (source->quads != NULL)
+    {
+        quad_layout *quad = source->quads + index;
+        *x = quad->transform.position.X;
+        *y = quad->transform.position.Y;
+        r32 sx = quad->transform.scale.X;
+        r32 sy = quad->transform.scale.Y;
+        *half_extent = 0.5f * ((sx > sy) ? sx : sy);
+    }
+    else
+    {
+        *x = source->position_x[index];
+        *y = source->position_y[index];
+        *half_extent = (source->half_extent != NULL) ? source->half_extent[index] : 0.0f;
+    }
+
+}
+
+// --- Rebuild -----------------------------------------------------------------
+//
+// The counting sort runs in four parallel passes. Each block of entries builds
+// its own bucket histogram, the histograms are summed into bucket totals, the
+// totals are scanned into bucket starts (serially, it is one pass over a flat
+// array), then each bucket hands out a contiguous range to each block in order
+// and the blocks scatter their entries. Because the blocks keep input order
+// within a bucket, the sort is stable.
+//
+
+static void
+spatial_grid_histogram_blocks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    spatial_grid_build_context *context = (spatial_grid_build_context*)user_data;
+    spatial_grid *grid = context->grid;
+
+    for (u64 block = begin; block < end; ++block)
+    {
+
+        u32 *histogram = grid->block_offsets + block * grid->bucket_count;
+        memset(histogram, 0, sizeof(u32) * grid->bucket_count);
+
+        u64 first = block * context->block_size;
+        u64 last = first + context->block_size;
+        if (last > grid->count) last = grid->count;
+
+        r32 max_half_extent = 0.0f;
+        for (u64 i = first; i < last; ++i)
+        {
+
+            r32 x, y, half_extent;
+            spatial_grid_source_read(context->source, i, &x, &y, &half_extent);
+
+            u32 bucket = spatial_grid_hash(grid, spatial_grid_cell(grid, x), spatial_grid_cell(grid, y));
+            grid->entry_bucket[i] = bucket;
+            histogram[bucket]++;
+            max_half_extent = (half_extent > max_half_extent) ? half_extent : max_half_extent;
+
+        }
+
+        context->block_max_half_extent[block] = max_half_extent;
+
+    }
+
+}
+
+static void
+spatial_grid_sum_buckets(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    spatial_grid_build_context *context = (spatial_grid_build_context*)user_data;
+    spatial_grid *grid = context->grid;
+
+    for (u64 bucket = begin; bucket < end; ++bucket)
+    {
+        u32 total = 0;
+        for (u32 block = 0; block < grid->block_count; ++block)
+            total += grid->block_offsets[block * grid->bucket_count + bucket];
+        grid->bucket_start[bucket] = total;
+    }
+
+}
+
+static void
+spatial_grid_assign_block_offsets(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    spatial_grid_build_context *context = (spatial_grid_build_context*)user_data;
+    spatial_grid *grid = context->grid;
+
+    for (u64 bucket = begin; bucket < end; ++bucket)
+    {
+        u32 running = grid->bucket_start[bucket];
+        for (u32 block = 0; block < grid->block_count; ++block)
+        {
+            u32 *slot = grid->block_offsets + block * grid->bucket_count + bucket;
+            u32 count = *slot;
+            *slot = running;
+            running += count;
+        }
+    }
+
+}
+
+static void
+spatial_grid_scatter_blocks(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    spatial_grid_build_context *context = (spatial_grid_build_context*)user_data;
+    spatial_grid *grid = context->grid;
+
+    for (u64 block = begin; block < end; ++block)
+    {
+
+        u32 *cursors = grid->block_offsets + block * grid->bucket_count;
+        u64 first = block * context->block_size;
+        u64 last = first + context->block_size;
+        if (last > grid->count) last = grid->count;
+
+        for (u64 i = first; i < last; ++i)
+        {
+
+            r32 x, y, half_extent;
+            spatial_grid_source_read(context->source, i, &x, &y, &half_extent);
+
+            u32 slot = cursors[grid->entry_bucket[i]]++;
+            grid->sorted_index[slot]        = (u32)i;
+            grid->sorted_x[slot]            = x;
+            grid->sorted_y[slot]            = y;
+            grid->sorted_half_extent[slot]  = half_extent;
+            grid->sorted_cell_x[slot]       = spatial_grid_cell(grid, x);
+            grid->sorted_cell_y[slot]       = spatial_grid_cell(grid, y);
+
+        }
+
+    }
+
+}
+
+static void
+spatial_grid_rebuild_from_source(spatial_grid *grid, spatial_grid_source *source, u64 count)
+{
+
+    NX_ENSURE_POINTER(grid);
+    NX_ASSERT(count <= grid->capacity);
+    if (count > grid->capacity) count = grid->capacity;
+
+    grid->count = count;
+    grid->max_half_extent = 0.0f;
+
+    u32 block_count = jobs_worker_count();
+    if (block_count > SPATIAL_GRID_MAX_BLOCKS) block_count = SPATIAL_GRID_MAX_BLOCKS;
+    if (count < 4096) block_count = 1;
+    grid->block_count = block_count;
+
+    spatial_grid_build_context context = {0};
+    context.grid        = grid;
+    context.source      = source;
+    context.block_size  = (count + block_count - 1) / block_count;
+    if (context.block_size == 0) context.block_size = 1;
+
+    u64 bucket_batch = 4096;
+    jobs_parallel_for(block_count, 1, spatial_grid_histogram_blocks, &context);
+    jobs_parallel_for(grid->bucket_count, bucket_batch, spatial_grid_sum_buckets, &context);
+
+    u32 running = 0;
+    for (u32 bucket = 0; bucket < grid->bucket_count; ++bucket)
+    {
+        u32 total = grid->bucket_start[bucket];
+        grid->bucket_start[bucket] = running;
+        running += total;
+    }
+    grid->bucket_start[grid->bucket_count] = running;
+
+    jobs_parallel_for(grid->bucket_count, bucket_batch, spatial_grid_assign_block_offsets, &context);
+    jobs_parallel_for(block_count, 1, spatial_grid_scatter_blocks, &context);
+
+    for (u32 block = 0; block < block_count; ++block)
+    {
+        r32 block_max = context.block_max_half_extent[block];
+        grid->max_half_extent = (block_max > grid->max_half_extent) ? block_max : grid->max_half_extent;
+    }
+
+}
+
+// --- Spatial Grid ------------------------------------------------------------
+
+void
+spatial_grid_create(spatial_grid *grid, memory_arena *arena, u64 capacity, r32 cell_size)
+{
+
+    NX_ENSURE_POINTER(grid);
+    NX_ENSURE_POINTER(arena);
+    NX_ASSERT(cell_size > 0.0f);
+
+    // Roughly two entries per bucket keeps the table small without making the
+    // buckets long when several cells collide.
+    u32 bucket_count = 1024;
+    while (bucket_count < capacity / 2) bucket_count <<= 1;
+
+    grid->cell_size             = cell_size;
+    grid->inverse_cell_size     = 1.0f / cell_size;
+    grid->max_half_extent       = 0.0f;
+    grid->bucket_count          = bucket_count;
+    grid->bucket_mask           = bucket_count - 1;
+    grid->block_count           = 1;
+    grid->capacity              = capacity;
+    grid->count                 = 0;
+
+    grid->bucket_start          = memory_arena_push_array(arena, u32, bucket_count + 1);
+    grid->block_offsets         = memory_arena_push_array(arena, u32, (u64)bucket_count * SPATIAL_GRID_MAX_BLOCKS);
+    grid->entry_bucket          = memory_arena_push_array(arena, u32, capacity);
+    grid->sorted_index          = memory_arena_push_array(arena, u32, capacity);
+    grid->sorted_x              = memory_arena_push_array(arena, r32, capacity);
+    grid->sorted_y              = memory_arena_push_array(arena, r32, capacity);
+    grid->sorted_half_extent    = memory_arena_push_array(arena, r32, capacity);
+    grid->sorted_cell_x         = memory_arena_push_array(arena, i32, capacity);
+    grid->sorted_cell_y         = memory_arena_push_array(arena, i32, capacity);
+
+    memset(grid->bucket_start, 0, sizeof(u32) * (bucket_count + 1));
+
+}
+
+void
+spatial_grid_rebuild(spatial_grid *grid, r32 *position_x, r32 *position_y,
+        r32 *half_extent, u64 count)
+{
+
+    NX_ENSURE_POINTER(position_x);
+    NX_ENSURE_POINTER(position_y);
+
+    spatial_grid_source source = {0};
+    source.position_x   = position_x;
+    source.position_y   = position_y;
+    source.half_extent  = half_extent;
+    spatial_grid_rebuild_from_source(grid, &source, count);
+
+}
+
+void
+spatial_grid_rebuild_from_quads(spatial_grid *grid, quad_layout *quads, u64 count)
+{
+
+    NX_ENSURE_POINTER(quads);
+
+    spatial_grid_source source = {0};
+    source.quads = quads;
+    spatial_grid_rebuild_from_source(grid, &source, count);
+
+}
+
+// --- Queries -----------------------------------------------------------------
+
+static inline b32
+spatial_grid_entry_overlaps(spatial_grid *grid, u64 slot, spatial_grid_shape shape,
+        vec2 min, vec2 max, vec2 center, r32 radius_squared)
+{
+
+    r32 x = grid->sorted_x[slot];
+    r32 y = grid->sorted_y[slot];
+    r32 h = grid->sorted_half_extent[slot];
+
+    if (shape == SPATIAL_GRID_SHAPE_RECT)
+    {
+        return (x + h >= min.X) && (x - h <= max.X) && (y + h >= min.Y) && (y - h <= max.Y);
+    }
+
+    // Closest point on the entry square to the circle center.
+    r32 cx = center.X < x - h ? x - h : (center.X > x + h ? x + h : center.X);
+    r32 cy = center.Y < y - h ? y - h : (center.Y > y + h ? y + h : center.Y);
+    r32 dx = center.X - cx;
+    r32 dy = center.Y - cy;
+    return (dx * dx + dy * dy) <= radius_squared;
+
+}
+
+static u64
+spatial_grid_query_shape(spatial_grid *grid, spatial_grid_shape shape, vec2 min, vec2 max,
+        vec2 center, r32 radius, u32 *results, u64 max_results)
+{
+
+    NX_ENSURE_POINTER(grid);
+
+    r32 radius_squared = radius * radius;
+    r32 reach = grid->max_half_extent;
+    i32 cell_x0 = spatial_grid_cell(grid, min.X - reach);
+    i32 cell_y0 = spatial_grid_cell(grid, min.Y - reach);
+    i32 cell_x1 = spatial_grid_cell(grid, max.X + reach);
+    i32 cell_y1 = spatial_grid_cell(grid, max.Y + reach);
+
+    u64 hits = 0;
+
+    // A query spanning more cells than there are buckets is cheaper as a flat
+    // scan over every entry.
+    r64 cell_span = ((r64)cell_x1 - cell_x0 + 1) * ((r64)cell_y1 - cell_y0 + 1);
+    if (cell_span >= (r64)grid->bucket_count)
+    {
+        for (u64 slot = 0; slot < grid->count; ++slot)
+        {
+            if (!spatial_grid_entry_overlaps(grid, slot, shape, min, max, center, radius_squared))
+                continue;
+            if (hits < max_results) results[hits] = grid->sorted_index[slot];
+            hits++;
+        }
+        return hits;
+    }
+
+    for (i32 cell_y = cell_y0; cell_y <= cell_y1; ++cell_y)
+    {
+        for (i32 cell_x = cell_x0; cell_x <= cell_x1; ++cell_x)
+        {
+
+            u32 bucket = spatial_grid_hash(grid, cell_x, cell_y);
+            u32 first = grid->bucket_start[bucket];
+            u32 last = grid->bucket_start[bucket + 1];
+
+            for (u32 slot = first; slot < last; ++slot)
+            {
+
+                // Other cells may hash into this bucket; only take entries that
+                // really live in this cell so no entry is reported twice.
+                if (grid->sorted_cell_x[slot] != cell_x || grid->sorted_cell_y[slot] != cell_y)
+                    continue;
+
+                if (!spatial_grid_entry_overlaps(grid, slot, shape, min, max, center, radius_squared))
+                    continue;
+
+                if (hits < max_results) results[hits] = grid->sorted_index[slot];
+                hits++;
+
+            }
+
+        }
+    }
+
+    return hits;
+
+}
+
+u64
+spatial_grid_query_point(spatial_grid *grid, vec2 point, u32 *results, u64 max_results)
+{
+
+    return spatial_grid_query_shape(grid, SPATIAL_GRID_SHAPE_RECT, point, point,
+            point, 0.0f, results, max_results);
+
+}
+
+u64
+spatial_grid_query_rect(spatial_grid *grid, vec2 min, vec2 max, u32 *results, u64 max_results)
+{
+
+    return spatial_grid_query_shape(grid, SPATIAL_GRID_SHAPE_RECT, min, max,
+            min, 0.0f, results, max_results);
+
+}
+
+u64
+spatial_grid_query_circle(spatial_grid *grid, vec2 center, r32 radius, u32 *results, u64 max_results)
+{
+
+    vec2 min = { center.X - radius, center.Y - radius };
+    vec2 max = { center.X + radius, center.Y + radius };
+    return spatial_grid_query_shape(grid, SPATIAL_GRID_SHAPE_CIRCLE, min, max,
+            center, radius, results, max_results);
+
+}
+
+// --- Pairs -------------------------------------------------------------------
+
+static inline void
+spatial_grid_flush_pairs(spatial_grid_pair_context *context, spatial_grid_pair *local, u32 count)
+{
+
+    u64 offset = context->pair_count.fetch_add(count, std::memory_order_relaxed);
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (offset + i < context->max_pairs) context->pairs[offset + i] = local[i];
+    }
+
+}
+
+static void
+spatial_grid_find_pairs_range(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    spatial_grid_pair_context *context = (spatial_grid_pair_context*)user_data;
+    spatial_grid *grid = context->grid;
+
+    spatial_grid_pair local[SPATIAL_GRID_LOCAL_PAIRS];
+    u32 local_count = 0;
+
+    for (u64 slot = begin; slot < end; ++slot)
+    {
+
+        u32 index = grid->sorted_index[slot];
+        r32 x = grid->sorted_x[slot];
+        r32 y = grid->sorted_y[slot];
+        r32 h = grid->sorted_half_extent[slot];
+        r32 reach = h + grid->max_half_extent;
+
+        i32 cell_x0 = spatial_grid_cell(grid, x - reach);
+        i32 cell_y0 = spatial_grid_cell(grid, y - reach);
+        i32 cell_x1 = spatial_grid_cell(grid, x + reach);
+        i32 cell_y1 = spatial_grid_cell(grid, y + reach);
+
+        for (i32 cell_y = cell_y0; cell_y <= cell_y1; ++cell_y)
+        {
+            for (i32 cell_x = cell_x0; cell_x <= cell_x1; ++cell_x)
+            {
+
+                u32 bucket = spatial_grid_hash(grid, cell_x, cell_y);
+                u32 first = grid->bucket_start[bucket];
+                u32 last = grid->bucket_start[bucket + 1];
+
+                for (u32 other = first; other < last; ++other)
+                {
+
+                    u32 other_index = grid->sorted_index[other];
+                    if (other_index <= index) continue;
+                    if (grid->sorted_cell_x[other] != cell_x || grid->sorted_cell_y[other] != cell_y)
+                        continue;
+
+                    r32 ox = grid->sorted_x[other];
+                    r32 oy = grid->sorted_y[other];
+
+                    r32 extent = h + grid->sorted_half_extent[other];
+                    r32 dx = ox - x;
+                    r32 dy = oy - y;
+                    if (dx > extent || dx < -extent || dy > extent || dy < -extent)
+                        continue;
+
+                    local[local_count].a = index;
+                    local[local_count].b = other_index;
+                    if (++local_count == SPATIAL_GRID_LOCAL_PAIRS)
+                    {
+                        spatial_grid_flush_pairs(context, local, local_count);
+                        local_count = 0;
+                    }
+
+                }
+
+            }
+        }
+
+    }
+
+    if (local_count > 0) spatial_grid_flush_pairs(context, local, local_count);
+
+}
+
+u64
+spatial_grid_find_pairs(spatial_grid *grid, spatial_grid_pair *pairs, u64 max_pairs)
+{
+
+    NX_ENSURE_POINTER(grid);
+
+    spatial_grid_pair_context context;
+    context.grid        = grid;
+    context.pairs       = pairs;
+    context.max_pairs   = max_pairs;
+    context.pair_count.store(0, std::memory_order_relaxed);
+
+    jobs_parallel_for(grid->count, SPATIAL_GRID_PAIR_BATCH, spatial_grid_find_pairs_range, &context);
+
+    return context.pair_count.load(std::memory_order_relaxed);
+
+}
@@ -0,0 +1,74 @@
+#ifndef SRC_ENGINE_SPATIALGRID_H
+#define SRC_ENGINE_SPATIALGRID_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Spatial Hash Grid -------------------------------------------------------
+//
+// A uniform 2D grid hashed into a fixed number of buckets, so the world does not
+// need to be bounded. The grid is meant to be thrown away and rebuilt from the
+// current positions every frame rather than incrementally updated; a rebuild is a
+// parallel counting sort of the entries by bucket, after which every bucket is a
+// contiguous run of entries. Positions and extents are copied into the sorted
+// order so that queries only ever touch sequential memory.
+//
+// Entries are axis-aligned squares given by a center and a half extent (zero for
+// points). Each entry is inserted once, into the cell containing its center, and
+// queries widen their search by the largest half extent seen during the rebuild.
+// Keep the cell size around the size of a typical entry; very large entries make
+// every query search more cells.
+//
+// Queries write the original entry indices to a caller provided list and return
+// the number of hits. If there are more hits than the list can hold, the return
+// value is still the total so the caller can detect truncation. Pair enumeration
+// reports every overlapping pair once, with a < b, in no particular order since
+// it runs across the job system.
+//
+
+#define SPATIAL_GRID_MAX_BLOCKS 16
+
+typedef struct spatial_grid_pair
+{
+    u32 a;
+    u32 b;
+} spatial_grid_pair;
+
+typedef struct spatial_grid
+{
+
+    r32 cell_size;
+    r32 inverse_cell_size;
+    r32 max_half_extent;
+    u32 bucket_count;
+    u32 bucket_mask;
+    u32 block_count;
+
+    u64 capacity;
+    u64 count;
+
+    u32 *bucket_start;          // Prefix sums, bucket_count + 1 entries.
+    u32 *block_offsets;         // Per-block scatter cursors, block_count * bucket_count.
+    u32 *entry_bucket;          // Bucket of each entry, in input order.
+
+    u32 *sorted_index;          // Original index of each entry, in bucket order.
+    r32 *sorted_x;
+    r32 *sorted_y;
+    r32 *sorted_half_extent;
+    i32 *sorted_cell_x;         // Cell of each entry, to reject bucket collisions.
+    i32 *sorted_cell_y;
+
+} spatial_grid;
+
+void    spatial_grid_create(spatial_grid *grid, memory_arena *arena, u64 capacity, r32 cell_size);
+void    spatial_grid_rebuild(spatial_grid *grid, r32 *position_x, r32 *position_y,
+            r32 *half_extent, u64 count);
+void    spatial_grid_rebuild_from_quads(spatial_grid *grid, quad_layout *quads, u64 count);
+
+u64     spatial_grid_query_point(spatial_grid *grid, vec2 point, u32 *results, u64 max_results);
+u64     spatial_grid_query_rect(spatial_grid *grid, vec2 min, vec2 max, u32 *results, u64 max_results);
+u64     spatial_grid_query_circle(spatial_grid *grid, vec2 center, r32 radius, u32 *results, u64 max_results);
+u64     spatial_grid_find_pairs(spatial_grid *grid, spatial_grid_pair *pairs, u64 max_pairs);
+
+#endif
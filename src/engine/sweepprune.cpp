@@ -0,0 +1,362 @@
+#include <engine/sweepprune.h>
+#include <immintrin.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+
+#define SWEEP_PRUNE_PADDING         8
+#define SWEEP_PRUNE_DEAD_BODY       0xFFFFFFFF
+#define SWEEP_PRUNE_LOCAL_PAIRS     512
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline void
+sweep_prune_write_slot(sweep_prune *sap, u32 slot, r32 min_x, r32 min_y, r32 max_x, r32 max_y, u32 body)
+{
+
+    sap->sorted_min_x[slot] = min_x;
+    sap->sorted_min_y[slot] = min_y;
+    sap->sorted_max_x[slot] = max_x;
+    sap->sorted_max_y[slot] = max_y;
+    sap->sorted_body[slot]  = body;
+    if (body != SWEEP_PRUNE_DEAD_BODY) sap->body_slot[body] = slot;
+
+}
+
+static void
+sweep_prune_full_sort(sweep_prune *sap)
+{
+
+    u32 count = sap->count;
+    u32 *order = sap->sort_scratch;
+    for (u32 i = 0; i < count; ++i) order[i] = i;
+
+    r32 *keys = sap->sorted_min_x;
+    std::sort(order, order + count, [keys](u32 a, u32 b) { return keys[a] < keys[b]; });
+
+    // Permute every column through the scratch buffer that sits after order.
+    u32 *scratch = sap->sort_scratch + sap->capacity;
+    r32 *columns[4] = { sap->sorted_min_x, sap->sorted_min_y, sap->sorted_max_x, sap->sorted_max_y };
+    for (u32 c = 0; c < 4; ++c)
+    {
+        r32 *column = columns[c];
+        r32 *permuted = (r32*)scratch;
+        for (u32 i = 0; i < count; ++i) permuted[i] = column[order[i]];
+        memcpy(column, permuted, sizeof(r32) * count);
+    }
+
+    for (u32 i = 0; i < count; ++i) scratch[i] = sap->sorted_body[order[i]];
+    memcpy(sap->sorted_body, scratch, sizeof(u32) * count);
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        u32 body = sap->sorted_body[i];
+        if (body != SWEEP_PRUNE_DEAD_BODY) sap->body_slot[body] = i;
+    }
+
+}
+
+// Parks a body's slot at +inf to be swept off the end at the next sort.
+static inline void
+sweep_prune_kill_body(sweep_prune *sap, u32 body)
+{
+
+    u32 slot = sap->body_slot[body];
+    sweep_prune_write_slot(sap, slot, INFINITY, INFINITY, INFINITY, INFINITY, SWEEP_PRUNE_DEAD_BODY);
+    sap->body_slot[body] = SWEEP_PRUNE_DEAD_BODY;
+    sap->removed_count++;
+
+}
+
+static inline void
+sweep_prune_insert_body(sweep_prune *sap, u32 body, vec2 min, vec2 max)
+{
+
+    // Reclaim the slots of removed bodies before giving up on space.
+    if (sap->count >= sap->capacity && sap->removed_count > 0) sweep_prune_sort(sap);
+    NX_ASSERT(sap->count < sap->capacity);
+    sweep_prune_write_slot(sap, sap->count++, min.X, min.Y, max.X, max.Y, body);
+
+}
+
+// --- Sweep and Prune ---------------------------------------------------------
+
+void
+sweep_prune_create(sweep_prune *sap, memory_arena *arena, u32 capacity)
+{
+
+    NX_ENSURE_POINTER(sap);
+    NX_ENSURE_POINTER(arena);
+
+    memset(sap, 0, sizeof(sweep_prune));
+    sap->capacity = capacity;
+
+    u32 padded = capacity + SWEEP_PRUNE_PADDING;
+    sap->sorted_min_x   = memory_arena_push_array(arena, r32, padded);
+    sap->sorted_max_x   = memory_arena_push_array(arena, r32, padded);
+    sap->sorted_min_y   = memory_arena_push_array(arena, r32, padded);
+    sap->sorted_max_y   = memory_arena_push_array(arena, r32, padded);
+    sap->sorted_body    = memory_arena_push_array(arena, u32, padded);
+    sap->body_slot      = memory_arena_push_array(arena, u32, capacity);
+    sap->free_bodies    = memory_arena_push_array(arena, u32, capacity);
+    sap->sort_scratch   = memory_arena_push_array(arena, u32, (u64)capacity * 2);
+
+    // Empty slots sort last and never pass the sweep's overlap test.
+    for (u32 i = 0; i < padded; ++i)
+        sweep_prune_write_slot(sap, i, INFINITY, INFINITY, INFINITY, INFINITY, SWEEP_PRUNE_DEAD_BODY);
+
+}
+
+u32
+sweep_prune_insert(sweep_prune *sap, vec2 min, vec2 max)
+{
+
+    NX_ENSURE_POINTER(sap);
+
+    if (sap->count >= sap->capacity && sap->removed_count > 0) sweep_prune_sort(sap);
+    NX_ASSERT(sap->count < sap->capacity);
+    if (sap->count >= sap->capacity) return SWEEP_PRUNE_DEAD_BODY;
+
+    u32 body;
+    if (sap->free_count > 0) body = sap->free_bodies[--sap->free_count];
+    else body = sap->body_high_water++;
+
+    sweep_prune_insert_body(sap, body, min, max);
+    return body;
+
+}
+
+void
+sweep_prune_remove(sweep_prune *sap, u32 body)
+{
+
+    NX_ENSURE_POINTER(sap);
+    NX_ASSERT(body < sap->body_high_water);
+    NX_ASSERT(sap->body_slot[body] != SWEEP_PRUNE_DEAD_BODY);
+
+    sweep_prune_kill_body(sap, body);
+    sap->free_bodies[sap->free_count++] = body;
+
+}
+
+void
+sweep_prune_update(sweep_prune *sap, u32 body, vec2 min, vec2 max)
+{
+
+    NX_ENSURE_POINTER(sap);
+    NX_ASSERT(body < sap->body_high_water);
+    NX_ASSERT(sap->body_slot[body] != SWEEP_PRUNE_DEAD_BODY);
+
+    u32 slot = sap->body_slot[body];
+    sap->sorted_min_x[slot] = min.X;
+    sap->sorted_min_y[slot] = min.Y;
+    sap->sorted_max_x[slot] = max.X;
+    sap->sorted_max_y[slot] = max.Y;
+
+}
+
+void
+sweep_prune_update_from_quads(sweep_prune *sap, quad_layout *quads, u32 count)
+{
+
+    NX_ENSURE_POINTER(sap);
+    NX_ENSURE_POINTER(quads);
+
+    // Bodies past the last quad go with it. Their handles are given up too, so
+    // growing again hands out the same ones.
+    if (count < sap->body_high_water)
+    {
+
+        for (u32 body = count; body < sap->body_high_water; ++body)
+        {
+            if (sap->body_slot[body] != SWEEP_PRUNE_DEAD_BODY) sweep_prune_kill_body(sap, body);
+        }
+
+        u32 kept = 0;
+        for (u32 i = 0; i < sap->free_count; ++i)
+        {
+            if (sap->free_bodies[i] < count) sap->free_bodies[kept++] = sap->free_bodies[i];
+        }
+
+        sap->free_count = kept;
+        sap->body_high_water = count;
+
+    }
+
+    // Bodies [0, count) mirror the quads one to one, missing ones are inserted.
+    // Ones removed by hand stay removed until their handle is inserted again.
+    for (u32 i = 0; i < count; ++i)
+    {
+
+        quad_layout *quad = quads + i;
+        r32 hx = quad->transform.scale.X * 0.5f;
+        r32 hy = quad->transform.scale.Y * 0.5f;
+        vec2 min = { quad->transform.position.X - hx, quad->transform.position.Y - hy };
+        vec2 max = { quad->transform.position.X + hx, quad->transform.position.Y + hy };
+
+        if (i >= sap->body_high_water)
+        {
+            sap->body_high_water = i + 1;
+            sweep_prune_insert_body(sap, i, min, max);
+        }
+        else if (sap->body_slot[i] != SWEEP_PRUNE_DEAD_BODY)
+        {
+            sweep_prune_update(sap, i, min, max);
+        }
+
+    }
+
+}
+
+void
+sweep_prune_sort(sweep_prune *sap)
+{
+
+    NX_ENSURE_POINTER(sap);
+
+    r32 *min_x = sap->sorted_min_x;
+    r32 *min_y = sap->sorted_min_y;
+    r32 *max_x = sap->sorted_max_x;
+    r32 *max_y = sap->sorted_max_y;
+    u32 *bodies = sap->sorted_body;
+
+    // Insertion sort with a budget on the number of shifts; past that the order
+    // is not coherent enough to be worth it and a full sort is cheaper.
+    u64 shift_budget = (u64)sap->count * 8 + 1024;
+    u64 shifts = 0;
+    b32 full_sort = false;
+
+    for (u32 i = 1; i < sap->count; ++i)
+    {
+
+        r32 key = min_x[i];
+        if (min_x[i - 1] <= key) continue;
+
+        r32 key_min_y = min_y[i];
+        r32 key_max_x = max_x[i];
+        r32 key_max_y = max_y[i];
+        u32 key_body = bodies[i];
+
+        u32 j = i;
+        while (j > 0 && min_x[j - 1] > key)
+        {
+            sweep_prune_write_slot(sap, j, min_x[j - 1], min_y[j - 1], max_x[j - 1], max_y[j - 1], bodies[j - 1]);
+            --j;
+            ++shifts;
+        }
+
+        sweep_prune_write_slot(sap, j, key, key_min_y, key_max_x, key_max_y, key_body);
+
+        if (shifts > shift_budget)
+        {
+            full_sort = true;
+            break;
+        }
+
+    }
+
+    if (full_sort) sweep_prune_full_sort(sap);
+
+    // Removed bodies are now all at the end, drop them.
+    sap->count -= sap->removed_count;
+    sap->removed_count = 0;
+
+    sap->last_shift_count = shifts;
+    sap->last_full_sort = full_sort;
+
+}
+
+static inline sweep_prune_pair*
+sweep_prune_flush_pairs(memory_arena *arena, sweep_prune_pair *local, u32 count,
+        sweep_prune_pair *first, u64 total)
+{
+
+    sweep_prune_pair *destination = memory_arena_push_array(arena, sweep_prune_pair, count);
+    NX_ASSERT(first == NULL || destination == first + total); // Something else pushed to the arena.
+    memcpy(destination, local, sizeof(sweep_prune_pair) * count);
+    return (first == NULL) ? destination : first;
+
+}
+
+u64
+sweep_prune_find_pairs(sweep_prune *sap, memory_arena *arena, sweep_prune_pair **pairs)
+{
+
+    NX_ENSURE_POINTER(sap);
+    NX_ENSURE_POINTER(arena);
+    NX_ENSURE_POINTER(pairs);
+
+    sweep_prune_sort(sap);
+
+    r32 *min_x = sap->sorted_min_x;
+    r32 *min_y = sap->sorted_min_y;
+    r32 *max_x = sap->sorted_max_x;
+    r32 *max_y = sap->sorted_max_y;
+    u32 *bodies = sap->sorted_body;
+
+    sweep_prune_pair local[SWEEP_PRUNE_LOCAL_PAIRS];
+    u32 local_count = 0;
+    sweep_prune_pair *first = NULL;
+    u64 total = 0;
+
+    for (u32 i = 0; i < sap->count; ++i)
+    {
+
+        __m256 extent_max_x = _mm256_set1_ps(max_x[i]);
+        __m256 extent_min_y = _mm256_set1_ps(min_y[i]);
+        __m256 extent_max_y = _mm256_set1_ps(max_y[i]);
+        u32 body = bodies[i];
+
+        // The padding guarantees eight readable slots past the last body, and
+        // padding slots fail the x test so the loop always terminates.
+        for (u32 j = i + 1; ; j += 8)
+        {
+
+            __m256 candidate_min_x = _mm256_loadu_ps(min_x + j);
+            __m256 candidate_min_y = _mm256_loadu_ps(min_y + j);
+            __m256 candidate_max_y = _mm256_loadu_ps(max_y + j);
+
+            __m256 overlap_x = _mm256_cmp_ps(candidate_min_x, extent_max_x, _CMP_LE_OQ);
+            u32 mask_x = (u32)_mm256_movemask_ps(overlap_x);
+            if (mask_x == 0) break;
+
+            __m256 overlap_y = _mm256_and_ps(
+                    _mm256_cmp_ps(candidate_min_y, extent_max_y, _CMP_LE_OQ),
+                    _mm256_cmp_ps(candidate_max_y, extent_min_y, _CMP_GE_OQ));
+            u32 mask = (u32)_mm256_movemask_ps(_mm256_and_ps(overlap_x, overlap_y));
+
+            while (mask != 0)
+            {
+
+                u32 lane = _tzcnt_u32(mask);
+                mask &= mask - 1;
+
+                u32 other = bodies[j + lane];
+                local[local_count].a = (body < other) ? body : other;
+                local[local_count].b = (body < other) ? other : body;
+                if (++local_count == SWEEP_PRUNE_LOCAL_PAIRS)
+                {
+                    first = sweep_prune_flush_pairs(arena, local, local_count, first, total);
+                    total += local_count;
+                    local_count = 0;
+                }
+
+            }
+
+            // Sorted by min x, so once a lane fails every later slot fails too.
+            if (mask_x != 0xFF) break;
+
+        }
+
+    }
+
+    if (local_count > 0)
+    {
+        first = sweep_prune_flush_pairs(arena, local, local_count, first, total);
+        total += local_count;
+    }
+
+    *pairs = first;
+    return total;
+
+}
@@ -0,0 +1,70 @@
+#ifndef SRC_ENGINE_SWEEPPRUNE_H
+#define SRC_ENGINE_SWEEPPRUNE_H
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <engine/renderers/quad2d.h>
+
+// --- Sweep and Prune Broadphase ----------------------------------------------
+//
+// An incremental sort-and-sweep broadphase for 2D bounding boxes. The boxes are
+// kept sorted along the x-axis in structure-of-arrays form, and every body knows
+// which slot of the sorted arrays it currently occupies, so moving a body is a
+// plain store. Before each sweep the arrays are re-sorted with an insertion sort;
+// bodies rarely move far between frames, so this is close to linear. If the
+// order has changed too much (a large batch of inserts, a teleport) the sort
+// gives up and falls back to a full sort.
+//
+// The sweep walks the sorted arrays and, for each box, tests the following boxes
+// eight at a time with AVX2 until their minimum x passes its maximum x. Unlike a
+// uniform grid this does not care about the spread of sizes, which makes it a
+// good fit for many moving sprites of mixed scales.
+//
+// Update from quads keeps bodies [0, count) in step with a quad array, inserting
+// the ones past the end and removing the ones past a count that shrank; bodies
+// removed by hand within the range are left out. Don't mix it with insert.
+//
+// Pairs are pushed into the provided arena as one contiguous array, so nothing
+// else may push to that arena during the sweep. Pairs report body handles with
+// a < b.
+//
+
+typedef struct sweep_prune_pair
+{
+    u32 a;
+    u32 b;
+} sweep_prune_pair;
+
+typedef struct sweep_prune
+{
+
+    u32 capacity;
+    u32 count;                  // Occupied slots, including removed bodies not yet swept out.
+    u32 removed_count;
+    u32 free_count;
+    u32 body_high_water;
+
+    r32 *sorted_min_x;          // Sorted by min_x, padded with +inf for the SIMD sweep.
+    r32 *sorted_max_x;
+    r32 *sorted_min_y;
+    r32 *sorted_max_y;
+    u32 *sorted_body;           // Body handle occupying each slot.
+
+    u32 *body_slot;             // Slot of each body handle.
+    u32 *free_bodies;
+    u32 *sort_scratch;
+
+    u64 last_shift_count;       // Statistics from the last sort.
+    b32 last_full_sort;
+
+} sweep_prune;
+
+void                sweep_prune_create(sweep_prune *sap, memory_arena *arena, u32 capacity);
+u32                 sweep_prune_insert(sweep_prune *sap, vec2 min, vec2 max);
+void                sweep_prune_remove(sweep_prune *sap, u32 body);
+void                sweep_prune_update(sweep_prune *sap, u32 body, vec2 min, vec2 max);
+void                sweep_prune_update_from_quads(sweep_prune *sap, quad_layout *quads, u32 count);
+void                sweep_prune_sort(sweep_prune *sap);
+u64                 sweep_prune_find_pairs(sweep_prune *sap, memory_arena *arena, sweep_prune_pair **pairs);
+
+#endif
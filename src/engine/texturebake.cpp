@@ -0,0 +1,822 @@
+#include <engine/texturebake.h>
+#include <core/jobs.h>
+#include <immintrin.h>
+#include <string.h>
+#include <math.h>
+
+#define TEXTURE_BAKE_ALIGNMENT          16
+#define TEXTURE_BAKE_DOWNSAMPLE_ROWS    16      // Rows of the smaller level per job.
+#define TEXTURE_BAKE_ENCODE_ROWS        4       // Block rows per job.
+
+static ccptr texture_bake_format_names[TEXTURE_BAKE_FORMAT_COUNT] =
+{
+    "RGBA8",
+    "BC1",
+    "BC3",
+    "BC7",
+};
+
+// BC7 interpolation weights for 4 bit indices, out of 64.
+static const u32 texture_bake_bc7_weights[16] =
+{
+    0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64
+};
+
+typedef struct texture_bake_downsample_context
+{
+    image *source;
+    image *destination;
+} texture_bake_downsample_context;
+
+typedef struct texture_bake_encode_context
+{
+    image *source;
+    texture_bake_format format;
+    u8 *output;
+    u32 blocks_x;
+    u32 block_size;
+} texture_bake_encode_context;
+
+typedef struct texture_bake_bits
+{
+    u64 words[2];
+    u32 position;
+} texture_bake_bits;
+
+// --- Helpers -----------------------------------------------------------------
+
+static inline u64
+texture_bake_align(u64 value, u64 alignment)
+{
+
+    return (value + alignment - 1) / alignment * alignment;
+
+}
+
+static inline u32
+texture_bake_half(u32 dimension)
+{
+
+    return (dimension > 1) ? dimension / 2 : 1;
+
+}
+
+static inline i32
+texture_bake_clamp_byte(r32 value)
+{
+
+    i32 rounded = (i32)(value + 0.5f);
+    if (rounded < 0) return 0;
+    if (rounded > 255) return 255;
+    return rounded;
+
+}
+
+static inline void
+texture_bake_put_bits(texture_bake_bits *bits, u32 value, u32 count)
+{
+
+    for (u32 i = 0; i < count; ++i, ++bits->position)
+    {
+        if ((value >> i) & 1) bits->words[bits->position >> 6] |= 1ULL << (bits->position & 63);
+    }
+
+}
+
+// Blocks hanging over the edge of the level repeat its last row and column.
+static void
+texture_bake_fetch_block(image *source, u32 block_x, u32 block_y, u8 texels[16][4])
+{
+
+    for (u32 y = 0; y < 4; ++y)
+    {
+
+        u32 source_y = block_y * 4 + y;
+        if (source_y >= source->height) source_y = source->height - 1;
+        u8 *row = (u8*)source->buffer + (u64)source_y * source->pitch;
+
+        for (u32 x = 0; x < 4; ++x)
+        {
+            u32 source_x = block_x * 4 + x;
+            if (source_x >= source->width) source_x = source->width - 1;
+            memcpy(texels[y * 4 + x], row + source_x * 4, 4);
+        }
+
+    }
+
+}
+
+// The direction the block's colours spread along, by power iteration on their
+// covariance, starting from the channel which varies the most. A flat block
+// leaves the axis at zero.
+static void
+texture_bake_principal_axis(u8 texels[16][4], u32 channels, r32 mean[4], r32 axis[4])
+{
+
+    for (u32 c = 0; c < 4; ++c)
+    {
+        mean[c] = 0.0f;
+        axis[c] = 0.0f;
+    }
+
+    for (u32 i = 0; i < 16; ++i)
+    {
+        for (u32 c = 0; c < channels; ++c) mean[c] += texels[i][c];
+    }
+    for (u32 c = 0; c < channels; ++c) mean[c] /= 16.0f;
+
+    r32 covariance[4][4] = {0};
+    for (u32 i = 0; i < 16; ++i)
+    {
+        r32 delta[4] = {0};
+        for (u32 c = 0; c < channels; ++c) delta[c] = texels[i][c] - mean[c];
+        for (u32 row = 0; row < channels; ++row)
+        {
+            for (u32 column = 0; column < channels; ++column)
+                covariance[row][column] += delta[row] * delta[column];
+        }
+    }
+
+    u32 widest = 0;
+    for (u32 c = 1; c < channels; ++c)
+    {
+        if (covariance[c][c] > covariance[widest][widest]) widest = c;
+    }
+    if (covariance[widest][widest] < 1.0f) return;
+
+    for (u32 c = 0; c < channels; ++c) axis[c] = covariance[widest][c];
+    for (u32 iteration = 0; iteration < 8; ++iteration)
+    {
+
+        r32 next[4] = {0};
+        r32 largest = 0.0f;
+        for (u32 row = 0; row < channels; ++row)
+        {
+            for (u32 column = 0; column < channels; ++column)
+                next[row] += covariance[row][column] * axis[column];
+            if (fabsf(next[row]) > largest) largest = fabsf(next[row]);
+        }
+
+        if (largest == 0.0f) break;
+        for (u32 c = 0; c < channels; ++c) axis[c] = next[c] / largest;
+
+    }
+
+    r32 length = 0.0f;
+    for (u32 c = 0; c < channels; ++c) length += axis[c] * axis[c];
+    length = sqrtf(length);
+    for (u32 c = 0; c < channels; ++c) axis[c] /= length;
+
+}
+
+// The ends of the line through the mean along the axis which cover the block.
+static void
+texture_bake_axis_extents(u8 texels[16][4], u32 channels, r32 mean[4], r32 axis[4],
+        r32 low[4], r32 high[4])
+{
+
+    r32 minimum = 0.0f;
+    r32 maximum = 0.0f;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        r32 projection = 0.0f;
+        for (u32 c = 0; c < channels; ++c) projection += (texels[i][c] - mean[c]) * axis[c];
+        if (projection < minimum) minimum = projection;
+        if (projection > maximum) maximum = projection;
+    }
+
+    for (u32 c = 0; c < 4; ++c)
+    {
+        low[c] = mean[c] + axis[c] * minimum;
+        high[c] = mean[c] + axis[c] * maximum;
+    }
+
+}
+
+// --- BC1 and BC3 -------------------------------------------------------------
+
+static inline u16
+texture_bake_pack_565(const i32 color[3])
+{
+
+    u32 red = (color[0] * 31 + 127) / 255;
+    u32 green = (color[1] * 63 + 127) / 255;
+    u32 blue = (color[2] * 31 + 127) / 255;
+    return (u16)((red << 11) | (green << 5) | blue);
+
+}
+
+static inline void
+texture_bake_unpack_565(u16 packed, i32 color[3])
+{
+
+    i32 red = (packed >> 11) & 31;
+    i32 green = (packed >> 5) & 63;
+    i32 blue = packed & 31;
+    color[0] = (red << 3) | (red >> 2);
+    color[1] = (green << 2) | (green >> 4);
+    color[2] = (blue << 3) | (blue >> 2);
+
+}
+
+// Orders the endpoints for four colour mode and picks each texel's index,
+// returning the squared error. Equal endpoints can only be one colour.
+static u32
+texture_bake_bc1_fit(u8 texels[16][4], u16 *color0, u16 *color1, u32 *indices)
+{
+
+    if (*color0 < *color1)
+    {
+        u16 swap = *color0;
+        *color0 = *color1;
+        *color1 = swap;
+    }
+
+    i32 palette[4][3];
+    texture_bake_unpack_565(*color0, palette[0]);
+    texture_bake_unpack_565(*color1, palette[1]);
+    for (u32 c = 0; c < 3; ++c)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    u32 palette_size = (*color0 == *color1) ? 1 : 4;
+    u32 error = 0;
+    *indices = 0;
+    for (u32 i = 0; i < 16; ++i)
+    {
+
+        u32 best = 0;
+        u32 best_error = 0xFFFFFFFF;
+        for (u32 p = 0; p < palette_size; ++p)
+        {
+            u32 texel_error = 0;
+            for (u32 c = 0; c < 3; ++c)
+            {
+                i32 delta = (i32)texels[i][c] - palette[p][c];
+                texel_error += (u32)(delta * delta);
+            }
+            if (texel_error < best_error)
+            {
+                best = p;
+                best_error = texel_error;
+            }
+        }
+
+        *indices |= best << (i * 2);
+        error += best_error;
+
+    }
+
+    return error;
+
+}
+
+// Solves for the endpoints which best fit the texels with their indices kept.
+static b32
+texture_bake_bc1_refine(u8 texels[16][4], u32 indices, i32 color0[3], i32 color1[3])
+{
+
+    static const r32 weights[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+
+    r32 aa = 0.0f;
+    r32 bb = 0.0f;
+    r32 ab = 0.0f;
+    r32 ax[3] = {0};
+    r32 bx[3] = {0};
+    for (u32 i = 0; i < 16; ++i)
+    {
+        r32 alpha = weights[(indices >> (i * 2)) & 3];
+        r32 beta = 1.0f - alpha;
+        aa += alpha * alpha;
+        bb += beta * beta;
+        ab += alpha * beta;
+        for (u32 c = 0; c < 3; ++c)
+        {
+            ax[c] += alpha * texels[i][c];
+            bx[c] += beta * texels[i][c];
+        }
+    }
+
+    r32 determinant = aa * bb - ab * ab;
+    if (fabsf(determinant) < 1e-6f) return false;
+
+    for (u32 c = 0; c < 3; ++c)
+    {
+        color0[c] = texture_bake_clamp_byte((ax[c] * bb - bx[c] * ab) / determinant);
+        color1[c] = texture_bake_clamp_byte((bx[c] * aa - ax[c] * ab) / determinant);
+    }
+
+    return true;
+
+}
+
+static void
+texture_bake_encode_bc1(u8 texels[16][4], u8 *output)
+{
+
+    r32 mean[4];
+    r32 axis[4];
+    r32 low[4];
+    r32 high[4];
+    texture_bake_principal_axis(texels, 3, mean, axis);
+    texture_bake_axis_extents(texels, 3, mean, axis, low, high);
+
+    // Pulling the ends in by a sixteenth of the range spends the palette on the
+    // bulk of the block rather than its outliers.
+    i32 color0[3];
+    i32 color1[3];
+    for (u32 c = 0; c < 3; ++c)
+    {
+        r32 inset = (high[c] - low[c]) / 16.0f;
+        color0[c] = texture_bake_clamp_byte(high[c] - inset);
+        color1[c] = texture_bake_clamp_byte(low[c] + inset);
+    }
+
+    u16 packed0 = texture_bake_pack_565(color0);
+    u16 packed1 = texture_bake_pack_565(color1);
+    u32 indices = 0;
+    u32 error = texture_bake_bc1_fit(texels, &packed0, &packed1, &indices);
+
+    if (error > 0 && packed0 != packed1 && texture_bake_bc1_refine(texels, indices, color0, color1))
+    {
+        u16 refined0 = texture_bake_pack_565(color0);
+        u16 refined1 = texture_bake_pack_565(color1);
+        u32 refined_indices = 0;
+        u32 refined_error = texture_bake_bc1_fit(texels, &refined0, &refined1, &refined_indices);
+        if (refined_error < error)
+        {
+            packed0 = refined0;
+            packed1 = refined1;
+            indices = refined_indices;
+        }
+    }
+
+    memcpy(output + 0, &packed0, 2);
+    memcpy(output + 2, &packed1, 2);
+    memcpy(output + 4, &indices, 4);
+
+}
+
+// The alpha half of BC3, eight steps from the block's highest alpha to its lowest.
+static void
+texture_bake_encode_bc3_alpha(u8 texels[16][4], u8 *output)
+{
+
+    u32 alpha0 = 0;
+    u32 alpha1 = 255;
+    for (u32 i = 0; i < 16; ++i)
+    {
+        if (texels[i][3] > alpha0) alpha0 = texels[i][3];
+        if (texels[i][3] < alpha1) alpha1 = texels[i][3];
+    }
+
+    u64 indices = 0;
+    if (alpha0 > alpha1)
+    {
+
+        u32 palette[8];
+        palette[0] = alpha0;
+        palette[1] = alpha1;
+        for (u32 p = 2; p < 8; ++p)
+            palette[p] = ((8 - p) * alpha0 + (p - 1) * alpha1) / 7;
+
+        for (u32 i = 0; i < 16; ++i)
+        {
+            u32 best = 0;
+            i32 best_error = 256;
+            for (u32 p = 0; p < 8; ++p)
+            {
+                i32 delta = (i32)texels[i][3] - (i32)palette[p];
+                if (delta < 0) delta = -delta;
+                if (delta < best_error)
+                {
+                    best = p;
+                    best_error = delta;
+                }
+            }
+            indices |= (u64)best << (i * 3);
+        }
+
+    }
+
+    output[0] = (u8)alpha0;
+    output[1] = (u8)alpha1;
+    memcpy(output + 2, &indices, 6);
+
+}
+
+// --- BC7 ---------------------------------------------------------------------
+
+// Mode 6 endpoints are 7 bits a channel plus a shared low bit, whichever low bit
+// lands closer.
+static void
+texture_bake_bc7_quantize(const r32 endpoint[4], u32 quantized[4], u32 *low_bit, u32 expanded[4])
+{
+
+    u32 best_error = 0xFFFFFFFF;
+    for (u32 bit = 0; bit < 2; ++bit)
+    {
+
+        u32 candidate[4];
+        u32 error = 0;
+        for (u32 c = 0; c < 4; ++c)
+        {
+            i32 value = (texture_bake_clamp_byte(endpoint[c]) - (i32)bit + 1) / 2;
+            if (value > 127) value = 127;
+            candidate[c] = (u32)value;
+            i32 delta = texture_bake_clamp_byte(endpoint[c]) - (i32)((candidate[c] << 1) | bit);
+            error += (u32)(delta * delta);
+        }
+
+        if (error < best_error)
+        {
+            best_error = error;
+            *low_bit = bit;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                quantized[c] = candidate[c];
+                expanded[c] = (candidate[c] << 1) | bit;
+            }
+        }
+
+    }
+
+}
+
+static void
+texture_bake_encode_bc7(u8 texels[16][4], u8 *output)
+{
+
+    r32 mean[4];
+    r32 axis[4];
+    r32 low[4];
+    r32 high[4];
+    texture_bake_principal_axis(texels, 4, mean, axis);
+    texture_bake_axis_extents(texels, 4, mean, axis, low, high);
+
+    u32 quantized[2][4];
+    u32 expanded[2][4];
+    u32 low_bits[2];
+    texture_bake_bc7_quantize(low, quantized[0], low_bits + 0, expanded[0]);
+    texture_bake_bc7_quantize(high, quantized[1], low_bits + 1, expanded[1]);
+
+    u32 palette[16][4];
+    for (u32 p = 0; p < 16; ++p)
+    {
+        u32 weight = texture_bake_bc7_weights[p];
+        for (u32 c = 0; c < 4; ++c)
+            palette[p][c] = ((64 - weight) * expanded[0][c] + weight * expanded[1][c] + 32) >> 6;
+    }
+
+    u32 indices[16];
+    for (u32 i = 0; i < 16; ++i)
+    {
+        u32 best = 0;
+        u32 best_error = 0xFFFFFFFF;
+        for (u32 p = 0; p < 16; ++p)
+        {
+            u32 error = 0;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                i32 delta = (i32)texels[i][c] - (i32)palette[p][c];
+                error += (u32)(delta * delta);
+            }
+            if (error < best_error)
+            {
+                best = p;
+                best_error = error;
+            }
+        }
+        indices[i] = best;
+    }
+
+    // The first texel's index is stored without its top bit, so it has to be
+    // in the lower half; swapping the endpoints mirrors every index.
+    u32 first = 0;
+    u32 second = 1;
+    if (indices[0] & 8)
+    {
+        first = 1;
+        second = 0;
+        for (u32 i = 0; i < 16; ++i) indices[i] = 15 - indices[i];
+    }
+
+    texture_bake_bits bits = {};
+    texture_bake_put_bits(&bits, 1 << 6, 7);
+    for (u32 c = 0; c < 4; ++c)
+    {
+        texture_bake_put_bits(&bits, quantized[first][c], 7);
+        texture_bake_put_bits(&bits, quantized[second][c], 7);
+    }
+
+    texture_bake_put_bits(&bits, low_bits[first], 1);
+    texture_bake_put_bits(&bits, low_bits[second], 1);
+    texture_bake_put_bits(&bits, indices[0], 3);
+    for (u32 i = 1; i < 16; ++i) texture_bake_put_bits(&bits, indices[i], 4);
+
+    NX_ASSERT(bits.position == 128);
+    memcpy(output, bits.words, 16);
+
+}
+
+// --- Jobs --------------------------------------------------------------------
+
+// Two texels of the smaller level at a time, from four of each source row, with
+// the sums in 16 bit lanes. An odd row or column at the edge of the source is
+// folded into the last texel, which averages three of them instead of two; that
+// texel, and any row with three, goes through the scalar loop.
+static void
+texture_bake_downsample_rows(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    texture_bake_downsample_context *context = (texture_bake_downsample_context*)user_data;
+    image *source = context->source;
+    image *destination = context->destination;
+
+    u32 simd_width = (source->width & 1) ? destination->width - 1 : destination->width;
+    __m128i zero = _mm_setzero_si128();
+    __m128i rounding = _mm_set1_epi16(2);
+    for (u64 y = begin; y < end; ++y)
+    {
+
+        u32 y0 = (u32)y * 2;
+        u32 row_count = (y0 + 1 < source->height) ? 2 : 1;
+        if (y + 1 == destination->height && y0 + 3 == source->height) row_count = 3;
+
+        u8 *rows[3];
+        for (u32 r = 0; r < 3; ++r)
+            rows[r] = (u8*)source->buffer + (u64)(y0 + ((r < row_count) ? r : 0)) * source->pitch;
+        u8 *output = (u8*)destination->buffer + y * destination->pitch;
+
+        u32 x = 0;
+        for (; row_count < 3 && x + 2 <= simd_width; x += 2)
+        {
+            __m128i top = _mm_loadu_si128((__m128i*)(rows[0] + x * 8));
+            __m128i bottom = _mm_loadu_si128((__m128i*)(rows[1] + x * 8));
+            __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+            __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+            left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+            right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+            __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(left, right), rounding);
+            sum = _mm_srli_epi16(sum, 2);
+            _mm_storel_epi64((__m128i*)(output + x * 4), _mm_packus_epi16(sum, sum));
+        }
+
+        for (; x < destination->width; ++x)
+        {
+
+            u32 x0 = x * 2;
+            u32 column_count = (x0 + 1 < source->width) ? 2 : 1;
+            if (x + 1 == destination->width && x0 + 3 == source->width) column_count = 3;
+
+            u32 texel_count = row_count * column_count;
+            for (u32 c = 0; c < 4; ++c)
+            {
+                u32 sum = 0;
+                for (u32 r = 0; r < row_count; ++r)
+                {
+                    for (u32 i = 0; i < column_count; ++i)
+                        sum += rows[r][(x0 + i) * 4 + c];
+                }
+                output[x * 4 + c] = (u8)((sum + texel_count / 2) / texel_count);
+            }
+
+        }
+
+    }
+
+}
+
+static void
+texture_bake_encode_rows(vptr user_data, u64 begin, u64 end, u32 worker_index)
+{
+
+    texture_bake_encode_context *context = (texture_bake_encode_context*)user_data;
+    for (u64 block_y = begin; block_y < end; ++block_y)
+    {
+        for (u32 block_x = 0; block_x < context->blocks_x; ++block_x)
+        {
+
+            u8 texels[16][4];
+            texture_bake_fetch_block(context->source, block_x, (u32)block_y, texels);
+            u8 *block = context->output + (block_y * context->blocks_x + block_x) * context->block_size;
+
+            switch (context->format)
+            {
+                case TEXTURE_BAKE_BC1:
+                {
+                    texture_bake_encode_bc1(texels, block);
+                } break;
+
+                case TEXTURE_BAKE_BC3:
+                {
+                    texture_bake_encode_bc3_alpha(texels, block);
+                    texture_bake_encode_bc1(texels, block + 8);
+                } break;
+
+                case TEXTURE_BAKE_BC7:
+                {
+                    texture_bake_encode_bc7(texels, block);
+                } break;
+
+                default:
+                {
+                    NX_ASSERT(!"Not a block format.");
+                } break;
+            }
+
+        }
+    }
+
+}
+
+// --- Texture Baking ----------------------------------------------------------
+
+ccptr
+texture_bake_format_name(texture_bake_format format)
+{
+
+    NX_ASSERT(format < TEXTURE_BAKE_FORMAT_COUNT);
+    return texture_bake_format_names[format];
+
+}
+
+u32
+texture_bake_level_count(u32 width, u32 height)
+{
+
+    u32 count = 1;
+    while ((width > 1 || height > 1) && count < TEXTURE_BAKE_MAX_LEVELS)
+    {
+        width = texture_bake_half(width);
+        height = texture_bake_half(height);
+        count++;
+    }
+
+    return count;
+
+}
+
+u64
+texture_bake_level_size(u32 width, u32 height, texture_bake_format format)
+{
+
+    NX_ASSERT(format < TEXTURE_BAKE_FORMAT_COUNT);
+    if (format == TEXTURE_BAKE_RGBA8) return (u64)width * height * 4;
+
+    u64 blocks = (u64)((width + 3) / 4) * ((height + 3) / 4);
+    return blocks * ((format == TEXTURE_BAKE_BC1) ? 8 : 16);
+
+}
+
+u64
+texture_bake_file_size(u32 width, u32 height, texture_bake_format format, b32 mipmaps)
+{
+
+    u64 size = texture_bake_align(sizeof(texture_bake_header), TEXTURE_BAKE_ALIGNMENT);
+    u32 level_count = (mipmaps) ? texture_bake_level_count(width, height) : 1;
+    for (u32 i = 0; i < level_count; ++i)
+    {
+        size += texture_bake_align(texture_bake_level_size(width, height, format), TEXTURE_BAKE_ALIGNMENT);
+        width = texture_bake_half(width);
+        height = texture_bake_half(height);
+    }
+
+    return size;
+
+}
+
+void
+texture_bake_downsample(image *source, image *destination)
+{
+
+    NX_ENSURE_POINTER(source);
+    NX_ENSURE_POINTER(destination);
+    NX_ASSERT(destination->width == texture_bake_half(source->width));
+    NX_ASSERT(destination->height == texture_bake_half(source->height));
+
+    texture_bake_downsample_context context = {};
+    context.source = source;
+    context.destination = destination;
+    jobs_parallel_for(destination->height, TEXTURE_BAKE_DOWNSAMPLE_ROWS,
+            texture_bake_downsample_rows, &context);
+
+}
+
+void
+texture_bake_encode(image *source, texture_bake_format format, vptr output)
+{
+
+    NX_ENSURE_POINTER(source);
+    NX_ENSURE_POINTER(output);
+    NX_ASSERT(format < TEXTURE_BAKE_FORMAT_COUNT);
+
+    if (format == TEXTURE_BAKE_RGBA8)
+    {
+        u64 row_size = (u64)source->width * 4;
+        for (u32 row = 0; row < source->height; ++row)
+            memcpy((u8*)output + row * row_size, (u8*)source->buffer + (u64)row * source->pitch, row_size);
+        return;
+    }
+
+    texture_bake_encode_context context = {};
+    context.source = source;
+    context.format = format;
+    context.output = (u8*)output;
+    context.blocks_x = (source->width + 3) / 4;
+    context.block_size = (format == TEXTURE_BAKE_BC1) ? 8 : 16;
+    jobs_parallel_for((source->height + 3) / 4, TEXTURE_BAKE_ENCODE_ROWS,
+            texture_bake_encode_rows, &context);
+
+}
+
+u64
+texture_bake(image *source, texture_bake_format format, b32 mipmaps,
+        memory_arena *scratch, vptr output, u64 output_size)
+{
+
+    NX_ENSURE_POINTER(source);
+    NX_ENSURE_POINTER(scratch);
+    NX_ENSURE_POINTER(output);
+    NX_ASSERT(source->bits_per_pixel == 32);
+    NX_ASSERT(source->width > 0 && source->height > 0);
+
+    u64 file_size = texture_bake_file_size(source->width, source->height, format, mipmaps);
+    if (file_size > output_size) return 0;
+
+    u8 *contents = (u8*)output;
+    memset(contents, 0, file_size);
+
+    texture_bake_header *header = (texture_bake_header*)contents;
+    header->magic = TEXTURE_BAKE_MAGIC;
+    header->version = TEXTURE_BAKE_VERSION;
+    header->format = format;
+    header->width = source->width;
+    header->height = source->height;
+    header->level_count = (mipmaps) ? texture_bake_level_count(source->width, source->height) : 1;
+
+    u64 save_point = memory_arena_save(scratch);
+    u64 offset = texture_bake_align(sizeof(texture_bake_header), TEXTURE_BAKE_ALIGNMENT);
+    image level = *source;
+    for (u32 i = 0; i < header->level_count; ++i)
+    {
+
+        // Each level is filtered from the one before it.
+        if (i > 0)
+        {
+            image smaller = {};
+            smaller.width = texture_bake_half(level.width);
+            smaller.height = texture_bake_half(level.height);
+            smaller.pitch = smaller.width * 4;
+            smaller.bits_per_pixel = 32;
+            smaller.buffer = memory_arena_push(scratch, (u64)smaller.pitch * smaller.height);
+            texture_bake_downsample(&level, &smaller);
+            level = smaller;
+        }
+
+        texture_bake_level *entry = header->levels + i;
+        entry->offset = offset;
+        entry->size = texture_bake_level_size(level.width, level.height, format);
+        entry->width = level.width;
+        entry->height = level.height;
+        texture_bake_encode(&level, format, contents + offset);
+        offset += texture_bake_align(entry->size, TEXTURE_BAKE_ALIGNMENT);
+
+    }
+
+    memory_arena_restore(scratch, save_point);
+    NX_ASSERT(offset == file_size);
+    return file_size;
+
+}
+
+texture_bake_header*
+texture_bake_parse(vptr contents, u64 size)
+{
+
+    NX_ENSURE_POINTER(contents);
+    if (size < sizeof(texture_bake_header)) return NULL;
+
+    texture_bake_header *header = (texture_bake_header*)contents;
+    if (header->magic != TEXTURE_BAKE_MAGIC || header->version != TEXTURE_BAKE_VERSION) return NULL;
+    if (header->format >= TEXTURE_BAKE_FORMAT_COUNT) return NULL;
+    if (header->width == 0 || header->height == 0) return NULL;
+    if (header->level_count == 0 || header->level_count > TEXTURE_BAKE_MAX_LEVELS) return NULL;
+
+    u32 width = header->width;
+    u32 height = header->height;
+    for (u32 i = 0; i < header->level_count; ++i)
+    {
+        texture_bake_level *level = header->levels + i;
+        if (level->width != width || level->height != height) return NULL;
+        if (level->size != texture_bake_level_size(width, height, (texture_bake_format)header->format)) return NULL;
+        if (level->offset > size || level->size > size - level->offset) return NULL;
+        width = texture_bake_half(width);
+        height = texture_bake_half(height);
+    }
+
+    return header;
+
+}
@@ -0,0 +1,86 @@
+#ifndef SRC_ENGINE_TEXTUREBAKE_H
+#define SRC_ENGINE_TEXTUREBAKE_H
+#include <core/definitions.h>
+#include <core/arena.h>
+
+// --- Texture Baking ----------------------------------------------------------
+//
+// Turns an RGBA8 image into a file the engine uploads without decoding anything:
+// the mip chain is generated and every level block compressed ahead of time, so
+// loading is reading the file and handing each level to the driver. The texbake
+// tool does this offline; the engine only needs the loader in bakedtexture.h.
+//
+// Mips are a 2x2 box filter of the level above, down to 1x1. An odd row or
+// column at the edge is averaged into the last texel of the smaller level,
+// which then covers three rows or columns instead of two. Values are averaged
+// as stored, without converting from sRGB.
+//
+// Formats, all in 4x4 blocks apart from RGBA8:
+//
+//      BC1     RGB at 8 bytes a block, 4 bits a texel. Alpha is dropped.
+//      BC3     RGBA at 16 bytes a block. BC1 colour with interpolated alpha.
+//      BC7     RGBA at 16 bytes a block. Only mode 6 is encoded, one pair of
+//              RGBA endpoints with 16 steps between them; it beats BC3 on
+//              most sprites and is quick to search.
+//      RGBA8   Uncompressed, for when only the mips are wanted.
+//
+// BC7 is core since GL 4.2, BC1 and BC3 need EXT_texture_compression_s3tc, which
+// every desktop driver has. Levels are encoded in parallel, a few block rows per
+// job, and blocks past the edge of a level repeat its last row and column.
+//
+// File layout, loosely modelled after KTX2: a fixed header, then the level index
+// from the largest level down, then each level's blocks in row order, starting
+// on 16 byte boundaries. Offsets are from the start of the file.
+//
+
+#define TEXTURE_BAKE_MAGIC          0x5854584E      // "NXTX"
+#define TEXTURE_BAKE_VERSION        1
+#define TEXTURE_BAKE_MAX_LEVELS     16
+
+typedef enum texture_bake_format
+{
+    TEXTURE_BAKE_RGBA8,
+    TEXTURE_BAKE_BC1,
+    TEXTURE_BAKE_BC3,
+    TEXTURE_BAKE_BC7,
+    TEXTURE_BAKE_FORMAT_COUNT,
+} texture_bake_format;
+
+typedef struct texture_bake_level
+{
+    u64 offset;
+    u64 size;
+    u32 width;
+    u32 height;
+} texture_bake_level;
+
+typedef struct texture_bake_header
+{
+    u32 magic;
+    u32 version;
+    u32 format;
+    u32 width;
+    u32 height;
+    u32 level_count;
+    texture_bake_level levels[TEXTURE_BAKE_MAX_LEVELS];
+} texture_bake_header;
+
+ccptr   texture_bake_format_name(texture_bake_format format);
+u32     texture_bake_level_count(u32 width, u32 height);
+u64     texture_bake_level_size(u32 width, u32 height, texture_bake_format format);
+u64     texture_bake_file_size(u32 width, u32 height, texture_bake_format format, b32 mipmaps);
+
+// Writes the whole file into output, returning its size or 0 if it doesn't fit.
+// The mips are built in scratch, which is restored before returning.
+u64     texture_bake(image *source, texture_bake_format format, b32 mipmaps,
+            memory_arena *scratch, vptr output, u64 output_size);
+
+// The steps texture_bake is made of. The destination of a downsample must be
+// half the source, rounded down and at least 1, in both dimensions.
+void    texture_bake_downsample(image *source, image *destination);
+void    texture_bake_encode(image *source, texture_bake_format format, vptr output);
+
+// Checks the header and the level index against the file's size.
+texture_bake_header*    texture_bake_parse(vptr contents, u64 size);
+
+#endif
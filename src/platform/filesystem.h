@@ -11,6 +11,7 @@ u64         file_read_all(ccptr file_path, vptr buffer, u64 buffer_size);
 u64         file_write_all(ccptr file_path, vptr buffer, u64 buffer_size);
 b32         file_copy_all(ccptr source, ccptr destination);
 u64         file_last_write_time(ccptr file_path);
+b32         file_create_directory(ccptr directory_path);
 
 vptr        file_stream_handle_create(ccptr file_path, u32 file_context);
 void        file_stream_handle_close(vptr handle);
@@ -9,6 +9,13 @@
 b32 create_opengl_render_context(vptr window_handle);
 b32 set_opengl_vertical_sync(i32 interval);
 
+// A context is current on one thread at a time. Release it on the thread that
+// has it before making it current on another; the render thread does this.
+b32 set_opengl_render_context_current(b32 current);
+
+// Whether the current context lists the extension, e.g. "GL_KHR_debug".
+b32 opengl_extension_supported(ccptr name);
+
 // --- Shader Helpers ----------------------------------------------------------
 
 GLuint  opengl_shader_create(GLuint type);
@@ -20,6 +27,20 @@ b32     opengl_program_link(GLuint program);
 void    opengl_program_attach(GLuint program, GLuint shader);
 void    opengl_program_release(GLuint program);
 
+// Compile and link above wait for the driver to finish before returning the
+// status. Begin issues the work without asking; end waits and returns what the
+// plain call would have, printing the log on failure. Between the two, other
+// shaders can be started, and with KHR/ARB_parallel_shader_compile the driver
+// builds them at the same time. Is done polls without waiting; without the
+// extension it's always true, since there's nothing to poll.
+b32     opengl_parallel_compile_supported();
+void    opengl_shader_compile_begin(GLuint id, ccptr source);
+b32     opengl_shader_compile_is_done(GLuint id);
+b32     opengl_shader_compile_end(GLuint id);
+void    opengl_program_link_begin(GLuint program);
+b32     opengl_program_link_is_done(GLuint program);
+b32     opengl_program_link_end(GLuint program);
+
 b32     opengl_shader_set_uniform_mat4(GLuint program, ccptr loc, mat4 *source, u64 count);
 b32     opengl_shader_set_uniform_vec2(GLuint program, ccptr loc, vec2 *source, u64 count);
 b32     opengl_shader_set_uniform_vec3(GLuint program, ccptr loc, vec3 *source, u64 count);
@@ -28,6 +49,139 @@ b32     opengl_shader_set_uniform_r32(GLuint program, ccptr loc, r32 *source, u6
 b32     opengl_shader_set_uniform_i32(GLuint program, ccptr loc, i32 *source, u64 count);
 b32     opengl_shader_set_uniform_u32(GLuint program, ccptr loc, u32 *source, u64 count);
 
+// --- Shader Program Reflection -----------------------------------------------
+//
+// The string setters above look the uniform up on every call. A reflected
+// program reads every active uniform, attribute, uniform block and storage
+// block once after linking and keeps them in small hashed tables. Uniforms are
+// then resolved to a handle once, at load time, and set through the handle.
+//
+// Setters go through glProgramUniform, so the program doesn't need to be bound,
+// and keep a copy of the last value set; setting the same value again makes no
+// GL call. Uniforms which don't fit the value cache are always set. Anything set
+// behind the reflection's back (the string setters, glUniform) isn't seen by the
+// cache, so pick one way per program.
+//
+// Looking up a name that isn't active returns OPENGL_UNIFORM_INVALID, and the
+// setters ignore that handle. Uniforms the compiler optimized away are common
+// when sharing code between shaders, so this isn't treated as an error.
+//
+
+#define OPENGL_PROGRAM_MAX_UNIFORMS     32
+#define OPENGL_PROGRAM_MAX_ATTRIBUTES   16
+#define OPENGL_PROGRAM_MAX_BLOCKS       16
+#define OPENGL_PROGRAM_NAME_LENGTH      48
+#define OPENGL_PROGRAM_TABLE_SIZE       64
+#define OPENGL_PROGRAM_CACHE_SIZE       2048
+#define OPENGL_UNIFORM_INVALID          0xFFFFFFFF
+
+typedef u32 opengl_uniform;
+
+typedef struct opengl_program_variable
+{
+    char name[OPENGL_PROGRAM_NAME_LENGTH];  // Arrays without the [0].
+    u32 name_hash;
+    GLenum type;                // GL_FLOAT_MAT4 etc, or the block interface.
+    GLint location;             // Block binding for blocks.
+    GLint size;                 // Array length, or data size in bytes for blocks.
+    u32 cache_offset;
+    u32 cache_size;             // Zero when the value isn't cached.
+    b32 cache_valid;
+} opengl_program_variable;
+
+typedef struct opengl_program_reflection
+{
+
+    GLuint program;
+
+    u32 uniform_count;
+    u32 attribute_count;
+    u32 block_count;            // Uniform blocks and storage blocks.
+    opengl_program_variable uniforms[OPENGL_PROGRAM_MAX_UNIFORMS];
+    opengl_program_variable attributes[OPENGL_PROGRAM_MAX_ATTRIBUTES];
+    opengl_program_variable blocks[OPENGL_PROGRAM_MAX_BLOCKS];
+
+    // Open addressed on the name hash, each slot is an index plus one.
+    u8 uniform_table[OPENGL_PROGRAM_TABLE_SIZE];
+    u8 attribute_table[OPENGL_PROGRAM_TABLE_SIZE];
+    u8 block_table[OPENGL_PROGRAM_TABLE_SIZE];
+
+    u8 cache[OPENGL_PROGRAM_CACHE_SIZE];
+    u32 cache_used;
+
+    u64 uniform_sets;           // Setter calls which reached GL.
+    u64 redundant_sets;         // Setter calls skipped because nothing changed.
+
+} opengl_program_reflection;
+
+b32             opengl_program_reflect(opengl_program_reflection *reflection, GLuint program);
+opengl_uniform  opengl_program_uniform(opengl_program_reflection *reflection, ccptr name);
+GLint           opengl_program_attribute_location(opengl_program_reflection *reflection, ccptr name);
+opengl_program_variable* opengl_program_block(opengl_program_reflection *reflection, ccptr name);
+void            opengl_program_invalidate_cache(opengl_program_reflection *reflection);
+
+b32     opengl_program_set_mat4(opengl_program_reflection *reflection, opengl_uniform uniform, mat4 *source, u64 count);
+b32     opengl_program_set_vec2(opengl_program_reflection *reflection, opengl_uniform uniform, vec2 *source, u64 count);
+b32     opengl_program_set_vec3(opengl_program_reflection *reflection, opengl_uniform uniform, vec3 *source, u64 count);
+b32     opengl_program_set_vec4(opengl_program_reflection *reflection, opengl_uniform uniform, vec4 *source, u64 count);
+b32     opengl_program_set_r32(opengl_program_reflection *reflection, opengl_uniform uniform, r32 *source, u64 count);
+b32     opengl_program_set_i32(opengl_program_reflection *reflection, opengl_uniform uniform, i32 *source, u64 count);
+b32     opengl_program_set_u32(opengl_program_reflection *reflection, opengl_uniform uniform, u32 *source, u64 count);
+
+// --- State Cache -------------------------------------------------------------
+//
+// A shadow of the GL binding and fixed function state the engine touches, so
+// that setting what's already set makes no driver call. Each setter compares
+// against the shadow, issues the call only on a change and updates the shadow.
+// The cache covers the program, the vertex array, the generic buffer targets,
+// the indexed uniform and storage buffer bindings, the 2D and 2D array textures
+// of the first OPENGL_STATE_TEXTURE_UNITS units, blend, depth, cull, scissor and
+// rasterizer discard, the blend function, the viewport and the clear color.
+// State outside it (other targets, capabilities or units) is passed straight
+// through and counted as issued.
+//
+// Everything starts out unknown, so the first set of anything always reaches
+// GL. Code which changes cached state behind the cache's back, including third
+// party code, must invalidate it afterwards. The element array buffer belongs to
+// the vertex array, so it goes back to unknown whenever the vertex array changes.
+//
+// Deleting a bound object unbinds it, and its name may come back from the next
+// glGen call. Delete buffers and vertex arrays through the cache, and textures
+// and programs with the helpers here, so the shadow doesn't keep the old name.
+//
+// There's one cache, for the one context. The counters keep the calls issued
+// and elided since the last begin frame, and those of the frame before.
+//
+
+#define OPENGL_STATE_TEXTURE_UNITS      16
+#define OPENGL_STATE_BUFFER_BINDINGS    16
+
+typedef struct opengl_state_statistics
+{
+    u64 issued_calls;           // Since the last begin frame.
+    u64 elided_calls;
+    u64 frame_issued_calls;     // In the last full frame.
+    u64 frame_elided_calls;
+} opengl_state_statistics;
+
+void    opengl_state_begin_frame();
+void    opengl_state_invalidate();
+void    opengl_state_get_statistics(opengl_state_statistics *statistics);
+
+void    opengl_state_use_program(GLuint program);
+void    opengl_state_bind_vertex_array(GLuint vertex_array);
+void    opengl_state_bind_buffer(GLenum target, GLuint buffer);
+void    opengl_state_bind_buffer_base(GLenum target, u32 index, GLuint buffer);
+void    opengl_state_bind_buffer_range(GLenum target, u32 index, GLuint buffer, u64 offset, u64 size);
+void    opengl_state_bind_texture(u32 unit, GLenum target, GLuint texture);
+void    opengl_state_enable(GLenum capability);
+void    opengl_state_disable(GLenum capability);
+void    opengl_state_blend_func(GLenum source_factor, GLenum destination_factor);
+void    opengl_state_viewport(i32 x, i32 y, i32 width, i32 height);
+void    opengl_state_clear_color(r32 red, r32 green, r32 blue, r32 alpha);
+
+void    opengl_state_delete_buffers(u32 count, GLuint *buffers);
+void    opengl_state_delete_vertex_arrays(u32 count, GLuint *vertex_arrays);
 
 // --- Texture Helpers ---------------------------------------------------------
 
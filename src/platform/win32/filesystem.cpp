@@ -88,8 +88,9 @@ u64
 file_write_all(ccptr file_path, vptr buffer, u64 buffer_size)
 {
 
+    // Truncates, a shorter write shouldn't leave the old file's tail behind.
     HANDLE file_handle = CreateFileA(file_path, GENERIC_WRITE, FILE_SHARE_WRITE,
-            NULL, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+            NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
     if (file_handle == INVALID_HANDLE_VALUE)
         return 0;
 
@@ -135,6 +136,15 @@ file_last_write_time(ccptr file_path)
 
 }
 
+b32
+file_create_directory(ccptr directory_path)
+{
+
+    if (CreateDirectoryA(directory_path, NULL)) return true;
+    return (GetLastError() == ERROR_ALREADY_EXISTS && file_is_directory(directory_path));
+
+}
+
 vptr          
 file_stream_handle_create(ccptr file_path, u32 open_context)
 {
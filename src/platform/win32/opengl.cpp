@@ -1,5 +1,6 @@
 #include <platform/opengl.h>
 #include <glad/glad_wgl.h>
+#include <string.h>
 
 typedef struct opengl_context
 {
@@ -10,6 +11,67 @@ typedef struct opengl_context
 
 static inline opengl_context* get_opengl_context() { static opengl_context ctx = {0}; return &ctx; }
 
+#define OPENGL_STATE_UNKNOWN    0xFFFFFFFF
+
+typedef enum opengl_state_buffer_slot
+{
+    OPENGL_STATE_ARRAY_BUFFER,
+    OPENGL_STATE_ELEMENT_ARRAY_BUFFER,
+    OPENGL_STATE_UNIFORM_BUFFER,
+    OPENGL_STATE_SHADER_STORAGE_BUFFER,
+    OPENGL_STATE_DRAW_INDIRECT_BUFFER,
+    OPENGL_STATE_DISPATCH_INDIRECT_BUFFER,
+    OPENGL_STATE_PIXEL_PACK_BUFFER,
+    OPENGL_STATE_PIXEL_UNPACK_BUFFER,
+    OPENGL_STATE_COPY_READ_BUFFER,
+    OPENGL_STATE_COPY_WRITE_BUFFER,
+    OPENGL_STATE_BUFFER_SLOT_COUNT,
+} opengl_state_buffer_slot;
+
+typedef enum opengl_state_capability_slot
+{
+    OPENGL_STATE_BLEND,
+    OPENGL_STATE_DEPTH_TEST,
+    OPENGL_STATE_CULL_FACE,
+    OPENGL_STATE_SCISSOR_TEST,
+    OPENGL_STATE_RASTERIZER_DISCARD,
+    OPENGL_STATE_CAPABILITY_SLOT_COUNT,
+} opengl_state_capability_slot;
+
+typedef struct opengl_state_indexed_buffer
+{
+    GLuint buffer;
+    u64 offset;
+    u64 size;                   // Zero for glBindBufferBase.
+} opengl_state_indexed_buffer;
+
+typedef struct opengl_state_cache
+{
+
+    GLuint program;
+    GLuint vertex_array;
+    GLuint buffers[OPENGL_STATE_BUFFER_SLOT_COUNT];
+    opengl_state_indexed_buffer uniform_bindings[OPENGL_STATE_BUFFER_BINDINGS];
+    opengl_state_indexed_buffer storage_bindings[OPENGL_STATE_BUFFER_BINDINGS];
+
+    u32 active_texture_unit;
+    GLuint textures_2d[OPENGL_STATE_TEXTURE_UNITS];
+    GLuint textures_2d_array[OPENGL_STATE_TEXTURE_UNITS];
+
+    u32 capabilities[OPENGL_STATE_CAPABILITY_SLOT_COUNT];   // Enabled, disabled or unknown.
+    GLenum blend_source_factor;
+    GLenum blend_destination_factor;
+    b32 viewport_known;
+    i32 viewport[4];
+    b32 clear_color_known;
+    r32 clear_color[4];
+
+    opengl_state_statistics statistics;
+
+} opengl_state_cache;
+
+static inline opengl_state_cache* get_opengl_state_cache() { static opengl_state_cache cache = {0}; return &cache; }
+
 // --- OpenGL Helpers ----------------------------------------------------------
 //
 // Non-platform specific OpenGL helper functions.
@@ -23,16 +85,108 @@ opengl_shader_create(GLuint type)
 
 }
 
-b32     
-opengl_shader_compile(GLuint id, ccptr source)
+// --- Parallel Compilation ---------------------------------------------------
+//
+// Compiles and links are only waited on when their status is asked for. With
+// KHR or ARB parallel_shader_compile the driver also runs them on its own
+// threads, and the completion status can be polled without waiting.
+//
+
+#define OPENGL_COMPLETION_STATUS                0x91B1
+#define OPENGL_MAX_SHADER_COMPILER_THREADS_ALL  0xFFFFFFFF
+
+typedef void (APIENTRYP opengl_max_shader_compiler_threads_proc)(GLuint count);
+typedef vptr (*opengl_proc_loader)(ccptr name);
+
+typedef struct opengl_parallel_compile
 {
+    b32 supported;
+    opengl_max_shader_compiler_threads_proc max_shader_compiler_threads;
+} opengl_parallel_compile;
 
-    GLuint shader_identifier = id;
+static inline opengl_parallel_compile* get_opengl_parallel_compile() { static opengl_parallel_compile pc = {0}; return &pc; }
+
+b32
+opengl_extension_supported(ccptr name)
+{
+
+    GLint extension_count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extension_count);
+    for (GLint i = 0; i < extension_count; ++i)
+    {
+        ccptr extension = (ccptr)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (extension != NULL && strcmp(extension, name) == 0) return true;
+    }
+
+    return false;
+
+}
+
+// Called once the context is current and GL is loaded.
+static void
+opengl_parallel_compile_initialize(opengl_proc_loader loader)
+{
+
+    opengl_parallel_compile *parallel = get_opengl_parallel_compile();
+    parallel->supported = false;
+    parallel->max_shader_compiler_threads = NULL;
+
+    if (opengl_extension_supported("GL_KHR_parallel_shader_compile"))
+    {
+        parallel->max_shader_compiler_threads = (opengl_max_shader_compiler_threads_proc)
+            loader("glMaxShaderCompilerThreadsKHR");
+    }
+    else if (opengl_extension_supported("GL_ARB_parallel_shader_compile"))
+    {
+        parallel->max_shader_compiler_threads = (opengl_max_shader_compiler_threads_proc)
+            loader("glMaxShaderCompilerThreadsARB");
+    }
+
+    // Let the driver pick how many threads to compile on.
+    if (parallel->max_shader_compiler_threads != NULL)
+    {
+        parallel->max_shader_compiler_threads(OPENGL_MAX_SHADER_COMPILER_THREADS_ALL);
+        parallel->supported = true;
+    }
+
+}
+
+b32
+opengl_parallel_compile_supported()
+{
+
+    return get_opengl_parallel_compile()->supported;
+
+}
+
+void
+opengl_shader_compile_begin(GLuint id, ccptr source)
+{
+
+    glShaderSource(id, 1, &source, NULL);
+    glCompileShader(id);
+
+}
+
+b32
+opengl_shader_compile_is_done(GLuint id)
+{
 
-    glShaderSource(shader_identifier, 1, &source, NULL);
-    glCompileShader(shader_identifier);
+    if (!get_opengl_parallel_compile()->supported) return true;
 
-    // Check compilation status.
+    GLint completed = GL_TRUE;
+    glGetShaderiv(id, OPENGL_COMPLETION_STATUS, &completed);
+    return completed == GL_TRUE;
+
+}
+
+b32
+opengl_shader_compile_end(GLuint id)
+{
+
+    GLuint shader_identifier = id;
+
+    // Check compilation status, this waits for the compile to finish.
     GLint compile_status = GL_FALSE;
     glGetShaderiv(shader_identifier, GL_COMPILE_STATUS, &compile_status);
 
@@ -60,6 +214,15 @@ opengl_shader_compile(GLuint id, ccptr source)
 
 }
 
+b32     
+opengl_shader_compile(GLuint id, ccptr source)
+{
+
+    opengl_shader_compile_begin(id, source);
+    return opengl_shader_compile_end(id);
+
+}
+
 void    
 opengl_shader_release(GLuint id)
 {
@@ -84,14 +247,33 @@ opengl_program_attach(GLuint program, GLuint shader)
 
 }
 
-b32     
-opengl_program_link(GLuint program)
+void
+opengl_program_link_begin(GLuint program)
+{
+
+    glLinkProgram(program);
+
+}
+
+b32
+opengl_program_link_is_done(GLuint program)
+{
+
+    if (!get_opengl_parallel_compile()->supported) return true;
+
+    GLint completed = GL_TRUE;
+    glGetProgramiv(program, OPENGL_COMPLETION_STATUS, &completed);
+    return completed == GL_TRUE;
+
+}
+
+b32
+opengl_program_link_end(GLuint program)
 {
 
     GLuint program_identifier = program;
 
-    glLinkProgram(program_identifier);
- 
+    // Waits for the link to finish.
     GLint program_link_status = GL_FALSE;
     glGetProgramiv(program_identifier, GL_LINK_STATUS, &program_link_status);
     if (program_link_status == GL_FALSE)
@@ -116,10 +298,22 @@ opengl_program_link(GLuint program)
 
 }
 
+b32     
+opengl_program_link(GLuint program)
+{
+
+    opengl_program_link_begin(program);
+    return opengl_program_link_end(program);
+
+}
+
 void    
 opengl_program_release(GLuint program)
 {
 
+    // A program in use is only deleted once it's no longer current.
+    opengl_state_cache *cache = get_opengl_state_cache();
+    if (cache->program == program) cache->program = OPENGL_STATE_UNKNOWN;
     glDeleteProgram(program);
 
 }
@@ -130,12 +324,12 @@ opengl_texture_create(image *img)
 
     GLuint texture_identifier = NULL;
     glGenTextures(1, &texture_identifier);
-    glBindTexture(GL_TEXTURE_2D, texture_identifier);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB,  img->width, img->height, 0, GL_RGBA,
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, texture_identifier);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, img->width, img->height, 0, GL_RGBA,
             GL_UNSIGNED_BYTE, img->buffer);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, NULL);
+    opengl_state_bind_texture(0, GL_TEXTURE_2D, 0);
     return texture_identifier;
 
 }
@@ -144,6 +338,14 @@ void
 opengl_texture_delete(GLuint texture_identifier)
 {
 
+    // Deleting a texture unbinds it from every unit.
+    opengl_state_cache *cache = get_opengl_state_cache();
+    for (u32 unit = 0; unit < OPENGL_STATE_TEXTURE_UNITS; ++unit)
+    {
+        if (cache->textures_2d[unit] == texture_identifier) cache->textures_2d[unit] = 0;
+        if (cache->textures_2d_array[unit] == texture_identifier) cache->textures_2d_array[unit] = 0;
+    }
+
     glDeleteTextures(1, &texture_identifier);
     return;
 
@@ -219,6 +421,757 @@ opengl_shader_set_uniform_u32(GLuint program, ccptr loc, u32 *source, u64 count)
     return true;
 }
 
+// --- Shader Program Reflection -----------------------------------------------
+
+static inline u32
+opengl_program_hash(ccptr name)
+{
+
+    // FNV-1a, names are short and this only runs at load time.
+    u32 hash = 2166136261u;
+    while (*name)
+    {
+        hash ^= (u8)(*name++);
+        hash *= 16777619u;
+    }
+    return hash;
+
+}
+
+static opengl_program_variable*
+opengl_program_find(opengl_program_variable *variables, u8 *table, ccptr name, u32 *index)
+{
+
+    u32 hash = opengl_program_hash(name);
+    for (u32 probe = 0; probe < OPENGL_PROGRAM_TABLE_SIZE; ++probe)
+    {
+        u32 slot = table[(hash + probe) & (OPENGL_PROGRAM_TABLE_SIZE - 1)];
+        if (slot == 0) return NULL;
+
+        opengl_program_variable *variable = variables + (slot - 1);
+        if (variable->name_hash == hash && strcmp(variable->name, name) == 0)
+        {
+            if (index != NULL) *index = slot - 1;
+            return variable;
+        }
+    }
+
+    return NULL;
+
+}
+
+static void
+opengl_program_insert(opengl_program_variable *variable, u8 *table, u32 index)
+{
+
+    for (u32 probe = 0; probe < OPENGL_PROGRAM_TABLE_SIZE; ++probe)
+    {
+        u8 *slot = table + ((variable->name_hash + probe) & (OPENGL_PROGRAM_TABLE_SIZE - 1));
+        if (*slot == 0)
+        {
+            *slot = (u8)(index + 1);
+            return;
+        }
+    }
+
+    NX_ASSERT(!"Program reflection table is full.");
+
+}
+
+// Reads the name of a resource, dropping the [0] GL puts on arrays, and hashes it.
+static void
+opengl_program_read_name(GLuint program, GLenum interface_type, GLuint resource,
+        opengl_program_variable *variable)
+{
+
+    GLsizei length = 0;
+    glGetProgramResourceName(program, interface_type, resource, OPENGL_PROGRAM_NAME_LENGTH,
+            &length, variable->name);
+    if (length >= 3 && strcmp(variable->name + length - 3, "[0]") == 0)
+        variable->name[length - 3] = '\0';
+    variable->name_hash = opengl_program_hash(variable->name);
+
+}
+
+static u32
+opengl_program_type_size(GLenum type)
+{
+
+    switch (type)
+    {
+        case GL_FLOAT:
+        case GL_INT:
+        case GL_UNSIGNED_INT:
+        case GL_BOOL:               return 4;
+        case GL_FLOAT_VEC2:
+        case GL_INT_VEC2:
+        case GL_UNSIGNED_INT_VEC2:  return 8;
+        case GL_FLOAT_VEC3:
+        case GL_INT_VEC3:
+        case GL_UNSIGNED_INT_VEC3:  return 12;
+        case GL_FLOAT_VEC4:
+        case GL_INT_VEC4:
+        case GL_UNSIGNED_INT_VEC4:
+        case GL_FLOAT_MAT2:         return 16;
+        case GL_FLOAT_MAT3:         return 36;
+        case GL_FLOAT_MAT4:         return 64;
+    }
+
+    // Samplers and images are set as a single integer unit.
+    return 4;
+
+}
+
+// Compares against the cached value and takes the new one. Returns true when
+// the value has to be sent to GL.
+static b32
+opengl_program_cache_update(opengl_program_reflection *reflection, opengl_program_variable *variable,
+        vptr source, u64 size)
+{
+
+    if (variable->cache_size == 0 || size > variable->cache_size)
+    {
+        reflection->uniform_sets++;
+        return true;
+    }
+
+    u8 *cached = reflection->cache + variable->cache_offset;
+    if (variable->cache_valid && memcmp(cached, source, size) == 0)
+    {
+        reflection->redundant_sets++;
+        return false;
+    }
+
+    // A shorter set leaves the rest of the array unknown.
+    memcpy(cached, source, size);
+    variable->cache_valid = (size == variable->cache_size);
+    reflection->uniform_sets++;
+    return true;
+
+}
+
+static inline opengl_program_variable*
+opengl_program_uniform_variable(opengl_program_reflection *reflection, opengl_uniform uniform)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    if (uniform >= reflection->uniform_count) return NULL;
+    return reflection->uniforms + uniform;
+
+}
+
+b32
+opengl_program_reflect(opengl_program_reflection *reflection, GLuint program)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    memset(reflection, 0, sizeof(opengl_program_reflection));
+    reflection->program = program;
+
+    GLint link_status = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &link_status);
+    if (link_status == GL_FALSE) return false;
+
+    // Uniforms outside of blocks, those in blocks are reached through the block.
+    GLint uniform_count = 0;
+    glGetProgramInterfaceiv(program, GL_UNIFORM, GL_ACTIVE_RESOURCES, &uniform_count);
+    for (GLint resource = 0; resource < uniform_count; ++resource)
+    {
+
+        const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION, GL_BLOCK_INDEX };
+        GLint values[4];
+        glGetProgramResourceiv(program, GL_UNIFORM, resource, 4, properties, 4, NULL, values);
+        if (values[3] != -1) continue;
+
+        NX_ASSERT(reflection->uniform_count < OPENGL_PROGRAM_MAX_UNIFORMS);
+        if (reflection->uniform_count >= OPENGL_PROGRAM_MAX_UNIFORMS) break;
+
+        u32 index = reflection->uniform_count++;
+        opengl_program_variable *variable = reflection->uniforms + index;
+        opengl_program_read_name(program, GL_UNIFORM, resource, variable);
+        variable->type      = values[0];
+        variable->size      = values[1];
+        variable->location  = values[2];
+
+        u32 value_size = opengl_program_type_size(variable->type) * variable->size;
+        if (reflection->cache_used + value_size <= OPENGL_PROGRAM_CACHE_SIZE)
+        {
+            variable->cache_offset = reflection->cache_used;
+            variable->cache_size = value_size;
+            reflection->cache_used += value_size;
+        }
+
+        opengl_program_insert(variable, reflection->uniform_table, index);
+
+    }
+
+    GLint attribute_count = 0;
+    glGetProgramInterfaceiv(program, GL_PROGRAM_INPUT, GL_ACTIVE_RESOURCES, &attribute_count);
+    for (GLint resource = 0; resource < attribute_count; ++resource)
+    {
+
+        const GLenum properties[] = { GL_TYPE, GL_ARRAY_SIZE, GL_LOCATION };
+        GLint values[3];
+        glGetProgramResourceiv(program, GL_PROGRAM_INPUT, resource, 3, properties, 3, NULL, values);
+
+        // Built-ins like gl_VertexID have no location.
+        if (values[2] == -1) continue;
+
+        NX_ASSERT(reflection->attribute_count < OPENGL_PROGRAM_MAX_ATTRIBUTES);
+        if (reflection->attribute_count >= OPENGL_PROGRAM_MAX_ATTRIBUTES) break;
+
+        u32 index = reflection->attribute_count++;
+        opengl_program_variable *variable = reflection->attributes + index;
+        opengl_program_read_name(program, GL_PROGRAM_INPUT, resource, variable);
+        variable->type      = values[0];
+        variable->size      = values[1];
+        variable->location  = values[2];
+        opengl_program_insert(variable, reflection->attribute_table, index);
+
+    }
+
+    const GLenum block_interfaces[] = { GL_UNIFORM_BLOCK, GL_SHADER_STORAGE_BLOCK };
+    for (u32 i = 0; i < 2; ++i)
+    {
+
+        GLint block_count = 0;
+        glGetProgramInterfaceiv(program, block_interfaces[i], GL_ACTIVE_RESOURCES, &block_count);
+        for (GLint resource = 0; resource < block_count; ++resource)
+        {
+
+            const GLenum properties[] = { GL_BUFFER_BINDING, GL_BUFFER_DATA_SIZE };
+            GLint values[2];
+            glGetProgramResourceiv(program, block_interfaces[i], resource, 2, properties, 2, NULL, values);
+
+            NX_ASSERT(reflection->block_count < OPENGL_PROGRAM_MAX_BLOCKS);
+            if (reflection->block_count >= OPENGL_PROGRAM_MAX_BLOCKS) break;
+
+            u32 index = reflection->block_count++;
+            opengl_program_variable *variable = reflection->blocks + index;
+            opengl_program_read_name(program, block_interfaces[i], resource, variable);
+            variable->type      = block_interfaces[i];
+            variable->location  = values[0];
+            variable->size      = values[1];
+            opengl_program_insert(variable, reflection->block_table, index);
+
+        }
+
+    }
+
+    return true;
+
+}
+
+opengl_uniform
+opengl_program_uniform(opengl_program_reflection *reflection, ccptr name)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    NX_ENSURE_POINTER(name);
+
+    u32 index = 0;
+    if (opengl_program_find(reflection->uniforms, reflection->uniform_table, name, &index) == NULL)
+        return OPENGL_UNIFORM_INVALID;
+    return index;
+
+}
+
+GLint
+opengl_program_attribute_location(opengl_program_reflection *reflection, ccptr name)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    NX_ENSURE_POINTER(name);
+
+    opengl_program_variable *variable = opengl_program_find(reflection->attributes,
+            reflection->attribute_table, name, NULL);
+    return (variable != NULL) ? variable->location : -1;
+
+}
+
+opengl_program_variable*
+opengl_program_block(opengl_program_reflection *reflection, ccptr name)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    NX_ENSURE_POINTER(name);
+    return opengl_program_find(reflection->blocks, reflection->block_table, name, NULL);
+
+}
+
+void
+opengl_program_invalidate_cache(opengl_program_reflection *reflection)
+{
+
+    NX_ENSURE_POINTER(reflection);
+    for (u32 i = 0; i < reflection->uniform_count; ++i)
+        reflection->uniforms[i].cache_valid = false;
+
+}
+
+b32
+opengl_program_set_mat4(opengl_program_reflection *reflection, opengl_uniform uniform, mat4 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_FLOAT_MAT4);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(mat4) * count))
+        glProgramUniformMatrix4fv(reflection->program, variable->location, (GLsizei)count, GL_FALSE, &(*source)[0][0]);
+    return true;
+
+}
+
+b32
+opengl_program_set_vec2(opengl_program_reflection *reflection, opengl_uniform uniform, vec2 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_FLOAT_VEC2);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(vec2) * count))
+        glProgramUniform2fv(reflection->program, variable->location, (GLsizei)count, &(*source)[0]);
+    return true;
+
+}
+
+b32
+opengl_program_set_vec3(opengl_program_reflection *reflection, opengl_uniform uniform, vec3 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_FLOAT_VEC3);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(vec3) * count))
+        glProgramUniform3fv(reflection->program, variable->location, (GLsizei)count, &(*source)[0]);
+    return true;
+
+}
+
+b32
+opengl_program_set_vec4(opengl_program_reflection *reflection, opengl_uniform uniform, vec4 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_FLOAT_VEC4);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(vec4) * count))
+        glProgramUniform4fv(reflection->program, variable->location, (GLsizei)count, &(*source)[0]);
+    return true;
+
+}
+
+b32
+opengl_program_set_r32(opengl_program_reflection *reflection, opengl_uniform uniform, r32 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_FLOAT);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(r32) * count))
+        glProgramUniform1fv(reflection->program, variable->location, (GLsizei)count, source);
+    return true;
+
+}
+
+b32
+opengl_program_set_i32(opengl_program_reflection *reflection, opengl_uniform uniform, i32 *source, u64 count)
+{
+
+    // Also used for samplers, which take the texture unit as an integer.
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type != GL_FLOAT && variable->type != GL_UNSIGNED_INT);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(i32) * count))
+        glProgramUniform1iv(reflection->program, variable->location, (GLsizei)count, source);
+    return true;
+
+}
+
+b32
+opengl_program_set_u32(opengl_program_reflection *reflection, opengl_uniform uniform, u32 *source, u64 count)
+{
+
+    opengl_program_variable *variable = opengl_program_uniform_variable(reflection, uniform);
+    if (variable == NULL) return false;
+    NX_ASSERT(variable->type == GL_UNSIGNED_INT);
+
+    if (opengl_program_cache_update(reflection, variable, source, sizeof(u32) * count))
+        glProgramUniform1uiv(reflection->program, variable->location, (GLsizei)count, source);
+    return true;
+
+}
+
+
+// --- State Cache -------------------------------------------------------------
+
+static inline u32
+opengl_state_buffer_slot_of(GLenum target)
+{
+
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER:               return OPENGL_STATE_ARRAY_BUFFER;
+        case GL_ELEMENT_ARRAY_BUFFER:       return OPENGL_STATE_ELEMENT_ARRAY_BUFFER;
+        case GL_UNIFORM_BUFFER:             return OPENGL_STATE_UNIFORM_BUFFER;
+        case GL_SHADER_STORAGE_BUFFER:      return OPENGL_STATE_SHADER_STORAGE_BUFFER;
+        case GL_DRAW_INDIRECT_BUFFER:       return OPENGL_STATE_DRAW_INDIRECT_BUFFER;
+        case GL_DISPATCH_INDIRECT_BUFFER:   return OPENGL_STATE_DISPATCH_INDIRECT_BUFFER;
+        case GL_PIXEL_PACK_BUFFER:          return OPENGL_STATE_PIXEL_PACK_BUFFER;
+        case GL_PIXEL_UNPACK_BUFFER:        return OPENGL_STATE_PIXEL_UNPACK_BUFFER;
+        case GL_COPY_READ_BUFFER:           return OPENGL_STATE_COPY_READ_BUFFER;
+        case GL_COPY_WRITE_BUFFER:          return OPENGL_STATE_COPY_WRITE_BUFFER;
+    }
+
+    return OPENGL_STATE_BUFFER_SLOT_COUNT;
+
+}
+
+static inline u32
+opengl_state_capability_slot_of(GLenum capability)
+{
+
+    switch (capability)
+    {
+        case GL_BLEND:                  return OPENGL_STATE_BLEND;
+        case GL_DEPTH_TEST:             return OPENGL_STATE_DEPTH_TEST;
+        case GL_CULL_FACE:              return OPENGL_STATE_CULL_FACE;
+        case GL_SCISSOR_TEST:           return OPENGL_STATE_SCISSOR_TEST;
+        case GL_RASTERIZER_DISCARD:     return OPENGL_STATE_RASTERIZER_DISCARD;
+    }
+
+    return OPENGL_STATE_CAPABILITY_SLOT_COUNT;
+
+}
+
+static inline opengl_state_indexed_buffer*
+opengl_state_indexed_bindings(opengl_state_cache *cache, GLenum target, u32 index)
+{
+
+    if (index >= OPENGL_STATE_BUFFER_BINDINGS) return NULL;
+    if (target == GL_UNIFORM_BUFFER) return cache->uniform_bindings + index;
+    if (target == GL_SHADER_STORAGE_BUFFER) return cache->storage_bindings + index;
+    return NULL;
+
+}
+
+static inline GLuint*
+opengl_state_texture_bindings(opengl_state_cache *cache, GLenum target)
+{
+
+    if (target == GL_TEXTURE_2D) return cache->textures_2d;
+    if (target == GL_TEXTURE_2D_ARRAY) return cache->textures_2d_array;
+    return NULL;
+
+}
+
+// Counts a setter, returns true when it has to reach GL.
+static inline b32
+opengl_state_count(opengl_state_cache *cache, b32 changed)
+{
+
+    if (changed) cache->statistics.issued_calls++;
+    else cache->statistics.elided_calls++;
+    return changed;
+
+}
+
+static void
+opengl_state_set_capability(GLenum capability, u32 enabled)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    u32 slot = opengl_state_capability_slot_of(capability);
+    b32 changed = (slot == OPENGL_STATE_CAPABILITY_SLOT_COUNT || cache->capabilities[slot] != enabled);
+    if (!opengl_state_count(cache, changed)) return;
+
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    if (slot != OPENGL_STATE_CAPABILITY_SLOT_COUNT) cache->capabilities[slot] = enabled;
+
+}
+
+void
+opengl_state_begin_frame()
+{
+
+    opengl_state_statistics *statistics = &get_opengl_state_cache()->statistics;
+    statistics->frame_issued_calls = statistics->issued_calls;
+    statistics->frame_elided_calls = statistics->elided_calls;
+    statistics->issued_calls = 0;
+    statistics->elided_calls = 0;
+
+}
+
+void
+opengl_state_invalidate()
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    cache->program = OPENGL_STATE_UNKNOWN;
+    cache->vertex_array = OPENGL_STATE_UNKNOWN;
+    cache->active_texture_unit = OPENGL_STATE_UNKNOWN;
+    cache->blend_source_factor = OPENGL_STATE_UNKNOWN;
+    cache->blend_destination_factor = OPENGL_STATE_UNKNOWN;
+    cache->viewport_known = false;
+    cache->clear_color_known = false;
+
+    for (u32 i = 0; i < OPENGL_STATE_BUFFER_SLOT_COUNT; ++i)
+        cache->buffers[i] = OPENGL_STATE_UNKNOWN;
+
+    for (u32 i = 0; i < OPENGL_STATE_BUFFER_BINDINGS; ++i)
+    {
+        cache->uniform_bindings[i].buffer = OPENGL_STATE_UNKNOWN;
+        cache->storage_bindings[i].buffer = OPENGL_STATE_UNKNOWN;
+    }
+
+    for (u32 i = 0; i < OPENGL_STATE_TEXTURE_UNITS; ++i)
+    {
+        cache->textures_2d[i] = OPENGL_STATE_UNKNOWN;
+        cache->textures_2d_array[i] = OPENGL_STATE_UNKNOWN;
+    }
+
+    for (u32 i = 0; i < OPENGL_STATE_CAPABILITY_SLOT_COUNT; ++i)
+        cache->capabilities[i] = OPENGL_STATE_UNKNOWN;
+
+}
+
+void
+opengl_state_get_statistics(opengl_state_statistics *statistics)
+{
+
+    NX_ENSURE_POINTER(statistics);
+    *statistics = get_opengl_state_cache()->statistics;
+
+}
+
+void
+opengl_state_use_program(GLuint program)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    if (!opengl_state_count(cache, cache->program != program)) return;
+
+    glUseProgram(program);
+    cache->program = program;
+
+}
+
+void
+opengl_state_bind_vertex_array(GLuint vertex_array)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    if (!opengl_state_count(cache, cache->vertex_array != vertex_array)) return;
+
+    glBindVertexArray(vertex_array);
+    cache->vertex_array = vertex_array;
+
+    // The element array binding is part of the vertex array.
+    cache->buffers[OPENGL_STATE_ELEMENT_ARRAY_BUFFER] = OPENGL_STATE_UNKNOWN;
+
+}
+
+void
+opengl_state_bind_buffer(GLenum target, GLuint buffer)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    u32 slot = opengl_state_buffer_slot_of(target);
+    b32 changed = (slot == OPENGL_STATE_BUFFER_SLOT_COUNT || cache->buffers[slot] != buffer);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glBindBuffer(target, buffer);
+    if (slot != OPENGL_STATE_BUFFER_SLOT_COUNT) cache->buffers[slot] = buffer;
+
+}
+
+void
+opengl_state_bind_buffer_base(GLenum target, u32 index, GLuint buffer)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    opengl_state_indexed_buffer *binding = opengl_state_indexed_bindings(cache, target, index);
+    b32 changed = (binding == NULL || binding->buffer != buffer || binding->size != 0);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glBindBufferBase(target, index, buffer);
+    if (binding != NULL)
+    {
+        binding->buffer = buffer;
+        binding->offset = 0;
+        binding->size = 0;
+    }
+
+    // Binding an index binds the generic target too.
+    u32 slot = opengl_state_buffer_slot_of(target);
+    if (slot != OPENGL_STATE_BUFFER_SLOT_COUNT) cache->buffers[slot] = buffer;
+
+}
+
+void
+opengl_state_bind_buffer_range(GLenum target, u32 index, GLuint buffer, u64 offset, u64 size)
+{
+
+    NX_ASSERT(size > 0);
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    opengl_state_indexed_buffer *binding = opengl_state_indexed_bindings(cache, target, index);
+    b32 changed = (binding == NULL || binding->buffer != buffer ||
+            binding->offset != offset || binding->size != size);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glBindBufferRange(target, index, buffer, (GLintptr)offset, (GLsizeiptr)size);
+    if (binding != NULL)
+    {
+        binding->buffer = buffer;
+        binding->offset = offset;
+        binding->size = size;
+    }
+
+    u32 slot = opengl_state_buffer_slot_of(target);
+    if (slot != OPENGL_STATE_BUFFER_SLOT_COUNT) cache->buffers[slot] = buffer;
+
+}
+
+void
+opengl_state_bind_texture(u32 unit, GLenum target, GLuint texture)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    GLuint *bindings = opengl_state_texture_bindings(cache, target);
+    b32 tracked = (bindings != NULL && unit < OPENGL_STATE_TEXTURE_UNITS);
+    if (!opengl_state_count(cache, !tracked || bindings[unit] != texture)) return;
+
+    if (cache->active_texture_unit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        cache->active_texture_unit = unit;
+        cache->statistics.issued_calls++;
+    }
+
+    glBindTexture(target, texture);
+    if (tracked) bindings[unit] = texture;
+
+}
+
+void
+opengl_state_enable(GLenum capability)
+{
+
+    opengl_state_set_capability(capability, 1);
+
+}
+
+void
+opengl_state_disable(GLenum capability)
+{
+
+    opengl_state_set_capability(capability, 0);
+
+}
+
+void
+opengl_state_blend_func(GLenum source_factor, GLenum destination_factor)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    b32 changed = (cache->blend_source_factor != source_factor ||
+            cache->blend_destination_factor != destination_factor);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glBlendFunc(source_factor, destination_factor);
+    cache->blend_source_factor = source_factor;
+    cache->blend_destination_factor = destination_factor;
+
+}
+
+void
+opengl_state_viewport(i32 x, i32 y, i32 width, i32 height)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    i32 viewport[4] = { x, y, width, height };
+    b32 changed = (!cache->viewport_known || memcmp(cache->viewport, viewport, sizeof(viewport)) != 0);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glViewport(x, y, width, height);
+    memcpy(cache->viewport, viewport, sizeof(viewport));
+    cache->viewport_known = true;
+
+}
+
+void
+opengl_state_clear_color(r32 red, r32 green, r32 blue, r32 alpha)
+{
+
+    opengl_state_cache *cache = get_opengl_state_cache();
+    r32 color[4] = { red, green, blue, alpha };
+    b32 changed = (!cache->clear_color_known || memcmp(cache->clear_color, color, sizeof(color)) != 0);
+    if (!opengl_state_count(cache, changed)) return;
+
+    glClearColor(red, green, blue, alpha);
+    memcpy(cache->clear_color, color, sizeof(color));
+    cache->clear_color_known = true;
+
+}
+
+void
+opengl_state_delete_buffers(u32 count, GLuint *buffers)
+{
+
+    NX_ENSURE_POINTER(buffers);
+    opengl_state_cache *cache = get_opengl_state_cache();
+
+    // Deleting a buffer unbinds it from everything in this context.
+    for (u32 i = 0; i < count; ++i)
+    {
+
+        GLuint buffer = buffers[i];
+        if (buffer == 0) continue;
+
+        for (u32 slot = 0; slot < OPENGL_STATE_BUFFER_SLOT_COUNT; ++slot)
+            if (cache->buffers[slot] == buffer) cache->buffers[slot] = 0;
+
+        for (u32 index = 0; index < OPENGL_STATE_BUFFER_BINDINGS; ++index)
+        {
+            if (cache->uniform_bindings[index].buffer == buffer)
+                memset(cache->uniform_bindings + index, 0, sizeof(opengl_state_indexed_buffer));
+            if (cache->storage_bindings[index].buffer == buffer)
+                memset(cache->storage_bindings + index, 0, sizeof(opengl_state_indexed_buffer));
+        }
+
+    }
+
+    glDeleteBuffers((GLsizei)count, buffers);
+
+}
+
+void
+opengl_state_delete_vertex_arrays(u32 count, GLuint *vertex_arrays)
+{
+
+    NX_ENSURE_POINTER(vertex_arrays);
+    opengl_state_cache *cache = get_opengl_state_cache();
+
+    for (u32 i = 0; i < count; ++i)
+    {
+        if (vertex_arrays[i] != 0 && cache->vertex_array == vertex_arrays[i])
+        {
+            cache->vertex_array = 0;
+            cache->buffers[OPENGL_STATE_ELEMENT_ARRAY_BUFFER] = OPENGL_STATE_UNKNOWN;
+        }
+    }
+
+    glDeleteVertexArrays((GLsizei)count, vertex_arrays);
+
+}
 
 // --- Platform OpenGL ---------------------------------------------------------
 //
@@ -252,6 +1205,18 @@ render_context_check_last_error()
 
 }
 
+// WGL returns small sentinel values instead of NULL for missing functions.
+static vptr
+opengl_wgl_get_proc_address(ccptr name)
+{
+
+    PROC proc = wglGetProcAddress(name);
+    if (proc == (PROC)0 || proc == (PROC)1 || proc == (PROC)2 || proc == (PROC)3 || proc == (PROC)-1)
+        return NULL;
+    return (vptr)proc;
+
+}
+
 b32 
 create_opengl_render_context(vptr window_handle)
 {
@@ -300,6 +1265,10 @@ create_opengl_render_context(vptr window_handle)
 
     gladLoadGL();
     gladLoadWGL(device_context);
+    opengl_parallel_compile_initialize(opengl_wgl_get_proc_address);
+
+    // Nothing is known about the new context's state yet.
+    opengl_state_invalidate();
 
     // Finally, set our contexts.
     ctx->window_handle = (HWND)window_handle;
@@ -310,6 +1279,29 @@ create_opengl_render_context(vptr window_handle)
 
 }
 
+b32
+set_opengl_render_context_current(b32 current)
+{
+
+    opengl_context* ctx = get_opengl_context();
+    NX_ASSERT(ctx->render_context != NULL);
+
+    BOOL result;
+    if (current)
+        result = wglMakeCurrent(ctx->device_context, ctx->render_context);
+    else
+        result = wglMakeCurrent(NULL, NULL);
+
+    if (!result)
+    {
+        render_context_check_last_error();
+        return false;
+    }
+
+    return true;
+
+}
+
 b32
 set_opengl_vertical_sync(i32 interval)
 {
@@ -0,0 +1,239 @@
+// --- Software Rasterizer Test ------------------------------------------------
+//
+// Draws a fixed set of quads with the software quad rasterizer and compares the
+// result against a golden image, so quad rendering can be regression tested
+// without a window or a GL context.
+//
+//      rastertest <golden image> [--update]
+//
+// The quads and their texture are generated from a fixed seed. Half of them are
+// opaque and half alpha blended over those, with mirrored quads, quads hanging
+// off the edges and texture coordinates outside [0, 1] mixed in. The golden
+// image is an RGBA8 texture without mips in the texbake format; --update writes
+// it from the current output instead of comparing. A pixel fails when a channel
+// is more than RASTERTEST_TOLERANCE away, and the test fails when more than
+// RASTERTEST_FAILURE_RATE of the pixels do, since compilers may round the odd
+// edge pixel or texel differently. Returns 0 when the test passes.
+//
+// Nothing here is platform specific: files go through stdio and memory comes
+// from malloc, so the test also builds and runs on headless Linux CI.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <core/definitions.h>
+#include <core/linear.h>
+#include <core/arena.h>
+#include <core/jobs.h>
+
+#include <engine/texturebake.h>
+#include <engine/renderers/quadraster.h>
+
+#define RASTERTEST_WIDTH            256
+#define RASTERTEST_HEIGHT           144
+#define RASTERTEST_TEXTURE_SIZE     64
+#define RASTERTEST_QUAD_COUNT       2048
+#define RASTERTEST_TOLERANCE        2
+#define RASTERTEST_FAILURE_RATE     0.001
+
+static inline u64
+rastertest_random(u64 *seed)
+{
+
+    *seed = *seed * 6364136223846793005ULL + 1442695040888963407ULL;
+    return *seed >> 33;
+
+}
+
+static u64
+rastertest_read_file(ccptr path, memory_arena *arena, vptr *contents)
+{
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) return 0;
+
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+
+    u64 read = 0;
+    if (size > 0)
+    {
+        *contents = memory_arena_push(arena, (u64)size);
+        read = fread(*contents, 1, (u64)size, file);
+    }
+
+    fclose(file);
+    return (size > 0 && read == (u64)size) ? read : 0;
+
+}
+
+static b32
+rastertest_write_file(ccptr path, vptr contents, u64 size)
+{
+
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) return false;
+    u64 written = fwrite(contents, 1, size, file);
+    fclose(file);
+    return written == size;
+
+}
+
+static void
+rastertest_generate(image *texture, quad_layout *quads, u64 count)
+{
+
+    // Every texel differs from its neighbours, so a texel off shows up, and
+    // alpha covers the whole range.
+    u32 *texels = (u32*)texture->buffer;
+    for (u32 y = 0; y < texture->height; ++y)
+    {
+        for (u32 x = 0; x < texture->width; ++x)
+        {
+            u32 red = x * 4;
+            u32 green = y * 4;
+            u32 blue = ((x * 7) ^ (y * 13)) & 0xFF;
+            u32 alpha = ((x + y) * 2) & 0xFF;
+            texels[y * texture->width + x] = red | (green << 8) | (blue << 16) | (alpha << 24);
+        }
+    }
+
+    u64 seed = 0x853C49E6748FEA9BULL;
+    for (u64 i = 0; i < count; ++i)
+    {
+
+        quad_layout *quad = quads + i;
+        r32 scale_x = 4.0f + (r32)(rastertest_random(&seed) % 60) + 0.25f;
+        r32 scale_y = 4.0f + (r32)(rastertest_random(&seed) % 60) + 0.75f;
+        if (rastertest_random(&seed) % 8 == 0) scale_x = -scale_x;
+        if (rastertest_random(&seed) % 8 == 0) scale_y = -scale_y;
+
+        quad->transform.position    = { (r32)(rastertest_random(&seed) % (RASTERTEST_WIDTH + 80)) - 40.0f + 0.5f,
+                                        (r32)(rastertest_random(&seed) % (RASTERTEST_HEIGHT + 80)) - 40.0f + 0.3f };
+        quad->transform.scale       = { scale_x, scale_y };
+        quad->texture.offset        = { (r32)(rastertest_random(&seed) % 120) / 100.0f - 0.1f,
+                                        (r32)(rastertest_random(&seed) % 120) / 100.0f - 0.1f };
+        quad->texture.dimension     = { (r32)(rastertest_random(&seed) % 50) / 100.0f + 0.05f,
+                                        (r32)(rastertest_random(&seed) % 50) / 100.0f + 0.05f };
+
+    }
+
+}
+
+int
+main(int argc, char **argv)
+{
+
+    if (argc < 2)
+    {
+        printf("Usage: rastertest <golden image> [--update]\n");
+        return 1;
+    }
+
+    ccptr golden_path = argv[1];
+    b32 update = (argc > 2 && strcmp(argv[2], "--update") == 0);
+
+    u64 memory_size = NX_MEGABYTES(256);
+    vptr memory = calloc(1, memory_size);
+    if (memory == NULL) return 1;
+
+    memory_arena arena = {};
+    memory_arena_initialize(&arena, memory, memory_size);
+    jobs_initialize(0);
+
+    image texture = {};
+    texture.width = RASTERTEST_TEXTURE_SIZE;
+    texture.height = RASTERTEST_TEXTURE_SIZE;
+    texture.pitch = RASTERTEST_TEXTURE_SIZE * 4;
+    texture.bits_per_pixel = 32;
+    texture.buffer = memory_arena_push(&arena, (u64)texture.pitch * texture.height);
+
+    quad_layout *quads = memory_arena_push_array(&arena, quad_layout, RASTERTEST_QUAD_COUNT);
+    rastertest_generate(&texture, quads, RASTERTEST_QUAD_COUNT);
+
+    // A camera offset, so the view projection is more than the projection.
+    mat4 view_projection = orthographic_rh_no(0.0f, (r32)RASTERTEST_WIDTH, 0.0f, (r32)RASTERTEST_HEIGHT, -10.0f, 10.0f) *
+        translate({ -12.0f, 7.0f, 0.0f });
+
+    quad_rasterizer rasterizer;
+    quad_rasterizer_create(&rasterizer, &arena, RASTERTEST_WIDTH, RASTERTEST_HEIGHT, RASTERTEST_QUAD_COUNT);
+    quad_rasterizer_clear(&rasterizer, 0xFF402010);
+    quad_rasterizer_draw(&rasterizer, quads, RASTERTEST_QUAD_COUNT / 2, &texture,
+            &view_projection, QUAD_RASTER_OPAQUE);
+    quad_rasterizer_draw(&rasterizer, quads + RASTERTEST_QUAD_COUNT / 2, RASTERTEST_QUAD_COUNT / 2, &texture,
+            &view_projection, QUAD_RASTER_ALPHA);
+
+    if (update)
+    {
+
+        u64 output_size = texture_bake_file_size(RASTERTEST_WIDTH, RASTERTEST_HEIGHT, TEXTURE_BAKE_RGBA8, false);
+        vptr output = memory_arena_push(&arena, output_size);
+        u64 baked_size = texture_bake(&rasterizer.target, TEXTURE_BAKE_RGBA8, false, &arena, output, output_size);
+        if (baked_size == 0 || !rastertest_write_file(golden_path, output, baked_size))
+        {
+            printf("-- Unable to write %s.\n", golden_path);
+            return 1;
+        }
+
+        printf("-- Wrote the golden image to %s.\n", golden_path);
+        jobs_shutdown();
+        return 0;
+
+    }
+
+    vptr golden = NULL;
+    u64 golden_size = rastertest_read_file(golden_path, &arena, &golden);
+    if (golden_size == 0)
+    {
+        printf("-- Unable to read %s.\n", golden_path);
+        return 1;
+    }
+
+    texture_bake_header *header = texture_bake_parse(golden, golden_size);
+    if (header == NULL || header->format != TEXTURE_BAKE_RGBA8 ||
+        header->width != RASTERTEST_WIDTH || header->height != RASTERTEST_HEIGHT)
+    {
+        printf("-- %s isn't a %ux%u RGBA8 image.\n", golden_path, RASTERTEST_WIDTH, RASTERTEST_HEIGHT);
+        return 1;
+    }
+
+    // A pixel differs by its largest channel difference.
+    u32 *expected = (u32*)((u8*)golden + header->levels[0].offset);
+    u32 *actual = (u32*)rasterizer.target.buffer;
+    u64 pixel_count = (u64)RASTERTEST_WIDTH * RASTERTEST_HEIGHT;
+    u64 failed = 0;
+    u32 largest = 0;
+    for (u64 i = 0; i < pixel_count; ++i)
+    {
+
+        u32 difference = 0;
+        for (u32 shift = 0; shift < 32; shift += 8)
+        {
+            i32 channel = (i32)((actual[i] >> shift) & 0xFF) - (i32)((expected[i] >> shift) & 0xFF);
+            channel = (channel < 0) ? -channel : channel;
+            difference = ((u32)channel > difference) ? (u32)channel : difference;
+        }
+
+        if (difference > RASTERTEST_TOLERANCE && failed++ == 0)
+        {
+            printf("-- First failing pixel at (%llu, %llu): %08X, expected %08X.\n",
+                    (unsigned long long)(i % RASTERTEST_WIDTH), (unsigned long long)(i / RASTERTEST_WIDTH),
+                    actual[i], expected[i]);
+        }
+        largest = (difference > largest) ? difference : largest;
+
+    }
+
+    b32 passed = ((r64)failed <= (r64)pixel_count * RASTERTEST_FAILURE_RATE);
+    printf("-- %s: %llu of %llu pixels off by more than %u, at most %u, in %u passes.\n",
+            (passed) ? "Passed" : "Failed", (unsigned long long)failed,
+            (unsigned long long)pixel_count, RASTERTEST_TOLERANCE,
+            largest, rasterizer.passes);
+
+    jobs_shutdown();
+    return (passed) ? 0 : 1;
+
+}
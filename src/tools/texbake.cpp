@@ -0,0 +1,122 @@
+// --- Texture Baker -----------------------------------------------------------
+//
+// Bakes an image into the engine's texture format, mips and block compression
+// done ahead of time so the engine only reads and uploads, see texturebake.h.
+//
+//      texbake <source image> <output file> [bc7|bc3|bc1|rgba8] [--no-mips]
+//
+// BC7 is the default. The source is anything stb_image reads, loaded the same
+// way as the engine loads its PNGs, so the baked texture comes out the same way
+// up. The job system spreads the filtering and encoding over every core.
+//
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <core/definitions.h>
+#include <core/arena.h>
+#include <core/jobs.h>
+
+#include <platform/system.h>
+#include <platform/filesystem.h>
+
+#include <engine/texturebake.h>
+
+static b32
+texbake_parse_format(ccptr name, texture_bake_format *format)
+{
+
+    for (u32 i = 0; i < TEXTURE_BAKE_FORMAT_COUNT; ++i)
+    {
+        if (_stricmp(name, texture_bake_format_name((texture_bake_format)i)) == 0)
+        {
+            *format = (texture_bake_format)i;
+            return true;
+        }
+    }
+
+    return false;
+
+}
+
+int
+main(int argc, char **argv)
+{
+
+    if (argc < 3)
+    {
+        printf("Usage: texbake <source image> <output file> [bc7|bc3|bc1|rgba8] [--no-mips]\n");
+        return 1;
+    }
+
+    ccptr source_path = argv[1];
+    ccptr output_path = argv[2];
+    texture_bake_format format = TEXTURE_BAKE_BC7;
+    b32 mipmaps = true;
+    for (i32 i = 3; i < argc; ++i)
+    {
+        if (strcmp(argv[i], "--no-mips") == 0) mipmaps = false;
+        else if (!texbake_parse_format(argv[i], &format))
+        {
+            printf("-- Unknown option or format: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    u64 memory_size = NX_GIGABYTES(2);
+    vptr memory = system_virtual_alloc(NULL, memory_size);
+    if (memory == NULL) return 1;
+
+    memory_arena arena = {};
+    memory_arena_initialize(&arena, memory, memory_size);
+    jobs_initialize(0);
+
+    u64 load_begin = system_timestamp();
+    u64 source_size = file_image_size(source_path);
+    if (source_size == 0)
+    {
+        printf("-- Unable to read %s.\n", source_path);
+        return 1;
+    }
+
+    image source = {};
+    vptr source_buffer = memory_arena_push(&arena, source_size);
+    if (!file_image_load(source_path, &source, source_buffer, source_size))
+    {
+        printf("-- Unable to decode %s.\n", source_path);
+        return 1;
+    }
+    r64 load_milliseconds = system_timestamp_difference_ms(load_begin, system_timestamp());
+
+    u64 bake_begin = system_timestamp();
+    u64 output_size = texture_bake_file_size(source.width, source.height, format, mipmaps);
+    vptr output = memory_arena_push(&arena, output_size);
+    u64 baked_size = texture_bake(&source, format, mipmaps, &arena, output, output_size);
+    r64 bake_milliseconds = system_timestamp_difference_ms(bake_begin, system_timestamp());
+
+    if (baked_size == 0 || file_write_all(output_path, output, baked_size) != baked_size)
+    {
+        printf("-- Unable to write %s.\n", output_path);
+        return 1;
+    }
+
+    texture_bake_header *header = (texture_bake_header*)output;
+    printf("-- %s: %ux%u, %u levels of %s, %llu bytes against %llu uncompressed.\n",
+            output_path, source.width, source.height, header->level_count,
+            texture_bake_format_name(format), baked_size, source_size);
+    printf("-- Loading took %.2f ms, baking %.2f ms on %u threads.\n",
+            load_milliseconds, bake_milliseconds, jobs_worker_count());
+
+    jobs_shutdown();
+    return 0;
+
+}
+
+#include <platform/win32/system.cpp>
+#include <platform/win32/filesystem.cpp>
+
+#else
+#   error "Platform has not been defined."
+#endif